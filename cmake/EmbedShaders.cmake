@@ -0,0 +1,30 @@
+# Writes a C source holding each input as a u32 array, named by its path relative to BASE_DIR.
+# Usage: cmake -DOUTPUT=<file.c> -DBASE_DIR=<dir> -DINPUTS=<a|b|...> -P EmbedShaders.cmake
+
+string(REPLACE "|" ";" INPUTS "${INPUTS}")
+# CMake regular expressions have no {n} repetition, so one row of eight words is spelled out.
+string(REPEAT "0x........u, " 8 row)
+
+set(source "#include \"embedded_assets.h\"\n\n")
+set(table "")
+set(index 0)
+foreach (input IN LISTS INPUTS)
+    file(RELATIVE_PATH name ${BASE_DIR} ${input})
+    file(READ ${input} hex HEX)
+    string(LENGTH "${hex}" hex_length)
+    math(EXPR byte_length "${hex_length} / 2")
+    math(EXPR padding "(4 - ${byte_length} % 4) % 4")
+    while (padding GREATER 0)
+        string(APPEND hex "00")
+        math(EXPR padding "${padding} - 1")
+    endwhile ()
+    # SPIR-V words are stored little endian, which is also the byte order of every platform we target.
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " words "${hex}")
+    string(REGEX REPLACE "(${row})" "\\1\n        " words "${words}")
+    string(APPEND source "static const u32 embedded_asset_${index}[] = {\n        ${words}\n};\n\n")
+    string(APPEND table "        {\"${name}\", embedded_asset_${index}, ${byte_length}},\n")
+    math(EXPR index "${index} + 1")
+endforeach ()
+string(APPEND source "const EmbeddedAsset embedded_assets[] = {\n${table}};\n\n")
+string(APPEND source "const u32 embedded_asset_count = ${index};\n")
+file(WRITE ${OUTPUT} "${source}")
@@ -0,0 +1,99 @@
+#include "archive.h"
+#include "lz4.h"
+#include <errno.h>
+#include <string.h>
+
+bool archive_is_range_valid(const Archive *archive, u64 offset, u64 size) {
+    return offset <= archive->mapping.length && size <= archive->mapping.length - offset;
+}
+
+/* Everything the lookups rely on is checked once here, so a truncated or corrupt archive is rejected up front. */
+bool archive_is_valid(const Archive *archive) {
+    if (archive->mapping.length < sizeof(ArchiveHeader)) {
+        return false;
+    }
+    const ArchiveHeader *header = (const ArchiveHeader *) archive->mapping.data;
+    if (header->magic != ARCHIVE_MAGIC || header->version != ARCHIVE_VERSION || header->slotCount == 0 ||
+        (header->slotCount & (header->slotCount - 1)) != 0 || header->entryCount >= header->slotCount ||
+        header->slotsOffset % sizeof(u32) != 0 || header->entriesOffset % sizeof(u64) != 0 ||
+        !archive_is_range_valid(archive, header->slotsOffset, (u64) header->slotCount * sizeof(u32)) ||
+        !archive_is_range_valid(archive, header->entriesOffset, (u64) header->entryCount * sizeof(ArchiveEntry)) ||
+        !archive_is_range_valid(archive, header->namesOffset, header->namesSize)) {
+        return false;
+    }
+    const u32 *slots = (const u32 *) (archive->mapping.data + header->slotsOffset);
+    for (u32 i = 0; i < header->slotCount; i++) {
+        if (slots[i] != ARCHIVE_EMPTY_SLOT && slots[i] >= header->entryCount) {
+            return false;
+        }
+    }
+    const ArchiveEntry *entries = (const ArchiveEntry *) (archive->mapping.data + header->entriesOffset);
+    for (u32 i = 0; i < header->entryCount; i++) {
+        if ((u64) entries[i].nameOffset + entries[i].nameLength > header->namesSize ||
+            !archive_is_range_valid(archive, entries[i].offset, entries[i].size) ||
+            (!(entries[i].flags & ARCHIVE_ENTRY_LZ4) && entries[i].size != entries[i].originalSize)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int archive_open(const char *path, Archive *archive) {
+    memset(archive, 0, sizeof(Archive));
+    int status = file_map(path, FILE_ACCESS_NORMAL, &archive->mapping);
+    if (status != 0) {
+        return status;
+    }
+    if (!archive_is_valid(archive)) {
+        file_unmap(&archive->mapping);
+        return EINVAL;
+    }
+    archive->header = (const ArchiveHeader *) archive->mapping.data;
+    archive->slots = (const u32 *) (archive->mapping.data + archive->header->slotsOffset);
+    archive->entries = (const ArchiveEntry *) (archive->mapping.data + archive->header->entriesOffset);
+    archive->names = (const char *) (archive->mapping.data + archive->header->namesOffset);
+    return 0;
+}
+
+void archive_close(Archive *archive) {
+    file_unmap(&archive->mapping);
+    memset(archive, 0, sizeof(Archive));
+}
+
+const ArchiveEntry *archive_find(const Archive *archive, const char *name) {
+    if (archive->header == NULL) {
+        return NULL;
+    }
+    usize length = strlen(name);
+    u64 hash = archive_hash_name(name, length);
+    u32 mask = archive->header->slotCount - 1;
+    for (u32 i = 0, slot = (u32) hash & mask; i <= mask; i++, slot = (slot + 1) & mask) {
+        u32 index = archive->slots[slot];
+        if (index == ARCHIVE_EMPTY_SLOT) {
+            return NULL;
+        }
+        const ArchiveEntry *entry = &archive->entries[index];
+        if (entry->hash == hash && entry->nameLength == length &&
+            memcmp(archive->names + entry->nameOffset, name, length) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+const u8 *archive_get_data(const Archive *archive, const ArchiveEntry *entry) {
+    if (entry->flags & ARCHIVE_ENTRY_LZ4) {
+        return NULL;
+    }
+    return archive->mapping.data + entry->offset;
+}
+
+int archive_read(const Archive *archive, const ArchiveEntry *entry, u8 *data) {
+    const u8 *source = archive->mapping.data + entry->offset;
+    if (!(entry->flags & ARCHIVE_ENTRY_LZ4)) {
+        memcpy(data, source, entry->size);
+        return 0;
+    }
+    isize size = lz4_decompress(source, entry->size, data, entry->originalSize);
+    return size == (isize) entry->originalSize ? 0 : EINVAL;
+}
@@ -0,0 +1,69 @@
+#ifndef CGFS_ARCHIVE_H
+#define CGFS_ARCHIVE_H
+
+#include "file.h"
+
+#define ARCHIVE_MAGIC 0x41464743u
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_ALIGNMENT 64
+#define ARCHIVE_EMPTY_SLOT 0xFFFFFFFFu
+
+#define ARCHIVE_ENTRY_LZ4 1u
+
+/*
+ * Layout: header, hash slots, entries, names, then the blobs, each starting on a 64 byte boundary. The slot table
+ * has a power of two size and maps the FNV-1a hash of a name to its entry with linear probing.
+ */
+typedef struct archive_header_s {
+    u32 magic;
+    u32 version;
+    u32 entryCount;
+    u32 slotCount;
+    u64 slotsOffset;
+    u64 entriesOffset;
+    u64 namesOffset;
+    u64 namesSize;
+    u8 reserved[16];
+} ArchiveHeader;
+
+typedef struct archive_entry_s {
+    u64 hash;
+    u64 offset;
+    u64 size;
+    u64 originalSize;
+    u32 nameOffset;
+    u32 nameLength;
+    u32 flags;
+    u32 reserved;
+} ArchiveEntry;
+
+typedef struct archive_s {
+    FileMapping mapping;
+    const ArchiveHeader *header;
+    const u32 *slots;
+    const ArchiveEntry *entries;
+    const char *names;
+} Archive;
+
+static inline u64 archive_hash_name(const char *name, usize length) {
+    u64 hash = 0xcbf29ce484222325ull;
+    for (usize i = 0; i < length; i++) {
+        hash ^= (u8) name[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+int archive_open(const char *path, Archive *archive);
+
+void archive_close(Archive *archive);
+
+const ArchiveEntry *archive_find(const Archive *archive, const char *name);
+
+/* Points into the mapping for uncompressed entries and returns NULL for compressed ones. */
+const u8 *archive_get_data(const Archive *archive, const ArchiveEntry *entry);
+
+/* Copies or decompresses the entry into data, which must hold entry->originalSize bytes. */
+int archive_read(const Archive *archive, const ArchiveEntry *entry, u8 *data);
+
+#endif //CGFS_ARCHIVE_H
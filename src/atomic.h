@@ -0,0 +1,259 @@
+#ifndef CGFS_ATOMIC_H
+#define CGFS_ATOMIC_H
+
+#include "types.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+
+#define ATOMIC_RELAXED __ATOMIC_RELAXED
+#define ATOMIC_ACQUIRE __ATOMIC_ACQUIRE
+#define ATOMIC_RELEASE __ATOMIC_RELEASE
+#define ATOMIC_ACQ_REL __ATOMIC_ACQ_REL
+#define ATOMIC_SEQ_CST __ATOMIC_SEQ_CST
+
+#if defined(__i386__) || defined(__x86_64__)
+#define atomic_pause() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define atomic_pause() __asm__ __volatile__("yield")
+#else
+#define atomic_pause() ((void) 0)
+#endif
+
+#define atomic_fence(order) __atomic_thread_fence(order)
+
+static inline i32 atomic_load_i32(const volatile i32 *address, int order) {
+    return __atomic_load_n(address, order);
+}
+
+static inline void atomic_store_i32(volatile i32 *address, i32 value, int order) {
+    __atomic_store_n(address, value, order);
+}
+
+static inline i32 atomic_exchange_i32(volatile i32 *address, i32 value, int order) {
+    return __atomic_exchange_n(address, value, order);
+}
+
+static inline bool atomic_compare_exchange_i32(volatile i32 *address, i32 *expected, i32 desired, int success,
+                                               int failure) {
+    return __atomic_compare_exchange_n(address, expected, desired, false, success, failure);
+}
+
+static inline i32 atomic_fetch_add_i32(volatile i32 *address, i32 value, int order) {
+    return __atomic_fetch_add(address, value, order);
+}
+
+static inline i64 atomic_load_i64(const volatile i64 *address, int order) {
+    return __atomic_load_n(address, order);
+}
+
+static inline void atomic_store_i64(volatile i64 *address, i64 value, int order) {
+    __atomic_store_n(address, value, order);
+}
+
+static inline i64 atomic_exchange_i64(volatile i64 *address, i64 value, int order) {
+    return __atomic_exchange_n(address, value, order);
+}
+
+static inline bool atomic_compare_exchange_i64(volatile i64 *address, i64 *expected, i64 desired, int success,
+                                               int failure) {
+    return __atomic_compare_exchange_n(address, expected, desired, false, success, failure);
+}
+
+static inline i64 atomic_fetch_add_i64(volatile i64 *address, i64 value, int order) {
+    return __atomic_fetch_add(address, value, order);
+}
+
+static inline void *atomic_load_ptr(void *const volatile *address, int order) {
+    return __atomic_load_n(address, order);
+}
+
+static inline void atomic_store_ptr(void *volatile *address, void *value, int order) {
+    __atomic_store_n(address, value, order);
+}
+
+static inline void *atomic_exchange_ptr(void *volatile *address, void *value, int order) {
+    return __atomic_exchange_n(address, value, order);
+}
+
+static inline bool atomic_compare_exchange_ptr(void *volatile *address, void **expected, void *desired, int success,
+                                               int failure) {
+    return __atomic_compare_exchange_n(address, expected, desired, false, success, failure);
+}
+
+#elif defined(_MSC_VER)
+
+#include <intrin.h>
+
+/*
+ * MSVC has no C99 atomics, so every read-modify-write maps to an Interlocked intrinsic, which is a full barrier.
+ * Plain loads and stores go through __iso_volatile accesses, which never tear, and get their ordering from explicit
+ * barriers instead of from /volatile:ms: on x86 and x64 the hardware already orders them, so only the compiler must
+ * be kept from reordering, while ARM64 needs a dmb on the acquire or release side. x86 has no 64-bit loads or stores
+ * outside of cmpxchg8b, so its i64 operations are built on _InterlockedCompareExchange64.
+ */
+#define ATOMIC_RELAXED 0
+#define ATOMIC_ACQUIRE 2
+#define ATOMIC_RELEASE 3
+#define ATOMIC_ACQ_REL 4
+#define ATOMIC_SEQ_CST 5
+
+#if defined(_M_IX86) || defined(_M_X64)
+#define atomic_pause() _mm_pause()
+#define ATOMIC_FULL_FENCE() _mm_mfence()
+#define ATOMIC_ORDER_FENCE() _ReadWriteBarrier()
+#elif defined(_M_ARM64)
+#define atomic_pause() __yield()
+#define ATOMIC_FULL_FENCE() __dmb(_ARM64_BARRIER_ISH)
+#define ATOMIC_ORDER_FENCE() __dmb(_ARM64_BARRIER_ISH)
+#else
+#error "atomic.h supports MSVC on x86, x64 and ARM64 only"
+#endif
+
+#define atomic_fence(order) \
+    ((order) == ATOMIC_SEQ_CST ? ATOMIC_FULL_FENCE() : (order) != ATOMIC_RELAXED ? ATOMIC_ORDER_FENCE() : (void) 0)
+
+static __forceinline void atomic_fence_after_load(int order) {
+    if (order != ATOMIC_RELAXED) {
+        ATOMIC_ORDER_FENCE();
+    }
+}
+
+static __forceinline void atomic_fence_before_store(int order) {
+    if (order != ATOMIC_RELAXED) {
+        ATOMIC_ORDER_FENCE();
+    }
+}
+
+static __forceinline void atomic_fence_after_store(int order) {
+    if (order == ATOMIC_SEQ_CST) {
+        ATOMIC_FULL_FENCE();
+    }
+}
+
+static __forceinline i32 atomic_load_i32(const volatile i32 *address, int order) {
+    i32 value = __iso_volatile_load32((const volatile __int32 *) address);
+    atomic_fence_after_load(order);
+    return value;
+}
+
+static __forceinline void atomic_store_i32(volatile i32 *address, i32 value, int order) {
+    atomic_fence_before_store(order);
+    __iso_volatile_store32((volatile __int32 *) address, value);
+    atomic_fence_after_store(order);
+}
+
+static __forceinline i32 atomic_exchange_i32(volatile i32 *address, i32 value, int order) {
+    return _InterlockedExchange((volatile long *) address, value);
+}
+
+static __forceinline bool atomic_compare_exchange_i32(volatile i32 *address, i32 *expected, i32 desired, int success,
+                                                      int failure) {
+    i32 previous = _InterlockedCompareExchange((volatile long *) address, desired, *expected);
+    if (previous == *expected) {
+        return true;
+    }
+    *expected = previous;
+    return false;
+}
+
+static __forceinline i32 atomic_fetch_add_i32(volatile i32 *address, i32 value, int order) {
+    return _InterlockedExchangeAdd((volatile long *) address, value);
+}
+
+static __forceinline bool atomic_compare_exchange_i64(volatile i64 *address, i64 *expected, i64 desired, int success,
+                                                      int failure) {
+    i64 previous = _InterlockedCompareExchange64(address, desired, *expected);
+    if (previous == *expected) {
+        return true;
+    }
+    *expected = previous;
+    return false;
+}
+
+#ifdef _M_IX86
+
+static __forceinline i64 atomic_load_i64(const volatile i64 *address, int order) {
+    return _InterlockedCompareExchange64((volatile i64 *) address, 0, 0);
+}
+
+static __forceinline i64 atomic_exchange_i64(volatile i64 *address, i64 value, int order) {
+    i64 previous = *address;
+    while (!atomic_compare_exchange_i64(address, &previous, value, order, ATOMIC_RELAXED)) {
+    }
+    return previous;
+}
+
+static __forceinline void atomic_store_i64(volatile i64 *address, i64 value, int order) {
+    atomic_exchange_i64(address, value, order);
+}
+
+static __forceinline i64 atomic_fetch_add_i64(volatile i64 *address, i64 value, int order) {
+    i64 previous = *address;
+    while (!atomic_compare_exchange_i64(address, &previous, previous + value, order, ATOMIC_RELAXED)) {
+    }
+    return previous;
+}
+
+#else
+
+static __forceinline i64 atomic_load_i64(const volatile i64 *address, int order) {
+    i64 value = __iso_volatile_load64((const volatile __int64 *) address);
+    atomic_fence_after_load(order);
+    return value;
+}
+
+static __forceinline void atomic_store_i64(volatile i64 *address, i64 value, int order) {
+    atomic_fence_before_store(order);
+    __iso_volatile_store64((volatile __int64 *) address, value);
+    atomic_fence_after_store(order);
+}
+
+static __forceinline i64 atomic_exchange_i64(volatile i64 *address, i64 value, int order) {
+    return _InterlockedExchange64(address, value);
+}
+
+static __forceinline i64 atomic_fetch_add_i64(volatile i64 *address, i64 value, int order) {
+    return _InterlockedExchangeAdd64(address, value);
+}
+
+#endif
+
+static __forceinline void *atomic_load_ptr(void *const volatile *address, int order) {
+#ifdef _M_IX86
+    void *value = (void *) (usize) __iso_volatile_load32((const volatile __int32 *) address);
+#else
+    void *value = (void *) __iso_volatile_load64((const volatile __int64 *) address);
+#endif
+    atomic_fence_after_load(order);
+    return value;
+}
+
+static __forceinline void atomic_store_ptr(void *volatile *address, void *value, int order) {
+    atomic_fence_before_store(order);
+#ifdef _M_IX86
+    __iso_volatile_store32((volatile __int32 *) address, (__int32) (usize) value);
+#else
+    __iso_volatile_store64((volatile __int64 *) address, (__int64) value);
+#endif
+    atomic_fence_after_store(order);
+}
+
+static __forceinline void *atomic_exchange_ptr(void *volatile *address, void *value, int order) {
+    return _InterlockedExchangePointer(address, value);
+}
+
+static __forceinline bool atomic_compare_exchange_ptr(void *volatile *address, void **expected, void *desired,
+                                                      int success, int failure) {
+    void *previous = _InterlockedCompareExchangePointer(address, desired, *expected);
+    if (previous == *expected) {
+        return true;
+    }
+    *expected = previous;
+    return false;
+}
+
+#else
+#error "Unsupported compiler for atomic.h"
+#endif
+
+#endif //CGFS_ATOMIC_H
@@ -0,0 +1,451 @@
+#include <float.h>
+#include <stdlib.h>
+#include "bvh.h"
+#include "atomic.h"
+#include "job.h"
+
+#define BVH_BIN_COUNT 16
+#define BVH_MAX_LEAF_SIZE 8
+#define BVH_PARALLEL_THRESHOLD 4096
+#define BVH_TRAVERSAL_COST 1.0f
+#define BVH_INTERSECTION_COST 1.0f
+#define BVH_STACK_SIZE 64
+#define BVH_MAX_DEPTH BVH_STACK_SIZE
+#define BVH_DETERMINANT_EPSILON 1e-16f
+
+typedef struct bvh_build_s {
+    Bvh *bvh;
+    const Vec3 *boundsMin;
+    const Vec3 *boundsMax;
+    Vec3 *centroids;
+    i32 nodeCount;
+    JobCounter counter;
+} BvhBuild;
+
+typedef struct bvh_build_task_s {
+    BvhBuild *build;
+    u32 node;
+    u32 depth;
+} BvhBuildTask;
+
+typedef struct bvh_bin_s {
+    Vec3 boundsMin;
+    Vec3 boundsMax;
+    u32 count;
+} BvhBin;
+
+typedef float (*BvhIntersectFunction)(const void *primitives, u32 index, Vec3 origin, Vec3 direction, float tMin,
+                                      float tMax);
+
+float bvh_get_surface_area(Vec3 boundsMin, Vec3 boundsMax) {
+    Vec3 extent = vec3_sub(boundsMax, boundsMin);
+    if (extent.x < 0.0f) {
+        return 0.0f;
+    }
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+float bvh_get_axis(Vec3 v, u32 axis) {
+    return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+void bvh_set_node_bounds(BvhNode *node, Vec3 boundsMin, Vec3 boundsMax) {
+    node->boundsMin[0] = boundsMin.x;
+    node->boundsMin[1] = boundsMin.y;
+    node->boundsMin[2] = boundsMin.z;
+    node->boundsMax[0] = boundsMax.x;
+    node->boundsMax[1] = boundsMax.y;
+    node->boundsMax[2] = boundsMax.z;
+}
+
+void bvh_build_node(BvhBuild *build, u32 nodeIndex, u32 depth);
+
+void bvh_build_node_job(void *arg) {
+    BvhBuildTask *task = arg;
+    bvh_build_node(task->build, task->node, task->depth);
+    free(task);
+}
+
+void bvh_build_child(BvhBuild *build, u32 nodeIndex, u32 depth) {
+    if (build->bvh->nodes[nodeIndex].count > BVH_PARALLEL_THRESHOLD) {
+        BvhBuildTask *task = malloc(sizeof(BvhBuildTask));
+        if (task != NULL) {
+            task->build = build;
+            task->node = nodeIndex;
+            task->depth = depth;
+            job_run(bvh_build_node_job, task, &build->counter);
+            return;
+        }
+    }
+    bvh_build_node(build, nodeIndex, depth);
+}
+
+/*
+ * Binned SAH: centroids are dropped into BVH_BIN_COUNT bins per axis and every bin boundary is evaluated as a split
+ * plane. Large subtrees are handed to the job system as soon as their range is partitioned, so the build fans out
+ * across worker threads after the first few levels. Nodes at BVH_MAX_DEPTH become leaves whatever their size, which
+ * bounds the traversal stack.
+ */
+void bvh_build_node(BvhBuild *build, u32 nodeIndex, u32 depth) {
+    Bvh *bvh = build->bvh;
+    BvhNode *node = &bvh->nodes[nodeIndex];
+    u32 first = node->leftFirst;
+    u32 count = node->count;
+    u32 *indices = bvh->primitiveIndices + first;
+
+    Vec3 boundsMin = vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vec3 boundsMax = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    Vec3 centroidMin = boundsMin;
+    Vec3 centroidMax = boundsMax;
+    for (u32 i = 0; i < count; i++) {
+        u32 primitive = indices[i];
+        boundsMin = vec3_min(boundsMin, build->boundsMin[primitive]);
+        boundsMax = vec3_max(boundsMax, build->boundsMax[primitive]);
+        centroidMin = vec3_min(centroidMin, build->centroids[primitive]);
+        centroidMax = vec3_max(centroidMax, build->centroids[primitive]);
+    }
+    bvh_set_node_bounds(node, boundsMin, boundsMax);
+    if (count <= 2 || depth >= BVH_MAX_DEPTH) {
+        return;
+    }
+
+    float bestCost = FLT_MAX;
+    u32 bestAxis = 0;
+    u32 bestSplit = 0;
+    float bestScale = 0.0f;
+    for (u32 axis = 0; axis < 3; axis++) {
+        float axisMin = bvh_get_axis(centroidMin, axis);
+        float extent = bvh_get_axis(centroidMax, axis) - axisMin;
+        if (extent <= 0.0f) {
+            continue;
+        }
+        float scale = (float) BVH_BIN_COUNT / extent;
+        BvhBin bins[BVH_BIN_COUNT];
+        for (u32 i = 0; i < BVH_BIN_COUNT; i++) {
+            bins[i].boundsMin = vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+            bins[i].boundsMax = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            bins[i].count = 0;
+        }
+        for (u32 i = 0; i < count; i++) {
+            u32 primitive = indices[i];
+            u32 bin = (u32) ((bvh_get_axis(build->centroids[primitive], axis) - axisMin) * scale);
+            if (bin >= BVH_BIN_COUNT) {
+                bin = BVH_BIN_COUNT - 1;
+            }
+            bins[bin].boundsMin = vec3_min(bins[bin].boundsMin, build->boundsMin[primitive]);
+            bins[bin].boundsMax = vec3_max(bins[bin].boundsMax, build->boundsMax[primitive]);
+            bins[bin].count++;
+        }
+        float leftArea[BVH_BIN_COUNT - 1];
+        u32 leftCount[BVH_BIN_COUNT - 1];
+        Vec3 sweepMin = vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+        Vec3 sweepMax = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        u32 sweepCount = 0;
+        for (u32 i = 0; i < BVH_BIN_COUNT - 1; i++) {
+            sweepMin = vec3_min(sweepMin, bins[i].boundsMin);
+            sweepMax = vec3_max(sweepMax, bins[i].boundsMax);
+            sweepCount += bins[i].count;
+            leftArea[i] = bvh_get_surface_area(sweepMin, sweepMax);
+            leftCount[i] = sweepCount;
+        }
+        sweepMin = vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+        sweepMax = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        sweepCount = 0;
+        for (u32 i = BVH_BIN_COUNT - 1; i > 0; i--) {
+            sweepMin = vec3_min(sweepMin, bins[i].boundsMin);
+            sweepMax = vec3_max(sweepMax, bins[i].boundsMax);
+            sweepCount += bins[i].count;
+            if (leftCount[i - 1] == 0 || sweepCount == 0) {
+                continue;
+            }
+            float cost = leftArea[i - 1] * (float) leftCount[i - 1] +
+                         bvh_get_surface_area(sweepMin, sweepMax) * (float) sweepCount;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+                bestScale = scale;
+            }
+        }
+    }
+    if (bestCost == FLT_MAX) {
+        return;
+    }
+    float area = bvh_get_surface_area(boundsMin, boundsMax);
+    float splitCost = BVH_TRAVERSAL_COST + BVH_INTERSECTION_COST * bestCost / area;
+    float leafCost = BVH_INTERSECTION_COST * (float) count;
+    if (splitCost >= leafCost && count <= BVH_MAX_LEAF_SIZE) {
+        return;
+    }
+
+    float axisMin = bvh_get_axis(centroidMin, bestAxis);
+    u32 left = 0;
+    u32 right = count;
+    while (left < right) {
+        u32 bin = (u32) ((bvh_get_axis(build->centroids[indices[left]], bestAxis) - axisMin) * bestScale);
+        if (bin >= BVH_BIN_COUNT) {
+            bin = BVH_BIN_COUNT - 1;
+        }
+        if (bin < bestSplit) {
+            left++;
+        } else {
+            right--;
+            u32 swap = indices[left];
+            indices[left] = indices[right];
+            indices[right] = swap;
+        }
+    }
+    if (left == 0 || left == count) {
+        return;
+    }
+    u32 children = (u32) atomic_fetch_add_i32(&build->nodeCount, 2, ATOMIC_RELAXED);
+    bvh->nodes[children].leftFirst = first;
+    bvh->nodes[children].count = left;
+    bvh->nodes[children + 1].leftFirst = first + left;
+    bvh->nodes[children + 1].count = count - left;
+    node->leftFirst = children;
+    node->count = 0;
+    bvh_build_child(build, children, depth + 1);
+    bvh_build_child(build, children + 1, depth + 1);
+}
+
+/*
+ * Builds over arbitrary primitives given only their bounds. A BVH of n primitives never needs more than 2n - 1
+ * nodes, so the node array is allocated once up front and children are claimed with an atomic bump.
+ */
+int bvh_build(Bvh *bvh, const Vec3 *bounds_min, const Vec3 *bounds_max, u32 count) {
+    bvh->nodes = NULL;
+    bvh->nodeCount = 0;
+    bvh->primitiveIndices = NULL;
+    bvh->primitiveCount = count;
+    if (count == 0) {
+        return 0;
+    }
+    BvhBuild build;
+    build.bvh = bvh;
+    build.boundsMin = bounds_min;
+    build.boundsMax = bounds_max;
+    build.centroids = malloc(sizeof(Vec3) * count);
+    bvh->nodes = malloc(sizeof(BvhNode) * (count * 2 - 1));
+    bvh->primitiveIndices = malloc(sizeof(u32) * count);
+    if (build.centroids == NULL || bvh->nodes == NULL || bvh->primitiveIndices == NULL) {
+        free(build.centroids);
+        bvh_destroy(bvh);
+        return -1;
+    }
+    for (u32 i = 0; i < count; i++) {
+        build.centroids[i] = vec3_scale(vec3_add(bounds_min[i], bounds_max[i]), 0.5f);
+        bvh->primitiveIndices[i] = i;
+    }
+    bvh->nodes[0].leftFirst = 0;
+    bvh->nodes[0].count = count;
+    build.nodeCount = 1;
+    job_counter_init(&build.counter);
+    bvh_build_node(&build, 0, 0);
+    job_wait(&build.counter);
+    bvh->nodeCount = (u32) build.nodeCount;
+    free(build.centroids);
+    BvhNode *nodes = realloc(bvh->nodes, sizeof(BvhNode) * bvh->nodeCount);
+    if (nodes != NULL) {
+        bvh->nodes = nodes;
+    }
+    return 0;
+}
+
+/*
+ * Children are always allocated after their parent, so a single reverse sweep over the node array visits every
+ * child before the node that contains it. The topology is kept, which stays fast as long as objects move coherently;
+ * rebuild once traversal cost drifts too far.
+ */
+void bvh_refit(Bvh *bvh, const Vec3 *bounds_min, const Vec3 *bounds_max) {
+    for (u32 i = bvh->nodeCount; i-- > 0;) {
+        BvhNode *node = &bvh->nodes[i];
+        Vec3 boundsMin;
+        Vec3 boundsMax;
+        if (node->count > 0) {
+            boundsMin = vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+            boundsMax = vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+            for (u32 j = 0; j < node->count; j++) {
+                u32 primitive = bvh->primitiveIndices[node->leftFirst + j];
+                boundsMin = vec3_min(boundsMin, bounds_min[primitive]);
+                boundsMax = vec3_max(boundsMax, bounds_max[primitive]);
+            }
+        } else {
+            const BvhNode *left = &bvh->nodes[node->leftFirst];
+            const BvhNode *right = left + 1;
+            boundsMin = vec3_min(vec3(left->boundsMin[0], left->boundsMin[1], left->boundsMin[2]),
+                                 vec3(right->boundsMin[0], right->boundsMin[1], right->boundsMin[2]));
+            boundsMax = vec3_max(vec3(left->boundsMax[0], left->boundsMax[1], left->boundsMax[2]),
+                                 vec3(right->boundsMax[0], right->boundsMax[1], right->boundsMax[2]));
+        }
+        bvh_set_node_bounds(node, boundsMin, boundsMax);
+    }
+}
+
+void bvh_destroy(Bvh *bvh) {
+    free(bvh->nodes);
+    free(bvh->primitiveIndices);
+    bvh->nodes = NULL;
+    bvh->primitiveIndices = NULL;
+    bvh->nodeCount = 0;
+    bvh->primitiveCount = 0;
+}
+
+usize bvh_get_memory_size(const Bvh *bvh) {
+    return sizeof(BvhNode) * bvh->nodeCount + sizeof(u32) * bvh->primitiveCount;
+}
+
+void bvh_get_triangle_bounds(const TriangleSoa *triangles, Vec3 *bounds_min, Vec3 *bounds_max) {
+    for (u32 i = 0; i < triangles->count; i++) {
+        Vec3 v0 = vec3(triangles->v0X[i], triangles->v0Y[i], triangles->v0Z[i]);
+        Vec3 v1 = vec3_add(v0, vec3(triangles->edge1X[i], triangles->edge1Y[i], triangles->edge1Z[i]));
+        Vec3 v2 = vec3_add(v0, vec3(triangles->edge2X[i], triangles->edge2Y[i], triangles->edge2Z[i]));
+        bounds_min[i] = vec3_min(v0, vec3_min(v1, v2));
+        bounds_max[i] = vec3_max(v0, vec3_max(v1, v2));
+    }
+}
+
+void bvh_get_sphere_bounds(const SphereSoa *spheres, Vec3 *bounds_min, Vec3 *bounds_max) {
+    for (u32 i = 0; i < spheres->count; i++) {
+        Vec3 center = vec3(spheres->centerX[i], spheres->centerY[i], spheres->centerZ[i]);
+        Vec3 radius = vec3(spheres->radius[i], spheres->radius[i], spheres->radius[i]);
+        bounds_min[i] = vec3_sub(center, radius);
+        bounds_max[i] = vec3_add(center, radius);
+    }
+}
+
+float bvh_intersect_triangle(const void *primitives, u32 index, Vec3 origin, Vec3 direction, float tMin,
+                             float tMax) {
+    const TriangleSoa *triangles = primitives;
+    Vec3 edge1 = vec3(triangles->edge1X[index], triangles->edge1Y[index], triangles->edge1Z[index]);
+    Vec3 edge2 = vec3(triangles->edge2X[index], triangles->edge2Y[index], triangles->edge2Z[index]);
+    Vec3 p = vec3_cross(direction, edge2);
+    float determinant = vec3_dot(edge1, p);
+    if (determinant * determinant <= BVH_DETERMINANT_EPSILON) {
+        return FLT_MAX;
+    }
+    float inverseDeterminant = 1.0f / determinant;
+    Vec3 t = vec3_sub(origin, vec3(triangles->v0X[index], triangles->v0Y[index], triangles->v0Z[index]));
+    float u = vec3_dot(t, p) * inverseDeterminant;
+    if (u < 0.0f || u > 1.0f) {
+        return FLT_MAX;
+    }
+    Vec3 q = vec3_cross(t, edge1);
+    float v = vec3_dot(direction, q) * inverseDeterminant;
+    if (v < 0.0f || u + v > 1.0f) {
+        return FLT_MAX;
+    }
+    float distance = vec3_dot(edge2, q) * inverseDeterminant;
+    return distance > tMin && distance < tMax ? distance : FLT_MAX;
+}
+
+float bvh_intersect_sphere(const void *primitives, u32 index, Vec3 origin, Vec3 direction, float tMin,
+                           float tMax) {
+    const SphereSoa *spheres = primitives;
+    Vec3 oc = vec3_sub(origin, vec3(spheres->centerX[index], spheres->centerY[index], spheres->centerZ[index]));
+    float a = vec3_dot(direction, direction);
+    float halfB = vec3_dot(oc, direction);
+    float c = vec3_dot(oc, oc) - spheres->radius[index] * spheres->radius[index];
+    float discriminant = halfB * halfB - a * c;
+    if (discriminant <= 0.0f) {
+        return FLT_MAX;
+    }
+    float root = sqrtf(discriminant);
+    float t = (-halfB - root) / a;
+    if (t <= tMin) {
+        t = (-halfB + root) / a;
+    }
+    return t > tMin && t < tMax ? t : FLT_MAX;
+}
+
+float bvh_min(float a, float b) {
+    return a < b ? a : b;
+}
+
+float bvh_max(float a, float b) {
+    return a > b ? a : b;
+}
+
+float bvh_intersect_node(const BvhNode *node, Vec3 origin, Vec3 inverseDirection, float tMin, float tMax) {
+    float t0 = (node->boundsMin[0] - origin.x) * inverseDirection.x;
+    float t1 = (node->boundsMax[0] - origin.x) * inverseDirection.x;
+    float tNear = bvh_max(tMin, bvh_min(t0, t1));
+    float tFar = bvh_min(tMax, bvh_max(t0, t1));
+    t0 = (node->boundsMin[1] - origin.y) * inverseDirection.y;
+    t1 = (node->boundsMax[1] - origin.y) * inverseDirection.y;
+    tNear = bvh_max(tNear, bvh_min(t0, t1));
+    tFar = bvh_min(tFar, bvh_max(t0, t1));
+    t0 = (node->boundsMin[2] - origin.z) * inverseDirection.z;
+    t1 = (node->boundsMax[2] - origin.z) * inverseDirection.z;
+    tNear = bvh_max(tNear, bvh_min(t0, t1));
+    tFar = bvh_min(tFar, bvh_max(t0, t1));
+    return tNear <= tFar ? tNear : FLT_MAX;
+}
+
+/*
+ * Stack traversal that descends into the nearer child first and skips any subtree whose entry distance is already
+ * beyond the closest hit.
+ */
+u32 bvh_intersect(const Bvh *bvh, const void *primitives, BvhIntersectFunction intersect, Vec3 origin,
+                  Vec3 direction, float tMin, float *tMax) {
+    if (bvh->nodeCount == 0) {
+        return RAY_PACKET_NO_HIT;
+    }
+    Vec3 inverseDirection = vec3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    u32 hit = RAY_PACKET_NO_HIT;
+    u32 stack[BVH_STACK_SIZE];
+    u32 stackSize = 0;
+    if (bvh_intersect_node(&bvh->nodes[0], origin, inverseDirection, tMin, *tMax) == FLT_MAX) {
+        return hit;
+    }
+    u32 nodeIndex = 0;
+    for (;;) {
+        const BvhNode *node = &bvh->nodes[nodeIndex];
+        if (node->count > 0) {
+            for (u32 i = 0; i < node->count; i++) {
+                u32 primitive = bvh->primitiveIndices[node->leftFirst + i];
+                float t = intersect(primitives, primitive, origin, direction, tMin, *tMax);
+                if (t < *tMax) {
+                    *tMax = t;
+                    hit = primitive;
+                }
+            }
+        } else {
+            u32 near = node->leftFirst;
+            u32 far = near + 1;
+            float tNear = bvh_intersect_node(&bvh->nodes[near], origin, inverseDirection, tMin, *tMax);
+            float tFar = bvh_intersect_node(&bvh->nodes[far], origin, inverseDirection, tMin, *tMax);
+            if (tFar < tNear) {
+                float swapT = tNear;
+                tNear = tFar;
+                tFar = swapT;
+                u32 swap = near;
+                near = far;
+                far = swap;
+            }
+            if (tNear != FLT_MAX) {
+                /* At most one entry per level above this node, and the build stops at BVH_MAX_DEPTH. */
+                if (tFar != FLT_MAX) {
+                    stack[stackSize++] = far;
+                }
+                nodeIndex = near;
+                continue;
+            }
+        }
+        if (stackSize == 0) {
+            break;
+        }
+        nodeIndex = stack[--stackSize];
+    }
+    return hit;
+}
+
+u32 bvh_intersect_triangles(const Bvh *bvh, const TriangleSoa *triangles, Vec3 origin, Vec3 direction,
+                            float t_min, float *t_max) {
+    return bvh_intersect(bvh, triangles, bvh_intersect_triangle, origin, direction, t_min, t_max);
+}
+
+u32 bvh_intersect_spheres(const Bvh *bvh, const SphereSoa *spheres, Vec3 origin, Vec3 direction, float t_min,
+                          float *t_max) {
+    return bvh_intersect(bvh, spheres, bvh_intersect_sphere, origin, direction, t_min, t_max);
+}
@@ -0,0 +1,44 @@
+#ifndef CGFS_BVH_H
+#define CGFS_BVH_H
+
+#include "types.h"
+#include "vec3.h"
+#include "ray_packet.h"
+
+/*
+ * 32-byte node, two per cache line. Interior nodes store the index of their left child, with the right child
+ * immediately after it; leaves store the first entry of their range in primitiveIndices and a non-zero count.
+ */
+typedef struct bvh_node_s {
+    float boundsMin[3];
+    u32 leftFirst;
+    float boundsMax[3];
+    u32 count;
+} BvhNode;
+
+typedef struct bvh_s {
+    BvhNode *nodes;
+    u32 nodeCount;
+    u32 *primitiveIndices;
+    u32 primitiveCount;
+} Bvh;
+
+int bvh_build(Bvh *bvh, const Vec3 *bounds_min, const Vec3 *bounds_max, u32 count);
+
+void bvh_refit(Bvh *bvh, const Vec3 *bounds_min, const Vec3 *bounds_max);
+
+void bvh_destroy(Bvh *bvh);
+
+usize bvh_get_memory_size(const Bvh *bvh);
+
+void bvh_get_triangle_bounds(const TriangleSoa *triangles, Vec3 *bounds_min, Vec3 *bounds_max);
+
+void bvh_get_sphere_bounds(const SphereSoa *spheres, Vec3 *bounds_min, Vec3 *bounds_max);
+
+u32 bvh_intersect_triangles(const Bvh *bvh, const TriangleSoa *triangles, Vec3 origin, Vec3 direction,
+                            float t_min, float *t_max);
+
+u32 bvh_intersect_spheres(const Bvh *bvh, const SphereSoa *spheres, Vec3 origin, Vec3 direction, float t_min,
+                          float *t_max);
+
+#endif //CGFS_BVH_H
@@ -0,0 +1,22 @@
+#ifndef CGFS_CONDITION_H
+#define CGFS_CONDITION_H
+
+#include "mutex.h"
+
+#ifdef _WIN32
+#include "condition_win32.h"
+#else
+#include "condition_pthread.h"
+#endif
+
+int condition_init(Condition *condition);
+
+int condition_wait(Condition *condition, Mutex *mutex);
+
+int condition_signal(Condition *condition);
+
+int condition_broadcast(Condition *condition);
+
+int condition_destroy(Condition *condition);
+
+#endif //CGFS_CONDITION_H
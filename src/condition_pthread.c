@@ -0,0 +1,26 @@
+#ifndef _WIN32
+
+#include "condition_pthread.h"
+#include "mutex_pthread.h"
+
+int condition_init(Condition *condition) {
+    return pthread_cond_init(condition, 0);
+}
+
+int condition_wait(Condition *condition, Mutex *mutex) {
+    return pthread_cond_wait(condition, mutex);
+}
+
+int condition_signal(Condition *condition) {
+    return pthread_cond_signal(condition);
+}
+
+int condition_broadcast(Condition *condition) {
+    return pthread_cond_broadcast(condition);
+}
+
+int condition_destroy(Condition *condition) {
+    return pthread_cond_destroy(condition);
+}
+
+#endif
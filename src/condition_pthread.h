@@ -0,0 +1,8 @@
+#ifndef CGFS_CONDITION_PTHREAD_H
+#define CGFS_CONDITION_PTHREAD_H
+
+#include <pthread.h>
+
+typedef pthread_cond_t Condition;
+
+#endif //CGFS_CONDITION_PTHREAD_H
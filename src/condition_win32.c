@@ -0,0 +1,29 @@
+#ifdef _WIN32
+
+#include "condition_win32.h"
+#include "mutex_win32.h"
+
+int condition_init(Condition *condition) {
+    InitializeConditionVariable(condition);
+    return 0;
+}
+
+int condition_wait(Condition *condition, Mutex *mutex) {
+    return !SleepConditionVariableCS(condition, mutex, INFINITE);
+}
+
+int condition_signal(Condition *condition) {
+    WakeConditionVariable(condition);
+    return 0;
+}
+
+int condition_broadcast(Condition *condition) {
+    WakeAllConditionVariable(condition);
+    return 0;
+}
+
+int condition_destroy(Condition *condition) {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef CGFS_CONDITION_WIN32_H
+#define CGFS_CONDITION_WIN32_H
+
+#include <windows.h>
+
+typedef CONDITION_VARIABLE Condition;
+
+#endif //CGFS_CONDITION_WIN32_H
@@ -0,0 +1,192 @@
+#include "connection_pool.h"
+#include "mutex.h"
+#include "timer.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct connection_pool_entry_s {
+    char hostname[RESOLVER_MAX_HOSTNAME];
+    char service[RESOLVER_MAX_SERVICE];
+    Socket sock;
+    u64 releaseTime;
+    struct connection_pool_entry_s *next;
+} ConnectionPoolEntry;
+
+typedef struct connection_pool_prefetch_s {
+    ResolverQuery query;
+    struct connection_pool_prefetch_s *next;
+} ConnectionPoolPrefetch;
+
+/* Idle connections form one list, newest first, so reuse prefers the connection most likely to still be open. */
+struct connection_pool_s {
+    Resolver *resolver;
+    Mutex mutex;
+    ConnectionPoolEntry *idle;
+    ConnectionPoolPrefetch *prefetches;
+    u32 maxIdlePerHost;
+    u64 idleTimeout;
+    ConnectionPoolStats stats;
+};
+
+bool connection_pool_entry_matches(const ConnectionPoolEntry *entry, const char *hostname, const char *service) {
+    return strcmp(entry->hostname, hostname) == 0 && strcmp(entry->service, service) == 0;
+}
+
+/* An idle connection should have nothing to read; if it does, the peer closed it or broke the protocol. */
+bool connection_pool_is_open(Socket sock) {
+    return socket_poll(sock, POLLIN, 0, NULL) == 0;
+}
+
+/* Expects the mutex to be held. */
+void connection_pool_reap_prefetches(ConnectionPool *pool) {
+    ConnectionPoolPrefetch **link = &pool->prefetches;
+    while (*link != NULL) {
+        ConnectionPoolPrefetch *prefetch = *link;
+        if (resolver_query_is_done(&prefetch->query)) {
+            *link = prefetch->next;
+            free(prefetch);
+        } else {
+            link = &prefetch->next;
+        }
+    }
+}
+
+ConnectionPool *connection_pool_create(Resolver *resolver, u32 max_idle_per_host, u64 idle_timeout_ms) {
+    ConnectionPool *pool = calloc(1, sizeof(ConnectionPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    if (mutex_init(&pool->mutex) != 0) {
+        free(pool);
+        return NULL;
+    }
+    pool->resolver = resolver;
+    pool->maxIdlePerHost = max_idle_per_host;
+    pool->idleTimeout = idle_timeout_ms * 1000000;
+    return pool;
+}
+
+void connection_pool_destroy(ConnectionPool *pool) {
+    while (pool->idle != NULL) {
+        ConnectionPoolEntry *entry = pool->idle;
+        pool->idle = entry->next;
+        socket_close(entry->sock);
+        free(entry);
+    }
+    while (pool->prefetches != NULL) {
+        ConnectionPoolPrefetch *prefetch = pool->prefetches;
+        pool->prefetches = prefetch->next;
+        resolver_query_wait(&prefetch->query);
+        free(prefetch);
+    }
+    mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+int connection_pool_acquire(ConnectionPool *pool, const char *hostname, const char *service, Socket *sock) {
+    u64 now = timer_get_time_ns();
+    mutex_lock(&pool->mutex);
+    connection_pool_reap_prefetches(pool);
+    ConnectionPoolEntry **link = &pool->idle;
+    while (*link != NULL) {
+        ConnectionPoolEntry *entry = *link;
+        bool expired = now - entry->releaseTime > pool->idleTimeout;
+        if (!expired && !connection_pool_entry_matches(entry, hostname, service)) {
+            link = &entry->next;
+            continue;
+        }
+        *link = entry->next;
+        pool->stats.idleCount--;
+        if (!expired && connection_pool_is_open(entry->sock)) {
+            *sock = entry->sock;
+            pool->stats.connectionsReused++;
+            mutex_unlock(&pool->mutex);
+            free(entry);
+            return 0;
+        }
+        socket_close(entry->sock);
+        free(entry);
+    }
+    mutex_unlock(&pool->mutex);
+
+    ResolverQuery query;
+    resolver_resolve(pool->resolver, hostname, service, AF_UNSPEC, SOCK_STREAM, &query);
+    int status = resolver_query_wait(&query);
+    if (status != 0) {
+        return status;
+    }
+    for (u32 i = 0; i < query.addressCount; i++) {
+        const ResolverAddress *address = &query.addresses[i];
+        Socket candidate = socket_create(address->address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+        if (candidate == INVALID_SOCKET_HANDLE) {
+            status = socket_get_last_error();
+            continue;
+        }
+        if (socket_connect(candidate, (const struct sockaddr *) &address->address, address->length) != 0) {
+            status = socket_get_last_error();
+            socket_close(candidate);
+            continue;
+        }
+        *sock = candidate;
+        mutex_lock(&pool->mutex);
+        pool->stats.connectionsCreated++;
+        mutex_unlock(&pool->mutex);
+        return 0;
+    }
+    return status;
+}
+
+void connection_pool_release(ConnectionPool *pool, const char *hostname, const char *service, Socket sock,
+                             bool reusable) {
+    usize hostnameLength = strlen(hostname);
+    usize serviceLength = strlen(service);
+    ConnectionPoolEntry *entry = NULL;
+    if (reusable && hostnameLength < RESOLVER_MAX_HOSTNAME && serviceLength < RESOLVER_MAX_SERVICE) {
+        entry = malloc(sizeof(ConnectionPoolEntry));
+    }
+    if (entry == NULL) {
+        socket_close(sock);
+        return;
+    }
+    memcpy(entry->hostname, hostname, hostnameLength + 1);
+    memcpy(entry->service, service, serviceLength + 1);
+    entry->sock = sock;
+    entry->releaseTime = timer_get_time_ns();
+    mutex_lock(&pool->mutex);
+    u32 count = 0;
+    for (ConnectionPoolEntry *other = pool->idle; other != NULL; other = other->next) {
+        if (connection_pool_entry_matches(other, hostname, service)) {
+            count++;
+        }
+    }
+    if (count >= pool->maxIdlePerHost) {
+        mutex_unlock(&pool->mutex);
+        socket_close(sock);
+        free(entry);
+        return;
+    }
+    entry->next = pool->idle;
+    pool->idle = entry;
+    pool->stats.idleCount++;
+    mutex_unlock(&pool->mutex);
+}
+
+void connection_pool_prefetch(ConnectionPool *pool, const char *hostname, const char *service) {
+    ConnectionPoolPrefetch *prefetch = malloc(sizeof(ConnectionPoolPrefetch));
+    if (prefetch == NULL) {
+        return;
+    }
+    resolver_resolve(pool->resolver, hostname, service, AF_UNSPEC, SOCK_STREAM, &prefetch->query);
+    mutex_lock(&pool->mutex);
+    connection_pool_reap_prefetches(pool);
+    prefetch->next = pool->prefetches;
+    pool->prefetches = prefetch;
+    mutex_unlock(&pool->mutex);
+}
+
+ConnectionPoolStats connection_pool_get_stats(ConnectionPool *pool) {
+    mutex_lock(&pool->mutex);
+    ConnectionPoolStats stats = pool->stats;
+    mutex_unlock(&pool->mutex);
+    return stats;
+}
@@ -0,0 +1,40 @@
+#ifndef CGFS_CONNECTION_POOL_H
+#define CGFS_CONNECTION_POOL_H
+
+#include "resolver.h"
+
+typedef struct connection_pool_stats_s {
+    u64 connectionsCreated;
+    u64 connectionsReused;
+    u32 idleCount;
+} ConnectionPoolStats;
+
+typedef struct connection_pool_s ConnectionPool;
+
+/*
+ * Keeps up to max_idle_per_host established TCP connections per host and service for reuse, each for at most
+ * idle_timeout_ms. Safe to use from several threads. Names go through the resolver, so repeated connects to a host
+ * cost no lookup until its cache entry expires.
+ */
+ConnectionPool *connection_pool_create(Resolver *resolver, u32 max_idle_per_host, u64 idle_timeout_ms);
+
+/* Closes every idle connection. Connections that are still acquired stay with their owners. */
+void connection_pool_destroy(ConnectionPool *pool);
+
+/*
+ * Hands out the most recently released idle connection to hostname:service that is still open, or else resolves
+ * and connects, trying every address in turn. Blocks, so it belongs on a worker thread. Returns 0, an EAI_ code or
+ * the connect error.
+ */
+int connection_pool_acquire(ConnectionPool *pool, const char *hostname, const char *service, Socket *sock);
+
+/* Gives a connection back. One that is not reusable, say after a protocol error, is closed instead. */
+void connection_pool_release(ConnectionPool *pool, const char *hostname, const char *service, Socket sock,
+                             bool reusable);
+
+/* Starts resolving in the background so a later acquire finds the address cached. */
+void connection_pool_prefetch(ConnectionPool *pool, const char *hostname, const char *service);
+
+ConnectionPoolStats connection_pool_get_stats(ConnectionPool *pool);
+
+#endif //CGFS_CONNECTION_POOL_H
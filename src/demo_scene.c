@@ -0,0 +1,79 @@
+#include "demo_scene.h"
+#include "vec3.h"
+
+#define DEMO_SCENE_NEAR 0.1f
+#define DEMO_SCENE_FAR 100.0f
+
+static const float demo_scene_cube_faces[6][4][3] = {
+        {{-1.0f, -1.0f, -1.0f}, {-1.0f, 1.0f, -1.0f}, {-1.0f, 1.0f, 1.0f}, {-1.0f, -1.0f, 1.0f}},
+        {{1.0f, -1.0f, 1.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f, -1.0f}, {1.0f, -1.0f, -1.0f}},
+        {{-1.0f, -1.0f, -1.0f}, {-1.0f, -1.0f, 1.0f}, {1.0f, -1.0f, 1.0f}, {1.0f, -1.0f, -1.0f}},
+        {{1.0f, 1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}, {-1.0f, 1.0f, 1.0f}, {-1.0f, 1.0f, -1.0f}},
+        {{-1.0f, -1.0f, -1.0f}, {1.0f, -1.0f, -1.0f}, {1.0f, 1.0f, -1.0f}, {-1.0f, 1.0f, -1.0f}},
+        {{-1.0f, 1.0f, 1.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, -1.0f, 1.0f}, {-1.0f, -1.0f, 1.0f}},
+};
+
+static const float demo_scene_cube_colors[6][3] = {
+        {1.0f, 0.2f, 0.2f},
+        {0.2f, 1.0f, 0.2f},
+        {0.2f, 0.2f, 1.0f},
+        {1.0f, 1.0f, 0.2f},
+        {0.2f, 1.0f, 1.0f},
+        {1.0f, 0.2f, 1.0f},
+};
+
+/* Perspective projection into Vulkan clip space, with the camera at the origin looking down +z and y pointing down. */
+void demo_scene_project_vertex(RasterizerVertex *vertex, Vec3 position, float aspect) {
+    float focal = 1.0f / tanf(0.5f);
+    vertex->position[0] = position.x * focal / aspect;
+    vertex->position[1] = position.y * focal;
+    vertex->position[2] = (position.z - DEMO_SCENE_NEAR) * DEMO_SCENE_FAR / (DEMO_SCENE_FAR - DEMO_SCENE_NEAR);
+    vertex->position[3] = position.z;
+}
+
+void demo_scene_build(RasterizerVertex *vertices, u32 cube_count, u32 frame, float aspect) {
+    u32 gridSize = (u32) ceilf(cbrtf((float) cube_count));
+    for (u32 cube = 0; cube < cube_count; cube++) {
+        Vec3 center = vec3(((float) (cube % gridSize) - (float) (gridSize - 1) * 0.5f) * 2.0f,
+                           ((float) (cube / gridSize % gridSize) - (float) (gridSize - 1) * 0.5f) * 2.0f,
+                           (float) (cube / (gridSize * gridSize)) * 2.0f + (float) gridSize * 2.0f);
+        float angle = (float) frame * 0.05f + (float) cube * 0.1f;
+        float c = cosf(angle);
+        float s = sinf(angle);
+        for (u32 face = 0; face < 6; face++) {
+            for (u32 corner = 0; corner < 4; corner++) {
+                const float *p = demo_scene_cube_faces[face][corner];
+                float x = p[0] * c + p[2] * s;
+                float z = p[2] * c - p[0] * s;
+                float y = p[1] * c - z * s;
+                z = z * c + p[1] * s;
+                RasterizerVertex *vertex = &vertices[(cube * 6 + face) * 4 + corner];
+                demo_scene_project_vertex(vertex, vec3_add(center, vec3_scale(vec3(x, y, z), 0.5f)), aspect);
+                float shade = 0.6f + 0.1f * (float) corner;
+                vertex->attributes[0] = demo_scene_cube_colors[face][0] * shade;
+                vertex->attributes[1] = demo_scene_cube_colors[face][1] * shade;
+                vertex->attributes[2] = demo_scene_cube_colors[face][2] * shade;
+                vertex->attributes[3] = 1.0f;
+            }
+        }
+    }
+    const float *floorFace = demo_scene_cube_faces[2][0];
+    for (u32 corner = 0; corner < 4; corner++) {
+        const float *p = floorFace + corner * 3;
+        RasterizerVertex *vertex = &vertices[cube_count * 24 + corner];
+        demo_scene_project_vertex(vertex, vec3(p[0] * 50.0f, (float) gridSize + 1.0f, p[2] * 50.0f + 40.0f), aspect);
+        vertex->attributes[0] = p[0] > 0.0f ? 0.5f : 0.2f;
+        vertex->attributes[1] = 0.3f;
+        vertex->attributes[2] = p[2] > 0.0f ? 0.5f : 0.2f;
+        vertex->attributes[3] = 1.0f;
+    }
+}
+
+void demo_scene_build_indices(u32 *indices, u32 quad_count) {
+    const u32 quad[6] = {0, 1, 2, 0, 2, 3};
+    for (u32 i = 0; i < quad_count; i++) {
+        for (u32 j = 0; j < 6; j++) {
+            indices[i * 6 + j] = i * 4 + quad[j];
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef CGFS_DEMO_SCENE_H
+#define CGFS_DEMO_SCENE_H
+
+#include "rasterizer.h"
+#include "types.h"
+
+/*
+ * A grid of spinning cubes over a floor that passes behind the camera, so the floor always exercises near-plane
+ * clipping. Every cube face and the floor is one quad of four vertices and six indices; the floor is the last quad.
+ */
+static inline u32 demo_scene_get_quad_count(u32 cube_count) {
+    return cube_count * 6 + 1;
+}
+
+/* Fills the vertices of frame number frame, projected for a viewport with the given aspect ratio. */
+void demo_scene_build(RasterizerVertex *vertices, u32 cube_count, u32 frame, float aspect);
+
+/* The indices never change between frames, so they are only built once. */
+void demo_scene_build_indices(u32 *indices, u32 quad_count);
+
+#endif //CGFS_DEMO_SCENE_H
@@ -0,0 +1,24 @@
+#include "embedded_assets.h"
+#include <string.h>
+
+#ifdef CGFS_EMBED_SHADERS
+
+extern const EmbeddedAsset embedded_assets[];
+extern const u32 embedded_asset_count;
+
+const EmbeddedAsset *embedded_asset_find(const char *name) {
+    for (u32 i = 0; i < embedded_asset_count; i++) {
+        if (strcmp(embedded_assets[i].name, name) == 0) {
+            return &embedded_assets[i];
+        }
+    }
+    return NULL;
+}
+
+#else
+
+const EmbeddedAsset *embedded_asset_find(const char *name) {
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef CGFS_EMBEDDED_ASSETS_H
+#define CGFS_EMBEDDED_ASSETS_H
+
+#include "types.h"
+
+/* Assets linked into the executable when it is built with CGFS_EMBED_SHADERS. */
+typedef struct embedded_asset_s {
+    const char *name;
+    const u32 *data;
+    usize length;
+} EmbeddedAsset;
+
+const EmbeddedAsset *embedded_asset_find(const char *name);
+
+#endif //CGFS_EMBEDDED_ASSETS_H
@@ -1,6 +1,8 @@
 #include "file.h"
 #include <stdio.h>
 #include <errno.h>
+#include <string.h>
+#include <stdlib.h>
 
 int file_read_all(const char *modes, const char *path, usize *length, u8 *data) {
     FILE *file = fopen(path, modes);
@@ -10,19 +12,21 @@ int file_read_all(const char *modes, const char *path, usize *length, u8 *data)
     fseek(file, 0L, SEEK_END);
     *length = ftell(file);
     if (data == NULL) {
+        fclose(file);
         return 0;
     }
     fseek(file, 0L, SEEK_SET);
     size_t read = fread(data, 1, *length, file);
+    int status = 0;
     if (read != *length) {
         if (feof(file)) {
-            return 1;
-        }
-        if (ferror(file)) {
-            return errno;
+            status = 1;
+        } else if (ferror(file)) {
+            status = errno;
         }
     }
-    return 0;
+    fclose(file);
+    return status;
 }
 
 int file_read_all_binary(const char *path, usize *length, u8 *data) {
@@ -32,3 +36,57 @@ int file_read_all_binary(const char *path, usize *length, u8 *data) {
 int file_read_all_text(const char *path, usize *length, u8 *data) {
     return file_read_all("r", path, length, data);
 }
+
+int file_write_all_binary(const char *path, usize length, const u8 *data) {
+    usize path_length = strlen(path);
+    char *temporary_path = malloc(path_length + 5);
+    if (temporary_path == NULL) {
+        return ENOMEM;
+    }
+    memcpy(temporary_path, path, path_length);
+    memcpy(temporary_path + path_length, ".tmp", 5);
+    FILE *file = fopen(temporary_path, "wb");
+    if (file == NULL) {
+        int status = errno;
+        free(temporary_path);
+        return status;
+    }
+    size_t written = fwrite(data, 1, length, file);
+    int status = written != length ? errno : 0;
+    if (fclose(file) != 0 && status == 0) {
+        status = errno;
+    }
+    if (status == 0) {
+#ifdef _WIN32
+        remove(path);
+#endif
+        if (rename(temporary_path, path) != 0) {
+            status = errno;
+        }
+    }
+    if (status != 0) {
+        remove(temporary_path);
+    }
+    free(temporary_path);
+    return status;
+}
+
+int file_write_ppm(const char *path, u32 width, u32 height, const u8 *pixels) {
+    char header[32];
+    int header_length = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", width, height);
+    usize length = (usize) header_length + (usize) width * height * 3;
+    u8 *data = malloc(length);
+    if (data == NULL) {
+        return ENOMEM;
+    }
+    memcpy(data, header, header_length);
+    u8 *rgb = data + header_length;
+    for (usize i = 0; i < (usize) width * height; i++) {
+        rgb[i * 3 + 0] = pixels[i * 4 + 0];
+        rgb[i * 3 + 1] = pixels[i * 4 + 1];
+        rgb[i * 3 + 2] = pixels[i * 4 + 2];
+    }
+    int status = file_write_all_binary(path, length, data);
+    free(data);
+    return status;
+}
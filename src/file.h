@@ -3,8 +3,43 @@
 
 #include "types.h"
 
+#ifdef _WIN32
+#include "file_win32.h"
+#else
+#include "file_unix.h"
+#endif
+
 int file_read_all_binary(const char *path, usize *length, u8 *data);
 
 int file_read_all_text(const char *path, usize *length, u8 *data);
 
+int file_write_all_binary(const char *path, usize length, const u8 *data);
+
+/* Writes tightly packed RGBA8 pixels as a binary PPM, dropping the alpha channel. */
+int file_write_ppm(const char *path, u32 width, u32 height, const u8 *pixels);
+
+typedef enum file_access_e {
+    FILE_ACCESS_NORMAL,
+    FILE_ACCESS_SEQUENTIAL,
+    FILE_ACCESS_RANDOM,
+    FILE_ACCESS_WILL_NEED
+} FileAccess;
+
+/* A read-only view of a whole file. The data is page aligned, and NULL for empty files. */
+typedef struct file_mapping_s {
+    const u8 *data;
+    usize length;
+} FileMapping;
+
+int file_map(const char *path, FileAccess access, FileMapping *mapping);
+
+void file_unmap(FileMapping *mapping);
+
+int file_open_read(const char *path, FileHandle *handle, u64 *size);
+
+/* Positional read that keeps going until length bytes are read or the end of the file is reached. */
+int file_read_at(FileHandle handle, u64 offset, usize length, u8 *data, usize *bytes_read);
+
+void file_close(FileHandle handle);
+
 #endif //CGFS_FILE_H
@@ -0,0 +1,215 @@
+#include "file_async.h"
+#include "atomic.h"
+#include "condition.h"
+#include "futex.h"
+#include "thread.h"
+#include <errno.h>
+#include <stdlib.h>
+
+#ifdef __linux__
+#include "file_async_uring.h"
+#endif
+
+#define FILE_ASYNC_DEFAULT_THREAD_COUNT 2
+#define FILE_ASYNC_URING_QUEUE_DEPTH 64
+
+/*
+ * Reads go to io_uring on Linux kernels that support it. Otherwise, or when the ring is full, they are queued for a
+ * small pool of threads doing blocking positional reads. Before file_async_init every read runs synchronously.
+ */
+typedef struct file_async_s {
+    bool initialized;
+    bool uring;
+    bool stopping;
+    Mutex mutex;
+    Condition condition;
+    FileRead *head;
+    FileRead *tail;
+    Thread *threads;
+    u32 threadCount;
+} FileAsync;
+
+static FileAsync file_async_state;
+
+void file_async_complete(FileRead *read, int status) {
+    file_close(read->handle);
+    read->handle = INVALID_FILE_HANDLE;
+    read->status = status;
+    atomic_store_i32(&read->done, 1, ATOMIC_RELEASE);
+    futex_wake_all(&read->done);
+}
+
+void file_async_perform(FileRead *read) {
+    usize bytesRead = 0;
+    int status = file_read_at(read->handle, read->offset + read->bytesRead, read->length - read->bytesRead,
+                              read->data + read->bytesRead, &bytesRead);
+    read->bytesRead += bytesRead;
+    file_async_complete(read, status);
+}
+
+void *file_async_worker(void *arg) {
+    mutex_lock(&file_async_state.mutex);
+    while (true) {
+        while (file_async_state.head == NULL && !file_async_state.stopping) {
+            condition_wait(&file_async_state.condition, &file_async_state.mutex);
+        }
+        FileRead *read = file_async_state.head;
+        if (read == NULL) {
+            break;
+        }
+        file_async_state.head = read->next;
+        if (file_async_state.head == NULL) {
+            file_async_state.tail = NULL;
+        }
+        mutex_unlock(&file_async_state.mutex);
+        file_async_perform(read);
+        mutex_lock(&file_async_state.mutex);
+    }
+    mutex_unlock(&file_async_state.mutex);
+    return NULL;
+}
+
+int file_async_init(u32 thread_count) {
+    if (file_async_state.initialized) {
+        return 0;
+    }
+#ifdef __linux__
+    file_async_state.uring = file_async_uring_init(FILE_ASYNC_URING_QUEUE_DEPTH) == 0;
+#endif
+    /* With io_uring the pool only takes the overflow of a full ring. */
+    if (file_async_state.uring) {
+        thread_count = 1;
+    } else if (thread_count == 0) {
+        thread_count = FILE_ASYNC_DEFAULT_THREAD_COUNT;
+    }
+    file_async_state.threads = malloc(sizeof(Thread) * thread_count);
+    if (file_async_state.threads == NULL || mutex_init(&file_async_state.mutex) != 0) {
+        free(file_async_state.threads);
+        return ENOMEM;
+    }
+    condition_init(&file_async_state.condition);
+    file_async_state.stopping = false;
+    file_async_state.head = NULL;
+    file_async_state.tail = NULL;
+    file_async_state.threadCount = 0;
+    for (u32 i = 0; i < thread_count; i++) {
+        Thread thread = thread_create(file_async_worker, NULL);
+        if (thread == 0) {
+            break;
+        }
+        file_async_state.threads[file_async_state.threadCount++] = thread;
+    }
+    file_async_state.initialized = true;
+    return 0;
+}
+
+void file_async_destroy() {
+    if (!file_async_state.initialized) {
+        return;
+    }
+#ifdef __linux__
+    if (file_async_state.uring) {
+        file_async_uring_destroy();
+        file_async_state.uring = false;
+    }
+#endif
+    mutex_lock(&file_async_state.mutex);
+    file_async_state.stopping = true;
+    condition_broadcast(&file_async_state.condition);
+    mutex_unlock(&file_async_state.mutex);
+    for (u32 i = 0; i < file_async_state.threadCount; i++) {
+        usize result;
+        thread_join(file_async_state.threads[i], &result);
+    }
+    free(file_async_state.threads);
+    condition_destroy(&file_async_state.condition);
+    mutex_destroy(&file_async_state.mutex);
+    file_async_state.initialized = false;
+}
+
+void file_async_enqueue(FileRead *read) {
+    if (file_async_state.threadCount == 0) {
+        file_async_perform(read);
+        return;
+    }
+    mutex_lock(&file_async_state.mutex);
+    read->next = NULL;
+    if (file_async_state.tail != NULL) {
+        file_async_state.tail->next = read;
+    } else {
+        file_async_state.head = read;
+    }
+    file_async_state.tail = read;
+    condition_signal(&file_async_state.condition);
+    mutex_unlock(&file_async_state.mutex);
+}
+
+void file_async_submit(FileRead *read) {
+    if (!file_async_state.initialized || read->length == 0) {
+        file_async_perform(read);
+        return;
+    }
+#ifdef __linux__
+    if (file_async_state.uring && file_async_uring_submit(read)) {
+        return;
+    }
+#endif
+    file_async_enqueue(read);
+}
+
+void file_read_init(FileRead *read, u64 offset, usize length, u8 *data) {
+    read->done = 0;
+    read->status = 0;
+    read->handle = INVALID_FILE_HANDLE;
+    read->offset = offset;
+    read->data = data;
+    read->length = length;
+    read->bytesRead = 0;
+    read->next = NULL;
+}
+
+int file_read_fail(FileRead *read, int status) {
+    read->status = status;
+    read->done = 1;
+    return status;
+}
+
+int file_read_async(const char *path, u64 offset, usize length, u8 *data, FileRead *read) {
+    file_read_init(read, offset, length, data);
+    u64 size;
+    int status = file_open_read(path, &read->handle, &size);
+    if (status != 0) {
+        return file_read_fail(read, status);
+    }
+    file_async_submit(read);
+    return 0;
+}
+
+int file_read_all_async(const char *path, FileRead *read) {
+    file_read_init(read, 0, 0, NULL);
+    u64 size;
+    int status = file_open_read(path, &read->handle, &size);
+    if (status != 0) {
+        return file_read_fail(read, status);
+    }
+    read->data = malloc(size > 0 ? (usize) size : 1);
+    if (read->data == NULL) {
+        file_close(read->handle);
+        read->handle = INVALID_FILE_HANDLE;
+        return file_read_fail(read, ENOMEM);
+    }
+    read->length = (usize) size;
+    file_async_submit(read);
+    return 0;
+}
+
+bool file_read_is_done(FileRead *read) {
+    return atomic_load_i32(&read->done, ATOMIC_ACQUIRE) != 0;
+}
+
+int file_read_wait(FileRead *read) {
+    while (atomic_load_i32(&read->done, ATOMIC_ACQUIRE) == 0) {
+        futex_wait(&read->done, 0);
+    }
+    return read->status;
+}
@@ -0,0 +1,34 @@
+#ifndef CGFS_FILE_ASYNC_H
+#define CGFS_FILE_ASYNC_H
+
+#include "file.h"
+
+/*
+ * Completion handle of one asynchronous read, owned by the caller. It must stay at the same address until the read is
+ * done, and the destination buffer must not be touched before that.
+ */
+typedef struct file_read_s {
+    i32 done;
+    i32 status;
+    FileHandle handle;
+    u64 offset;
+    u8 *data;
+    usize length;
+    usize bytesRead;
+    struct file_read_s *next;
+} FileRead;
+
+int file_async_init(u32 thread_count);
+
+void file_async_destroy();
+
+int file_read_async(const char *path, u64 offset, usize length, u8 *data, FileRead *read);
+
+/* Reads the whole file into a buffer allocated with malloc, which the caller frees once the read is done. */
+int file_read_all_async(const char *path, FileRead *read);
+
+bool file_read_is_done(FileRead *read);
+
+int file_read_wait(FileRead *read);
+
+#endif //CGFS_FILE_ASYNC_H
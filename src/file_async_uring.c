@@ -0,0 +1,310 @@
+#ifdef __linux__
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "atomic.h"
+#include "file_async_uring.h"
+#include "mutex.h"
+#include "thread.h"
+
+/* Reads are split so a single submission never exceeds what the kernel accepts for one read. */
+#define FILE_ASYNC_URING_MAX_READ 0x40000000
+
+/*
+ * Raw io_uring without liburing. Any thread submits under the mutex, and a reaper thread blocks for completions,
+ * resubmits short reads and signals the completion handles.
+ */
+typedef struct file_async_uring_s {
+    int fd;
+    void *sqRing;
+    usize sqRingSize;
+    void *cqRing;
+    usize cqRingSize;
+    struct io_uring_sqe *sqes;
+    usize sqesSize;
+    u32 *sqHead;
+    u32 *sqTail;
+    u32 *sqArray;
+    u32 sqMask;
+    u32 sqEntries;
+    u32 *cqHead;
+    u32 *cqTail;
+    struct io_uring_cqe *cqes;
+    u32 cqMask;
+    u32 cqEntries;
+    u32 inFlight;
+    u32 unsubmitted;
+    bool stopRetracted;
+    Mutex mutex;
+    Thread reaper;
+} FileAsyncUring;
+
+static FileAsyncUring file_async_uring;
+
+int file_async_uring_enter(u32 to_submit, u32 min_complete, u32 flags) {
+    return (int) syscall(__NR_io_uring_enter, file_async_uring.fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+/*
+ * Takes back the entries the kernel has not accepted. Without SQPOLL the kernel reads the submission ring only inside
+ * io_uring_enter, so moving the tail back under the mutex is safe. Returns the reads as a list for the thread pool;
+ * a retracted stop no-op is flagged for file_async_uring_destroy to push again. Expects the mutex to be held.
+ */
+FileRead *file_async_uring_retract() {
+    FileRead *retracted = NULL;
+    u32 tail = *file_async_uring.sqTail;
+    while (file_async_uring.unsubmitted > 0) {
+        tail--;
+        FileRead *read = (FileRead *) (usize) file_async_uring.sqes[tail & file_async_uring.sqMask].user_data;
+        if (read != NULL) {
+            read->next = retracted;
+            retracted = read;
+        } else {
+            file_async_uring.stopRetracted = true;
+        }
+        file_async_uring.unsubmitted--;
+        file_async_uring.inFlight--;
+    }
+    atomic_store_i32((volatile i32 *) file_async_uring.sqTail, (i32) tail, ATOMIC_RELEASE);
+    return retracted;
+}
+
+/*
+ * Expects the mutex to be held. On EAGAIN or EBUSY the entries stay queued while other reads are in the kernel, as
+ * their completions wake the reaper to retry. With nothing in the kernel no completion would ever come, so the
+ * entries are retracted and returned for the thread pool.
+ */
+FileRead *file_async_uring_flush() {
+    while (file_async_uring.unsubmitted > 0) {
+        int submitted = file_async_uring_enter(file_async_uring.unsubmitted, 0, 0);
+        if (submitted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (file_async_uring.inFlight == file_async_uring.unsubmitted) {
+                return file_async_uring_retract();
+            }
+            break;
+        }
+        file_async_uring.unsubmitted -= (u32) submitted;
+    }
+    return NULL;
+}
+
+void file_async_uring_enqueue_all(FileRead *read) {
+    while (read != NULL) {
+        FileRead *next = read->next;
+        file_async_enqueue(read);
+        read = next;
+    }
+}
+
+/*
+ * Expects the mutex to be held. A NULL read queues a no-op used to wake the reaper. Reads the kernel refused are
+ * added to retracted and must be passed to file_async_uring_enqueue_all once the mutex is released.
+ */
+bool file_async_uring_push(FileRead *read, FileRead **retracted) {
+    u32 tail = *file_async_uring.sqTail;
+    u32 head = (u32) atomic_load_i32((volatile i32 *) file_async_uring.sqHead, ATOMIC_ACQUIRE);
+    if (tail - head >= file_async_uring.sqEntries || file_async_uring.inFlight >= file_async_uring.cqEntries) {
+        return false;
+    }
+    u32 index = tail & file_async_uring.sqMask;
+    struct io_uring_sqe *sqe = &file_async_uring.sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    if (read != NULL) {
+        usize remaining = read->length - read->bytesRead;
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = read->handle;
+        sqe->addr = (u64) (usize) (read->data + read->bytesRead);
+        sqe->len = remaining > FILE_ASYNC_URING_MAX_READ ? FILE_ASYNC_URING_MAX_READ : (u32) remaining;
+        sqe->off = read->offset + read->bytesRead;
+    } else {
+        sqe->opcode = IORING_OP_NOP;
+    }
+    sqe->user_data = (u64) (usize) read;
+    file_async_uring.sqArray[index] = index;
+    atomic_store_i32((volatile i32 *) file_async_uring.sqTail, (i32) (tail + 1), ATOMIC_RELEASE);
+    file_async_uring.inFlight++;
+    file_async_uring.unsubmitted++;
+    *retracted = file_async_uring_flush();
+    return true;
+}
+
+bool file_async_uring_submit(FileRead *read) {
+    FileRead *retracted = NULL;
+    mutex_lock(&file_async_uring.mutex);
+    bool pushed = file_async_uring_push(read, &retracted);
+    mutex_unlock(&file_async_uring.mutex);
+    file_async_uring_enqueue_all(retracted);
+    return pushed;
+}
+
+void file_async_uring_continue(FileRead *read, i32 result) {
+    if (result == -EINTR || result == -EAGAIN) {
+        result = 0;
+    } else if (result < 0) {
+        file_async_complete(read, -result);
+        return;
+    } else if (result == 0) {
+        file_async_complete(read, 0);
+        return;
+    }
+    read->bytesRead += (usize) result;
+    if (read->bytesRead == read->length) {
+        file_async_complete(read, 0);
+        return;
+    }
+    if (!file_async_uring_submit(read)) {
+        file_async_enqueue(read);
+    }
+}
+
+void *file_async_uring_reaper(void *arg) {
+    bool stopping = false;
+    while (true) {
+        mutex_lock(&file_async_uring.mutex);
+        FileRead *retracted = file_async_uring_flush();
+        bool idle = file_async_uring.inFlight == 0;
+        mutex_unlock(&file_async_uring.mutex);
+        file_async_uring_enqueue_all(retracted);
+        if (stopping && idle) {
+            break;
+        }
+        file_async_uring_enter(0, 1, IORING_ENTER_GETEVENTS);
+        u32 head = *file_async_uring.cqHead;
+        u32 tail = (u32) atomic_load_i32((volatile i32 *) file_async_uring.cqTail, ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &file_async_uring.cqes[head & file_async_uring.cqMask];
+            FileRead *read = (FileRead *) (usize) cqe->user_data;
+            i32 result = cqe->res;
+            head++;
+            atomic_store_i32((volatile i32 *) file_async_uring.cqHead, (i32) head, ATOMIC_RELEASE);
+            mutex_lock(&file_async_uring.mutex);
+            file_async_uring.inFlight--;
+            mutex_unlock(&file_async_uring.mutex);
+            if (read == NULL) {
+                stopping = true;
+            } else {
+                file_async_uring_continue(read, result);
+            }
+        }
+    }
+    return NULL;
+}
+
+int file_async_uring_init(u32 queue_depth) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(struct io_uring_params));
+    int fd = (int) syscall(__NR_io_uring_setup, queue_depth, &params);
+    if (fd < 0) {
+        return errno;
+    }
+    /* IORING_OP_READ arrived in the same kernel release as this feature bit. */
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        close(fd);
+        return ENOSYS;
+    }
+    FileAsyncUring *ring = &file_async_uring;
+    memset(ring, 0, sizeof(FileAsyncUring));
+    ring->fd = fd;
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(u32);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cqRingSize > ring->sqRingSize) {
+            ring->sqRingSize = ring->cqRingSize;
+        }
+        ring->cqRingSize = ring->sqRingSize;
+    }
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                        IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        int status = errno;
+        close(fd);
+        return status;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cqRing = ring->sqRing;
+    } else {
+        ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                            IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED) {
+            int status = errno;
+            munmap(ring->sqRing, ring->sqRingSize);
+            close(fd);
+            return status;
+        }
+    }
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                      IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        int status = errno;
+        if (ring->cqRing != ring->sqRing) {
+            munmap(ring->cqRing, ring->cqRingSize);
+        }
+        munmap(ring->sqRing, ring->sqRingSize);
+        close(fd);
+        return status;
+    }
+    u8 *sqRing = ring->sqRing;
+    u8 *cqRing = ring->cqRing;
+    ring->sqHead = (u32 *) (sqRing + params.sq_off.head);
+    ring->sqTail = (u32 *) (sqRing + params.sq_off.tail);
+    ring->sqArray = (u32 *) (sqRing + params.sq_off.array);
+    ring->sqMask = *(u32 *) (sqRing + params.sq_off.ring_mask);
+    ring->sqEntries = params.sq_entries;
+    ring->cqHead = (u32 *) (cqRing + params.cq_off.head);
+    ring->cqTail = (u32 *) (cqRing + params.cq_off.tail);
+    ring->cqes = (struct io_uring_cqe *) (cqRing + params.cq_off.cqes);
+    ring->cqMask = *(u32 *) (cqRing + params.cq_off.ring_mask);
+    ring->cqEntries = params.cq_entries;
+    mutex_init(&ring->mutex);
+    ring->reaper = thread_create(file_async_uring_reaper, NULL);
+    if (ring->reaper == 0) {
+        file_async_uring_destroy();
+        return EAGAIN;
+    }
+    return 0;
+}
+
+void file_async_uring_destroy() {
+    FileAsyncUring *ring = &file_async_uring;
+    if (ring->reaper != 0) {
+        /*
+         * The reaper drains every read still in flight before it sees the no-op and exits. The no-op has to reach the
+         * kernel to wake it, so it is pushed again for as long as the ring is full or the kernel refuses it.
+         */
+        mutex_lock(&ring->mutex);
+        while (true) {
+            FileRead *retracted = NULL;
+            ring->stopRetracted = false;
+            bool pushed = file_async_uring_push(NULL, &retracted);
+            if (pushed && !ring->stopRetracted) {
+                mutex_unlock(&ring->mutex);
+                file_async_uring_enqueue_all(retracted);
+                break;
+            }
+            mutex_unlock(&ring->mutex);
+            file_async_uring_enqueue_all(retracted);
+            thread_yield();
+            mutex_lock(&ring->mutex);
+        }
+        usize result;
+        thread_join(ring->reaper, &result);
+        ring->reaper = 0;
+    }
+    munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRing != ring->sqRing) {
+        munmap(ring->cqRing, ring->cqRingSize);
+    }
+    munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd);
+    mutex_destroy(&ring->mutex);
+}
+
+#endif
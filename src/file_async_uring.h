@@ -0,0 +1,19 @@
+#ifndef CGFS_FILE_ASYNC_URING_H
+#define CGFS_FILE_ASYNC_URING_H
+
+#include "file_async.h"
+
+int file_async_uring_init(u32 queue_depth);
+
+void file_async_uring_destroy();
+
+bool file_async_uring_submit(FileRead *read);
+
+void file_async_complete(FileRead *read, int status);
+
+void file_async_perform(FileRead *read);
+
+/* Hands a read to the thread pool, or performs it right away when there is none. */
+void file_async_enqueue(FileRead *read);
+
+#endif //CGFS_FILE_ASYNC_URING_H
@@ -0,0 +1,104 @@
+#ifndef _WIN32
+
+#include "file.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int file_map(const char *path, FileAccess access, FileMapping *mapping) {
+    mapping->data = NULL;
+    mapping->length = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return errno;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        int status = errno;
+        close(fd);
+        return status;
+    }
+    if (fileStat.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    /* The mapping keeps its own reference to the file, so the descriptor is not needed past this point. */
+    void *data = mmap(NULL, (usize) fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int status = data == MAP_FAILED ? errno : 0;
+    close(fd);
+    if (status != 0) {
+        return status;
+    }
+    int advice = MADV_NORMAL;
+    switch (access) {
+        case FILE_ACCESS_SEQUENTIAL:
+            advice = MADV_SEQUENTIAL;
+            break;
+        case FILE_ACCESS_RANDOM:
+            advice = MADV_RANDOM;
+            break;
+        case FILE_ACCESS_WILL_NEED:
+            advice = MADV_WILLNEED;
+            break;
+        default:
+            break;
+    }
+    if (advice != MADV_NORMAL) {
+        madvise(data, (usize) fileStat.st_size, advice);
+    }
+    mapping->data = data;
+    mapping->length = (usize) fileStat.st_size;
+    return 0;
+}
+
+void file_unmap(FileMapping *mapping) {
+    if (mapping->data != NULL) {
+        munmap((void *) mapping->data, mapping->length);
+    }
+    mapping->data = NULL;
+    mapping->length = 0;
+}
+
+int file_open_read(const char *path, FileHandle *handle, u64 *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return errno;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        int status = errno;
+        close(fd);
+        return status;
+    }
+    *handle = fd;
+    *size = (u64) fileStat.st_size;
+    return 0;
+}
+
+int file_read_at(FileHandle handle, u64 offset, usize length, u8 *data, usize *bytes_read) {
+    usize total = 0;
+    while (total < length) {
+        ssize_t result = pread(handle, data + total, length - total, (off_t) (offset + total));
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            *bytes_read = total;
+            return errno;
+        }
+        if (result == 0) {
+            break;
+        }
+        total += (usize) result;
+    }
+    *bytes_read = total;
+    return 0;
+}
+
+void file_close(FileHandle handle) {
+    close(handle);
+}
+
+#endif
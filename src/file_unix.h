@@ -0,0 +1,8 @@
+#ifndef CGFS_FILE_UNIX_H
+#define CGFS_FILE_UNIX_H
+
+typedef int FileHandle;
+
+#define INVALID_FILE_HANDLE (-1)
+
+#endif //CGFS_FILE_UNIX_H
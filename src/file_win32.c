@@ -0,0 +1,108 @@
+#ifdef _WIN32
+
+#include <windows.h>
+#include <string.h>
+#include "file.h"
+
+int file_map(const char *path, FileAccess access, FileMapping *mapping) {
+    mapping->data = NULL;
+    mapping->length = 0;
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if (access == FILE_ACCESS_SEQUENTIAL) {
+        flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    } else if (access == FILE_ACCESS_RANDOM) {
+        flags |= FILE_FLAG_RANDOM_ACCESS;
+    }
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return (int) GetLastError();
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        int status = (int) GetLastError();
+        CloseHandle(file);
+        return status;
+    }
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return 0;
+    }
+    HANDLE fileMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (fileMapping == NULL) {
+        return (int) GetLastError();
+    }
+    /* The view keeps the mapping object alive, so both handles can be closed right away. */
+    void *data = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+    int status = data == NULL ? (int) GetLastError() : 0;
+    CloseHandle(fileMapping);
+    if (status != 0) {
+        return status;
+    }
+    if (access == FILE_ACCESS_WILL_NEED) {
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = data;
+        range.NumberOfBytes = (SIZE_T) size.QuadPart;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+    mapping->data = data;
+    mapping->length = (usize) size.QuadPart;
+    return 0;
+}
+
+void file_unmap(FileMapping *mapping) {
+    if (mapping->data != NULL) {
+        UnmapViewOfFile(mapping->data);
+    }
+    mapping->data = NULL;
+    mapping->length = 0;
+}
+
+int file_open_read(const char *path, FileHandle *handle, u64 *size) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return (int) GetLastError();
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        int status = (int) GetLastError();
+        CloseHandle(file);
+        return status;
+    }
+    *handle = file;
+    *size = (u64) fileSize.QuadPart;
+    return 0;
+}
+
+int file_read_at(FileHandle handle, u64 offset, usize length, u8 *data, usize *bytes_read) {
+    usize total = 0;
+    while (total < length) {
+        usize remaining = length - total;
+        DWORD chunk = remaining > 0x40000000 ? 0x40000000 : (DWORD) remaining;
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(OVERLAPPED));
+        overlapped.Offset = (DWORD) (offset + total);
+        overlapped.OffsetHigh = (DWORD) ((offset + total) >> 32);
+        DWORD read = 0;
+        if (!ReadFile(handle, data + total, chunk, &read, &overlapped)) {
+            DWORD error = GetLastError();
+            if (error == ERROR_HANDLE_EOF) {
+                break;
+            }
+            *bytes_read = total;
+            return (int) error;
+        }
+        if (read == 0) {
+            break;
+        }
+        total += read;
+    }
+    *bytes_read = total;
+    return 0;
+}
+
+void file_close(FileHandle handle) {
+    CloseHandle(handle);
+}
+
+#endif
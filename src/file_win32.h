@@ -0,0 +1,8 @@
+#ifndef CGFS_FILE_WIN32_H
+#define CGFS_FILE_WIN32_H
+
+typedef void *FileHandle;
+
+#define INVALID_FILE_HANDLE ((FileHandle) (isize) -1)
+
+#endif //CGFS_FILE_WIN32_H
@@ -0,0 +1,521 @@
+#include "frame_stream.h"
+#include "atomic.h"
+#include "lz4.h"
+#include "mutex.h"
+#include "reactor.h"
+#include "thread.h"
+#include "timer.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+#define FRAME_STREAM_BACKLOG 16
+#define FRAME_STREAM_TILE_BYTES (FRAME_STREAM_TILE_SIZE * FRAME_STREAM_TILE_SIZE * 4)
+
+typedef struct frame_stream_connection_s {
+    FrameStreamServer *server;
+    ReactorSocket *sock;
+    u8 *reference;
+    u32 width;
+    u32 height;
+    u8 *message;
+    usize messageCapacity;
+    usize messageLength;
+    u64 frameNumber;
+    u32 operations;
+    bool sending;
+    bool closed;
+    u8 discard[64];
+    struct frame_stream_connection_s *previous;
+    struct frame_stream_connection_s *next;
+} FrameStreamConnection;
+
+/*
+ * The producer copies into pending under the mutex; the network thread swaps it with current. Tiles of the current
+ * frame are compressed at most once, the first time any connection needs them, and shared by every connection.
+ */
+struct frame_stream_server_s {
+    Reactor *reactor;
+    ReactorSocket *listener;
+    Thread thread;
+    volatile i32 stopping;
+    Mutex mutex;
+    u8 *pending;
+    usize pendingCapacity;
+    u32 pendingWidth;
+    u32 pendingHeight;
+    u64 pendingTimestamp;
+    bool hasPending;
+    u8 *current;
+    usize currentCapacity;
+    u32 width;
+    u32 height;
+    u64 frameNumber;
+    u64 timestamp;
+    u32 tileCountX;
+    u32 tileCount;
+    u8 *tileData;
+    u32 *tileLengths;
+    u32 tileCapacity;
+    usize tileStride;
+    FrameStreamConnection *connections;
+    FrameStreamStats stats;
+};
+
+static inline void frame_stream_get_tile_rect(u32 width, u32 height, u32 index, u32 *x, u32 *y, u32 *tile_width,
+                                              u32 *tile_height) {
+    u32 tileCountX = (width + FRAME_STREAM_TILE_SIZE - 1) / FRAME_STREAM_TILE_SIZE;
+    *x = (index % tileCountX) * FRAME_STREAM_TILE_SIZE;
+    *y = (index / tileCountX) * FRAME_STREAM_TILE_SIZE;
+    *tile_width = width - *x < FRAME_STREAM_TILE_SIZE ? width - *x : FRAME_STREAM_TILE_SIZE;
+    *tile_height = height - *y < FRAME_STREAM_TILE_SIZE ? height - *y : FRAME_STREAM_TILE_SIZE;
+}
+
+bool frame_stream_reserve(u8 **buffer, usize *capacity, usize size) {
+    if (*capacity >= size) {
+        return true;
+    }
+    u8 *grown = realloc(*buffer, size);
+    if (grown == NULL) {
+        return false;
+    }
+    *buffer = grown;
+    *capacity = size;
+    return true;
+}
+
+void frame_stream_connection_close(FrameStreamConnection *connection) {
+    if (!connection->closed) {
+        connection->closed = true;
+        reactor_close(connection->sock);
+    }
+}
+
+/* Frees a closed connection once the reactor returned its last outstanding operation. */
+void frame_stream_connection_release(FrameStreamConnection *connection) {
+    if (!connection->closed || connection->operations > 0) {
+        return;
+    }
+    FrameStreamServer *server = connection->server;
+    if (connection->previous != NULL) {
+        connection->previous->next = connection->next;
+    } else {
+        server->connections = connection->next;
+    }
+    if (connection->next != NULL) {
+        connection->next->previous = connection->previous;
+    }
+    mutex_lock(&server->mutex);
+    server->stats.clientCount--;
+    mutex_unlock(&server->mutex);
+    free(connection->reference);
+    free(connection->message);
+    free(connection);
+}
+
+u32 frame_stream_server_encode_tile(FrameStreamServer *server, u32 index) {
+    if (server->tileLengths[index] != 0) {
+        return server->tileLengths[index];
+    }
+    u32 x, y, tileWidth, tileHeight;
+    frame_stream_get_tile_rect(server->width, server->height, index, &x, &y, &tileWidth, &tileHeight);
+    u8 packed[FRAME_STREAM_TILE_BYTES];
+    usize rowBytes = (usize) tileWidth * 4;
+    for (u32 row = 0; row < tileHeight; row++) {
+        memcpy(packed + row * rowBytes, server->current + ((usize) (y + row) * server->width + x) * 4, rowBytes);
+    }
+    usize rawLength = rowBytes * tileHeight;
+    u8 *destination = server->tileData + index * server->tileStride;
+    usize length = lz4_compress(packed, rawLength, destination, rawLength - 1);
+    if (length == 0) {
+        memcpy(destination, packed, rawLength);
+        server->tileLengths[index] = (u32) rawLength | FRAME_STREAM_TILE_RAW;
+    } else {
+        server->tileLengths[index] = (u32) length;
+    }
+    return server->tileLengths[index];
+}
+
+/* Compares a tile against what the connection was sent last and refreshes that copy when it changed. */
+bool frame_stream_connection_update_tile(FrameStreamConnection *connection, const u8 *frame, u32 index) {
+    u32 x, y, tileWidth, tileHeight;
+    frame_stream_get_tile_rect(connection->width, connection->height, index, &x, &y, &tileWidth, &tileHeight);
+    usize rowBytes = (usize) tileWidth * 4;
+    bool changed = false;
+    for (u32 row = 0; row < tileHeight; row++) {
+        usize offset = ((usize) (y + row) * connection->width + x) * 4;
+        if (changed || memcmp(connection->reference + offset, frame + offset, rowBytes) != 0) {
+            memcpy(connection->reference + offset, frame + offset, rowBytes);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void frame_stream_send_callback(ReactorSocket *sock, int status, void *user_data);
+
+void frame_stream_server_send_frame(FrameStreamServer *server, FrameStreamConnection *connection) {
+    bool keyframe = connection->width != server->width || connection->height != server->height;
+    usize frameBytes = (usize) server->width * server->height * 4;
+    if (keyframe) {
+        free(connection->reference);
+        connection->reference = malloc(frameBytes);
+        if (connection->reference == NULL) {
+            frame_stream_connection_close(connection);
+            return;
+        }
+        connection->width = server->width;
+        connection->height = server->height;
+    }
+    usize capacity = sizeof(FrameStreamHeader) +
+                     (usize) server->tileCount * (sizeof(FrameStreamTileHeader) + server->tileStride);
+    if (!frame_stream_reserve(&connection->message, &connection->messageCapacity, capacity)) {
+        frame_stream_connection_close(connection);
+        return;
+    }
+    FrameStreamHeader header;
+    header.magic = FRAME_STREAM_MAGIC;
+    header.width = server->width;
+    header.height = server->height;
+    header.tileCount = 0;
+    header.frameNumber = server->frameNumber;
+    header.timestamp = server->timestamp;
+    u8 *output = connection->message + sizeof(FrameStreamHeader);
+    for (u32 i = 0; i < server->tileCount; i++) {
+        if (keyframe) {
+            u32 x, y, tileWidth, tileHeight;
+            frame_stream_get_tile_rect(server->width, server->height, i, &x, &y, &tileWidth, &tileHeight);
+            for (u32 row = 0; row < tileHeight; row++) {
+                usize offset = ((usize) (y + row) * server->width + x) * 4;
+                memcpy(connection->reference + offset, server->current + offset, (usize) tileWidth * 4);
+            }
+        } else if (!frame_stream_connection_update_tile(connection, server->current, i)) {
+            continue;
+        }
+        FrameStreamTileHeader tile;
+        tile.index = i;
+        tile.length = frame_stream_server_encode_tile(server, i);
+        memcpy(output, &tile, sizeof(FrameStreamTileHeader));
+        output += sizeof(FrameStreamTileHeader);
+        usize length = tile.length & ~FRAME_STREAM_TILE_RAW;
+        memcpy(output, server->tileData + i * server->tileStride, length);
+        output += length;
+        header.tileCount++;
+    }
+    connection->messageLength = output - connection->message;
+    header.payloadLength = connection->messageLength - sizeof(FrameStreamHeader);
+    memcpy(connection->message, &header, sizeof(FrameStreamHeader));
+    u64 dropped = connection->frameNumber != 0 ? server->frameNumber - connection->frameNumber - 1 : 0;
+    connection->frameNumber = server->frameNumber;
+    if (reactor_send(connection->sock, connection->message, connection->messageLength,
+                     frame_stream_send_callback) != 0) {
+        frame_stream_connection_close(connection);
+        return;
+    }
+    connection->sending = true;
+    connection->operations++;
+    mutex_lock(&server->mutex);
+    server->stats.framesDropped += dropped;
+    server->stats.tilesSent += header.tileCount;
+    mutex_unlock(&server->mutex);
+}
+
+void frame_stream_send_callback(ReactorSocket *sock, int status, void *user_data) {
+    FrameStreamConnection *connection = user_data;
+    FrameStreamServer *server = connection->server;
+    connection->sending = false;
+    connection->operations--;
+    if (status != 0) {
+        frame_stream_connection_close(connection);
+    } else {
+        mutex_lock(&server->mutex);
+        server->stats.framesSent++;
+        server->stats.bytesSent += connection->messageLength;
+        mutex_unlock(&server->mutex);
+        if (!connection->closed && connection->frameNumber < server->frameNumber) {
+            frame_stream_server_send_frame(server, connection);
+        }
+    }
+    frame_stream_connection_release(connection);
+}
+
+/* Clients never send anything; the receive only notices when they go away. */
+void frame_stream_receive_callback(ReactorSocket *sock, int status, usize length, void *user_data) {
+    FrameStreamConnection *connection = user_data;
+    connection->operations--;
+    if (status != 0 || length == 0) {
+        frame_stream_connection_close(connection);
+    } else if (!connection->closed &&
+               reactor_receive(sock, connection->discard, sizeof(connection->discard),
+                               frame_stream_receive_callback) == 0) {
+        connection->operations++;
+    }
+    frame_stream_connection_release(connection);
+}
+
+void frame_stream_accept_callback(ReactorSocket *listener, ReactorSocket *sock, void *user_data) {
+    FrameStreamServer *server = user_data;
+    FrameStreamConnection *connection = calloc(1, sizeof(FrameStreamConnection));
+    if (connection == NULL) {
+        reactor_close(sock);
+        return;
+    }
+    connection->server = server;
+    connection->sock = sock;
+    int noDelay = 1;
+    socket_set_option(reactor_socket_get_handle(sock), IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    reactor_socket_set_user_data(sock, connection);
+    connection->next = server->connections;
+    if (server->connections != NULL) {
+        server->connections->previous = connection;
+    }
+    server->connections = connection;
+    mutex_lock(&server->mutex);
+    server->stats.clientCount++;
+    mutex_unlock(&server->mutex);
+    if (reactor_receive(sock, connection->discard, sizeof(connection->discard), frame_stream_receive_callback) != 0) {
+        frame_stream_connection_close(connection);
+        frame_stream_connection_release(connection);
+        return;
+    }
+    connection->operations++;
+    if (server->frameNumber != 0) {
+        frame_stream_server_send_frame(server, connection);
+    }
+}
+
+/* Takes the newest submitted frame, if any, and starts sending it to every connection that is idle. */
+void frame_stream_server_publish(FrameStreamServer *server) {
+    mutex_lock(&server->mutex);
+    if (!server->hasPending) {
+        mutex_unlock(&server->mutex);
+        return;
+    }
+    u8 *frame = server->pending;
+    usize capacity = server->pendingCapacity;
+    server->pending = server->current;
+    server->pendingCapacity = server->currentCapacity;
+    server->current = frame;
+    server->currentCapacity = capacity;
+    server->width = server->pendingWidth;
+    server->height = server->pendingHeight;
+    server->timestamp = server->pendingTimestamp;
+    server->frameNumber = server->stats.framesSubmitted;
+    server->hasPending = false;
+    mutex_unlock(&server->mutex);
+    server->tileCountX = (server->width + FRAME_STREAM_TILE_SIZE - 1) / FRAME_STREAM_TILE_SIZE;
+    server->tileCount = server->tileCountX * ((server->height + FRAME_STREAM_TILE_SIZE - 1) / FRAME_STREAM_TILE_SIZE);
+    if (server->tileCount > server->tileCapacity) {
+        free(server->tileData);
+        free(server->tileLengths);
+        server->tileData = malloc(server->tileCount * server->tileStride);
+        server->tileLengths = malloc(server->tileCount * sizeof(u32));
+        server->tileCapacity = server->tileData != NULL && server->tileLengths != NULL ? server->tileCount : 0;
+        if (server->tileCapacity == 0) {
+            server->tileCount = 0;
+        }
+    }
+    memset(server->tileLengths, 0, server->tileCount * sizeof(u32));
+    FrameStreamConnection *connection = server->connections;
+    while (connection != NULL) {
+        FrameStreamConnection *next = connection->next;
+        if (!connection->sending && !connection->closed) {
+            frame_stream_server_send_frame(server, connection);
+            frame_stream_connection_release(connection);
+        }
+        connection = next;
+    }
+}
+
+void *frame_stream_server_thread(void *arg) {
+    FrameStreamServer *server = arg;
+    while (!atomic_load_i32(&server->stopping, ATOMIC_ACQUIRE)) {
+        reactor_run_once(server->reactor, -1);
+        frame_stream_server_publish(server);
+    }
+    return NULL;
+}
+
+FrameStreamServer *frame_stream_server_create(const struct sockaddr *addr, int addr_length) {
+    FrameStreamServer *server = calloc(1, sizeof(FrameStreamServer));
+    if (server == NULL) {
+        return NULL;
+    }
+    server->tileStride = lz4_compress_bound(FRAME_STREAM_TILE_BYTES);
+    server->reactor = reactor_create();
+    if (server->reactor == NULL) {
+        free(server);
+        return NULL;
+    }
+    server->listener = reactor_listen(server->reactor, addr, addr_length, FRAME_STREAM_BACKLOG,
+                                      frame_stream_accept_callback, server);
+    if (server->listener == NULL) {
+        reactor_destroy(server->reactor);
+        free(server);
+        return NULL;
+    }
+    mutex_init(&server->mutex);
+    server->thread = thread_create(frame_stream_server_thread, server);
+    if (server->thread == 0) {
+        reactor_destroy(server->reactor);
+        mutex_destroy(&server->mutex);
+        free(server);
+        return NULL;
+    }
+    return server;
+}
+
+void frame_stream_server_destroy(FrameStreamServer *server) {
+    atomic_store_i32(&server->stopping, 1, ATOMIC_RELEASE);
+    reactor_wake(server->reactor);
+    usize result;
+    thread_join(server->thread, &result);
+    reactor_destroy(server->reactor);
+    while (server->connections != NULL) {
+        FrameStreamConnection *connection = server->connections;
+        server->connections = connection->next;
+        free(connection->reference);
+        free(connection->message);
+        free(connection);
+    }
+    mutex_destroy(&server->mutex);
+    free(server->pending);
+    free(server->current);
+    free(server->tileData);
+    free(server->tileLengths);
+    free(server);
+}
+
+int frame_stream_server_submit(FrameStreamServer *server, const u8 *pixels, u32 width, u32 height) {
+    usize size = (usize) width * height * 4;
+    mutex_lock(&server->mutex);
+    if (!frame_stream_reserve(&server->pending, &server->pendingCapacity, size)) {
+        mutex_unlock(&server->mutex);
+        return ENOMEM;
+    }
+    memcpy(server->pending, pixels, size);
+    server->pendingWidth = width;
+    server->pendingHeight = height;
+    server->pendingTimestamp = timer_get_time_ns();
+    server->hasPending = true;
+    server->stats.framesSubmitted++;
+    mutex_unlock(&server->mutex);
+    reactor_wake(server->reactor);
+    return 0;
+}
+
+FrameStreamStats frame_stream_server_get_stats(FrameStreamServer *server) {
+    mutex_lock(&server->mutex);
+    FrameStreamStats stats = server->stats;
+    mutex_unlock(&server->mutex);
+    return stats;
+}
+
+int frame_stream_receive_all(Socket sock, u8 *buffer, usize length) {
+    while (length > 0) {
+        isize received = socket_receive(sock, buffer, length, 0);
+        if (received == 0) {
+            return -1;
+        }
+        if (received < 0) {
+            int status = socket_get_last_error();
+            if (status == EINTR) {
+                continue;
+            }
+            return status;
+        }
+        buffer += received;
+        length -= received;
+    }
+    return 0;
+}
+
+int frame_stream_receiver_connect(FrameStreamReceiver *receiver, const struct sockaddr *addr, int addr_length) {
+    memset(receiver, 0, sizeof(FrameStreamReceiver));
+    receiver->sock = socket_create(addr->sa_family, SOCK_STREAM, IPPROTO_TCP);
+    if (receiver->sock == INVALID_SOCKET_HANDLE) {
+        return socket_get_last_error();
+    }
+    if (socket_connect(receiver->sock, addr, addr_length) != 0) {
+        int status = socket_get_last_error();
+        socket_close(receiver->sock);
+        receiver->sock = INVALID_SOCKET_HANDLE;
+        return status;
+    }
+    return 0;
+}
+
+int frame_stream_receiver_receive(FrameStreamReceiver *receiver) {
+    FrameStreamHeader header;
+    int status = frame_stream_receive_all(receiver->sock, (u8 *) &header, sizeof(FrameStreamHeader));
+    if (status != 0) {
+        return status;
+    }
+    if (header.magic != FRAME_STREAM_MAGIC ||
+        !frame_stream_reserve(&receiver->payload, &receiver->payloadCapacity, header.payloadLength)) {
+        return EPROTO;
+    }
+    status = frame_stream_receive_all(receiver->sock, receiver->payload, header.payloadLength);
+    if (status != 0) {
+        return status;
+    }
+    if (header.width != receiver->header.width || header.height != receiver->header.height ||
+        receiver->pixels == NULL) {
+        free(receiver->pixels);
+        receiver->pixels = calloc((usize) header.width * header.height, 4);
+        if (receiver->pixels == NULL) {
+            return ENOMEM;
+        }
+    }
+    receiver->header = header;
+    u32 tileCount = ((header.width + FRAME_STREAM_TILE_SIZE - 1) / FRAME_STREAM_TILE_SIZE) *
+                    ((header.height + FRAME_STREAM_TILE_SIZE - 1) / FRAME_STREAM_TILE_SIZE);
+    const u8 *input = receiver->payload;
+    const u8 *end = receiver->payload + header.payloadLength;
+    u8 packed[FRAME_STREAM_TILE_BYTES];
+    for (u32 i = 0; i < header.tileCount; i++) {
+        FrameStreamTileHeader tile;
+        if ((usize) (end - input) < sizeof(FrameStreamTileHeader)) {
+            return EPROTO;
+        }
+        memcpy(&tile, input, sizeof(FrameStreamTileHeader));
+        input += sizeof(FrameStreamTileHeader);
+        usize length = tile.length & ~FRAME_STREAM_TILE_RAW;
+        if (tile.index >= tileCount || (usize) (end - input) < length) {
+            return EPROTO;
+        }
+        u32 x, y, tileWidth, tileHeight;
+        frame_stream_get_tile_rect(header.width, header.height, tile.index, &x, &y, &tileWidth, &tileHeight);
+        usize rowBytes = (usize) tileWidth * 4;
+        usize rawLength = rowBytes * tileHeight;
+        const u8 *rows = input;
+        if (!(tile.length & FRAME_STREAM_TILE_RAW)) {
+            if (lz4_decompress(input, length, packed, sizeof(packed)) != (isize) rawLength) {
+                return EPROTO;
+            }
+            rows = packed;
+        } else if (length != rawLength) {
+            return EPROTO;
+        }
+        for (u32 row = 0; row < tileHeight; row++) {
+            memcpy(receiver->pixels + ((usize) (y + row) * header.width + x) * 4, rows + row * rowBytes, rowBytes);
+        }
+        input += length;
+    }
+    return 0;
+}
+
+void frame_stream_receiver_close(FrameStreamReceiver *receiver) {
+    if (receiver->sock != INVALID_SOCKET_HANDLE) {
+        socket_close(receiver->sock);
+    }
+    free(receiver->pixels);
+    free(receiver->payload);
+    memset(receiver, 0, sizeof(FrameStreamReceiver));
+    receiver->sock = INVALID_SOCKET_HANDLE;
+}
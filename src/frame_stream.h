@@ -0,0 +1,72 @@
+#ifndef CGFS_FRAME_STREAM_H
+#define CGFS_FRAME_STREAM_H
+
+#include "socket.h"
+#include "types.h"
+
+#define FRAME_STREAM_MAGIC 0x53464743u
+#define FRAME_STREAM_TILE_SIZE 64
+#define FRAME_STREAM_TILE_RAW 0x80000000u
+
+/*
+ * Wire format, in host byte order: a header, then tileCount records of a tile header followed by its data. A tile
+ * holds the RGBA8 rows of one FRAME_STREAM_TILE_SIZE square of the frame, clipped at the edges, as an LZ4 block or
+ * raw when FRAME_STREAM_TILE_RAW is set. Only tiles that differ from the previous frame sent on the connection are
+ * included, so the first frame and every size change carry all tiles.
+ */
+typedef struct frame_stream_header_s {
+    u32 magic;
+    u32 width;
+    u32 height;
+    u32 tileCount;
+    u64 frameNumber;
+    u64 timestamp;
+    u64 payloadLength;
+} FrameStreamHeader;
+
+typedef struct frame_stream_tile_header_s {
+    u32 index;
+    u32 length;
+} FrameStreamTileHeader;
+
+typedef struct frame_stream_server_s FrameStreamServer;
+
+typedef struct frame_stream_stats_s {
+    u32 clientCount;
+    u64 framesSubmitted;
+    u64 framesSent;
+    u64 framesDropped;
+    u64 tilesSent;
+    u64 bytesSent;
+} FrameStreamStats;
+
+/* Listens on addr and serves clients from a thread of its own. */
+FrameStreamServer *frame_stream_server_create(const struct sockaddr *addr, int addr_length);
+
+void frame_stream_server_destroy(FrameStreamServer *server);
+
+/*
+ * Copies an RGBA8 frame and returns without touching the network. A client still busy with an earlier frame skips
+ * to the newest one once it caught up, so slow clients drop frames rather than holding up the caller.
+ */
+int frame_stream_server_submit(FrameStreamServer *server, const u8 *pixels, u32 width, u32 height);
+
+FrameStreamStats frame_stream_server_get_stats(FrameStreamServer *server);
+
+/* Blocking client side, which keeps the reconstructed frame in pixels. */
+typedef struct frame_stream_receiver_s {
+    Socket sock;
+    FrameStreamHeader header;
+    u8 *pixels;
+    u8 *payload;
+    usize payloadCapacity;
+} FrameStreamReceiver;
+
+int frame_stream_receiver_connect(FrameStreamReceiver *receiver, const struct sockaddr *addr, int addr_length);
+
+/* Waits for the next frame and applies it. Returns 0, -1 once the server closed the connection, or an error. */
+int frame_stream_receiver_receive(FrameStreamReceiver *receiver);
+
+void frame_stream_receiver_close(FrameStreamReceiver *receiver);
+
+#endif //CGFS_FRAME_STREAM_H
@@ -0,0 +1,12 @@
+#ifndef CGFS_FUTEX_H
+#define CGFS_FUTEX_H
+
+#include "types.h"
+
+int futex_wait(volatile i32 *address, i32 expected);
+
+int futex_wake_one(volatile i32 *address);
+
+int futex_wake_all(volatile i32 *address);
+
+#endif //CGFS_FUTEX_H
@@ -0,0 +1,26 @@
+#ifdef __linux__
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "futex.h"
+
+int futex_wait(volatile i32 *address, i32 expected) {
+    long status = syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+    if (status != 0 && errno != EAGAIN && errno != EINTR) {
+        return -1;
+    }
+    return 0;
+}
+
+int futex_wake_one(volatile i32 *address) {
+    return syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0) < 0 ? -1 : 0;
+}
+
+int futex_wake_all(volatile i32 *address) {
+    return syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0) < 0 ? -1 : 0;
+}
+
+#endif
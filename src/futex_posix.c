@@ -0,0 +1,64 @@
+#if !defined(_WIN32) && !defined(__linux__)
+
+#include <pthread.h>
+#include "atomic.h"
+#include "futex.h"
+
+#define FUTEX_BUCKET_COUNT 64
+
+/*
+ * Emulation for systems without a futex syscall. Addresses hash onto a fixed set of mutex and condition pairs; the
+ * value is compared under the bucket mutex, and wakers take the same mutex, so a wake issued after the value changed
+ * can never slip in between the comparison and the wait. Unrelated addresses may share a bucket, so every wake is a
+ * broadcast and waiters see the occasional spurious return, which callers already tolerate.
+ */
+typedef struct futex_bucket_s {
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+} FutexBucket;
+
+static FutexBucket futex_buckets[FUTEX_BUCKET_COUNT];
+static pthread_once_t futex_buckets_once = PTHREAD_ONCE_INIT;
+
+void futex_init_buckets() {
+    for (u32 i = 0; i < FUTEX_BUCKET_COUNT; i++) {
+        pthread_mutex_init(&futex_buckets[i].mutex, 0);
+        pthread_cond_init(&futex_buckets[i].condition, 0);
+    }
+}
+
+FutexBucket *futex_get_bucket(volatile i32 *address) {
+    pthread_once(&futex_buckets_once, futex_init_buckets);
+    usize hash = (usize) address >> 2;
+    hash ^= hash >> 7;
+    return &futex_buckets[hash % FUTEX_BUCKET_COUNT];
+}
+
+int futex_wait(volatile i32 *address, i32 expected) {
+    FutexBucket *bucket = futex_get_bucket(address);
+    pthread_mutex_lock(&bucket->mutex);
+    int status = 0;
+    if (atomic_load_i32(address, ATOMIC_ACQUIRE) == expected) {
+        status = pthread_cond_wait(&bucket->condition, &bucket->mutex);
+    }
+    pthread_mutex_unlock(&bucket->mutex);
+    return status != 0 ? -1 : 0;
+}
+
+int futex_wake(volatile i32 *address) {
+    FutexBucket *bucket = futex_get_bucket(address);
+    pthread_mutex_lock(&bucket->mutex);
+    int status = pthread_cond_broadcast(&bucket->condition);
+    pthread_mutex_unlock(&bucket->mutex);
+    return status != 0 ? -1 : 0;
+}
+
+int futex_wake_one(volatile i32 *address) {
+    return futex_wake(address);
+}
+
+int futex_wake_all(volatile i32 *address) {
+    return futex_wake(address);
+}
+
+#endif
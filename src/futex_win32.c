@@ -0,0 +1,23 @@
+#ifdef _WIN32
+
+#include <windows.h>
+#include "futex.h"
+
+int futex_wait(volatile i32 *address, i32 expected) {
+    if (!WaitOnAddress(address, &expected, sizeof(i32), INFINITE)) {
+        return -1;
+    }
+    return 0;
+}
+
+int futex_wake_one(volatile i32 *address) {
+    WakeByAddressSingle((PVOID) address);
+    return 0;
+}
+
+int futex_wake_all(volatile i32 *address) {
+    WakeByAddressAll((PVOID) address);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,387 @@
+#include <stdlib.h>
+#include <string.h>
+#include "job.h"
+#include "atomic.h"
+#include "futex.h"
+#include "sync.h"
+#include "thread.h"
+
+#define JOB_DEQUE_CAPACITY 4096
+#define JOB_MAX_THREADS 64
+#define JOB_IDLE_SPIN_COUNT 256
+
+typedef struct job_s {
+    JobFunction function;
+    void *arg;
+    JobCounter *counter;
+} Job;
+
+/*
+ * Chase-Lev work-stealing deque. The owning thread pushes and pops at the bottom, other threads steal from the top.
+ * Jobs are stored by value; a thief that reads a slot the owner is concurrently reusing always fails its CAS on top
+ * and discards the copy.
+ */
+typedef struct job_deque_s {
+    i64 top;
+    u8 topPadding[64 - sizeof(i64)];
+    i64 bottom;
+    u8 bottomPadding[64 - sizeof(i64)];
+    Job jobs[JOB_DEQUE_CAPACITY];
+} JobDeque;
+
+typedef struct job_thread_s {
+    JobDeque deque;
+    Thread thread;
+    u32 index;
+    u32 random;
+} JobThread;
+
+typedef struct job_system_s {
+    JobThread *threads;
+    u32 threadCount;
+    bool initialized;
+    i32 threadZeroAttached;
+    i32 quit;
+    i32 pendingJobCount;
+    i32 sleepingThreadCount;
+    LightMutex sleepMutex;
+    LightCondition wakeCondition;
+} JobSystem;
+
+static JobSystem job_system;
+
+static THREAD_LOCAL JobThread *job_current_thread;
+
+bool job_deque_push(JobDeque *deque, const Job *job) {
+    i64 bottom = atomic_load_i64(&deque->bottom, ATOMIC_RELAXED);
+    i64 top = atomic_load_i64(&deque->top, ATOMIC_ACQUIRE);
+    if (bottom - top >= JOB_DEQUE_CAPACITY) {
+        return false;
+    }
+    deque->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)] = *job;
+    atomic_fence(ATOMIC_RELEASE);
+    atomic_store_i64(&deque->bottom, bottom + 1, ATOMIC_RELAXED);
+    return true;
+}
+
+bool job_deque_pop(JobDeque *deque, Job *job) {
+    i64 bottom = atomic_load_i64(&deque->bottom, ATOMIC_RELAXED) - 1;
+    atomic_store_i64(&deque->bottom, bottom, ATOMIC_RELAXED);
+    atomic_fence(ATOMIC_SEQ_CST);
+    i64 top = atomic_load_i64(&deque->top, ATOMIC_RELAXED);
+    if (top > bottom) {
+        atomic_store_i64(&deque->bottom, bottom + 1, ATOMIC_RELAXED);
+        return false;
+    }
+    *job = deque->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)];
+    if (top < bottom) {
+        return true;
+    }
+    bool taken = atomic_compare_exchange_i64(&deque->top, &top, top + 1, ATOMIC_SEQ_CST, ATOMIC_RELAXED);
+    atomic_store_i64(&deque->bottom, bottom + 1, ATOMIC_RELAXED);
+    return taken;
+}
+
+bool job_deque_steal(JobDeque *deque, Job *job) {
+    i64 top = atomic_load_i64(&deque->top, ATOMIC_ACQUIRE);
+    atomic_fence(ATOMIC_SEQ_CST);
+    i64 bottom = atomic_load_i64(&deque->bottom, ATOMIC_ACQUIRE);
+    if (top >= bottom) {
+        return false;
+    }
+    *job = deque->jobs[top & (JOB_DEQUE_CAPACITY - 1)];
+    return atomic_compare_exchange_i64(&deque->top, &top, top + 1, ATOMIC_SEQ_CST, ATOMIC_RELAXED);
+}
+
+void job_wake_threads() {
+    if (atomic_load_i32(&job_system.sleepingThreadCount, ATOMIC_SEQ_CST) > 0) {
+        light_mutex_lock(&job_system.sleepMutex);
+        light_condition_signal(&job_system.wakeCondition);
+        light_mutex_unlock(&job_system.sleepMutex);
+    }
+}
+
+void job_execute(const Job *job);
+
+void job_schedule(const Job *job) {
+    JobThread *thread = job_current_thread;
+    if (thread == NULL || !job_deque_push(&thread->deque, job)) {
+        job_execute(job);
+        return;
+    }
+    atomic_fetch_add_i32(&job_system.pendingJobCount, 1, ATOMIC_SEQ_CST);
+    job_wake_threads();
+}
+
+/*
+ * Only the final decrement takes the counter lock, and it publishes zero while still holding it. A waiter that sees
+ * zero takes the lock once before returning, so the counter is never touched after its owner may have freed it.
+ */
+void job_complete(JobCounter *counter) {
+    i32 value = atomic_load_i32(&counter->value, ATOMIC_RELAXED);
+    while (value > 1) {
+        if (atomic_compare_exchange_i32(&counter->value, &value, value - 1, ATOMIC_ACQ_REL, ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+    spin_lock(&counter->lock);
+    if (atomic_fetch_add_i32(&counter->value, -1, ATOMIC_SEQ_CST) != 1) {
+        spin_unlock(&counter->lock);
+        return;
+    }
+    JobDependent *dependent = counter->dependents;
+    counter->dependents = NULL;
+    if (atomic_load_i32(&counter->waiterCount, ATOMIC_SEQ_CST) > 0) {
+        futex_wake_all(&counter->value);
+    }
+    spin_unlock(&counter->lock);
+    while (dependent != NULL) {
+        JobDependent *next = dependent->next;
+        Job job = {dependent->function, dependent->arg, dependent->counter};
+        free(dependent);
+        job_schedule(&job);
+        dependent = next;
+    }
+}
+
+void job_execute(const Job *job) {
+    job->function(job->arg);
+    if (job->counter != NULL) {
+        job_complete(job->counter);
+    }
+}
+
+bool job_find(JobThread *thread, Job *job) {
+    if (thread != NULL && job_deque_pop(&thread->deque, job)) {
+        atomic_fetch_add_i32(&job_system.pendingJobCount, -1, ATOMIC_SEQ_CST);
+        return true;
+    }
+    u32 start = 0;
+    if (thread != NULL) {
+        thread->random ^= thread->random << 13;
+        thread->random ^= thread->random >> 17;
+        thread->random ^= thread->random << 5;
+        start = thread->random;
+    }
+    for (u32 i = 0; i < job_system.threadCount; i++) {
+        JobThread *victim = &job_system.threads[(start + i) % job_system.threadCount];
+        if (victim != thread && job_deque_steal(&victim->deque, job)) {
+            atomic_fetch_add_i32(&job_system.pendingJobCount, -1, ATOMIC_SEQ_CST);
+            return true;
+        }
+    }
+    return false;
+}
+
+void *job_worker_entry_point(void *arg) {
+    JobThread *thread = arg;
+    job_current_thread = thread;
+    u32 idleSpinCount = 0;
+    while (!atomic_load_i32(&job_system.quit, ATOMIC_ACQUIRE)) {
+        Job job;
+        if (job_find(thread, &job)) {
+            job_execute(&job);
+            idleSpinCount = 0;
+            continue;
+        }
+        if (++idleSpinCount < JOB_IDLE_SPIN_COUNT) {
+            atomic_pause();
+            continue;
+        }
+        idleSpinCount = 0;
+        light_mutex_lock(&job_system.sleepMutex);
+        atomic_fetch_add_i32(&job_system.sleepingThreadCount, 1, ATOMIC_SEQ_CST);
+        while (!atomic_load_i32(&job_system.quit, ATOMIC_SEQ_CST) &&
+               atomic_load_i32(&job_system.pendingJobCount, ATOMIC_SEQ_CST) == 0) {
+            light_condition_wait(&job_system.wakeCondition, &job_system.sleepMutex);
+        }
+        atomic_fetch_add_i32(&job_system.sleepingThreadCount, -1, ATOMIC_SEQ_CST);
+        light_mutex_unlock(&job_system.sleepMutex);
+    }
+    return NULL;
+}
+
+/*
+ * Thread 0 is the calling thread, which keeps running its own code and only executes jobs while it waits on a
+ * counter. A worker_count of zero starts one worker per remaining processor.
+ */
+int job_system_init(u32 worker_count) {
+    if (job_system.initialized) {
+        return 0;
+    }
+    if (worker_count == 0) {
+        worker_count = thread_get_processor_count() - 1;
+    }
+    if (worker_count + 1 > JOB_MAX_THREADS) {
+        worker_count = JOB_MAX_THREADS - 1;
+    }
+    job_system.threads = calloc(worker_count + 1, sizeof(JobThread));
+    if (job_system.threads == NULL) {
+        return -1;
+    }
+    job_system.quit = 0;
+    job_system.pendingJobCount = 0;
+    job_system.sleepingThreadCount = 0;
+    light_mutex_init(&job_system.sleepMutex);
+    light_condition_init(&job_system.wakeCondition);
+    for (u32 i = 0; i <= worker_count; i++) {
+        job_system.threads[i].index = i;
+        job_system.threads[i].random = 0x9E3779B9u * (i + 1);
+    }
+    job_system.threadCount = worker_count + 1;
+    job_system.threadZeroAttached = 1;
+    job_current_thread = &job_system.threads[0];
+    job_system.initialized = true;
+    for (u32 i = 1; i <= worker_count; i++) {
+        job_system.threads[i].thread = thread_create(job_worker_entry_point, &job_system.threads[i]);
+        if (job_system.threads[i].thread == 0) {
+            job_system.threadCount = i;
+            job_system_destroy();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void job_system_destroy() {
+    if (!job_system.initialized) {
+        return;
+    }
+    Job job;
+    while (job_find(job_current_thread, &job)) {
+        job_execute(&job);
+    }
+    light_mutex_lock(&job_system.sleepMutex);
+    atomic_store_i32(&job_system.quit, 1, ATOMIC_SEQ_CST);
+    light_condition_broadcast(&job_system.wakeCondition);
+    light_mutex_unlock(&job_system.sleepMutex);
+    for (u32 i = 1; i < job_system.threadCount; i++) {
+        usize threadResult;
+        thread_join(job_system.threads[i].thread, &threadResult);
+    }
+    free(job_system.threads);
+    memset(&job_system, 0, sizeof(JobSystem));
+    job_current_thread = NULL;
+}
+
+/*
+ * Thread 0 can be handed to another thread, such as one that drives the renderer while the thread that started the
+ * job system blocks in an event loop. The current owner detaches first, which runs whatever is left in its deque so
+ * no job stays stranded, and the new one attaches. Attaching fails while thread 0 is still taken.
+ */
+int job_system_attach_thread() {
+    i32 expected = 0;
+    if (!job_system.initialized || job_current_thread != NULL ||
+        !atomic_compare_exchange_i32(&job_system.threadZeroAttached, &expected, 1, ATOMIC_ACQUIRE, ATOMIC_RELAXED)) {
+        return -1;
+    }
+    job_current_thread = &job_system.threads[0];
+    return 0;
+}
+
+void job_system_detach_thread() {
+    JobThread *thread = job_current_thread;
+    if (thread == NULL || thread->index != 0) {
+        return;
+    }
+    Job job;
+    while (job_deque_pop(&thread->deque, &job)) {
+        atomic_fetch_add_i32(&job_system.pendingJobCount, -1, ATOMIC_SEQ_CST);
+        job_execute(&job);
+    }
+    job_current_thread = NULL;
+    atomic_store_i32(&job_system.threadZeroAttached, 0, ATOMIC_RELEASE);
+}
+
+u32 job_system_get_thread_count() {
+    return job_system.initialized ? job_system.threadCount : 1;
+}
+
+u32 job_get_thread_index() {
+    return job_current_thread != NULL ? job_current_thread->index : INVALID_JOB_THREAD;
+}
+
+void job_counter_init(JobCounter *counter) {
+    counter->value = 0;
+    counter->waiterCount = 0;
+    spin_lock_init(&counter->lock);
+    counter->dependents = NULL;
+}
+
+bool job_counter_is_done(JobCounter *counter) {
+    if (atomic_load_i32(&counter->value, ATOMIC_ACQUIRE) != 0) {
+        return false;
+    }
+    spin_lock(&counter->lock);
+    spin_unlock(&counter->lock);
+    return true;
+}
+
+void job_run(JobFunction function, void *arg, JobCounter *counter) {
+    if (counter != NULL) {
+        atomic_fetch_add_i32(&counter->value, 1, ATOMIC_RELAXED);
+    }
+    Job job = {function, arg, counter};
+    job_schedule(&job);
+}
+
+void job_run_after(JobCounter *dependency, JobFunction function, void *arg, JobCounter *counter) {
+    if (counter != NULL) {
+        atomic_fetch_add_i32(&counter->value, 1, ATOMIC_RELAXED);
+    }
+    Job job = {function, arg, counter};
+    if (dependency != NULL) {
+        JobDependent *dependent = malloc(sizeof(JobDependent));
+        if (dependent != NULL) {
+            spin_lock(&dependency->lock);
+            if (atomic_load_i32(&dependency->value, ATOMIC_ACQUIRE) != 0) {
+                dependent->function = function;
+                dependent->arg = arg;
+                dependent->counter = counter;
+                dependent->next = dependency->dependents;
+                dependency->dependents = dependent;
+                spin_unlock(&dependency->lock);
+                return;
+            }
+            spin_unlock(&dependency->lock);
+            free(dependent);
+        } else {
+            job_wait(dependency);
+        }
+    }
+    job_schedule(&job);
+}
+
+/*
+ * Waiting threads execute other jobs while the counter is pending and only sleep on the counter once there has been
+ * nothing to steal for a while.
+ */
+void job_wait(JobCounter *counter) {
+    JobThread *thread = job_current_thread;
+    u32 idleSpinCount = 0;
+    for (;;) {
+        i32 value = atomic_load_i32(&counter->value, ATOMIC_ACQUIRE);
+        if (value == 0) {
+            break;
+        }
+        Job job;
+        if (job_system.initialized && job_find(thread, &job)) {
+            job_execute(&job);
+            idleSpinCount = 0;
+            continue;
+        }
+        if (++idleSpinCount < JOB_IDLE_SPIN_COUNT) {
+            atomic_pause();
+            continue;
+        }
+        idleSpinCount = 0;
+        atomic_fetch_add_i32(&counter->waiterCount, 1, ATOMIC_SEQ_CST);
+        value = atomic_load_i32(&counter->value, ATOMIC_SEQ_CST);
+        if (value != 0) {
+            futex_wait(&counter->value, value);
+        }
+        atomic_fetch_add_i32(&counter->waiterCount, -1, ATOMIC_SEQ_CST);
+    }
+    spin_lock(&counter->lock);
+    spin_unlock(&counter->lock);
+}
@@ -0,0 +1,47 @@
+#ifndef CGFS_JOB_H
+#define CGFS_JOB_H
+
+#include "types.h"
+#include "sync.h"
+
+#define INVALID_JOB_THREAD 0xFFFFFFFF
+
+typedef void (*JobFunction)(void *arg);
+
+typedef struct job_dependent_s {
+    JobFunction function;
+    void *arg;
+    struct job_counter_s *counter;
+    struct job_dependent_s *next;
+} JobDependent;
+
+typedef struct job_counter_s {
+    i32 value;
+    i32 waiterCount;
+    SpinLock lock;
+    JobDependent *dependents;
+} JobCounter;
+
+int job_system_init(u32 worker_count);
+
+void job_system_destroy();
+
+u32 job_system_get_thread_count();
+
+int job_system_attach_thread();
+
+void job_system_detach_thread();
+
+u32 job_get_thread_index();
+
+void job_counter_init(JobCounter *counter);
+
+bool job_counter_is_done(JobCounter *counter);
+
+void job_run(JobFunction function, void *arg, JobCounter *counter);
+
+void job_run_after(JobCounter *dependency, JobFunction function, void *arg, JobCounter *counter);
+
+void job_wait(JobCounter *counter);
+
+#endif //CGFS_JOB_H
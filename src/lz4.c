@@ -0,0 +1,167 @@
+#include "lz4.h"
+#include <string.h>
+
+#define LZ4_HASH_BITS 12
+#define LZ4_MIN_MATCH 4
+#define LZ4_MAX_OFFSET 65535
+/* The format requires the last 5 bytes to be literals and the last match to start at least 12 bytes before the end. */
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MATCH_FIND_LIMIT 12
+
+static inline u32 lz4_read_u32(const u8 *address) {
+    u32 value;
+    memcpy(&value, address, sizeof(u32));
+    return value;
+}
+
+static inline u32 lz4_hash(u32 sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+bool lz4_write_length(u8 **output, const u8 *end, usize length) {
+    for (; length >= 255; length -= 255) {
+        if (*output >= end) {
+            return false;
+        }
+        *(*output)++ = 255;
+    }
+    if (*output >= end) {
+        return false;
+    }
+    *(*output)++ = (u8) length;
+    return true;
+}
+
+bool lz4_write_sequence(u8 **output, const u8 *end, const u8 *literals, usize literal_length, usize offset,
+                        usize match_length) {
+    if (*output >= end) {
+        return false;
+    }
+    u8 *token = (*output)++;
+    *token = (u8) ((literal_length >= 15 ? 15 : literal_length) << 4);
+    if (literal_length >= 15 && !lz4_write_length(output, end, literal_length - 15)) {
+        return false;
+    }
+    if ((usize) (end - *output) < literal_length) {
+        return false;
+    }
+    memcpy(*output, literals, literal_length);
+    *output += literal_length;
+    if (match_length == 0) {
+        return true;
+    }
+    if (end - *output < 2) {
+        return false;
+    }
+    *(*output)++ = (u8) offset;
+    *(*output)++ = (u8) (offset >> 8);
+    usize length = match_length - LZ4_MIN_MATCH;
+    *token |= (u8) (length >= 15 ? 15 : length);
+    return length < 15 || lz4_write_length(output, end, length - 15);
+}
+
+usize lz4_compress_bound(usize size) {
+    return size + size / 255 + 16;
+}
+
+/* Greedy single-probe matcher; quick enough for offline packing and decodes with any LZ4 decoder. */
+usize lz4_compress(const u8 *source, usize size, u8 *destination, usize capacity) {
+    u32 table[1 << LZ4_HASH_BITS];
+    memset(table, 0, sizeof(table));
+    u8 *output = destination;
+    const u8 *end = destination + capacity;
+    usize anchor = 0;
+    if (size > LZ4_MATCH_FIND_LIMIT) {
+        usize searchEnd = size - LZ4_MATCH_FIND_LIMIT;
+        usize matchLimit = size - LZ4_LAST_LITERALS;
+        usize position = 0;
+        while (position < searchEnd) {
+            u32 sequence = lz4_read_u32(source + position);
+            u32 hash = lz4_hash(sequence);
+            usize candidate = table[hash];
+            table[hash] = (u32) position;
+            if (candidate >= position || position - candidate > LZ4_MAX_OFFSET ||
+                lz4_read_u32(source + candidate) != sequence) {
+                position++;
+                continue;
+            }
+            usize length = LZ4_MIN_MATCH;
+            while (position + length < matchLimit && source[candidate + length] == source[position + length]) {
+                length++;
+            }
+            if (!lz4_write_sequence(&output, end, source + anchor, position - anchor, position - candidate,
+                                    length)) {
+                return 0;
+            }
+            position += length;
+            anchor = position;
+        }
+    }
+    if (!lz4_write_sequence(&output, end, source + anchor, size - anchor, 0, 0)) {
+        return 0;
+    }
+    return (usize) (output - destination);
+}
+
+isize lz4_decompress(const u8 *source, usize size, u8 *destination, usize capacity) {
+    const u8 *input = source;
+    const u8 *inputEnd = source + size;
+    u8 *output = destination;
+    u8 *outputEnd = destination + capacity;
+    while (input < inputEnd) {
+        u8 token = *input++;
+        usize literalLength = token >> 4;
+        if (literalLength == 15) {
+            u8 extra;
+            do {
+                if (input >= inputEnd) {
+                    return -1;
+                }
+                extra = *input++;
+                literalLength += extra;
+            } while (extra == 255);
+        }
+        if ((usize) (inputEnd - input) < literalLength || (usize) (outputEnd - output) < literalLength) {
+            return -1;
+        }
+        memcpy(output, input, literalLength);
+        input += literalLength;
+        output += literalLength;
+        if (input == inputEnd) {
+            break;
+        }
+        if (inputEnd - input < 2) {
+            return -1;
+        }
+        usize offset = input[0] | (usize) input[1] << 8;
+        input += 2;
+        if (offset == 0 || offset > (usize) (output - destination)) {
+            return -1;
+        }
+        usize matchLength = token & 15;
+        if (matchLength == 15) {
+            u8 extra;
+            do {
+                if (input >= inputEnd) {
+                    return -1;
+                }
+                extra = *input++;
+                matchLength += extra;
+            } while (extra == 255);
+        }
+        matchLength += LZ4_MIN_MATCH;
+        if ((usize) (outputEnd - output) < matchLength) {
+            return -1;
+        }
+        const u8 *match = output - offset;
+        if (offset >= matchLength) {
+            memcpy(output, match, matchLength);
+            output += matchLength;
+        } else {
+            for (usize i = 0; i < matchLength; i++) {
+                *output++ = match[i];
+            }
+        }
+    }
+    return output - destination;
+}
@@ -0,0 +1,15 @@
+#ifndef CGFS_LZ4_H
+#define CGFS_LZ4_H
+
+#include "types.h"
+
+/* Raw LZ4 blocks, without the frame format. */
+usize lz4_compress_bound(usize size);
+
+/* Returns the compressed size, or 0 when the result does not fit in capacity. */
+usize lz4_compress(const u8 *source, usize size, u8 *destination, usize capacity);
+
+/* Returns the decompressed size, or -1 when the block is malformed or does not fit in capacity. */
+isize lz4_decompress(const u8 *source, usize size, u8 *destination, usize capacity);
+
+#endif //CGFS_LZ4_H
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "profiler.h"
+#include "atomic.h"
+#include "sync.h"
+#include "thread.h"
+#include "timer.h"
+
+#define PROFILER_MAX_DEPTH 32
+#define PROFILER_GPU_THREAD_ID 0
+
+typedef struct profiler_event_s {
+    const char *name;
+    u64 begin;
+    u64 end;
+} ProfilerEvent;
+
+/*
+ * Each thread owns one ring of completed scopes. Only the owner writes events and advances head, so recording is a
+ * plain store followed by a release store of head; the exporter copies the ring and drops any event the owner may
+ * have overwritten while it was reading.
+ */
+typedef struct profiler_thread_s {
+    ProfilerEvent *events;
+    i64 head;
+    u32 id;
+    const char *name;
+    u32 depth;
+    const char *scopeNames[PROFILER_MAX_DEPTH];
+    u64 scopeBegins[PROFILER_MAX_DEPTH];
+    struct profiler_thread_s *next;
+} ProfilerThread;
+
+typedef struct profiler_s {
+    i32 enabled;
+    u32 generation;
+    u32 capacity;
+    u64 startTime;
+    i32 nextThreadId;
+    ProfilerThread *threads;
+    ProfilerThread gpuThread;
+    SpinLock gpuLock;
+} Profiler;
+
+static Profiler profiler;
+
+static THREAD_LOCAL ProfilerThread *profiler_current_thread;
+static THREAD_LOCAL u32 profiler_current_generation;
+
+ProfilerThread *profiler_get_thread() {
+    if (profiler_current_thread != NULL && profiler_current_generation == profiler.generation) {
+        return profiler_current_thread;
+    }
+    ProfilerThread *thread;
+    thread = calloc(1, sizeof(ProfilerThread));
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->events = malloc(sizeof(ProfilerEvent) * profiler.capacity);
+    if (thread->events == NULL) {
+        free(thread);
+        return NULL;
+    }
+    thread->id = (u32) atomic_fetch_add_i32(&profiler.nextThreadId, 1, ATOMIC_RELAXED);
+    thread->next = atomic_load_ptr((void **) &profiler.threads, ATOMIC_RELAXED);
+    while (!atomic_compare_exchange_ptr((void **) &profiler.threads, (void **) &thread->next, thread,
+                                        ATOMIC_RELEASE, ATOMIC_RELAXED)) {
+    }
+    profiler_current_thread = thread;
+    profiler_current_generation = profiler.generation;
+    return thread;
+}
+
+void profiler_push_event(ProfilerThread *thread, const char *name, u64 begin, u64 end) {
+    i64 head = atomic_load_i64(&thread->head, ATOMIC_RELAXED);
+    ProfilerEvent *event = &thread->events[head % profiler.capacity];
+    event->name = name;
+    event->begin = begin;
+    event->end = end;
+    atomic_store_i64(&thread->head, head + 1, ATOMIC_RELEASE);
+}
+
+int profiler_init(u32 events_per_thread) {
+    if (profiler.enabled) {
+        return 0;
+    }
+    if (events_per_thread == 0) {
+        events_per_thread = PROFILER_DEFAULT_EVENT_CAPACITY;
+    }
+    profiler.gpuThread.events = malloc(sizeof(ProfilerEvent) * events_per_thread);
+    if (profiler.gpuThread.events == NULL) {
+        return -1;
+    }
+    profiler.capacity = events_per_thread;
+    profiler.gpuThread.head = 0;
+    profiler.gpuThread.id = PROFILER_GPU_THREAD_ID;
+    profiler.gpuThread.name = "GPU";
+    spin_lock_init(&profiler.gpuLock);
+    profiler.generation++;
+    profiler.nextThreadId = PROFILER_GPU_THREAD_ID + 1;
+    profiler.threads = NULL;
+    profiler.startTime = timer_get_time_ns();
+    atomic_store_i32(&profiler.enabled, 1, ATOMIC_RELEASE);
+    return 0;
+}
+
+/*
+ * Threads that recorded events must not be recording anymore when the profiler is destroyed.
+ */
+void profiler_destroy() {
+    if (!profiler.enabled) {
+        return;
+    }
+    atomic_store_i32(&profiler.enabled, 0, ATOMIC_SEQ_CST);
+    ProfilerThread *thread = profiler.threads;
+    while (thread != NULL) {
+        ProfilerThread *next = thread->next;
+        free(thread->events);
+        free(thread);
+        thread = next;
+    }
+    profiler.threads = NULL;
+    free(profiler.gpuThread.events);
+    profiler.gpuThread.events = NULL;
+    profiler_current_thread = NULL;
+}
+
+bool profiler_is_enabled() {
+    return atomic_load_i32(&profiler.enabled, ATOMIC_RELAXED) != 0;
+}
+
+void profiler_set_thread_name(const char *name) {
+    if (!profiler_is_enabled()) {
+        return;
+    }
+    ProfilerThread *thread = profiler_get_thread();
+    if (thread != NULL) {
+        thread->name = name;
+    }
+}
+
+void profiler_begin(const char *name) {
+    if (!profiler_is_enabled()) {
+        return;
+    }
+    ProfilerThread *thread = profiler_get_thread();
+    if (thread == NULL) {
+        return;
+    }
+    if (thread->depth < PROFILER_MAX_DEPTH) {
+        thread->scopeNames[thread->depth] = name;
+        thread->scopeBegins[thread->depth] = timer_get_time_ns();
+    }
+    thread->depth++;
+}
+
+void profiler_end() {
+    if (!profiler_is_enabled()) {
+        return;
+    }
+    ProfilerThread *thread = profiler_current_thread;
+    if (thread == NULL || profiler_current_generation != profiler.generation || thread->depth == 0) {
+        return;
+    }
+    thread->depth--;
+    if (thread->depth < PROFILER_MAX_DEPTH) {
+        profiler_push_event(thread, thread->scopeNames[thread->depth], thread->scopeBegins[thread->depth],
+                            timer_get_time_ns());
+    }
+}
+
+void profiler_record_gpu(const char *name, u64 begin_ns, u64 end_ns) {
+    if (!profiler_is_enabled()) {
+        return;
+    }
+    spin_lock(&profiler.gpuLock);
+    profiler_push_event(&profiler.gpuThread, name, begin_ns, end_ns);
+    spin_unlock(&profiler.gpuLock);
+}
+
+void profiler_write_thread(FILE *file, ProfilerThread *thread, ProfilerEvent *events, bool *first) {
+    i64 head = atomic_load_i64(&thread->head, ATOMIC_ACQUIRE);
+    i64 copyBegin = head > profiler.capacity ? head - profiler.capacity : 0;
+    for (i64 i = copyBegin; i < head; i++) {
+        events[i - copyBegin] = thread->events[i % profiler.capacity];
+    }
+    /*
+     * Slots overwritten during the copy are discarded, and so is the one after them: the owner may already be writing
+     * event headAfter, which shares its slot with event headAfter - capacity, before publishing the new head.
+     */
+    i64 headAfter = atomic_load_i64(&thread->head, ATOMIC_ACQUIRE);
+    i64 overwritten = headAfter - (i64) profiler.capacity + 1;
+    i64 begin = overwritten > copyBegin ? overwritten : copyBegin;
+    char defaultName[32];
+    const char *name = thread->name;
+    if (name == NULL) {
+        snprintf(defaultName, sizeof(defaultName), "Thread %u", thread->id);
+        name = defaultName;
+    }
+    fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+            *first ? "" : ",", thread->id, name);
+    *first = false;
+    for (i64 i = begin; i < head; i++) {
+        ProfilerEvent *event = &events[i - copyBegin];
+        if (event->begin < profiler.startTime || event->end < event->begin) {
+            continue;
+        }
+        fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                event->name, thread->id == PROFILER_GPU_THREAD_ID ? "gpu" : "cpu", thread->id,
+                (double) (event->begin - profiler.startTime) / 1000.0, (double) (event->end - event->begin) / 1000.0);
+    }
+}
+
+/*
+ * Writes every event still held in the rings in the Chrome trace-event format, loadable in chrome://tracing or
+ * Perfetto. Timestamps are microseconds since profiler_init.
+ */
+int profiler_export_chrome_trace(const char *path) {
+    if (!profiler_is_enabled()) {
+        return -1;
+    }
+    ProfilerEvent *events = malloc(sizeof(ProfilerEvent) * profiler.capacity);
+    if (events == NULL) {
+        return -1;
+    }
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        free(events);
+        return -1;
+    }
+    bool first = true;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    spin_lock(&profiler.gpuLock);
+    profiler_write_thread(file, &profiler.gpuThread, events, &first);
+    spin_unlock(&profiler.gpuLock);
+    ProfilerThread *thread = atomic_load_ptr((void **) &profiler.threads, ATOMIC_ACQUIRE);
+    while (thread != NULL) {
+        profiler_write_thread(file, thread, events, &first);
+        thread = thread->next;
+    }
+    fprintf(file, "\n]}\n");
+    int status = ferror(file) ? -1 : 0;
+    if (fclose(file) != 0) {
+        status = -1;
+    }
+    free(events);
+    return status;
+}
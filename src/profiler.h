@@ -0,0 +1,24 @@
+#ifndef CGFS_PROFILER_H
+#define CGFS_PROFILER_H
+
+#include "types.h"
+
+#define PROFILER_DEFAULT_EVENT_CAPACITY 65536
+
+int profiler_init(u32 events_per_thread);
+
+void profiler_destroy();
+
+bool profiler_is_enabled();
+
+void profiler_set_thread_name(const char *name);
+
+void profiler_begin(const char *name);
+
+void profiler_end();
+
+void profiler_record_gpu(const char *name, u64 begin_ns, u64 end_ns);
+
+int profiler_export_chrome_trace(const char *path);
+
+#endif //CGFS_PROFILER_H
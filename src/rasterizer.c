@@ -0,0 +1,560 @@
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rasterizer.h"
+#include "atomic.h"
+#include "job.h"
+#include "profiler.h"
+
+#define RASTERIZER_SUBPIXEL_BITS 4
+#define RASTERIZER_SUBPIXEL_SCALE (1 << RASTERIZER_SUBPIXEL_BITS)
+#define RASTERIZER_GUARD_BAND 4.0f
+#define RASTERIZER_CLIP_PLANE_COUNT 6
+#define RASTERIZER_MAX_CLIP_VERTICES (3 + RASTERIZER_CLIP_PLANE_COUNT)
+#define RASTERIZER_TRIANGLES_PER_SLOT 256
+#define RASTERIZER_PLANE_DEPTH 0
+#define RASTERIZER_PLANE_INVERSE_W 1
+#define RASTERIZER_PLANE_ATTRIBUTES 2
+#define RASTERIZER_PLANE_COUNT (RASTERIZER_PLANE_ATTRIBUTES + RASTERIZER_ATTRIBUTE_COUNT)
+
+/*
+ * Edge functions are evaluated at pixel centers in 28.4 fixed point, which makes the coverage test exact: pixels on a
+ * shared edge belong to exactly one of the two triangles, decided by the top-left rule folded into edgeC.
+ * Interpolated values are planes anchored at the top-left pixel of the bounding box.
+ */
+struct rasterizer_triangle_s {
+    i64 edgeA[3];
+    i64 edgeB[3];
+    i64 edgeC[3];
+    i32 minX;
+    i32 minY;
+    i32 maxX;
+    i32 maxY;
+    float minDepth;
+    float planes[RASTERIZER_PLANE_COUNT][3];
+};
+
+typedef struct rasterizer_draw_s {
+    Rasterizer *rasterizer;
+    const RasterizerVertex *vertices;
+    const u32 *indices;
+    RasterizerCullMode cullMode;
+    u32 slotCount;
+    i32 nextTile;
+} RasterizerDraw;
+
+/* Vulkan depth range, then a guard band around the viewport that keeps fixed-point coordinates in range. */
+static const float rasterizer_clip_planes[RASTERIZER_CLIP_PLANE_COUNT][4] = {
+        {0.0f, 0.0f, 1.0f, 0.0f},
+        {0.0f, 0.0f, -1.0f, 1.0f},
+        {1.0f, 0.0f, 0.0f, RASTERIZER_GUARD_BAND},
+        {-1.0f, 0.0f, 0.0f, RASTERIZER_GUARD_BAND},
+        {0.0f, 1.0f, 0.0f, RASTERIZER_GUARD_BAND},
+        {0.0f, -1.0f, 0.0f, RASTERIZER_GUARD_BAND},
+};
+
+int rasterizer_create(Rasterizer *rasterizer, u32 width, u32 height) {
+    memset(rasterizer, 0, sizeof(Rasterizer));
+    if (width == 0 || height == 0 || width > RASTERIZER_MAX_SIZE || height > RASTERIZER_MAX_SIZE) {
+        return -1;
+    }
+    rasterizer->width = width;
+    rasterizer->height = height;
+    rasterizer->blockCountX = (width + RASTERIZER_BLOCK_SIZE - 1) / RASTERIZER_BLOCK_SIZE;
+    u32 blockCountY = (height + RASTERIZER_BLOCK_SIZE - 1) / RASTERIZER_BLOCK_SIZE;
+    rasterizer->tileCountX = (width + RASTERIZER_TILE_SIZE - 1) / RASTERIZER_TILE_SIZE;
+    rasterizer->tileCount = rasterizer->tileCountX * ((height + RASTERIZER_TILE_SIZE - 1) / RASTERIZER_TILE_SIZE);
+    rasterizer->slotCount = job_system_get_thread_count();
+    if (rasterizer->slotCount == 0) {
+        rasterizer->slotCount = 1;
+    }
+    rasterizer->pixels = malloc((usize) width * height * 4);
+    rasterizer->depth = malloc(sizeof(float) * width * height);
+    rasterizer->blockDepth = malloc(sizeof(float) * rasterizer->blockCountX * blockCountY);
+    rasterizer->slots = calloc(rasterizer->slotCount, sizeof(RasterizerSlot));
+    if (rasterizer->pixels == NULL || rasterizer->depth == NULL || rasterizer->blockDepth == NULL ||
+        rasterizer->slots == NULL) {
+        rasterizer_destroy(rasterizer);
+        return -1;
+    }
+    for (u32 i = 0; i < rasterizer->slotCount; i++) {
+        rasterizer->slots[i].binEnds = malloc(sizeof(u32) * rasterizer->tileCount);
+        if (rasterizer->slots[i].binEnds == NULL) {
+            rasterizer_destroy(rasterizer);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void rasterizer_destroy(Rasterizer *rasterizer) {
+    if (rasterizer->slots != NULL) {
+        for (u32 i = 0; i < rasterizer->slotCount; i++) {
+            free(rasterizer->slots[i].triangles);
+            free(rasterizer->slots[i].binEnds);
+            free(rasterizer->slots[i].binTriangles);
+        }
+    }
+    free(rasterizer->slots);
+    free(rasterizer->blockDepth);
+    free(rasterizer->depth);
+    free(rasterizer->pixels);
+    memset(rasterizer, 0, sizeof(Rasterizer));
+}
+
+u8 rasterizer_to_byte(float value) {
+    if (value <= 0.0f) {
+        return 0;
+    }
+    if (value >= 1.0f) {
+        return 255;
+    }
+    return (u8) (value * 255.0f + 0.5f);
+}
+
+void rasterizer_clear(Rasterizer *rasterizer, const float color[4], float depth) {
+    u8 pixel[4];
+    for (u32 i = 0; i < 4; i++) {
+        pixel[i] = rasterizer_to_byte(color[i]);
+    }
+    usize pixelCount = (usize) rasterizer->width * rasterizer->height;
+    for (usize i = 0; i < pixelCount; i++) {
+        memcpy(rasterizer->pixels + i * 4, pixel, 4);
+        rasterizer->depth[i] = depth;
+    }
+    usize blockCount = (usize) rasterizer->blockCountX *
+                       ((rasterizer->height + RASTERIZER_BLOCK_SIZE - 1) / RASTERIZER_BLOCK_SIZE);
+    for (usize i = 0; i < blockCount; i++) {
+        rasterizer->blockDepth[i] = depth;
+    }
+}
+
+float rasterizer_clip_distance(const RasterizerVertex *vertex, const float *plane) {
+    return vertex->position[0] * plane[0] + vertex->position[1] * plane[1] + vertex->position[2] * plane[2] +
+           vertex->position[3] * plane[3];
+}
+
+/*
+ * Sutherland-Hodgman against the depth range and the guard band. Each plane adds at most one vertex, so the result
+ * always fits in RASTERIZER_MAX_CLIP_VERTICES.
+ */
+u32 rasterizer_clip_polygon(RasterizerVertex *polygon, RasterizerVertex *scratch, u32 count) {
+    RasterizerVertex *input = polygon;
+    RasterizerVertex *output = scratch;
+    for (u32 plane = 0; plane < RASTERIZER_CLIP_PLANE_COUNT; plane++) {
+        u32 outputCount = 0;
+        for (u32 i = 0; i < count; i++) {
+            const RasterizerVertex *current = &input[i];
+            const RasterizerVertex *next = &input[(i + 1) % count];
+            float currentDistance = rasterizer_clip_distance(current, rasterizer_clip_planes[plane]);
+            float nextDistance = rasterizer_clip_distance(next, rasterizer_clip_planes[plane]);
+            if (currentDistance >= 0.0f) {
+                output[outputCount++] = *current;
+            }
+            if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+                float t = currentDistance / (currentDistance - nextDistance);
+                RasterizerVertex *vertex = &output[outputCount++];
+                for (u32 j = 0; j < 4; j++) {
+                    vertex->position[j] = current->position[j] + (next->position[j] - current->position[j]) * t;
+                }
+                for (u32 j = 0; j < RASTERIZER_ATTRIBUTE_COUNT; j++) {
+                    vertex->attributes[j] = current->attributes[j] +
+                                            (next->attributes[j] - current->attributes[j]) * t;
+                }
+            }
+        }
+        count = outputCount;
+        if (count < 3) {
+            return 0;
+        }
+        RasterizerVertex *swap = input;
+        input = output;
+        output = swap;
+    }
+    if (input != polygon) {
+        memcpy(polygon, input, sizeof(RasterizerVertex) * count);
+    }
+    return count;
+}
+
+bool rasterizer_is_inside_clip_volume(const RasterizerVertex *vertex) {
+    for (u32 plane = 0; plane < RASTERIZER_CLIP_PLANE_COUNT; plane++) {
+        if (rasterizer_clip_distance(vertex, rasterizer_clip_planes[plane]) < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+i32 rasterizer_floor_div(i64 value, i64 divisor) {
+    i64 quotient = value / divisor;
+    if (value % divisor != 0 && value < 0) {
+        quotient--;
+    }
+    return (i32) quotient;
+}
+
+RasterizerTriangle *rasterizer_push_triangle(RasterizerSlot *slot) {
+    if (slot->triangleCount == slot->triangleCapacity) {
+        u32 capacity = slot->triangleCapacity != 0 ? slot->triangleCapacity * 2 : RASTERIZER_TRIANGLES_PER_SLOT;
+        RasterizerTriangle *triangles = realloc(slot->triangles, sizeof(RasterizerTriangle) * capacity);
+        if (triangles == NULL) {
+            slot->failed = true;
+            return NULL;
+        }
+        slot->triangles = triangles;
+        slot->triangleCapacity = capacity;
+    }
+    return &slot->triangles[slot->triangleCount++];
+}
+
+void rasterizer_setup_triangle(RasterizerSlot *slot, const RasterizerVertex *v0, const RasterizerVertex *v1,
+                               const RasterizerVertex *v2) {
+    const Rasterizer *rasterizer = slot->draw->rasterizer;
+    const RasterizerVertex *vertices[3] = {v0, v1, v2};
+    i64 x[3];
+    i64 y[3];
+    double values[3][RASTERIZER_PLANE_COUNT];
+    float minDepth = FLT_MAX;
+    for (u32 i = 0; i < 3; i++) {
+        const float *position = vertices[i]->position;
+        if (!(position[3] > 0.0f)) {
+            return;
+        }
+        double inverseW = 1.0 / position[3];
+        x[i] = (i64) floor(((double) position[0] * inverseW * 0.5 + 0.5) * rasterizer->width *
+                           RASTERIZER_SUBPIXEL_SCALE + 0.5);
+        y[i] = (i64) floor(((double) position[1] * inverseW * 0.5 + 0.5) * rasterizer->height *
+                           RASTERIZER_SUBPIXEL_SCALE + 0.5);
+        values[i][RASTERIZER_PLANE_DEPTH] = position[2] * inverseW;
+        values[i][RASTERIZER_PLANE_INVERSE_W] = inverseW;
+        for (u32 j = 0; j < RASTERIZER_ATTRIBUTE_COUNT; j++) {
+            values[i][RASTERIZER_PLANE_ATTRIBUTES + j] = vertices[i]->attributes[j] * inverseW;
+        }
+        if ((float) values[i][RASTERIZER_PLANE_DEPTH] < minDepth) {
+            minDepth = (float) values[i][RASTERIZER_PLANE_DEPTH];
+        }
+    }
+
+    /* Positive area is clockwise on screen, which matches VK_FRONT_FACE_CLOCKWISE in the Vulkan pipeline. */
+    i64 area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (area == 0 || (area < 0 && slot->draw->cullMode == RASTERIZER_CULL_BACK)) {
+        return;
+    }
+    u32 order[3] = {0, 1, 2};
+    if (area < 0) {
+        order[1] = 2;
+        order[2] = 1;
+        area = -area;
+    }
+
+    i64 minX = x[0] < x[1] ? (x[0] < x[2] ? x[0] : x[2]) : (x[1] < x[2] ? x[1] : x[2]);
+    i64 maxX = x[0] > x[1] ? (x[0] > x[2] ? x[0] : x[2]) : (x[1] > x[2] ? x[1] : x[2]);
+    i64 minY = y[0] < y[1] ? (y[0] < y[2] ? y[0] : y[2]) : (y[1] < y[2] ? y[1] : y[2]);
+    i64 maxY = y[0] > y[1] ? (y[0] > y[2] ? y[0] : y[2]) : (y[1] > y[2] ? y[1] : y[2]);
+    i64 halfPixel = RASTERIZER_SUBPIXEL_SCALE / 2;
+    i32 pixelMinX = rasterizer_floor_div(minX - halfPixel + RASTERIZER_SUBPIXEL_SCALE - 1, RASTERIZER_SUBPIXEL_SCALE);
+    i32 pixelMinY = rasterizer_floor_div(minY - halfPixel + RASTERIZER_SUBPIXEL_SCALE - 1, RASTERIZER_SUBPIXEL_SCALE);
+    i32 pixelMaxX = rasterizer_floor_div(maxX - halfPixel, RASTERIZER_SUBPIXEL_SCALE);
+    i32 pixelMaxY = rasterizer_floor_div(maxY - halfPixel, RASTERIZER_SUBPIXEL_SCALE);
+    if (pixelMinX < 0) {
+        pixelMinX = 0;
+    }
+    if (pixelMinY < 0) {
+        pixelMinY = 0;
+    }
+    if (pixelMaxX > (i32) rasterizer->width - 1) {
+        pixelMaxX = (i32) rasterizer->width - 1;
+    }
+    if (pixelMaxY > (i32) rasterizer->height - 1) {
+        pixelMaxY = (i32) rasterizer->height - 1;
+    }
+    if (pixelMinX > pixelMaxX || pixelMinY > pixelMaxY) {
+        return;
+    }
+
+    RasterizerTriangle *triangle = rasterizer_push_triangle(slot);
+    if (triangle == NULL) {
+        return;
+    }
+    triangle->minX = pixelMinX;
+    triangle->minY = pixelMinY;
+    triangle->maxX = pixelMaxX;
+    triangle->maxY = pixelMaxY;
+    triangle->minDepth = minDepth;
+
+    i64 edgeAtOrigin[3];
+    i64 originX = (i64) pixelMinX * RASTERIZER_SUBPIXEL_SCALE + halfPixel;
+    i64 originY = (i64) pixelMinY * RASTERIZER_SUBPIXEL_SCALE + halfPixel;
+    for (u32 i = 0; i < 3; i++) {
+        u32 from = order[i];
+        u32 to = order[(i + 1) % 3];
+        i64 dx = x[to] - x[from];
+        i64 dy = y[to] - y[from];
+        bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+        triangle->edgeA[i] = -dy * RASTERIZER_SUBPIXEL_SCALE;
+        triangle->edgeB[i] = dx * RASTERIZER_SUBPIXEL_SCALE;
+        triangle->edgeC[i] = dy * x[from] - dx * y[from] - dy * halfPixel + dx * halfPixel - (topLeft ? 0 : 1);
+        edgeAtOrigin[i] = dy * (x[from] - originX) - dx * (y[from] - originY);
+    }
+
+    /* Edge i is opposite vertex order[(i + 2) % 3], so its value over the area is that vertex's barycentric weight. */
+    double inverseArea = 1.0 / (double) area;
+    for (u32 plane = 0; plane < RASTERIZER_PLANE_COUNT; plane++) {
+        double q0 = values[order[0]][plane];
+        double d1 = values[order[1]][plane] - q0;
+        double d2 = values[order[2]][plane] - q0;
+        triangle->planes[plane][0] = (float) (q0 + (d1 * (double) edgeAtOrigin[2] + d2 * (double) edgeAtOrigin[0]) *
+                                                   inverseArea);
+        triangle->planes[plane][1] = (float) ((d1 * (double) triangle->edgeA[2] + d2 * (double) triangle->edgeA[0]) *
+                                              inverseArea);
+        triangle->planes[plane][2] = (float) ((d1 * (double) triangle->edgeB[2] + d2 * (double) triangle->edgeB[0]) *
+                                              inverseArea);
+    }
+}
+
+void rasterizer_setup_primitive(RasterizerSlot *slot, u32 primitive) {
+    const RasterizerDraw *draw = slot->draw;
+    RasterizerVertex polygon[RASTERIZER_MAX_CLIP_VERTICES];
+    for (u32 i = 0; i < 3; i++) {
+        u32 index = draw->indices != NULL ? draw->indices[primitive * 3 + i] : primitive * 3 + i;
+        polygon[i] = draw->vertices[index];
+    }
+    if (rasterizer_is_inside_clip_volume(&polygon[0]) && rasterizer_is_inside_clip_volume(&polygon[1]) &&
+        rasterizer_is_inside_clip_volume(&polygon[2])) {
+        rasterizer_setup_triangle(slot, &polygon[0], &polygon[1], &polygon[2]);
+        return;
+    }
+    RasterizerVertex scratch[RASTERIZER_MAX_CLIP_VERTICES];
+    u32 count = rasterizer_clip_polygon(polygon, scratch, 3);
+    for (u32 i = 2; i < count; i++) {
+        rasterizer_setup_triangle(slot, &polygon[0], &polygon[i - 1], &polygon[i]);
+    }
+}
+
+/*
+ * Each slot bins only the triangles it set up, into its own per-tile lists, so binning needs no synchronization.
+ * Slots cover consecutive primitive ranges, so walking the slots in order keeps submission order within a tile.
+ */
+void rasterizer_setup_job(void *arg) {
+    RasterizerSlot *slot = arg;
+    const Rasterizer *rasterizer = slot->draw->rasterizer;
+    profiler_begin("rasterizer setup");
+    slot->triangleCount = 0;
+    slot->failed = false;
+    for (u32 i = slot->firstTriangle; i < slot->endTriangle && !slot->failed; i++) {
+        rasterizer_setup_primitive(slot, i);
+    }
+
+    memset(slot->binEnds, 0, sizeof(u32) * rasterizer->tileCount);
+    u32 entryCount = 0;
+    for (u32 i = 0; i < slot->triangleCount; i++) {
+        const RasterizerTriangle *triangle = &slot->triangles[i];
+        for (i32 tileY = triangle->minY / RASTERIZER_TILE_SIZE; tileY <= triangle->maxY / RASTERIZER_TILE_SIZE;
+             tileY++) {
+            for (i32 tileX = triangle->minX / RASTERIZER_TILE_SIZE; tileX <= triangle->maxX / RASTERIZER_TILE_SIZE;
+                 tileX++) {
+                slot->binEnds[tileY * rasterizer->tileCountX + tileX]++;
+                entryCount++;
+            }
+        }
+    }
+    if (entryCount > slot->binCapacity) {
+        u32 *binTriangles = realloc(slot->binTriangles, sizeof(u32) * entryCount);
+        if (binTriangles == NULL) {
+            slot->failed = true;
+            profiler_end();
+            return;
+        }
+        slot->binTriangles = binTriangles;
+        slot->binCapacity = entryCount;
+    }
+    u32 offset = 0;
+    for (u32 i = 0; i < rasterizer->tileCount; i++) {
+        u32 count = slot->binEnds[i];
+        slot->binEnds[i] = offset;
+        offset += count;
+    }
+    for (u32 i = 0; i < slot->triangleCount; i++) {
+        const RasterizerTriangle *triangle = &slot->triangles[i];
+        for (i32 tileY = triangle->minY / RASTERIZER_TILE_SIZE; tileY <= triangle->maxY / RASTERIZER_TILE_SIZE;
+             tileY++) {
+            for (i32 tileX = triangle->minX / RASTERIZER_TILE_SIZE; tileX <= triangle->maxX / RASTERIZER_TILE_SIZE;
+                 tileX++) {
+                slot->binTriangles[slot->binEnds[tileY * rasterizer->tileCountX + tileX]++] = i;
+            }
+        }
+    }
+    profiler_end();
+}
+
+void rasterizer_update_block_depth(Rasterizer *rasterizer, i32 blockX, i32 blockY, i32 endX, i32 endY) {
+    float maxDepth = 0.0f;
+    for (i32 y = blockY; y < endY; y++) {
+        const float *row = rasterizer->depth + (usize) y * rasterizer->width;
+        for (i32 x = blockX; x < endX; x++) {
+            if (row[x] > maxDepth) {
+                maxDepth = row[x];
+            }
+        }
+    }
+    rasterizer->blockDepth[(blockY / RASTERIZER_BLOCK_SIZE) * rasterizer->blockCountX +
+                           blockX / RASTERIZER_BLOCK_SIZE] = maxDepth;
+}
+
+/*
+ * Walks the 8x8 blocks of the triangle's bounding box inside the tile. A block is skipped when the triangle is
+ * behind everything already in it or when one edge rejects all four corners, and the per-pixel edge test is skipped
+ * when every edge accepts all four corners.
+ */
+void rasterizer_draw_triangle(Rasterizer *rasterizer, const RasterizerTriangle *triangle, i32 tileX, i32 tileY) {
+    i32 minX = triangle->minX > tileX ? triangle->minX : tileX;
+    i32 minY = triangle->minY > tileY ? triangle->minY : tileY;
+    i32 maxX = triangle->maxX < tileX + RASTERIZER_TILE_SIZE - 1 ? triangle->maxX : tileX + RASTERIZER_TILE_SIZE - 1;
+    i32 maxY = triangle->maxY < tileY + RASTERIZER_TILE_SIZE - 1 ? triangle->maxY : tileY + RASTERIZER_TILE_SIZE - 1;
+    const i64 *edgeA = triangle->edgeA;
+    const i64 *edgeB = triangle->edgeB;
+    const i64 *edgeC = triangle->edgeC;
+    i32 blockEnd = RASTERIZER_BLOCK_SIZE - 1;
+    for (i32 blockY = minY - minY % RASTERIZER_BLOCK_SIZE; blockY <= maxY; blockY += RASTERIZER_BLOCK_SIZE) {
+        for (i32 blockX = minX - minX % RASTERIZER_BLOCK_SIZE; blockX <= maxX; blockX += RASTERIZER_BLOCK_SIZE) {
+            float *blockDepth = &rasterizer->blockDepth[(blockY / RASTERIZER_BLOCK_SIZE) * rasterizer->blockCountX +
+                                                        blockX / RASTERIZER_BLOCK_SIZE];
+            if (triangle->minDepth >= *blockDepth) {
+                continue;
+            }
+            bool outside = false;
+            bool covered = true;
+            for (u32 i = 0; i < 3; i++) {
+                i64 corner = edgeA[i] * blockX + edgeB[i] * blockY + edgeC[i];
+                i64 stepX = edgeA[i] * blockEnd;
+                i64 stepY = edgeB[i] * blockEnd;
+                i64 low = corner + (stepX < 0 ? stepX : 0) + (stepY < 0 ? stepY : 0);
+                i64 high = corner + (stepX > 0 ? stepX : 0) + (stepY > 0 ? stepY : 0);
+                outside |= high < 0;
+                covered &= low >= 0;
+            }
+            if (outside) {
+                continue;
+            }
+
+            i32 startX = blockX > minX ? blockX : minX;
+            i32 startY = blockY > minY ? blockY : minY;
+            i32 endX = blockX + blockEnd < maxX ? blockX + blockEnd : maxX;
+            i32 endY = blockY + blockEnd < maxY ? blockY + blockEnd : maxY;
+            bool written = false;
+            for (i32 y = startY; y <= endY; y++) {
+                i64 edge0 = edgeA[0] * startX + edgeB[0] * y + edgeC[0];
+                i64 edge1 = edgeA[1] * startX + edgeB[1] * y + edgeC[1];
+                i64 edge2 = edgeA[2] * startX + edgeB[2] * y + edgeC[2];
+                float planeY = (float) (y - triangle->minY);
+                usize rowOffset = (usize) y * rasterizer->width;
+                for (i32 x = startX; x <= endX; x++) {
+                    if (covered || (edge0 | edge1 | edge2) >= 0) {
+                        float planeX = (float) (x - triangle->minX);
+                        const float (*planes)[3] = triangle->planes;
+                        float depth = planes[RASTERIZER_PLANE_DEPTH][0] + planes[RASTERIZER_PLANE_DEPTH][1] * planeX +
+                                      planes[RASTERIZER_PLANE_DEPTH][2] * planeY;
+                        float *depthTarget = &rasterizer->depth[rowOffset + x];
+                        if (depth < *depthTarget) {
+                            *depthTarget = depth;
+                            float w = 1.0f / (planes[RASTERIZER_PLANE_INVERSE_W][0] +
+                                              planes[RASTERIZER_PLANE_INVERSE_W][1] * planeX +
+                                              planes[RASTERIZER_PLANE_INVERSE_W][2] * planeY);
+                            u8 *pixel = rasterizer->pixels + (rowOffset + x) * 4;
+                            for (u32 i = 0; i < RASTERIZER_ATTRIBUTE_COUNT; i++) {
+                                const float *plane = planes[RASTERIZER_PLANE_ATTRIBUTES + i];
+                                pixel[i] = rasterizer_to_byte((plane[0] + plane[1] * planeX + plane[2] * planeY) * w);
+                            }
+                            written = true;
+                        }
+                    }
+                    edge0 += edgeA[0];
+                    edge1 += edgeA[1];
+                    edge2 += edgeA[2];
+                }
+            }
+            if (written) {
+                i32 screenEndX = blockX + RASTERIZER_BLOCK_SIZE < (i32) rasterizer->width ?
+                                 blockX + RASTERIZER_BLOCK_SIZE : (i32) rasterizer->width;
+                i32 screenEndY = blockY + RASTERIZER_BLOCK_SIZE < (i32) rasterizer->height ?
+                                 blockY + RASTERIZER_BLOCK_SIZE : (i32) rasterizer->height;
+                rasterizer_update_block_depth(rasterizer, blockX, blockY, screenEndX, screenEndY);
+            }
+        }
+    }
+}
+
+/* Tiles are claimed from a shared cursor; a tile is only ever touched by the thread that claimed it. */
+void rasterizer_tiles_job(void *arg) {
+    RasterizerDraw *draw = arg;
+    Rasterizer *rasterizer = draw->rasterizer;
+    profiler_begin("rasterizer tiles");
+    for (;;) {
+        i32 tile = atomic_fetch_add_i32(&draw->nextTile, 1, ATOMIC_RELAXED);
+        if ((u32) tile >= rasterizer->tileCount) {
+            break;
+        }
+        i32 tileX = (i32) ((u32) tile % rasterizer->tileCountX) * RASTERIZER_TILE_SIZE;
+        i32 tileY = (i32) ((u32) tile / rasterizer->tileCountX) * RASTERIZER_TILE_SIZE;
+        for (u32 i = 0; i < draw->slotCount; i++) {
+            const RasterizerSlot *slot = &rasterizer->slots[i];
+            u32 begin = tile > 0 ? slot->binEnds[tile - 1] : 0;
+            for (u32 j = begin; j < slot->binEnds[tile]; j++) {
+                rasterizer_draw_triangle(rasterizer, &slot->triangles[slot->binTriangles[j]], tileX, tileY);
+            }
+        }
+    }
+    profiler_end();
+}
+
+/*
+ * Draws an indexed triangle list into the color and depth buffers with a less-than depth test. With indices set to
+ * NULL, every three consecutive vertices form a triangle. Returns -1 if setup ran out of memory, in which case
+ * nothing is drawn.
+ */
+int rasterizer_draw(Rasterizer *rasterizer, const RasterizerVertex *vertices, const u32 *indices, u32 triangle_count,
+                    RasterizerCullMode cull_mode) {
+    if (triangle_count == 0) {
+        return 0;
+    }
+    RasterizerDraw draw;
+    draw.rasterizer = rasterizer;
+    draw.vertices = vertices;
+    draw.indices = indices;
+    draw.cullMode = cull_mode;
+    draw.slotCount = (triangle_count + RASTERIZER_TRIANGLES_PER_SLOT - 1) / RASTERIZER_TRIANGLES_PER_SLOT;
+    if (draw.slotCount > rasterizer->slotCount) {
+        draw.slotCount = rasterizer->slotCount;
+    }
+    draw.nextTile = 0;
+
+    JobCounter counter;
+    job_counter_init(&counter);
+    u32 trianglesPerSlot = (triangle_count + draw.slotCount - 1) / draw.slotCount;
+    for (u32 i = 0; i < draw.slotCount; i++) {
+        RasterizerSlot *slot = &rasterizer->slots[i];
+        slot->draw = &draw;
+        slot->firstTriangle = i * trianglesPerSlot < triangle_count ? i * trianglesPerSlot : triangle_count;
+        slot->endTriangle = slot->firstTriangle + trianglesPerSlot < triangle_count ?
+                            slot->firstTriangle + trianglesPerSlot : triangle_count;
+        job_run(rasterizer_setup_job, slot, &counter);
+    }
+    job_wait(&counter);
+    for (u32 i = 0; i < draw.slotCount; i++) {
+        if (rasterizer->slots[i].failed) {
+            return -1;
+        }
+    }
+
+    u32 jobCount = job_system_get_thread_count();
+    if (jobCount > rasterizer->tileCount) {
+        jobCount = rasterizer->tileCount;
+    }
+    for (u32 i = 0; i < jobCount; i++) {
+        job_run(rasterizer_tiles_job, &draw, &counter);
+    }
+    job_wait(&counter);
+    return 0;
+}
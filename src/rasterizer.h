@@ -0,0 +1,62 @@
+#ifndef CGFS_RASTERIZER_H
+#define CGFS_RASTERIZER_H
+
+#include "types.h"
+
+#define RASTERIZER_ATTRIBUTE_COUNT 4
+#define RASTERIZER_TILE_SIZE 64
+#define RASTERIZER_BLOCK_SIZE 8
+#define RASTERIZER_MAX_SIZE 8192
+
+/*
+ * Positions are in Vulkan clip space: y points down and visible depth is 0 <= z <= w. The attributes are
+ * interpolated perspective-correctly and written out as the RGBA color of the fragment.
+ */
+typedef struct rasterizer_vertex_s {
+    float position[4];
+    float attributes[RASTERIZER_ATTRIBUTE_COUNT];
+} RasterizerVertex;
+
+typedef enum rasterizer_cull_mode_e {
+    RASTERIZER_CULL_NONE,
+    RASTERIZER_CULL_BACK
+} RasterizerCullMode;
+
+typedef struct rasterizer_triangle_s RasterizerTriangle;
+
+typedef struct rasterizer_slot_s {
+    struct rasterizer_draw_s *draw;
+    u32 firstTriangle;
+    u32 endTriangle;
+    RasterizerTriangle *triangles;
+    u32 triangleCount;
+    u32 triangleCapacity;
+    u32 *binEnds;
+    u32 *binTriangles;
+    u32 binCapacity;
+    bool failed;
+} RasterizerSlot;
+
+typedef struct rasterizer_s {
+    u32 width;
+    u32 height;
+    u8 *pixels;
+    float *depth;
+    float *blockDepth;
+    u32 blockCountX;
+    u32 tileCountX;
+    u32 tileCount;
+    RasterizerSlot *slots;
+    u32 slotCount;
+} Rasterizer;
+
+int rasterizer_create(Rasterizer *rasterizer, u32 width, u32 height);
+
+void rasterizer_destroy(Rasterizer *rasterizer);
+
+void rasterizer_clear(Rasterizer *rasterizer, const float color[4], float depth);
+
+int rasterizer_draw(Rasterizer *rasterizer, const RasterizerVertex *vertices, const u32 *indices, u32 triangle_count,
+                    RasterizerCullMode cull_mode);
+
+#endif //CGFS_RASTERIZER_H
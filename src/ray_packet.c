@@ -0,0 +1,245 @@
+#include <math.h>
+#include "ray_packet.h"
+#include "simd.h"
+
+#if defined(SIMD_X86)
+#include <immintrin.h>
+#elif defined(SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+#define RAY_PACKET_DETERMINANT_EPSILON 1e-16f
+
+u32 ray_packet_intersect_spheres_scalar(const RayPacket *rays, u32 start, const SphereSoa *spheres, float t_min,
+                                        u32 first_id) {
+    for (u32 i = start; i < rays->count; i++) {
+        float directionX = rays->directionX[i];
+        float directionY = rays->directionY[i];
+        float directionZ = rays->directionZ[i];
+        float a = directionX * directionX + directionY * directionY + directionZ * directionZ;
+        for (u32 j = 0; j < spheres->count; j++) {
+            float ocX = rays->originX[i] - spheres->centerX[j];
+            float ocY = rays->originY[i] - spheres->centerY[j];
+            float ocZ = rays->originZ[i] - spheres->centerZ[j];
+            float halfB = ocX * directionX + ocY * directionY + ocZ * directionZ;
+            float c = ocX * ocX + ocY * ocY + ocZ * ocZ - spheres->radius[j] * spheres->radius[j];
+            float discriminant = halfB * halfB - a * c;
+            if (discriminant <= 0.0f) {
+                continue;
+            }
+            float root = sqrtf(discriminant);
+            float t = (-halfB - root) / a;
+            if (t <= t_min) {
+                t = (-halfB + root) / a;
+            }
+            if (t > t_min && t < rays->tMax[i]) {
+                rays->tMax[i] = t;
+                rays->hitId[i] = first_id + j;
+            }
+        }
+    }
+    return rays->count;
+}
+
+u32 ray_packet_intersect_triangles_scalar(const RayPacket *rays, u32 start, const TriangleSoa *triangles,
+                                          float t_min, u32 first_id) {
+    for (u32 i = start; i < rays->count; i++) {
+        float directionX = rays->directionX[i];
+        float directionY = rays->directionY[i];
+        float directionZ = rays->directionZ[i];
+        for (u32 j = 0; j < triangles->count; j++) {
+            float pX = directionY * triangles->edge2Z[j] - directionZ * triangles->edge2Y[j];
+            float pY = directionZ * triangles->edge2X[j] - directionX * triangles->edge2Z[j];
+            float pZ = directionX * triangles->edge2Y[j] - directionY * triangles->edge2X[j];
+            float determinant = triangles->edge1X[j] * pX + triangles->edge1Y[j] * pY + triangles->edge1Z[j] * pZ;
+            if (determinant * determinant <= RAY_PACKET_DETERMINANT_EPSILON) {
+                continue;
+            }
+            float inverseDeterminant = 1.0f / determinant;
+            float tX = rays->originX[i] - triangles->v0X[j];
+            float tY = rays->originY[i] - triangles->v0Y[j];
+            float tZ = rays->originZ[i] - triangles->v0Z[j];
+            float u = (tX * pX + tY * pY + tZ * pZ) * inverseDeterminant;
+            if (u < 0.0f || u > 1.0f) {
+                continue;
+            }
+            float qX = tY * triangles->edge1Z[j] - tZ * triangles->edge1Y[j];
+            float qY = tZ * triangles->edge1X[j] - tX * triangles->edge1Z[j];
+            float qZ = tX * triangles->edge1Y[j] - tY * triangles->edge1X[j];
+            float v = (directionX * qX + directionY * qY + directionZ * qZ) * inverseDeterminant;
+            if (v < 0.0f || u + v > 1.0f) {
+                continue;
+            }
+            float t = (triangles->edge2X[j] * qX + triangles->edge2Y[j] * qY + triangles->edge2Z[j] * qZ) *
+                      inverseDeterminant;
+            if (t > t_min && t < rays->tMax[i]) {
+                rays->tMax[i] = t;
+                rays->hitId[i] = first_id + j;
+            }
+        }
+    }
+    return rays->count;
+}
+
+#if defined(SIMD_X86)
+
+#define KERNEL_SPHERES ray_packet_intersect_spheres_sse4
+#define KERNEL_TRIANGLES ray_packet_intersect_triangles_sse4
+#define KERNEL_WIDTH 4
+#define KERNEL_TARGET SIMD_TARGET("sse4.1")
+#define V_FLOAT __m128
+#define V_MASK __m128
+#define V_LOAD(p) _mm_loadu_ps(p)
+#define V_LOAD_BITS(p) _mm_loadu_ps((const float *) (p))
+#define V_STORE(p, v) _mm_storeu_ps(p, v)
+#define V_STORE_BITS(p, v) _mm_storeu_ps((float *) (p), v)
+#define V_SET1(x) _mm_set1_ps(x)
+#define V_SET1_BITS(x) _mm_castsi128_ps(_mm_set1_epi32((int) (x)))
+#define V_ADD(a, b) _mm_add_ps(a, b)
+#define V_SUB(a, b) _mm_sub_ps(a, b)
+#define V_MUL(a, b) _mm_mul_ps(a, b)
+#define V_DIV(a, b) _mm_div_ps(a, b)
+#define V_SQRT(a) _mm_sqrt_ps(a)
+#define V_MAX(a, b) _mm_max_ps(a, b)
+#define V_LT(a, b) _mm_cmplt_ps(a, b)
+#define V_LE(a, b) _mm_cmple_ps(a, b)
+#define V_GT(a, b) _mm_cmpgt_ps(a, b)
+#define V_GE(a, b) _mm_cmpge_ps(a, b)
+#define V_AND(a, b) _mm_and_ps(a, b)
+#define V_SELECT(m, a, b) _mm_blendv_ps(b, a, m)
+#define V_ANY(m) (_mm_movemask_ps(m) != 0)
+#include "ray_packet_kernel.h"
+
+#define KERNEL_SPHERES ray_packet_intersect_spheres_avx2
+#define KERNEL_TRIANGLES ray_packet_intersect_triangles_avx2
+#define KERNEL_WIDTH 8
+#define KERNEL_TARGET SIMD_TARGET("avx2")
+#define V_FLOAT __m256
+#define V_MASK __m256
+#define V_LOAD(p) _mm256_loadu_ps(p)
+#define V_LOAD_BITS(p) _mm256_loadu_ps((const float *) (p))
+#define V_STORE(p, v) _mm256_storeu_ps(p, v)
+#define V_STORE_BITS(p, v) _mm256_storeu_ps((float *) (p), v)
+#define V_SET1(x) _mm256_set1_ps(x)
+#define V_SET1_BITS(x) _mm256_castsi256_ps(_mm256_set1_epi32((int) (x)))
+#define V_ADD(a, b) _mm256_add_ps(a, b)
+#define V_SUB(a, b) _mm256_sub_ps(a, b)
+#define V_MUL(a, b) _mm256_mul_ps(a, b)
+#define V_DIV(a, b) _mm256_div_ps(a, b)
+#define V_SQRT(a) _mm256_sqrt_ps(a)
+#define V_MAX(a, b) _mm256_max_ps(a, b)
+#define V_LT(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define V_LE(a, b) _mm256_cmp_ps(a, b, _CMP_LE_OQ)
+#define V_GT(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define V_GE(a, b) _mm256_cmp_ps(a, b, _CMP_GE_OQ)
+#define V_AND(a, b) _mm256_and_ps(a, b)
+#define V_SELECT(m, a, b) _mm256_blendv_ps(b, a, m)
+#define V_ANY(m) (_mm256_movemask_ps(m) != 0)
+#include "ray_packet_kernel.h"
+
+#define KERNEL_SPHERES ray_packet_intersect_spheres_avx512
+#define KERNEL_TRIANGLES ray_packet_intersect_triangles_avx512
+#define KERNEL_WIDTH 16
+#define KERNEL_TARGET SIMD_TARGET("avx512f")
+#define V_FLOAT __m512
+#define V_MASK __mmask16
+#define V_LOAD(p) _mm512_loadu_ps(p)
+#define V_LOAD_BITS(p) _mm512_loadu_ps((const float *) (p))
+#define V_STORE(p, v) _mm512_storeu_ps(p, v)
+#define V_STORE_BITS(p, v) _mm512_storeu_ps((float *) (p), v)
+#define V_SET1(x) _mm512_set1_ps(x)
+#define V_SET1_BITS(x) _mm512_castsi512_ps(_mm512_set1_epi32((int) (x)))
+#define V_ADD(a, b) _mm512_add_ps(a, b)
+#define V_SUB(a, b) _mm512_sub_ps(a, b)
+#define V_MUL(a, b) _mm512_mul_ps(a, b)
+#define V_DIV(a, b) _mm512_div_ps(a, b)
+#define V_SQRT(a) _mm512_sqrt_ps(a)
+#define V_MAX(a, b) _mm512_max_ps(a, b)
+#define V_LT(a, b) _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ)
+#define V_LE(a, b) _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ)
+#define V_GT(a, b) _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ)
+#define V_GE(a, b) _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ)
+#define V_AND(a, b) ((__mmask16) ((a) & (b)))
+#define V_SELECT(m, a, b) _mm512_mask_blend_ps(m, b, a)
+#define V_ANY(m) ((m) != 0)
+#include "ray_packet_kernel.h"
+
+#elif defined(SIMD_NEON)
+
+#define KERNEL_SPHERES ray_packet_intersect_spheres_neon
+#define KERNEL_TRIANGLES ray_packet_intersect_triangles_neon
+#define KERNEL_WIDTH 4
+#define KERNEL_TARGET
+#define V_FLOAT float32x4_t
+#define V_MASK uint32x4_t
+#define V_LOAD(p) vld1q_f32(p)
+#define V_LOAD_BITS(p) vreinterpretq_f32_u32(vld1q_u32(p))
+#define V_STORE(p, v) vst1q_f32(p, v)
+#define V_STORE_BITS(p, v) vst1q_u32(p, vreinterpretq_u32_f32(v))
+#define V_SET1(x) vdupq_n_f32(x)
+#define V_SET1_BITS(x) vreinterpretq_f32_u32(vdupq_n_u32(x))
+#define V_ADD(a, b) vaddq_f32(a, b)
+#define V_SUB(a, b) vsubq_f32(a, b)
+#define V_MUL(a, b) vmulq_f32(a, b)
+#define V_DIV(a, b) vdivq_f32(a, b)
+#define V_SQRT(a) vsqrtq_f32(a)
+#define V_MAX(a, b) vmaxq_f32(a, b)
+#define V_LT(a, b) vcltq_f32(a, b)
+#define V_LE(a, b) vcleq_f32(a, b)
+#define V_GT(a, b) vcgtq_f32(a, b)
+#define V_GE(a, b) vcgeq_f32(a, b)
+#define V_AND(a, b) vandq_u32(a, b)
+#define V_SELECT(m, a, b) vbslq_f32(m, a, b)
+#define V_ANY(m) (vmaxvq_u32(m) != 0)
+#include "ray_packet_kernel.h"
+
+#endif
+
+void ray_packet_intersect_spheres(const RayPacket *rays, const SphereSoa *spheres, float t_min, u32 first_id) {
+    u32 done = 0;
+    switch (simd_get_isa()) {
+#if defined(SIMD_X86)
+        case SIMD_ISA_SSE4:
+            done = ray_packet_intersect_spheres_sse4(rays, spheres, t_min, first_id);
+            break;
+        case SIMD_ISA_AVX2:
+            done = ray_packet_intersect_spheres_avx2(rays, spheres, t_min, first_id);
+            break;
+        case SIMD_ISA_AVX512:
+            done = ray_packet_intersect_spheres_avx512(rays, spheres, t_min, first_id);
+            break;
+#elif defined(SIMD_NEON)
+        case SIMD_ISA_NEON:
+            done = ray_packet_intersect_spheres_neon(rays, spheres, t_min, first_id);
+            break;
+#endif
+        default:
+            break;
+    }
+    ray_packet_intersect_spheres_scalar(rays, done, spheres, t_min, first_id);
+}
+
+void ray_packet_intersect_triangles(const RayPacket *rays, const TriangleSoa *triangles, float t_min,
+                                    u32 first_id) {
+    u32 done = 0;
+    switch (simd_get_isa()) {
+#if defined(SIMD_X86)
+        case SIMD_ISA_SSE4:
+            done = ray_packet_intersect_triangles_sse4(rays, triangles, t_min, first_id);
+            break;
+        case SIMD_ISA_AVX2:
+            done = ray_packet_intersect_triangles_avx2(rays, triangles, t_min, first_id);
+            break;
+        case SIMD_ISA_AVX512:
+            done = ray_packet_intersect_triangles_avx512(rays, triangles, t_min, first_id);
+            break;
+#elif defined(SIMD_NEON)
+        case SIMD_ISA_NEON:
+            done = ray_packet_intersect_triangles_neon(rays, triangles, t_min, first_id);
+            break;
+#endif
+        default:
+            break;
+    }
+    ray_packet_intersect_triangles_scalar(rays, done, triangles, t_min, first_id);
+}
@@ -0,0 +1,51 @@
+#ifndef CGFS_RAY_PACKET_H
+#define CGFS_RAY_PACKET_H
+
+#include "types.h"
+
+#define RAY_PACKET_NO_HIT 0xFFFFFFFF
+
+/*
+ * Rays and primitives are stored as structures of arrays so that one vector load fetches the same component of
+ * 4, 8 or 16 rays. tMax is both the search limit and the closest hit distance found so far, which lets several
+ * primitive sets be intersected in turn.
+ */
+typedef struct ray_packet_s {
+    float *originX;
+    float *originY;
+    float *originZ;
+    float *directionX;
+    float *directionY;
+    float *directionZ;
+    float *tMax;
+    u32 *hitId;
+    u32 count;
+} RayPacket;
+
+typedef struct sphere_soa_s {
+    const float *centerX;
+    const float *centerY;
+    const float *centerZ;
+    const float *radius;
+    u32 count;
+} SphereSoa;
+
+typedef struct triangle_soa_s {
+    const float *v0X;
+    const float *v0Y;
+    const float *v0Z;
+    const float *edge1X;
+    const float *edge1Y;
+    const float *edge1Z;
+    const float *edge2X;
+    const float *edge2Y;
+    const float *edge2Z;
+    u32 count;
+} TriangleSoa;
+
+void ray_packet_intersect_spheres(const RayPacket *rays, const SphereSoa *spheres, float t_min, u32 first_id);
+
+void ray_packet_intersect_triangles(const RayPacket *rays, const TriangleSoa *triangles, float t_min,
+                                    u32 first_id);
+
+#endif //CGFS_RAY_PACKET_H
@@ -0,0 +1,128 @@
+/*
+ * Packet intersection kernels, written once against the V_* vector macros. ray_packet.c includes this file once
+ * per instruction set after defining the macros, the kernel names, KERNEL_WIDTH and KERNEL_TARGET; there is
+ * deliberately no include guard. Kernels process whole vectors only and return how many rays they handled.
+ */
+
+KERNEL_TARGET
+u32 KERNEL_SPHERES(const RayPacket *rays, const SphereSoa *spheres, float t_min, u32 first_id) {
+    u32 count = rays->count / KERNEL_WIDTH * KERNEL_WIDTH;
+    V_FLOAT zero = V_SET1(0.0f);
+    V_FLOAT one = V_SET1(1.0f);
+    V_FLOAT tMin = V_SET1(t_min);
+    for (u32 i = 0; i < count; i += KERNEL_WIDTH) {
+        V_FLOAT originX = V_LOAD(rays->originX + i);
+        V_FLOAT originY = V_LOAD(rays->originY + i);
+        V_FLOAT originZ = V_LOAD(rays->originZ + i);
+        V_FLOAT directionX = V_LOAD(rays->directionX + i);
+        V_FLOAT directionY = V_LOAD(rays->directionY + i);
+        V_FLOAT directionZ = V_LOAD(rays->directionZ + i);
+        V_FLOAT a = V_ADD(V_ADD(V_MUL(directionX, directionX), V_MUL(directionY, directionY)),
+                          V_MUL(directionZ, directionZ));
+        V_FLOAT inverseA = V_DIV(one, a);
+        V_FLOAT closest = V_LOAD(rays->tMax + i);
+        V_FLOAT hitId = V_LOAD_BITS(rays->hitId + i);
+        for (u32 j = 0; j < spheres->count; j++) {
+            V_FLOAT ocX = V_SUB(originX, V_SET1(spheres->centerX[j]));
+            V_FLOAT ocY = V_SUB(originY, V_SET1(spheres->centerY[j]));
+            V_FLOAT ocZ = V_SUB(originZ, V_SET1(spheres->centerZ[j]));
+            V_FLOAT halfB = V_ADD(V_ADD(V_MUL(ocX, directionX), V_MUL(ocY, directionY)), V_MUL(ocZ, directionZ));
+            V_FLOAT c = V_SUB(V_ADD(V_ADD(V_MUL(ocX, ocX), V_MUL(ocY, ocY)), V_MUL(ocZ, ocZ)),
+                              V_SET1(spheres->radius[j] * spheres->radius[j]));
+            V_FLOAT discriminant = V_SUB(V_MUL(halfB, halfB), V_MUL(a, c));
+            V_MASK valid = V_GT(discriminant, zero);
+            if (!V_ANY(valid)) {
+                continue;
+            }
+            V_FLOAT root = V_SQRT(V_MAX(discriminant, zero));
+            V_FLOAT negativeB = V_SUB(zero, halfB);
+            V_FLOAT tNear = V_MUL(V_SUB(negativeB, root), inverseA);
+            V_FLOAT tFar = V_MUL(V_ADD(negativeB, root), inverseA);
+            V_FLOAT t = V_SELECT(V_GT(tNear, tMin), tNear, tFar);
+            V_MASK hit = V_AND(V_AND(valid, V_GT(t, tMin)), V_LT(t, closest));
+            closest = V_SELECT(hit, t, closest);
+            hitId = V_SELECT(hit, V_SET1_BITS(first_id + j), hitId);
+        }
+        V_STORE(rays->tMax + i, closest);
+        V_STORE_BITS(rays->hitId + i, hitId);
+    }
+    return count;
+}
+
+KERNEL_TARGET
+u32 KERNEL_TRIANGLES(const RayPacket *rays, const TriangleSoa *triangles, float t_min, u32 first_id) {
+    u32 count = rays->count / KERNEL_WIDTH * KERNEL_WIDTH;
+    V_FLOAT zero = V_SET1(0.0f);
+    V_FLOAT one = V_SET1(1.0f);
+    V_FLOAT tMin = V_SET1(t_min);
+    V_FLOAT epsilon = V_SET1(RAY_PACKET_DETERMINANT_EPSILON);
+    for (u32 i = 0; i < count; i += KERNEL_WIDTH) {
+        V_FLOAT originX = V_LOAD(rays->originX + i);
+        V_FLOAT originY = V_LOAD(rays->originY + i);
+        V_FLOAT originZ = V_LOAD(rays->originZ + i);
+        V_FLOAT directionX = V_LOAD(rays->directionX + i);
+        V_FLOAT directionY = V_LOAD(rays->directionY + i);
+        V_FLOAT directionZ = V_LOAD(rays->directionZ + i);
+        V_FLOAT closest = V_LOAD(rays->tMax + i);
+        V_FLOAT hitId = V_LOAD_BITS(rays->hitId + i);
+        for (u32 j = 0; j < triangles->count; j++) {
+            V_FLOAT edge1X = V_SET1(triangles->edge1X[j]);
+            V_FLOAT edge1Y = V_SET1(triangles->edge1Y[j]);
+            V_FLOAT edge1Z = V_SET1(triangles->edge1Z[j]);
+            V_FLOAT edge2X = V_SET1(triangles->edge2X[j]);
+            V_FLOAT edge2Y = V_SET1(triangles->edge2Y[j]);
+            V_FLOAT edge2Z = V_SET1(triangles->edge2Z[j]);
+            V_FLOAT pX = V_SUB(V_MUL(directionY, edge2Z), V_MUL(directionZ, edge2Y));
+            V_FLOAT pY = V_SUB(V_MUL(directionZ, edge2X), V_MUL(directionX, edge2Z));
+            V_FLOAT pZ = V_SUB(V_MUL(directionX, edge2Y), V_MUL(directionY, edge2X));
+            V_FLOAT determinant = V_ADD(V_ADD(V_MUL(edge1X, pX), V_MUL(edge1Y, pY)), V_MUL(edge1Z, pZ));
+            V_FLOAT inverseDeterminant = V_DIV(one, determinant);
+            V_FLOAT tX = V_SUB(originX, V_SET1(triangles->v0X[j]));
+            V_FLOAT tY = V_SUB(originY, V_SET1(triangles->v0Y[j]));
+            V_FLOAT tZ = V_SUB(originZ, V_SET1(triangles->v0Z[j]));
+            V_FLOAT u = V_MUL(V_ADD(V_ADD(V_MUL(tX, pX), V_MUL(tY, pY)), V_MUL(tZ, pZ)), inverseDeterminant);
+            V_FLOAT qX = V_SUB(V_MUL(tY, edge1Z), V_MUL(tZ, edge1Y));
+            V_FLOAT qY = V_SUB(V_MUL(tZ, edge1X), V_MUL(tX, edge1Z));
+            V_FLOAT qZ = V_SUB(V_MUL(tX, edge1Y), V_MUL(tY, edge1X));
+            V_FLOAT v = V_MUL(V_ADD(V_ADD(V_MUL(directionX, qX), V_MUL(directionY, qY)), V_MUL(directionZ, qZ)),
+                              inverseDeterminant);
+            V_FLOAT t = V_MUL(V_ADD(V_ADD(V_MUL(edge2X, qX), V_MUL(edge2Y, qY)), V_MUL(edge2Z, qZ)),
+                              inverseDeterminant);
+            V_MASK hit = V_AND(V_GT(V_MUL(determinant, determinant), epsilon),
+                               V_AND(V_GE(u, zero), V_GE(v, zero)));
+            hit = V_AND(hit, V_LE(V_ADD(u, v), one));
+            hit = V_AND(hit, V_AND(V_GT(t, tMin), V_LT(t, closest)));
+            closest = V_SELECT(hit, t, closest);
+            hitId = V_SELECT(hit, V_SET1_BITS(first_id + j), hitId);
+        }
+        V_STORE(rays->tMax + i, closest);
+        V_STORE_BITS(rays->hitId + i, hitId);
+    }
+    return count;
+}
+
+#undef KERNEL_SPHERES
+#undef KERNEL_TRIANGLES
+#undef KERNEL_WIDTH
+#undef KERNEL_TARGET
+#undef V_FLOAT
+#undef V_MASK
+#undef V_LOAD
+#undef V_LOAD_BITS
+#undef V_STORE
+#undef V_STORE_BITS
+#undef V_SET1
+#undef V_SET1_BITS
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_DIV
+#undef V_SQRT
+#undef V_MAX
+#undef V_LT
+#undef V_LE
+#undef V_GT
+#undef V_GE
+#undef V_AND
+#undef V_SELECT
+#undef V_ANY
@@ -0,0 +1,262 @@
+#include <float.h>
+#include <stddef.h>
+#include "raytracer.h"
+#include "atomic.h"
+#include "job.h"
+#include "profiler.h"
+
+#define RAYTRACER_TILE_SIZE 32
+#define RAYTRACER_EPSILON 0.001f
+
+typedef struct raytracer_frame_s {
+    const RaytracerScene *scene;
+    u32 width;
+    u32 height;
+    u32 rectX;
+    u32 rectY;
+    u32 rectWidth;
+    u32 rectHeight;
+    u8 *pixels;
+    u32 tileCountX;
+    u32 tileCount;
+    i32 nextTile;
+    float viewportWidth;
+    float viewportHeight;
+} RaytracerFrame;
+
+static const RaytracerSphere raytracer_default_spheres[] = {
+        {{0.0f, -1.0f, 3.0f}, 1.0f, {1.0f, 0.0f, 0.0f}, 500.0f, 0.2f},
+        {{2.0f, 0.0f, 4.0f}, 1.0f, {0.0f, 0.0f, 1.0f}, 500.0f, 0.3f},
+        {{-2.0f, 0.0f, 4.0f}, 1.0f, {0.0f, 1.0f, 0.0f}, 10.0f, 0.4f},
+        {{0.0f, -5001.0f, 0.0f}, 5000.0f, {1.0f, 1.0f, 0.0f}, 1000.0f, 0.5f},
+};
+
+static const RaytracerLight raytracer_default_lights[] = {
+        {RAYTRACER_LIGHT_AMBIENT, 0.2f, {0.0f, 0.0f, 0.0f}},
+        {RAYTRACER_LIGHT_POINT, 0.6f, {2.0f, 1.0f, 0.0f}},
+        {RAYTRACER_LIGHT_DIRECTIONAL, 0.2f, {1.0f, 4.0f, 4.0f}},
+};
+
+void raytracer_get_default_scene(RaytracerScene *scene) {
+    static const float identity[9] = {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+    scene->spheres = raytracer_default_spheres;
+    scene->sphereCount = sizeof(raytracer_default_spheres) / sizeof(RaytracerSphere);
+    scene->lights = raytracer_default_lights;
+    scene->lightCount = sizeof(raytracer_default_lights) / sizeof(RaytracerLight);
+    scene->cameraPosition = vec3(0.0f, 0.0f, 0.0f);
+    for (u32 i = 0; i < 9; i++) {
+        scene->cameraRotation[i] = identity[i];
+    }
+    scene->backgroundColor = vec3(0.0f, 0.0f, 0.0f);
+    scene->recursionDepth = 3;
+}
+
+/*
+ * Solved in double precision: with a large sphere such as the floor, |co|^2 and r^2 are both huge and nearly equal,
+ * and in float their difference is noisy enough to speckle the surface with acne.
+ */
+float raytracer_intersect_sphere(Vec3 origin, Vec3 direction, float directionDot, const RaytracerSphere *sphere,
+                                 float tMin, float tMax) {
+    double cox = (double) origin.x - sphere->center.x;
+    double coy = (double) origin.y - sphere->center.y;
+    double coz = (double) origin.z - sphere->center.z;
+    double a = directionDot;
+    double halfB = cox * direction.x + coy * direction.y + coz * direction.z;
+    double c = cox * cox + coy * coy + coz * coz - (double) sphere->radius * sphere->radius;
+    double discriminant = halfB * halfB - a * c;
+    if (discriminant < 0.0) {
+        return FLT_MAX;
+    }
+    double root = sqrt(discriminant);
+    float t = (float) ((-halfB - root) / a);
+    if (t > tMin && t < tMax) {
+        return t;
+    }
+    t = (float) ((-halfB + root) / a);
+    if (t > tMin && t < tMax) {
+        return t;
+    }
+    return FLT_MAX;
+}
+
+const RaytracerSphere *raytracer_closest_intersection(const RaytracerScene *scene, Vec3 origin, Vec3 direction,
+                                                      float tMin, float tMax, float *closestT) {
+    float directionDot = vec3_dot(direction, direction);
+    const RaytracerSphere *closestSphere = NULL;
+    *closestT = tMax;
+    for (u32 i = 0; i < scene->sphereCount; i++) {
+        float t = raytracer_intersect_sphere(origin, direction, directionDot, &scene->spheres[i], tMin, *closestT);
+        if (t < *closestT) {
+            *closestT = t;
+            closestSphere = &scene->spheres[i];
+        }
+    }
+    return closestSphere;
+}
+
+bool raytracer_is_occluded(const RaytracerScene *scene, Vec3 origin, Vec3 direction, float tMax) {
+    float directionDot = vec3_dot(direction, direction);
+    for (u32 i = 0; i < scene->sphereCount; i++) {
+        if (raytracer_intersect_sphere(origin, direction, directionDot, &scene->spheres[i], RAYTRACER_EPSILON,
+                                       tMax) != FLT_MAX) {
+            return true;
+        }
+    }
+    return false;
+}
+
+float raytracer_compute_lighting(const RaytracerScene *scene, Vec3 point, Vec3 normal, Vec3 view, float specular) {
+    float intensity = 0.0f;
+    float viewLength = vec3_length(view);
+    for (u32 i = 0; i < scene->lightCount; i++) {
+        const RaytracerLight *light = &scene->lights[i];
+        if (light->type == RAYTRACER_LIGHT_AMBIENT) {
+            intensity += light->intensity;
+            continue;
+        }
+        Vec3 lightVector;
+        float tMax;
+        if (light->type == RAYTRACER_LIGHT_POINT) {
+            lightVector = vec3_sub(light->vector, point);
+            tMax = 1.0f;
+        } else {
+            lightVector = light->vector;
+            tMax = FLT_MAX;
+        }
+        if (raytracer_is_occluded(scene, point, lightVector, tMax)) {
+            continue;
+        }
+        float lightLength = vec3_length(lightVector);
+        float normalDotLight = vec3_dot(normal, lightVector);
+        if (normalDotLight > 0.0f) {
+            intensity += light->intensity * normalDotLight / lightLength;
+        }
+        if (specular >= 0.0f) {
+            Vec3 reflected = vec3_reflect(lightVector, normal);
+            float reflectedDotView = vec3_dot(reflected, view);
+            if (reflectedDotView > 0.0f) {
+                intensity += light->intensity *
+                             powf(reflectedDotView / (vec3_length(reflected) * viewLength), specular);
+            }
+        }
+    }
+    return intensity;
+}
+
+Vec3 raytracer_trace_ray(const RaytracerScene *scene, Vec3 origin, Vec3 direction, float tMin, float tMax,
+                         u32 depth) {
+    float t;
+    const RaytracerSphere *sphere = raytracer_closest_intersection(scene, origin, direction, tMin, tMax, &t);
+    if (sphere == NULL) {
+        return scene->backgroundColor;
+    }
+    Vec3 point = vec3_add(origin, vec3_scale(direction, t));
+    Vec3 normal = vec3_scale(vec3_sub(point, sphere->center), 1.0f / sphere->radius);
+    Vec3 view = vec3_scale(direction, -1.0f);
+    float lighting = raytracer_compute_lighting(scene, point, normal, view, sphere->specular);
+    Vec3 localColor = vec3_scale(sphere->color, lighting);
+    if (depth == 0 || sphere->reflective <= 0.0f) {
+        return localColor;
+    }
+    Vec3 reflectedColor = raytracer_trace_ray(scene, point, vec3_reflect(view, normal), RAYTRACER_EPSILON, FLT_MAX,
+                                              depth - 1);
+    return vec3_add(vec3_scale(localColor, 1.0f - sphere->reflective),
+                    vec3_scale(reflectedColor, sphere->reflective));
+}
+
+u8 raytracer_to_byte(float value) {
+    if (value <= 0.0f) {
+        return 0;
+    }
+    if (value >= 1.0f) {
+        return 255;
+    }
+    return (u8) (value * 255.0f + 0.5f);
+}
+
+void raytracer_render_tile(RaytracerFrame *frame, u32 tile) {
+    const RaytracerScene *scene = frame->scene;
+    const float *rotation = scene->cameraRotation;
+    u32 rectX1 = frame->rectX + frame->rectWidth;
+    u32 rectY1 = frame->rectY + frame->rectHeight;
+    u32 x0 = frame->rectX + tile % frame->tileCountX * RAYTRACER_TILE_SIZE;
+    u32 y0 = frame->rectY + tile / frame->tileCountX * RAYTRACER_TILE_SIZE;
+    u32 x1 = x0 + RAYTRACER_TILE_SIZE < rectX1 ? x0 + RAYTRACER_TILE_SIZE : rectX1;
+    u32 y1 = y0 + RAYTRACER_TILE_SIZE < rectY1 ? y0 + RAYTRACER_TILE_SIZE : rectY1;
+    float scaleX = frame->viewportWidth / (float) frame->width;
+    float scaleY = frame->viewportHeight / (float) frame->height;
+    for (u32 y = y0; y < y1; y++) {
+        u8 *row = frame->pixels + (usize) (y - frame->rectY) * frame->rectWidth * 4;
+        float viewportY = ((float) frame->height * 0.5f - (float) y - 0.5f) * scaleY;
+        for (u32 x = x0; x < x1; x++) {
+            float viewportX = ((float) x + 0.5f - (float) frame->width * 0.5f) * scaleX;
+            Vec3 direction = vec3(rotation[0] * viewportX + rotation[1] * viewportY + rotation[2],
+                                  rotation[3] * viewportX + rotation[4] * viewportY + rotation[5],
+                                  rotation[6] * viewportX + rotation[7] * viewportY + rotation[8]);
+            Vec3 color = raytracer_trace_ray(scene, scene->cameraPosition, direction, 1.0f, FLT_MAX,
+                                             scene->recursionDepth);
+            u8 *pixel = row + (x - frame->rectX) * 4;
+            pixel[0] = raytracer_to_byte(color.x);
+            pixel[1] = raytracer_to_byte(color.y);
+            pixel[2] = raytracer_to_byte(color.z);
+            pixel[3] = 255;
+        }
+    }
+}
+
+/*
+ * Every job keeps claiming the next unrendered tile until none are left, so threads that land on cheap tiles (sky)
+ * simply render more of them and the frame finishes when the last expensive tile does.
+ */
+void raytracer_render_tiles_job(void *arg) {
+    RaytracerFrame *frame = arg;
+    profiler_begin("raytrace tiles");
+    for (;;) {
+        i32 tile = atomic_fetch_add_i32(&frame->nextTile, 1, ATOMIC_RELAXED);
+        if ((u32) tile >= frame->tileCount) {
+            break;
+        }
+        raytracer_render_tile(frame, (u32) tile);
+    }
+    profiler_end();
+}
+
+/*
+ * Renders the scene into a tightly packed RGBA8 framebuffer. The viewport is one unit tall at distance one from the
+ * camera, and as wide as the aspect ratio requires.
+ */
+void raytracer_render(const RaytracerScene *scene, u32 width, u32 height, u8 *pixels) {
+    raytracer_render_rect(scene, width, height, 0, 0, width, height, pixels);
+}
+
+void raytracer_render_rect(const RaytracerScene *scene, u32 width, u32 height, u32 x, u32 y, u32 rect_width,
+                           u32 rect_height, u8 *pixels) {
+    if (rect_width == 0 || rect_height == 0) {
+        return;
+    }
+    RaytracerFrame frame;
+    frame.scene = scene;
+    frame.width = width;
+    frame.height = height;
+    frame.rectX = x;
+    frame.rectY = y;
+    frame.rectWidth = rect_width;
+    frame.rectHeight = rect_height;
+    frame.pixels = pixels;
+    frame.tileCountX = (rect_width + RAYTRACER_TILE_SIZE - 1) / RAYTRACER_TILE_SIZE;
+    frame.tileCount = frame.tileCountX * ((rect_height + RAYTRACER_TILE_SIZE - 1) / RAYTRACER_TILE_SIZE);
+    frame.nextTile = 0;
+    frame.viewportHeight = 1.0f;
+    frame.viewportWidth = (float) width / (float) height;
+
+    JobCounter counter;
+    job_counter_init(&counter);
+    u32 jobCount = job_system_get_thread_count();
+    if (jobCount > frame.tileCount) {
+        jobCount = frame.tileCount;
+    }
+    for (u32 i = 0; i < jobCount; i++) {
+        job_run(raytracer_render_tiles_job, &frame, &counter);
+    }
+    job_wait(&counter);
+}
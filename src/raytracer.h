@@ -0,0 +1,46 @@
+#ifndef CGFS_RAYTRACER_H
+#define CGFS_RAYTRACER_H
+
+#include "types.h"
+#include "vec3.h"
+
+typedef struct raytracer_sphere_s {
+    Vec3 center;
+    float radius;
+    Vec3 color;
+    float specular;
+    float reflective;
+} RaytracerSphere;
+
+typedef enum raytracer_light_type_e {
+    RAYTRACER_LIGHT_AMBIENT,
+    RAYTRACER_LIGHT_POINT,
+    RAYTRACER_LIGHT_DIRECTIONAL
+} RaytracerLightType;
+
+typedef struct raytracer_light_s {
+    RaytracerLightType type;
+    float intensity;
+    Vec3 vector;
+} RaytracerLight;
+
+typedef struct raytracer_scene_s {
+    const RaytracerSphere *spheres;
+    u32 sphereCount;
+    const RaytracerLight *lights;
+    u32 lightCount;
+    Vec3 cameraPosition;
+    float cameraRotation[9];
+    Vec3 backgroundColor;
+    u32 recursionDepth;
+} RaytracerScene;
+
+void raytracer_get_default_scene(RaytracerScene *scene);
+
+void raytracer_render(const RaytracerScene *scene, u32 width, u32 height, u8 *pixels);
+
+/* Renders only the given rectangle of a width by height frame, into a buffer packed to the rectangle's width. */
+void raytracer_render_rect(const RaytracerScene *scene, u32 width, u32 height, u32 x, u32 y, u32 rect_width,
+                           u32 rect_height, u8 *pixels);
+
+#endif //CGFS_RAYTRACER_H
@@ -0,0 +1,69 @@
+#ifndef CGFS_REACTOR_H
+#define CGFS_REACTOR_H
+
+#include "socket.h"
+#include "types.h"
+
+/*
+ * Single threaded event loop over non-blocking sockets and timers, backed by epoll on Linux, poll on other POSIX
+ * systems and an I/O completion port on win32. Operations are completion based on all of them: a callback runs from
+ * reactor_run_once once a receive got data, a send went out in full, a connection was accepted or a connect finished.
+ * Buffers handed to an operation must stay valid until its callback ran. Statuses are 0 or an errno / WSA error code.
+ */
+typedef struct reactor_s Reactor;
+typedef struct reactor_socket_s ReactorSocket;
+typedef struct reactor_timer_s ReactorTimer;
+
+typedef void (*ReactorAcceptCallback)(ReactorSocket *listener, ReactorSocket *connection, void *user_data);
+
+typedef void (*ReactorConnectCallback)(ReactorSocket *sock, int status, void *user_data);
+
+/* A length of 0 with status 0 means the peer closed the connection. */
+typedef void (*ReactorReceiveCallback)(ReactorSocket *sock, int status, usize length, void *user_data);
+
+typedef void (*ReactorSendCallback)(ReactorSocket *sock, int status, void *user_data);
+
+typedef void (*ReactorTimerCallback)(ReactorTimer *timer, void *user_data);
+
+Reactor *reactor_create();
+
+/* Closes every socket and timer still registered, without running their callbacks. */
+void reactor_destroy(Reactor *reactor);
+
+/* Waits up to timeout_ms (negative for no limit) and dispatches what is ready. Returns the number of callbacks run. */
+int reactor_run_once(Reactor *reactor, i64 timeout_ms);
+
+/* Safe to call from any thread; makes a blocked reactor_run_once return. */
+void reactor_wake(Reactor *reactor);
+
+ReactorSocket *reactor_listen(Reactor *reactor, const struct sockaddr *addr, int addr_length, int backlog,
+                              ReactorAcceptCallback callback, void *user_data);
+
+ReactorSocket *reactor_connect(Reactor *reactor, const struct sockaddr *addr, int addr_length,
+                               ReactorConnectCallback callback, void *user_data);
+
+/* At most one receive can be outstanding per socket. */
+int reactor_receive(ReactorSocket *sock, void *buffer, usize capacity, ReactorReceiveCallback callback);
+
+/* Sends are queued and go out in order; the callback runs once all length bytes were written. */
+int reactor_send(ReactorSocket *sock, const void *buffer, usize length, ReactorSendCallback callback);
+
+/* Bytes queued by reactor_send that have not been written yet, for back-pressure. */
+usize reactor_get_pending_send_bytes(ReactorSocket *sock);
+
+void reactor_socket_set_user_data(ReactorSocket *sock, void *user_data);
+
+void *reactor_socket_get_user_data(ReactorSocket *sock);
+
+Socket reactor_socket_get_handle(ReactorSocket *sock);
+
+/* Outstanding operations complete with ECANCELED from a later reactor_run_once, after which the socket is freed. */
+void reactor_close(ReactorSocket *sock);
+
+/* Fires after delay_ms, then every interval_ms unless that is 0, in which case the timer is freed after firing. */
+ReactorTimer *reactor_add_timer(Reactor *reactor, u64 delay_ms, u64 interval_ms, ReactorTimerCallback callback,
+                                void *user_data);
+
+void reactor_cancel_timer(Reactor *reactor, ReactorTimer *timer);
+
+#endif //CGFS_REACTOR_H
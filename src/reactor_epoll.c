@@ -0,0 +1,122 @@
+#ifdef __linux__
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "reactor_posix.h"
+
+#define REACTOR_EVENT_BATCH_SIZE 64
+
+Reactor *reactor_create() {
+    Reactor *reactor = calloc(1, sizeof(Reactor));
+    if (reactor == NULL) {
+        return NULL;
+    }
+    reactor->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    reactor->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    if (reactor->epollFd == -1 || reactor->wakeFd == -1 ||
+        epoll_ctl(reactor->epollFd, EPOLL_CTL_ADD, reactor->wakeFd, &event) != 0) {
+        if (reactor->epollFd != -1) {
+            close(reactor->epollFd);
+        }
+        if (reactor->wakeFd != -1) {
+            close(reactor->wakeFd);
+        }
+        free(reactor);
+        return NULL;
+    }
+    return reactor;
+}
+
+void reactor_destroy(Reactor *reactor) {
+    reactor_release_all(reactor);
+    close(reactor->wakeFd);
+    close(reactor->epollFd);
+    free(reactor);
+}
+
+/*
+ * Level triggered epoll, with each socket registered only while it has something to wait for so that a hung up
+ * socket without outstanding operations does not keep waking the loop.
+ */
+void reactor_update_events(ReactorSocket *sock) {
+    if (sock->closed) {
+        return;
+    }
+    u32 events = 0;
+    if (sock->kind == REACTOR_SOCKET_LISTENER || sock->receiveCallback != NULL) {
+        events |= EPOLLIN;
+    }
+    if (sock->kind == REACTOR_SOCKET_CONNECTING || sock->sendHead != NULL) {
+        events |= EPOLLOUT;
+    }
+    if (sock->registered && events == sock->events) {
+        return;
+    }
+    if (events == 0) {
+        reactor_unregister_socket(sock);
+        return;
+    }
+    struct epoll_event event;
+    event.events = events;
+    event.data.ptr = sock;
+    epoll_ctl(sock->reactor->epollFd, sock->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, sock->handle, &event);
+    sock->registered = true;
+    sock->events = events;
+}
+
+void reactor_unregister_socket(ReactorSocket *sock) {
+    if (sock->registered) {
+        epoll_ctl(sock->reactor->epollFd, EPOLL_CTL_DEL, sock->handle, NULL);
+        sock->registered = false;
+    }
+}
+
+Socket reactor_open_socket(int family) {
+    return socket_create(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+}
+
+Socket reactor_accept_socket(Socket listener) {
+    return accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+}
+
+int reactor_run_once(Reactor *reactor, i64 timeout_ms) {
+    i64 timeout = reactor->closedSockets != NULL ? 0 : reactor_timer_heap_get_timeout(&reactor->timers, timeout_ms);
+    struct epoll_event events[REACTOR_EVENT_BATCH_SIZE];
+    int eventCount = epoll_wait(reactor->epollFd, events, REACTOR_EVENT_BATCH_SIZE,
+                                timeout > INT_MAX ? INT_MAX : (int) timeout);
+    int count = 0;
+    for (int i = 0; i < eventCount; i++) {
+        ReactorSocket *sock = events[i].data.ptr;
+        if (sock == NULL) {
+            u64 value;
+            ssize_t result = read(reactor->wakeFd, &value, sizeof(value));
+            (void) result;
+            continue;
+        }
+        if (!sock->closed) {
+            count += reactor_handle_events(sock, (events[i].events & EPOLLIN) != 0,
+                                           (events[i].events & EPOLLOUT) != 0,
+                                           (events[i].events & (EPOLLERR | EPOLLHUP)) != 0);
+        }
+    }
+    count += reactor_timer_heap_fire(&reactor->timers);
+    count += reactor_release_closed_sockets(reactor);
+    return count;
+}
+
+void reactor_wake(Reactor *reactor) {
+    u64 value = 1;
+    ssize_t result = write(reactor->wakeFd, &value, sizeof(value));
+    (void) result;
+}
+
+#endif
@@ -0,0 +1,502 @@
+#ifdef _WIN32
+
+#include <winsock2.h>
+#include <mswsock.h>
+#include <ws2tcpip.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reactor_timer.h"
+
+#define REACTOR_EVENT_BATCH_SIZE 64
+#define REACTOR_ACCEPT_ADDRESS_SIZE (sizeof(struct sockaddr_storage) + 16)
+#define REACTOR_MAX_TRANSFER 0x40000000
+#define REACTOR_DESTROY_DRAIN_TIMEOUT 1000
+
+typedef enum reactor_socket_kind_e {
+    REACTOR_SOCKET_LISTENER,
+    REACTOR_SOCKET_CONNECTING,
+    REACTOR_SOCKET_STREAM
+} ReactorSocketKind;
+
+typedef enum reactor_operation_type_e {
+    REACTOR_OPERATION_ACCEPT,
+    REACTOR_OPERATION_CONNECT,
+    REACTOR_OPERATION_RECEIVE,
+    REACTOR_OPERATION_SEND
+} ReactorOperationType;
+
+/* The OVERLAPPED comes first, so the pointer handed back by the port is the operation itself. */
+typedef struct reactor_operation_s {
+    OVERLAPPED overlapped;
+    ReactorOperationType type;
+    struct reactor_socket_s *sock;
+} ReactorOperation;
+
+typedef struct reactor_send_s {
+    const u8 *data;
+    usize length;
+    usize sent;
+    ReactorSendCallback callback;
+    struct reactor_send_s *next;
+} ReactorSend;
+
+/*
+ * Only the head of the send queue is in flight, so partial completions can be resumed without reordering. A closed
+ * socket stays allocated until the port returned every operation that was still outstanding on it.
+ */
+struct reactor_socket_s {
+    Reactor *reactor;
+    Socket handle;
+    ReactorSocketKind kind;
+    int family;
+    void *userData;
+    ReactorAcceptCallback acceptCallback;
+    ReactorConnectCallback connectCallback;
+    LPFN_ACCEPTEX acceptEx;
+    Socket acceptHandle;
+    u8 acceptAddresses[REACTOR_ACCEPT_ADDRESS_SIZE * 2];
+    ReactorOperation acceptOperation;
+    ReactorOperation connectOperation;
+    ReactorOperation receiveOperation;
+    ReactorReceiveCallback receiveCallback;
+    ReactorOperation sendOperation;
+    ReactorSend *sendHead;
+    ReactorSend *sendTail;
+    usize pendingSendBytes;
+    u32 pendingOperations;
+    bool closed;
+    struct reactor_socket_s *previous;
+    struct reactor_socket_s *next;
+};
+
+struct reactor_s {
+    HANDLE port;
+    ReactorTimerHeap timers;
+    ReactorSocket *sockets;
+    u32 closingCount;
+};
+
+Reactor *reactor_create() {
+    Reactor *reactor = calloc(1, sizeof(Reactor));
+    if (reactor == NULL) {
+        return NULL;
+    }
+    reactor->port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    if (reactor->port == NULL) {
+        free(reactor);
+        return NULL;
+    }
+    return reactor;
+}
+
+void reactor_release(ReactorSocket *sock) {
+    if (!sock->closed || sock->pendingOperations > 0) {
+        return;
+    }
+    while (sock->sendHead != NULL) {
+        ReactorSend *request = sock->sendHead;
+        sock->sendHead = request->next;
+        free(request);
+    }
+    sock->reactor->closingCount--;
+    free(sock);
+}
+
+void reactor_close(ReactorSocket *sock) {
+    if (sock->closed) {
+        return;
+    }
+    Reactor *reactor = sock->reactor;
+    /* Closing the handle aborts every outstanding operation, which then completes through the port. */
+    socket_close(sock->handle);
+    if (sock->acceptHandle != INVALID_SOCKET_HANDLE && sock->pendingOperations == 0) {
+        socket_close(sock->acceptHandle);
+        sock->acceptHandle = INVALID_SOCKET_HANDLE;
+    }
+    sock->closed = true;
+    if (sock->previous != NULL) {
+        sock->previous->next = sock->next;
+    } else {
+        reactor->sockets = sock->next;
+    }
+    if (sock->next != NULL) {
+        sock->next->previous = sock->previous;
+    }
+    sock->previous = NULL;
+    sock->next = NULL;
+    reactor->closingCount++;
+    reactor_release(sock);
+}
+
+void reactor_destroy(Reactor *reactor) {
+    while (reactor->sockets != NULL) {
+        reactor_close(reactor->sockets);
+    }
+    /* Aborted operations come back quickly; drain them without callbacks so their sockets can be freed. */
+    OVERLAPPED_ENTRY entries[REACTOR_EVENT_BATCH_SIZE];
+    while (reactor->closingCount > 0) {
+        ULONG entryCount = 0;
+        if (!GetQueuedCompletionStatusEx(reactor->port, entries, REACTOR_EVENT_BATCH_SIZE, &entryCount,
+                                         REACTOR_DESTROY_DRAIN_TIMEOUT, FALSE)) {
+            break;
+        }
+        for (ULONG i = 0; i < entryCount; i++) {
+            ReactorOperation *operation = (ReactorOperation *) entries[i].lpOverlapped;
+            if (operation == NULL) {
+                continue;
+            }
+            ReactorSocket *sock = operation->sock;
+            if (operation->type == REACTOR_OPERATION_ACCEPT && sock->acceptHandle != INVALID_SOCKET_HANDLE) {
+                socket_close(sock->acceptHandle);
+                sock->acceptHandle = INVALID_SOCKET_HANDLE;
+            }
+            sock->pendingOperations--;
+            reactor_release(sock);
+        }
+    }
+    reactor_timer_heap_destroy(&reactor->timers);
+    CloseHandle(reactor->port);
+    free(reactor);
+}
+
+ReactorSocket *reactor_add_socket(Reactor *reactor, Socket handle, ReactorSocketKind kind, int family,
+                                  void *user_data) {
+    if (CreateIoCompletionPort((HANDLE) handle, reactor->port, 0, 0) == NULL) {
+        return NULL;
+    }
+    ReactorSocket *sock = calloc(1, sizeof(ReactorSocket));
+    if (sock == NULL) {
+        return NULL;
+    }
+    sock->reactor = reactor;
+    sock->handle = handle;
+    sock->kind = kind;
+    sock->family = family;
+    sock->userData = user_data;
+    sock->acceptHandle = INVALID_SOCKET_HANDLE;
+    sock->acceptOperation.type = REACTOR_OPERATION_ACCEPT;
+    sock->acceptOperation.sock = sock;
+    sock->connectOperation.type = REACTOR_OPERATION_CONNECT;
+    sock->connectOperation.sock = sock;
+    sock->receiveOperation.type = REACTOR_OPERATION_RECEIVE;
+    sock->receiveOperation.sock = sock;
+    sock->sendOperation.type = REACTOR_OPERATION_SEND;
+    sock->sendOperation.sock = sock;
+    sock->next = reactor->sockets;
+    if (reactor->sockets != NULL) {
+        reactor->sockets->previous = sock;
+    }
+    reactor->sockets = sock;
+    return sock;
+}
+
+void *reactor_get_extension_function(Socket handle, GUID guid) {
+    void *function = NULL;
+    DWORD bytes = 0;
+    if (WSAIoctl(handle, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid), &function, sizeof(function),
+                 &bytes, NULL, NULL) != 0) {
+        return NULL;
+    }
+    return function;
+}
+
+int reactor_post_accept(ReactorSocket *listener) {
+    listener->acceptHandle = socket_create(listener->family, SOCK_STREAM, IPPROTO_TCP);
+    if (listener->acceptHandle == INVALID_SOCKET_HANDLE) {
+        return WSAGetLastError();
+    }
+    memset(&listener->acceptOperation.overlapped, 0, sizeof(OVERLAPPED));
+    DWORD bytes = 0;
+    if (!listener->acceptEx(listener->handle, listener->acceptHandle, listener->acceptAddresses, 0,
+                            REACTOR_ACCEPT_ADDRESS_SIZE, REACTOR_ACCEPT_ADDRESS_SIZE, &bytes,
+                            &listener->acceptOperation.overlapped) && WSAGetLastError() != ERROR_IO_PENDING) {
+        int status = WSAGetLastError();
+        socket_close(listener->acceptHandle);
+        listener->acceptHandle = INVALID_SOCKET_HANDLE;
+        return status;
+    }
+    listener->pendingOperations++;
+    return 0;
+}
+
+ReactorSocket *reactor_listen(Reactor *reactor, const struct sockaddr *addr, int addr_length, int backlog,
+                              ReactorAcceptCallback callback, void *user_data) {
+    Socket handle = socket_create(addr->sa_family, SOCK_STREAM, IPPROTO_TCP);
+    if (handle == INVALID_SOCKET_HANDLE) {
+        return NULL;
+    }
+    if (socket_bind(handle, addr, addr_length) != 0 || socket_listen(handle, backlog) != 0) {
+        socket_close(handle);
+        return NULL;
+    }
+    GUID acceptExGuid = WSAID_ACCEPTEX;
+    LPFN_ACCEPTEX acceptEx = reactor_get_extension_function(handle, acceptExGuid);
+    ReactorSocket *sock = acceptEx != NULL ? reactor_add_socket(reactor, handle, REACTOR_SOCKET_LISTENER,
+                                                                addr->sa_family, user_data) : NULL;
+    if (sock == NULL) {
+        socket_close(handle);
+        return NULL;
+    }
+    sock->acceptCallback = callback;
+    sock->acceptEx = acceptEx;
+    if (reactor_post_accept(sock) != 0) {
+        reactor_close(sock);
+        return NULL;
+    }
+    return sock;
+}
+
+ReactorSocket *reactor_connect(Reactor *reactor, const struct sockaddr *addr, int addr_length,
+                               ReactorConnectCallback callback, void *user_data) {
+    Socket handle = socket_create(addr->sa_family, SOCK_STREAM, IPPROTO_TCP);
+    if (handle == INVALID_SOCKET_HANDLE) {
+        return NULL;
+    }
+    /* ConnectEx only works on a bound socket. */
+    struct sockaddr_storage local;
+    memset(&local, 0, sizeof(local));
+    local.ss_family = addr->sa_family;
+    GUID connectExGuid = WSAID_CONNECTEX;
+    LPFN_CONNECTEX connectEx = reactor_get_extension_function(handle, connectExGuid);
+    if (connectEx == NULL || socket_bind(handle, (struct sockaddr *) &local, addr_length) != 0) {
+        socket_close(handle);
+        return NULL;
+    }
+    ReactorSocket *sock = reactor_add_socket(reactor, handle, REACTOR_SOCKET_CONNECTING, addr->sa_family, user_data);
+    if (sock == NULL) {
+        socket_close(handle);
+        return NULL;
+    }
+    sock->connectCallback = callback;
+    if (!connectEx(handle, addr, addr_length, NULL, 0, NULL, &sock->connectOperation.overlapped) &&
+        WSAGetLastError() != ERROR_IO_PENDING) {
+        reactor_close(sock);
+        return NULL;
+    }
+    sock->pendingOperations++;
+    return sock;
+}
+
+int reactor_receive(ReactorSocket *sock, void *buffer, usize capacity, ReactorReceiveCallback callback) {
+    if (sock->closed || sock->kind != REACTOR_SOCKET_STREAM) {
+        return EINVAL;
+    }
+    if (sock->receiveCallback != NULL) {
+        return EBUSY;
+    }
+    WSABUF buffers;
+    buffers.buf = buffer;
+    buffers.len = capacity > REACTOR_MAX_TRANSFER ? REACTOR_MAX_TRANSFER : (ULONG) capacity;
+    DWORD flags = 0;
+    memset(&sock->receiveOperation.overlapped, 0, sizeof(OVERLAPPED));
+    if (WSARecv(sock->handle, &buffers, 1, NULL, &flags, &sock->receiveOperation.overlapped, NULL) != 0 &&
+        WSAGetLastError() != WSA_IO_PENDING) {
+        return WSAGetLastError();
+    }
+    sock->receiveCallback = callback;
+    sock->pendingOperations++;
+    return 0;
+}
+
+int reactor_post_send(ReactorSocket *sock) {
+    ReactorSend *request = sock->sendHead;
+    usize remaining = request->length - request->sent;
+    WSABUF buffers;
+    buffers.buf = (char *) request->data + request->sent;
+    buffers.len = remaining > REACTOR_MAX_TRANSFER ? REACTOR_MAX_TRANSFER : (ULONG) remaining;
+    memset(&sock->sendOperation.overlapped, 0, sizeof(OVERLAPPED));
+    if (WSASend(sock->handle, &buffers, 1, NULL, 0, &sock->sendOperation.overlapped, NULL) != 0 &&
+        WSAGetLastError() != WSA_IO_PENDING) {
+        return WSAGetLastError();
+    }
+    sock->pendingOperations++;
+    return 0;
+}
+
+int reactor_send(ReactorSocket *sock, const void *buffer, usize length, ReactorSendCallback callback) {
+    if (sock->closed || sock->kind != REACTOR_SOCKET_STREAM) {
+        return EINVAL;
+    }
+    ReactorSend *request = malloc(sizeof(ReactorSend));
+    if (request == NULL) {
+        return ENOMEM;
+    }
+    request->data = buffer;
+    request->length = length;
+    request->sent = 0;
+    request->callback = callback;
+    request->next = NULL;
+    if (sock->sendHead != NULL) {
+        sock->sendTail->next = request;
+        sock->sendTail = request;
+        sock->pendingSendBytes += length;
+        return 0;
+    }
+    sock->sendHead = request;
+    sock->sendTail = request;
+    int status = reactor_post_send(sock);
+    if (status != 0) {
+        sock->sendHead = NULL;
+        sock->sendTail = NULL;
+        free(request);
+        return status;
+    }
+    sock->pendingSendBytes += length;
+    return 0;
+}
+
+usize reactor_get_pending_send_bytes(ReactorSocket *sock) {
+    return sock->pendingSendBytes;
+}
+
+void reactor_socket_set_user_data(ReactorSocket *sock, void *user_data) {
+    sock->userData = user_data;
+}
+
+void *reactor_socket_get_user_data(ReactorSocket *sock) {
+    return sock->userData;
+}
+
+Socket reactor_socket_get_handle(ReactorSocket *sock) {
+    return sock->handle;
+}
+
+int reactor_complete_accept(ReactorSocket *listener, int status) {
+    Socket handle = listener->acceptHandle;
+    listener->acceptHandle = INVALID_SOCKET_HANDLE;
+    int count = 0;
+    if (status == 0) {
+        socket_set_option(handle, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT, &listener->handle, sizeof(Socket));
+        ReactorSocket *sock = reactor_add_socket(listener->reactor, handle, REACTOR_SOCKET_STREAM, listener->family,
+                                                 NULL);
+        if (sock != NULL) {
+            listener->acceptCallback(listener, sock, listener->userData);
+            count++;
+        } else {
+            socket_close(handle);
+        }
+    } else if (handle != INVALID_SOCKET_HANDLE) {
+        socket_close(handle);
+    }
+    if (!listener->closed) {
+        reactor_post_accept(listener);
+    }
+    return count;
+}
+
+/* A failed send fails everything queued behind it, since the stream can no longer be continued in order. */
+int reactor_complete_send(ReactorSocket *sock, int status, DWORD bytes) {
+    ReactorSend *request = sock->sendHead;
+    if (status == 0) {
+        request->sent += bytes;
+        sock->pendingSendBytes -= bytes;
+        if (request->sent < request->length && !sock->closed) {
+            status = reactor_post_send(sock);
+            if (status == 0) {
+                return 0;
+            }
+        }
+    }
+    int count = 0;
+    while (sock->sendHead != NULL) {
+        request = sock->sendHead;
+        sock->sendHead = request->next;
+        sock->pendingSendBytes -= request->length - request->sent;
+        ReactorSendCallback callback = request->callback;
+        free(request);
+        if (callback != NULL) {
+            callback(sock, status, sock->userData);
+        }
+        count++;
+        if (status == 0 && sock->sendHead != NULL && !sock->closed) {
+            status = reactor_post_send(sock);
+            if (status == 0) {
+                break;
+            }
+        } else if (status == 0) {
+            break;
+        }
+    }
+    if (sock->sendHead == NULL) {
+        sock->sendTail = NULL;
+    }
+    return count;
+}
+
+int reactor_complete(OVERLAPPED_ENTRY *entry) {
+    ReactorOperation *operation = (ReactorOperation *) entry->lpOverlapped;
+    ReactorSocket *sock = operation->sock;
+    DWORD bytes = entry->dwNumberOfBytesTransferred;
+    int status = 0;
+    if (sock->closed) {
+        status = ECANCELED;
+    } else {
+        DWORD flags = 0;
+        if (!WSAGetOverlappedResult(sock->handle, &operation->overlapped, &bytes, FALSE, &flags)) {
+            status = WSAGetLastError();
+        }
+    }
+    int count = 0;
+    switch (operation->type) {
+        case REACTOR_OPERATION_ACCEPT:
+            count = reactor_complete_accept(sock, status);
+            break;
+        case REACTOR_OPERATION_CONNECT:
+            if (!sock->closed) {
+                if (status == 0) {
+                    socket_set_option(sock->handle, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, NULL, 0);
+                }
+                sock->kind = REACTOR_SOCKET_STREAM;
+                sock->connectCallback(sock, status, sock->userData);
+                count = 1;
+            }
+            break;
+        case REACTOR_OPERATION_RECEIVE: {
+            ReactorReceiveCallback callback = sock->receiveCallback;
+            sock->receiveCallback = NULL;
+            callback(sock, status, status == 0 ? bytes : 0, sock->userData);
+            count = 1;
+            break;
+        }
+        case REACTOR_OPERATION_SEND:
+            count = reactor_complete_send(sock, status, bytes);
+            break;
+    }
+    sock->pendingOperations--;
+    reactor_release(sock);
+    return count;
+}
+
+int reactor_run_once(Reactor *reactor, i64 timeout_ms) {
+    i64 timeout = reactor_timer_heap_get_timeout(&reactor->timers, timeout_ms);
+    OVERLAPPED_ENTRY entries[REACTOR_EVENT_BATCH_SIZE];
+    ULONG entryCount = 0;
+    DWORD wait = timeout < 0 ? INFINITE : timeout >= INFINITE ? INFINITE - 1 : (DWORD) timeout;
+    if (!GetQueuedCompletionStatusEx(reactor->port, entries, REACTOR_EVENT_BATCH_SIZE, &entryCount, wait, FALSE)) {
+        entryCount = 0;
+    }
+    int count = 0;
+    for (ULONG i = 0; i < entryCount; i++) {
+        if (entries[i].lpOverlapped != NULL) {
+            count += reactor_complete(&entries[i]);
+        }
+    }
+    count += reactor_timer_heap_fire(&reactor->timers);
+    return count;
+}
+
+void reactor_wake(Reactor *reactor) {
+    PostQueuedCompletionStatus(reactor->port, 0, 0, NULL);
+}
+
+ReactorTimer *reactor_add_timer(Reactor *reactor, u64 delay_ms, u64 interval_ms, ReactorTimerCallback callback,
+                                void *user_data) {
+    return reactor_timer_heap_add(&reactor->timers, delay_ms, interval_ms, callback, user_data);
+}
+
+void reactor_cancel_timer(Reactor *reactor, ReactorTimer *timer) {
+    reactor_timer_heap_cancel(&reactor->timers, timer);
+}
+
+#endif
@@ -0,0 +1,170 @@
+#if !defined(_WIN32) && !defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "reactor_posix.h"
+
+#define REACTOR_POLL_INITIAL_CAPACITY 64
+
+void reactor_set_close_on_exec(int fd) {
+    int flags = fcntl(fd, F_GETFD, 0);
+    if (flags != -1) {
+        fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+    }
+}
+
+/*
+ * Stands in for the SOCK_CLOEXEC and SOCK_NONBLOCK flags and MSG_NOSIGNAL, which not every system has. Closes the
+ * handle when that fails, and passes an invalid handle through, so it can wrap the call that made the socket.
+ */
+Socket reactor_prepare_socket(Socket handle) {
+    if (handle == INVALID_SOCKET_HANDLE) {
+        return INVALID_SOCKET_HANDLE;
+    }
+    reactor_set_close_on_exec(handle);
+#ifdef SO_NOSIGPIPE
+    int enable = 1;
+    socket_set_option(handle, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+    if (socket_set_non_blocking(handle, true) != 0) {
+        int status = errno;
+        socket_close(handle);
+        errno = status;
+        return INVALID_SOCKET_HANDLE;
+    }
+    return handle;
+}
+
+Reactor *reactor_create() {
+    Reactor *reactor = calloc(1, sizeof(Reactor));
+    if (reactor == NULL) {
+        return NULL;
+    }
+    reactor->pollCapacity = REACTOR_POLL_INITIAL_CAPACITY;
+    reactor->pollFds = malloc(sizeof(struct pollfd) * reactor->pollCapacity);
+    reactor->pollSockets = malloc(sizeof(ReactorSocket *) * reactor->pollCapacity);
+    if (reactor->pollFds == NULL || reactor->pollSockets == NULL || pipe(reactor->wakeFds) != 0) {
+        free(reactor->pollFds);
+        free(reactor->pollSockets);
+        free(reactor);
+        return NULL;
+    }
+    for (int i = 0; i < 2; i++) {
+        reactor_set_close_on_exec(reactor->wakeFds[i]);
+        socket_set_non_blocking(reactor->wakeFds[i], true);
+    }
+    return reactor;
+}
+
+void reactor_destroy(Reactor *reactor) {
+    reactor_release_all(reactor);
+    close(reactor->wakeFds[0]);
+    close(reactor->wakeFds[1]);
+    free(reactor->pollFds);
+    free(reactor->pollSockets);
+    free(reactor);
+}
+
+/*
+ * Fallback for POSIX systems without epoll. Every reactor_run_once rebuilds the poll set from the sockets that have
+ * something to wait for, so a hung up socket without outstanding operations does not keep waking the loop, and a
+ * self-pipe stands in for the eventfd.
+ */
+void reactor_update_events(ReactorSocket *sock) {
+    if (sock->closed) {
+        return;
+    }
+    u32 events = 0;
+    if (sock->kind == REACTOR_SOCKET_LISTENER || sock->receiveCallback != NULL) {
+        events |= POLLIN;
+    }
+    if (sock->kind == REACTOR_SOCKET_CONNECTING || sock->sendHead != NULL) {
+        events |= POLLOUT;
+    }
+    sock->events = events;
+}
+
+/* The poll set is rebuilt before every wait, so there is nothing to drop. */
+void reactor_unregister_socket(ReactorSocket *sock) {
+    (void) sock;
+}
+
+Socket reactor_open_socket(int family) {
+    return reactor_prepare_socket(socket_create(family, SOCK_STREAM, IPPROTO_TCP));
+}
+
+Socket reactor_accept_socket(Socket listener) {
+    return reactor_prepare_socket(accept(listener, NULL, NULL));
+}
+
+/* Fills the poll set with the wake pipe followed by every socket that waits for something. Returns its size. */
+u32 reactor_build_poll_set(Reactor *reactor) {
+    u32 count = 1;
+    reactor->pollFds[0].fd = reactor->wakeFds[0];
+    reactor->pollFds[0].events = POLLIN;
+    reactor->pollFds[0].revents = 0;
+    reactor->pollSockets[0] = NULL;
+    for (ReactorSocket *sock = reactor->sockets; sock != NULL; sock = sock->next) {
+        if (sock->events == 0) {
+            continue;
+        }
+        if (count == reactor->pollCapacity) {
+            u32 capacity = reactor->pollCapacity * 2;
+            struct pollfd *pollFds = realloc(reactor->pollFds, sizeof(struct pollfd) * capacity);
+            if (pollFds != NULL) {
+                reactor->pollFds = pollFds;
+            }
+            ReactorSocket **pollSockets = realloc(reactor->pollSockets, sizeof(ReactorSocket *) * capacity);
+            if (pollSockets != NULL) {
+                reactor->pollSockets = pollSockets;
+            }
+            if (pollFds == NULL || pollSockets == NULL) {
+                /* The sockets left out wait for the next round. */
+                break;
+            }
+            reactor->pollCapacity = capacity;
+        }
+        reactor->pollFds[count].fd = sock->handle;
+        reactor->pollFds[count].events = (short) sock->events;
+        reactor->pollFds[count].revents = 0;
+        reactor->pollSockets[count] = sock;
+        count++;
+    }
+    return count;
+}
+
+int reactor_run_once(Reactor *reactor, i64 timeout_ms) {
+    i64 timeout = reactor->closedSockets != NULL ? 0 : reactor_timer_heap_get_timeout(&reactor->timers, timeout_ms);
+    u32 pollCount = reactor_build_poll_set(reactor);
+    int eventCount = poll(reactor->pollFds, pollCount, timeout > INT_MAX ? INT_MAX : (int) timeout);
+    int count = 0;
+    if (eventCount > 0 && reactor->pollFds[0].revents != 0) {
+        u8 drain[64];
+        while (read(reactor->wakeFds[0], drain, sizeof(drain)) > 0) {
+        }
+    }
+    for (u32 i = 1; i < pollCount && eventCount > 0; i++) {
+        ReactorSocket *sock = reactor->pollSockets[i];
+        if (reactor->pollFds[i].revents != 0 && !sock->closed) {
+            short events = reactor->pollFds[i].revents;
+            count += reactor_handle_events(sock, (events & POLLIN) != 0, (events & POLLOUT) != 0,
+                                           (events & (POLLERR | POLLHUP | POLLNVAL)) != 0);
+        }
+    }
+    count += reactor_timer_heap_fire(&reactor->timers);
+    count += reactor_release_closed_sockets(reactor);
+    return count;
+}
+
+void reactor_wake(Reactor *reactor) {
+    u8 value = 1;
+    ssize_t result = write(reactor->wakeFds[1], &value, sizeof(value));
+    (void) result;
+}
+
+#endif
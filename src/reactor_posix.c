@@ -0,0 +1,330 @@
+#ifndef _WIN32
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include "reactor_posix.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define REACTOR_SEND_BATCH_SIZE 16
+
+void reactor_free_socket(ReactorSocket *sock) {
+    while (sock->sendHead != NULL) {
+        ReactorSend *request = sock->sendHead;
+        sock->sendHead = request->next;
+        free(request);
+    }
+    free(sock);
+}
+
+void reactor_release_all(Reactor *reactor) {
+    while (reactor->sockets != NULL) {
+        ReactorSocket *sock = reactor->sockets;
+        reactor->sockets = sock->next;
+        socket_close(sock->handle);
+        reactor_free_socket(sock);
+    }
+    while (reactor->closedSockets != NULL) {
+        ReactorSocket *sock = reactor->closedSockets;
+        reactor->closedSockets = sock->next;
+        reactor_free_socket(sock);
+    }
+    reactor_timer_heap_destroy(&reactor->timers);
+}
+
+ReactorSocket *reactor_add_socket(Reactor *reactor, Socket handle, ReactorSocketKind kind, void *user_data) {
+    ReactorSocket *sock = calloc(1, sizeof(ReactorSocket));
+    if (sock == NULL) {
+        return NULL;
+    }
+    sock->reactor = reactor;
+    sock->handle = handle;
+    sock->kind = kind;
+    sock->userData = user_data;
+    sock->next = reactor->sockets;
+    if (reactor->sockets != NULL) {
+        reactor->sockets->previous = sock;
+    }
+    reactor->sockets = sock;
+    return sock;
+}
+
+ReactorSocket *reactor_listen(Reactor *reactor, const struct sockaddr *addr, int addr_length, int backlog,
+                              ReactorAcceptCallback callback, void *user_data) {
+    Socket handle = reactor_open_socket(addr->sa_family);
+    if (handle == INVALID_SOCKET_HANDLE) {
+        return NULL;
+    }
+    int reuse = 1;
+    socket_set_option(handle, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (socket_bind(handle, addr, addr_length) != 0 || socket_listen(handle, backlog) != 0) {
+        int status = errno;
+        socket_close(handle);
+        errno = status;
+        return NULL;
+    }
+    ReactorSocket *sock = reactor_add_socket(reactor, handle, REACTOR_SOCKET_LISTENER, user_data);
+    if (sock == NULL) {
+        socket_close(handle);
+        return NULL;
+    }
+    sock->acceptCallback = callback;
+    reactor_update_events(sock);
+    return sock;
+}
+
+ReactorSocket *reactor_connect(Reactor *reactor, const struct sockaddr *addr, int addr_length,
+                               ReactorConnectCallback callback, void *user_data) {
+    Socket handle = reactor_open_socket(addr->sa_family);
+    if (handle == INVALID_SOCKET_HANDLE) {
+        return NULL;
+    }
+    if (socket_connect(handle, addr, addr_length) != 0 && errno != EINPROGRESS) {
+        int status = errno;
+        socket_close(handle);
+        errno = status;
+        return NULL;
+    }
+    /* Even an immediately established connection is reported from the loop, once the socket shows up writable. */
+    ReactorSocket *sock = reactor_add_socket(reactor, handle, REACTOR_SOCKET_CONNECTING, user_data);
+    if (sock == NULL) {
+        socket_close(handle);
+        return NULL;
+    }
+    sock->connectCallback = callback;
+    reactor_update_events(sock);
+    return sock;
+}
+
+int reactor_receive(ReactorSocket *sock, void *buffer, usize capacity, ReactorReceiveCallback callback) {
+    if (sock->closed || sock->kind != REACTOR_SOCKET_STREAM) {
+        return EINVAL;
+    }
+    if (sock->receiveCallback != NULL) {
+        return EBUSY;
+    }
+    sock->receiveBuffer = buffer;
+    sock->receiveCapacity = capacity;
+    sock->receiveCallback = callback;
+    reactor_update_events(sock);
+    return 0;
+}
+
+/*
+ * Writes as much of the queue as the socket takes without blocking, gathering up to REACTOR_SEND_BATCH_SIZE queued
+ * sends into each sendmsg. Returns 0, EAGAIN or the send error.
+ */
+int reactor_write_queue(ReactorSocket *sock) {
+    SocketBuffer buffers[REACTOR_SEND_BATCH_SIZE];
+    ReactorSend *first = sock->sendHead;
+    while (true) {
+        while (first != NULL && first->sent == first->length) {
+            first = first->next;
+        }
+        if (first == NULL) {
+            break;
+        }
+        u32 count = 0;
+        for (ReactorSend *request = first; request != NULL && count < REACTOR_SEND_BATCH_SIZE;
+             request = request->next) {
+            buffers[count++] = socket_buffer(request->data + request->sent, request->length - request->sent);
+        }
+        isize written = socket_send_vector(sock->handle, buffers, count, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? EAGAIN : errno;
+        }
+        sock->pendingSendBytes -= (usize) written;
+        while (first != NULL && (usize) written >= first->length - first->sent) {
+            written -= (isize) (first->length - first->sent);
+            first->sent = first->length;
+            first = first->next;
+        }
+        if (first != NULL) {
+            first->sent += (usize) written;
+        }
+    }
+    return 0;
+}
+
+int reactor_send(ReactorSocket *sock, const void *buffer, usize length, ReactorSendCallback callback) {
+    if (sock->closed || sock->kind != REACTOR_SOCKET_STREAM) {
+        return EINVAL;
+    }
+    ReactorSend *request = malloc(sizeof(ReactorSend));
+    if (request == NULL) {
+        return ENOMEM;
+    }
+    request->data = buffer;
+    request->length = length;
+    request->sent = 0;
+    request->callback = callback;
+    request->next = NULL;
+    bool idle = sock->sendHead == NULL;
+    if (idle) {
+        sock->sendHead = request;
+    } else {
+        sock->sendTail->next = request;
+    }
+    sock->sendTail = request;
+    sock->pendingSendBytes += length;
+    /* Write right away when nothing is queued ahead; the callback still runs from the loop. */
+    if (idle) {
+        reactor_write_queue(sock);
+    }
+    reactor_update_events(sock);
+    return 0;
+}
+
+usize reactor_get_pending_send_bytes(ReactorSocket *sock) {
+    return sock->pendingSendBytes;
+}
+
+void reactor_socket_set_user_data(ReactorSocket *sock, void *user_data) {
+    sock->userData = user_data;
+}
+
+void *reactor_socket_get_user_data(ReactorSocket *sock) {
+    return sock->userData;
+}
+
+Socket reactor_socket_get_handle(ReactorSocket *sock) {
+    return sock->handle;
+}
+
+void reactor_close(ReactorSocket *sock) {
+    if (sock->closed) {
+        return;
+    }
+    Reactor *reactor = sock->reactor;
+    reactor_unregister_socket(sock);
+    socket_close(sock->handle);
+    sock->closed = true;
+    if (sock->previous != NULL) {
+        sock->previous->next = sock->next;
+    } else {
+        reactor->sockets = sock->next;
+    }
+    if (sock->next != NULL) {
+        sock->next->previous = sock->previous;
+    }
+    sock->previous = NULL;
+    sock->next = reactor->closedSockets;
+    reactor->closedSockets = sock;
+}
+
+int reactor_accept_all(ReactorSocket *listener) {
+    int count = 0;
+    while (!listener->closed) {
+        Socket handle = reactor_accept_socket(listener->handle);
+        if (handle == INVALID_SOCKET_HANDLE) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            /* EAGAIN, or EMFILE and friends; either way the listener stays armed and retries on the next event. */
+            break;
+        }
+        ReactorSocket *sock = reactor_add_socket(listener->reactor, handle, REACTOR_SOCKET_STREAM, NULL);
+        if (sock == NULL) {
+            socket_close(handle);
+            break;
+        }
+        listener->acceptCallback(listener, sock, listener->userData);
+        count++;
+    }
+    return count;
+}
+
+int reactor_complete_sends(ReactorSocket *sock, int status) {
+    int count = 0;
+    while (sock->sendHead != NULL && !sock->closed) {
+        ReactorSend *request = sock->sendHead;
+        if (status == 0 && request->sent < request->length) {
+            break;
+        }
+        sock->sendHead = request->next;
+        sock->pendingSendBytes -= request->length - request->sent;
+        ReactorSendCallback callback = request->callback;
+        free(request);
+        if (callback != NULL) {
+            callback(sock, status, sock->userData);
+        }
+        count++;
+    }
+    return count;
+}
+
+int reactor_handle_events(ReactorSocket *sock, bool readable, bool writable, bool failed) {
+    int count = 0;
+    if (sock->kind == REACTOR_SOCKET_LISTENER) {
+        return reactor_accept_all(sock);
+    }
+    if (sock->kind == REACTOR_SOCKET_CONNECTING) {
+        int status = 0;
+        socklen_t length = sizeof(status);
+        if (getsockopt(sock->handle, SOL_SOCKET, SO_ERROR, &status, &length) != 0) {
+            status = errno;
+        }
+        sock->kind = REACTOR_SOCKET_STREAM;
+        reactor_update_events(sock);
+        sock->connectCallback(sock, status, sock->userData);
+        return 1;
+    }
+    if (sock->sendHead != NULL && (writable || failed)) {
+        int status = reactor_write_queue(sock);
+        count += reactor_complete_sends(sock, status == EAGAIN ? 0 : status);
+    }
+    if (!sock->closed && sock->receiveCallback != NULL && (readable || failed)) {
+        ssize_t received;
+        do {
+            received = recv(sock->handle, sock->receiveBuffer, sock->receiveCapacity, 0);
+        } while (received < 0 && errno == EINTR);
+        if (received >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            ReactorReceiveCallback callback = sock->receiveCallback;
+            sock->receiveCallback = NULL;
+            callback(sock, received < 0 ? errno : 0, received > 0 ? (usize) received : 0, sock->userData);
+            count++;
+        }
+    }
+    reactor_update_events(sock);
+    return count;
+}
+
+int reactor_release_closed_sockets(Reactor *reactor) {
+    int count = 0;
+    while (reactor->closedSockets != NULL) {
+        ReactorSocket *sock = reactor->closedSockets;
+        reactor->closedSockets = sock->next;
+        if (sock->receiveCallback != NULL) {
+            sock->receiveCallback(sock, ECANCELED, 0, sock->userData);
+            count++;
+        }
+        while (sock->sendHead != NULL) {
+            ReactorSend *request = sock->sendHead;
+            sock->sendHead = request->next;
+            if (request->callback != NULL) {
+                request->callback(sock, ECANCELED, sock->userData);
+                count++;
+            }
+            free(request);
+        }
+        free(sock);
+    }
+    return count;
+}
+
+ReactorTimer *reactor_add_timer(Reactor *reactor, u64 delay_ms, u64 interval_ms, ReactorTimerCallback callback,
+                                void *user_data) {
+    return reactor_timer_heap_add(&reactor->timers, delay_ms, interval_ms, callback, user_data);
+}
+
+void reactor_cancel_timer(Reactor *reactor, ReactorTimer *timer) {
+    reactor_timer_heap_cancel(&reactor->timers, timer);
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef CGFS_REACTOR_POSIX_H
+#define CGFS_REACTOR_POSIX_H
+
+#include "reactor_timer.h"
+
+typedef enum reactor_socket_kind_e {
+    REACTOR_SOCKET_LISTENER,
+    REACTOR_SOCKET_CONNECTING,
+    REACTOR_SOCKET_STREAM
+} ReactorSocketKind;
+
+typedef struct reactor_send_s {
+    const u8 *data;
+    usize length;
+    usize sent;
+    ReactorSendCallback callback;
+    struct reactor_send_s *next;
+} ReactorSend;
+
+struct reactor_socket_s {
+    Reactor *reactor;
+    Socket handle;
+    ReactorSocketKind kind;
+    void *userData;
+    ReactorAcceptCallback acceptCallback;
+    ReactorConnectCallback connectCallback;
+    u8 *receiveBuffer;
+    usize receiveCapacity;
+    ReactorReceiveCallback receiveCallback;
+    ReactorSend *sendHead;
+    ReactorSend *sendTail;
+    usize pendingSendBytes;
+    /* What the socket waits for, in the backend's event flags. */
+    u32 events;
+#ifdef __linux__
+    bool registered;
+#endif
+    bool closed;
+    struct reactor_socket_s *previous;
+    struct reactor_socket_s *next;
+};
+
+/*
+ * The readiness based backends, epoll on Linux and poll elsewhere, share everything but how sockets are registered,
+ * waited on and woken. Closed sockets are parked until the end of reactor_run_once, since events of the current wait
+ * may still point at them.
+ */
+struct reactor_s {
+#ifdef __linux__
+    int epollFd;
+    int wakeFd;
+#else
+    int wakeFds[2];
+    struct pollfd *pollFds;
+    ReactorSocket **pollSockets;
+    u32 pollCapacity;
+#endif
+    ReactorTimerHeap timers;
+    ReactorSocket *sockets;
+    ReactorSocket *closedSockets;
+};
+
+/* Provided by the backend: brings the registration in line with what the socket currently waits for. */
+void reactor_update_events(ReactorSocket *sock);
+
+/* Provided by the backend: drops the socket from the wait set before its handle is closed. */
+void reactor_unregister_socket(ReactorSocket *sock);
+
+/* Provided by the backend: a non-blocking, close-on-exec stream socket that never raises SIGPIPE. */
+Socket reactor_open_socket(int family);
+
+/* Provided by the backend: accepts one connection set up like reactor_open_socket, or fails with errno set. */
+Socket reactor_accept_socket(Socket listener);
+
+int reactor_handle_events(ReactorSocket *sock, bool readable, bool writable, bool failed);
+
+/* Runs the cancellation callbacks of the sockets closed since the last call and frees them. */
+int reactor_release_closed_sockets(Reactor *reactor);
+
+/* Frees every socket and timer without running callbacks, leaving the backend's own handles to the caller. */
+void reactor_release_all(Reactor *reactor);
+
+#endif //CGFS_REACTOR_POSIX_H
@@ -0,0 +1,143 @@
+#include "reactor_timer.h"
+#include "timer.h"
+#include <stdlib.h>
+
+#define REACTOR_TIMER_HEAP_INITIAL_CAPACITY 16
+
+void reactor_timer_heap_swap(ReactorTimerHeap *heap, u32 a, u32 b) {
+    ReactorTimer *timer = heap->timers[a];
+    heap->timers[a] = heap->timers[b];
+    heap->timers[b] = timer;
+    heap->timers[a]->heapIndex = a;
+    heap->timers[b]->heapIndex = b;
+}
+
+void reactor_timer_heap_sift_up(ReactorTimerHeap *heap, u32 index) {
+    while (index > 0) {
+        u32 parent = (index - 1) / 2;
+        if (heap->timers[parent]->deadline <= heap->timers[index]->deadline) {
+            break;
+        }
+        reactor_timer_heap_swap(heap, parent, index);
+        index = parent;
+    }
+}
+
+void reactor_timer_heap_sift_down(ReactorTimerHeap *heap, u32 index) {
+    while (true) {
+        u32 smallest = index;
+        u32 left = index * 2 + 1;
+        u32 right = left + 1;
+        if (left < heap->count && heap->timers[left]->deadline < heap->timers[smallest]->deadline) {
+            smallest = left;
+        }
+        if (right < heap->count && heap->timers[right]->deadline < heap->timers[smallest]->deadline) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        reactor_timer_heap_swap(heap, smallest, index);
+        index = smallest;
+    }
+}
+
+bool reactor_timer_heap_push(ReactorTimerHeap *heap, ReactorTimer *timer) {
+    if (heap->count == heap->capacity) {
+        u32 capacity = heap->capacity > 0 ? heap->capacity * 2 : REACTOR_TIMER_HEAP_INITIAL_CAPACITY;
+        ReactorTimer **timers = realloc(heap->timers, sizeof(ReactorTimer *) * capacity);
+        if (timers == NULL) {
+            return false;
+        }
+        heap->timers = timers;
+        heap->capacity = capacity;
+    }
+    timer->heapIndex = heap->count;
+    heap->timers[heap->count++] = timer;
+    reactor_timer_heap_sift_up(heap, timer->heapIndex);
+    return true;
+}
+
+void reactor_timer_heap_remove(ReactorTimerHeap *heap, ReactorTimer *timer) {
+    u32 index = timer->heapIndex;
+    heap->count--;
+    if (index != heap->count) {
+        reactor_timer_heap_swap(heap, index, heap->count);
+        reactor_timer_heap_sift_down(heap, index);
+        reactor_timer_heap_sift_up(heap, index);
+    }
+}
+
+ReactorTimer *reactor_timer_heap_add(ReactorTimerHeap *heap, u64 delay_ms, u64 interval_ms,
+                                     ReactorTimerCallback callback, void *user_data) {
+    ReactorTimer *timer = malloc(sizeof(ReactorTimer));
+    if (timer == NULL) {
+        return NULL;
+    }
+    timer->deadline = timer_get_time_ns() + delay_ms * 1000000ull;
+    timer->interval = interval_ms * 1000000ull;
+    timer->callback = callback;
+    timer->userData = user_data;
+    timer->cancelled = false;
+    if (!reactor_timer_heap_push(heap, timer)) {
+        free(timer);
+        return NULL;
+    }
+    return timer;
+}
+
+/* A timer cancelled from its own callback is only flagged; reactor_timer_heap_fire frees it afterwards. */
+void reactor_timer_heap_cancel(ReactorTimerHeap *heap, ReactorTimer *timer) {
+    if (timer == heap->firing) {
+        timer->cancelled = true;
+        return;
+    }
+    reactor_timer_heap_remove(heap, timer);
+    free(timer);
+}
+
+i64 reactor_timer_heap_get_timeout(ReactorTimerHeap *heap, i64 timeout_ms) {
+    if (heap->count == 0) {
+        return timeout_ms;
+    }
+    u64 now = timer_get_time_ns();
+    u64 deadline = heap->timers[0]->deadline;
+    i64 until = deadline > now ? (i64) ((deadline - now + 999999) / 1000000) : 0;
+    return timeout_ms < 0 || until < timeout_ms ? until : timeout_ms;
+}
+
+int reactor_timer_heap_fire(ReactorTimerHeap *heap) {
+    int fired = 0;
+    u64 now = timer_get_time_ns();
+    while (heap->count > 0 && heap->timers[0]->deadline <= now) {
+        ReactorTimer *timer = heap->timers[0];
+        reactor_timer_heap_remove(heap, timer);
+        heap->firing = timer;
+        timer->callback(timer, timer->userData);
+        heap->firing = NULL;
+        fired++;
+        if (timer->interval == 0 || timer->cancelled) {
+            free(timer);
+            continue;
+        }
+        /* Rescheduled from the previous deadline so periodic timers do not drift, but never into the past. */
+        timer->deadline += timer->interval;
+        if (timer->deadline <= now) {
+            timer->deadline = now + timer->interval;
+        }
+        if (!reactor_timer_heap_push(heap, timer)) {
+            free(timer);
+        }
+    }
+    return fired;
+}
+
+void reactor_timer_heap_destroy(ReactorTimerHeap *heap) {
+    for (u32 i = 0; i < heap->count; i++) {
+        free(heap->timers[i]);
+    }
+    free(heap->timers);
+    heap->timers = NULL;
+    heap->count = 0;
+    heap->capacity = 0;
+}
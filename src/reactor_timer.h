@@ -0,0 +1,35 @@
+#ifndef CGFS_REACTOR_TIMER_H
+#define CGFS_REACTOR_TIMER_H
+
+#include "reactor.h"
+
+struct reactor_timer_s {
+    u64 deadline;
+    u64 interval;
+    ReactorTimerCallback callback;
+    void *userData;
+    u32 heapIndex;
+    bool cancelled;
+};
+
+/* Binary min-heap on the deadline, shared by the reactor backends. */
+typedef struct reactor_timer_heap_s {
+    ReactorTimer **timers;
+    u32 count;
+    u32 capacity;
+    ReactorTimer *firing;
+} ReactorTimerHeap;
+
+ReactorTimer *reactor_timer_heap_add(ReactorTimerHeap *heap, u64 delay_ms, u64 interval_ms,
+                                     ReactorTimerCallback callback, void *user_data);
+
+void reactor_timer_heap_cancel(ReactorTimerHeap *heap, ReactorTimer *timer);
+
+/* Shortens timeout_ms so the wait ends at the next deadline. */
+i64 reactor_timer_heap_get_timeout(ReactorTimerHeap *heap, i64 timeout_ms);
+
+int reactor_timer_heap_fire(ReactorTimerHeap *heap);
+
+void reactor_timer_heap_destroy(ReactorTimerHeap *heap);
+
+#endif //CGFS_REACTOR_TIMER_H
@@ -0,0 +1,590 @@
+#include "render_cluster.h"
+#include "raytracer.h"
+#include "reactor.h"
+#include "thread.h"
+#include "timer.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RENDER_CLUSTER_BACKLOG 16
+#define RENDER_CLUSTER_QUEUE_DEPTH 4
+#define RENDER_CLUSTER_SEND_SLOTS 32
+#define RENDER_CLUSTER_WORKER_QUEUE_CAPACITY 64
+#define RENDER_CLUSTER_TILE_BYTES (RENDER_CLUSTER_TILE_SIZE * RENDER_CLUSTER_TILE_SIZE * 4)
+
+typedef enum render_cluster_message_type_e {
+    RENDER_CLUSTER_MESSAGE_TILE = 1,
+    RENDER_CLUSTER_MESSAGE_CANCEL,
+    RENDER_CLUSTER_MESSAGE_RESULT
+} RenderClusterMessageType;
+
+typedef struct render_cluster_message_header_s {
+    u32 type;
+    u32 length;
+} RenderClusterMessageHeader;
+
+/* Payload of every message; a result is followed by the tile's pixels. */
+typedef struct render_cluster_tile_message_s {
+    u32 frameId;
+    u32 width;
+    u32 height;
+    u32 tile;
+} RenderClusterTileMessage;
+
+#define RENDER_CLUSTER_CONTROL_MESSAGE_SIZE (sizeof(RenderClusterMessageHeader) + sizeof(RenderClusterTileMessage))
+#define RENDER_CLUSTER_MAX_MESSAGE_SIZE (RENDER_CLUSTER_CONTROL_MESSAGE_SIZE + RENDER_CLUSTER_TILE_BYTES)
+
+/* Outgoing messages complete in order, so their buffers form a ring that each send callback pops. */
+typedef struct render_cluster_connection_s {
+    RenderClusterCoordinator *coordinator;
+    ReactorSocket *sock;
+    u32 assigned[RENDER_CLUSTER_QUEUE_DEPTH];
+    u32 assignedCount;
+    u8 sendSlots[RENDER_CLUSTER_SEND_SLOTS][RENDER_CLUSTER_CONTROL_MESSAGE_SIZE];
+    u32 sendHead;
+    u32 sendCount;
+    u8 receiveBuffer[RENDER_CLUSTER_MAX_MESSAGE_SIZE * 2];
+    usize received;
+    u32 operations;
+    bool closed;
+    struct render_cluster_connection_s *previous;
+    struct render_cluster_connection_s *next;
+} RenderClusterConnection;
+
+struct render_cluster_coordinator_s {
+    Reactor *reactor;
+    ReactorSocket *listener;
+    RenderClusterConnection *connections;
+    u32 connectionCount;
+    bool rendering;
+    u32 frameId;
+    u32 width;
+    u32 height;
+    u8 *pixels;
+    u32 tileCount;
+    u32 doneCount;
+    bool *tileDone;
+    u8 *tileHolders;
+    u64 *tileAssignTimes;
+    u32 *pendingTiles;
+    u32 pendingCount;
+    u32 tileCapacity;
+    u64 lastProgress;
+    RenderClusterStats stats;
+};
+
+/* Written to stay in range for any 32-bit extent, since workers feed it dimensions straight off the network. */
+static inline u32 render_cluster_get_tile_count(u32 extent) {
+    return extent / RENDER_CLUSTER_TILE_SIZE + (extent % RENDER_CLUSTER_TILE_SIZE != 0);
+}
+
+static inline void render_cluster_get_tile_rect(u32 width, u32 height, u32 tile, u32 *x, u32 *y, u32 *tile_width,
+                                                u32 *tile_height) {
+    u32 tileCountX = render_cluster_get_tile_count(width);
+    *x = tile % tileCountX * RENDER_CLUSTER_TILE_SIZE;
+    *y = tile / tileCountX * RENDER_CLUSTER_TILE_SIZE;
+    *tile_width = width - *x < RENDER_CLUSTER_TILE_SIZE ? width - *x : RENDER_CLUSTER_TILE_SIZE;
+    *tile_height = height - *y < RENDER_CLUSTER_TILE_SIZE ? height - *y : RENDER_CLUSTER_TILE_SIZE;
+}
+
+bool render_cluster_connection_remove_tile(RenderClusterConnection *connection, u32 tile) {
+    for (u32 i = 0; i < connection->assignedCount; i++) {
+        if (connection->assigned[i] == tile) {
+            memmove(&connection->assigned[i], &connection->assigned[i + 1],
+                    (connection->assignedCount - i - 1) * sizeof(u32));
+            connection->assignedCount--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void render_cluster_connection_close(RenderClusterConnection *connection) {
+    if (connection->closed) {
+        return;
+    }
+    RenderClusterCoordinator *coordinator = connection->coordinator;
+    for (u32 i = 0; i < connection->assignedCount; i++) {
+        u32 tile = connection->assigned[i];
+        if (--coordinator->tileHolders[tile] == 0 && !coordinator->tileDone[tile]) {
+            coordinator->pendingTiles[coordinator->pendingCount++] = tile;
+        }
+    }
+    connection->assignedCount = 0;
+    connection->closed = true;
+    coordinator->connectionCount--;
+    reactor_close(connection->sock);
+}
+
+void render_cluster_connection_release(RenderClusterConnection *connection) {
+    if (!connection->closed || connection->operations > 0) {
+        return;
+    }
+    RenderClusterCoordinator *coordinator = connection->coordinator;
+    if (connection->previous != NULL) {
+        connection->previous->next = connection->next;
+    } else {
+        coordinator->connections = connection->next;
+    }
+    if (connection->next != NULL) {
+        connection->next->previous = connection->previous;
+    }
+    free(connection);
+}
+
+void render_cluster_send_callback(ReactorSocket *sock, int status, void *user_data) {
+    RenderClusterConnection *connection = user_data;
+    connection->sendHead = (connection->sendHead + 1) % RENDER_CLUSTER_SEND_SLOTS;
+    connection->sendCount--;
+    connection->operations--;
+    if (status != 0) {
+        render_cluster_connection_close(connection);
+    }
+    render_cluster_connection_release(connection);
+}
+
+void render_cluster_connection_send(RenderClusterConnection *connection, RenderClusterMessageType type, u32 tile) {
+    if (connection->closed) {
+        return;
+    }
+    if (connection->sendCount == RENDER_CLUSTER_SEND_SLOTS) {
+        render_cluster_connection_close(connection);
+        return;
+    }
+    RenderClusterCoordinator *coordinator = connection->coordinator;
+    u8 *slot = connection->sendSlots[(connection->sendHead + connection->sendCount) % RENDER_CLUSTER_SEND_SLOTS];
+    RenderClusterMessageHeader header;
+    header.type = type;
+    header.length = sizeof(RenderClusterTileMessage);
+    RenderClusterTileMessage message;
+    message.frameId = coordinator->frameId;
+    message.width = coordinator->width;
+    message.height = coordinator->height;
+    message.tile = tile;
+    memcpy(slot, &header, sizeof(RenderClusterMessageHeader));
+    memcpy(slot + sizeof(RenderClusterMessageHeader), &message, sizeof(RenderClusterTileMessage));
+    if (reactor_send(connection->sock, slot, RENDER_CLUSTER_CONTROL_MESSAGE_SIZE, render_cluster_send_callback) != 0) {
+        render_cluster_connection_close(connection);
+        return;
+    }
+    connection->sendCount++;
+    connection->operations++;
+}
+
+void render_cluster_connection_assign(RenderClusterConnection *connection, u32 tile) {
+    RenderClusterCoordinator *coordinator = connection->coordinator;
+    connection->assigned[connection->assignedCount++] = tile;
+    coordinator->tileHolders[tile]++;
+    coordinator->tileAssignTimes[tile] = timer_get_time_ns();
+    render_cluster_connection_send(connection, RENDER_CLUSTER_MESSAGE_TILE, tile);
+}
+
+/* Idle workers steal queued tiles from the busiest worker first, and only duplicate running tiles when none are. */
+bool render_cluster_coordinator_rebalance(RenderClusterCoordinator *coordinator, RenderClusterConnection *idle) {
+    RenderClusterConnection *victim = NULL;
+    for (RenderClusterConnection *connection = coordinator->connections; connection != NULL;
+         connection = connection->next) {
+        if (connection != idle && !connection->closed &&
+            (victim == NULL || connection->assignedCount > victim->assignedCount)) {
+            victim = connection;
+        }
+    }
+    if (victim != NULL && victim->assignedCount >= 2) {
+        u32 tile = victim->assigned[--victim->assignedCount];
+        coordinator->tileHolders[tile]--;
+        render_cluster_connection_send(victim, RENDER_CLUSTER_MESSAGE_CANCEL, tile);
+        render_cluster_connection_assign(idle, tile);
+        coordinator->stats.stolenTiles++;
+        return true;
+    }
+    u32 oldestTile = 0;
+    u64 oldestTime = 0;
+    bool found = false;
+    for (RenderClusterConnection *connection = coordinator->connections; connection != NULL;
+         connection = connection->next) {
+        if (connection == idle || connection->closed || connection->assignedCount == 0) {
+            continue;
+        }
+        u32 tile = connection->assigned[0];
+        if (coordinator->tileHolders[tile] == 1 && (!found || coordinator->tileAssignTimes[tile] < oldestTime)) {
+            oldestTile = tile;
+            oldestTime = coordinator->tileAssignTimes[tile];
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    render_cluster_connection_assign(idle, oldestTile);
+    coordinator->stats.duplicatedTiles++;
+    return true;
+}
+
+void render_cluster_coordinator_dispatch(RenderClusterCoordinator *coordinator) {
+    if (!coordinator->rendering) {
+        return;
+    }
+    for (RenderClusterConnection *connection = coordinator->connections; connection != NULL;
+         connection = connection->next) {
+        while (!connection->closed && connection->assignedCount < RENDER_CLUSTER_QUEUE_DEPTH &&
+               coordinator->pendingCount > 0) {
+            render_cluster_connection_assign(connection, coordinator->pendingTiles[--coordinator->pendingCount]);
+        }
+    }
+    if (coordinator->pendingCount > 0) {
+        return;
+    }
+    for (RenderClusterConnection *connection = coordinator->connections; connection != NULL;
+         connection = connection->next) {
+        if (!connection->closed && connection->assignedCount == 0 &&
+            !render_cluster_coordinator_rebalance(coordinator, connection)) {
+            break;
+        }
+    }
+}
+
+void render_cluster_coordinator_accept_result(RenderClusterCoordinator *coordinator,
+                                              RenderClusterConnection *connection,
+                                              const RenderClusterTileMessage *message, const u8 *pixels,
+                                              usize length) {
+    u32 tile = message->tile;
+    if (!coordinator->rendering || message->frameId != coordinator->frameId || tile >= coordinator->tileCount) {
+        return;
+    }
+    u32 x, y, tileWidth, tileHeight;
+    render_cluster_get_tile_rect(coordinator->width, coordinator->height, tile, &x, &y, &tileWidth, &tileHeight);
+    usize rowBytes = (usize) tileWidth * 4;
+    /* Checked while the tile is still assigned, so closing the connection puts it back in the queue. */
+    if (length != rowBytes * tileHeight) {
+        render_cluster_connection_close(connection);
+        return;
+    }
+    if (render_cluster_connection_remove_tile(connection, tile)) {
+        coordinator->tileHolders[tile]--;
+    }
+    if (coordinator->tileDone[tile]) {
+        coordinator->stats.wastedTiles++;
+        return;
+    }
+    for (u32 row = 0; row < tileHeight; row++) {
+        memcpy(coordinator->pixels + ((usize) (y + row) * coordinator->width + x) * 4, pixels + row * rowBytes,
+               rowBytes);
+    }
+    coordinator->tileDone[tile] = true;
+    coordinator->doneCount++;
+    coordinator->lastProgress = timer_get_time_ns();
+    /* Whoever else holds a copy can drop it, or at least skip it if it has not started yet. */
+    for (RenderClusterConnection *other = coordinator->connections; other != NULL; other = other->next) {
+        if (other != connection && !other->closed && render_cluster_connection_remove_tile(other, tile)) {
+            coordinator->tileHolders[tile]--;
+            render_cluster_connection_send(other, RENDER_CLUSTER_MESSAGE_CANCEL, tile);
+        }
+    }
+}
+
+void render_cluster_receive_callback(ReactorSocket *sock, int status, usize length, void *user_data) {
+    RenderClusterConnection *connection = user_data;
+    RenderClusterCoordinator *coordinator = connection->coordinator;
+    connection->operations--;
+    if (status != 0 || length == 0 || connection->closed) {
+        render_cluster_connection_close(connection);
+        render_cluster_connection_release(connection);
+        render_cluster_coordinator_dispatch(coordinator);
+        return;
+    }
+    connection->received += length;
+    coordinator->stats.bytesReceived += length;
+    usize offset = 0;
+    while (!connection->closed && connection->received - offset >= sizeof(RenderClusterMessageHeader)) {
+        RenderClusterMessageHeader header;
+        memcpy(&header, connection->receiveBuffer + offset, sizeof(RenderClusterMessageHeader));
+        if (header.type != RENDER_CLUSTER_MESSAGE_RESULT || header.length < sizeof(RenderClusterTileMessage) ||
+            header.length > RENDER_CLUSTER_MAX_MESSAGE_SIZE - sizeof(RenderClusterMessageHeader)) {
+            render_cluster_connection_close(connection);
+            break;
+        }
+        if (connection->received - offset < sizeof(RenderClusterMessageHeader) + header.length) {
+            break;
+        }
+        const u8 *payload = connection->receiveBuffer + offset + sizeof(RenderClusterMessageHeader);
+        RenderClusterTileMessage message;
+        memcpy(&message, payload, sizeof(RenderClusterTileMessage));
+        render_cluster_coordinator_accept_result(coordinator, connection, &message,
+                                                 payload + sizeof(RenderClusterTileMessage),
+                                                 header.length - sizeof(RenderClusterTileMessage));
+        offset += sizeof(RenderClusterMessageHeader) + header.length;
+    }
+    memmove(connection->receiveBuffer, connection->receiveBuffer + offset, connection->received - offset);
+    connection->received -= offset;
+    if (!connection->closed &&
+        reactor_receive(sock, connection->receiveBuffer + connection->received,
+                        sizeof(connection->receiveBuffer) - connection->received,
+                        render_cluster_receive_callback) == 0) {
+        connection->operations++;
+    } else {
+        render_cluster_connection_close(connection);
+    }
+    render_cluster_connection_release(connection);
+    render_cluster_coordinator_dispatch(coordinator);
+}
+
+void render_cluster_accept_callback(ReactorSocket *listener, ReactorSocket *sock, void *user_data) {
+    RenderClusterCoordinator *coordinator = user_data;
+    RenderClusterConnection *connection = calloc(1, sizeof(RenderClusterConnection));
+    if (connection == NULL) {
+        reactor_close(sock);
+        return;
+    }
+    connection->coordinator = coordinator;
+    connection->sock = sock;
+    reactor_socket_set_user_data(sock, connection);
+    connection->next = coordinator->connections;
+    if (coordinator->connections != NULL) {
+        coordinator->connections->previous = connection;
+    }
+    coordinator->connections = connection;
+    coordinator->connectionCount++;
+    if (reactor_receive(sock, connection->receiveBuffer, sizeof(connection->receiveBuffer),
+                        render_cluster_receive_callback) != 0) {
+        render_cluster_connection_close(connection);
+        render_cluster_connection_release(connection);
+        return;
+    }
+    connection->operations++;
+    render_cluster_coordinator_dispatch(coordinator);
+}
+
+RenderClusterCoordinator *render_cluster_coordinator_create(const struct sockaddr *addr, int addr_length) {
+    RenderClusterCoordinator *coordinator = calloc(1, sizeof(RenderClusterCoordinator));
+    if (coordinator == NULL) {
+        return NULL;
+    }
+    coordinator->reactor = reactor_create();
+    if (coordinator->reactor == NULL) {
+        free(coordinator);
+        return NULL;
+    }
+    coordinator->listener = reactor_listen(coordinator->reactor, addr, addr_length, RENDER_CLUSTER_BACKLOG,
+                                           render_cluster_accept_callback, coordinator);
+    if (coordinator->listener == NULL) {
+        reactor_destroy(coordinator->reactor);
+        free(coordinator);
+        return NULL;
+    }
+    return coordinator;
+}
+
+void render_cluster_coordinator_destroy(RenderClusterCoordinator *coordinator) {
+    reactor_destroy(coordinator->reactor);
+    while (coordinator->connections != NULL) {
+        RenderClusterConnection *connection = coordinator->connections;
+        coordinator->connections = connection->next;
+        free(connection);
+    }
+    free(coordinator->tileDone);
+    free(coordinator->tileHolders);
+    free(coordinator->tileAssignTimes);
+    free(coordinator->pendingTiles);
+    free(coordinator);
+}
+
+u32 render_cluster_coordinator_wait_for_workers(RenderClusterCoordinator *coordinator, u32 count, u64 timeout_ms) {
+    u64 deadline = timer_get_time_ns() + timeout_ms * 1000000;
+    while (coordinator->connectionCount < count) {
+        u64 now = timer_get_time_ns();
+        if (now >= deadline) {
+            break;
+        }
+        reactor_run_once(coordinator->reactor, (i64) ((deadline - now + 999999) / 1000000));
+    }
+    return coordinator->connectionCount;
+}
+
+int render_cluster_coordinator_render(RenderClusterCoordinator *coordinator, u32 width, u32 height, u8 *pixels,
+                                      u64 timeout_ms, RenderClusterStats *stats) {
+    u32 tileCount = render_cluster_get_tile_count(width) * render_cluster_get_tile_count(height);
+    if (tileCount > coordinator->tileCapacity) {
+        free(coordinator->tileDone);
+        free(coordinator->tileHolders);
+        free(coordinator->tileAssignTimes);
+        free(coordinator->pendingTiles);
+        coordinator->tileDone = malloc(tileCount * sizeof(bool));
+        coordinator->tileHolders = malloc(tileCount);
+        coordinator->tileAssignTimes = malloc(tileCount * sizeof(u64));
+        coordinator->pendingTiles = malloc(tileCount * sizeof(u32));
+        coordinator->tileCapacity = tileCount;
+        if (coordinator->tileDone == NULL || coordinator->tileHolders == NULL ||
+            coordinator->tileAssignTimes == NULL || coordinator->pendingTiles == NULL) {
+            coordinator->tileCapacity = 0;
+            return ENOMEM;
+        }
+    }
+    /* Tiles still queued on a worker from an earlier frame are stale; their results are ignored by frame id. */
+    for (RenderClusterConnection *connection = coordinator->connections; connection != NULL;
+         connection = connection->next) {
+        connection->assignedCount = 0;
+    }
+    memset(&coordinator->stats, 0, sizeof(RenderClusterStats));
+    coordinator->frameId++;
+    coordinator->width = width;
+    coordinator->height = height;
+    coordinator->pixels = pixels;
+    coordinator->tileCount = tileCount;
+    coordinator->doneCount = 0;
+    memset(coordinator->tileDone, 0, tileCount * sizeof(bool));
+    memset(coordinator->tileHolders, 0, tileCount);
+    /* Popped from the back, so tiles go out top to bottom. */
+    for (u32 i = 0; i < tileCount; i++) {
+        coordinator->pendingTiles[i] = tileCount - 1 - i;
+    }
+    coordinator->pendingCount = tileCount;
+    coordinator->rendering = true;
+    coordinator->lastProgress = timer_get_time_ns();
+    int status = 0;
+    render_cluster_coordinator_dispatch(coordinator);
+    while (coordinator->doneCount < tileCount) {
+        u64 deadline = coordinator->lastProgress + timeout_ms * 1000000;
+        u64 now = timer_get_time_ns();
+        if (now >= deadline) {
+            status = ETIMEDOUT;
+            break;
+        }
+        reactor_run_once(coordinator->reactor, (i64) ((deadline - now + 999999) / 1000000));
+    }
+    coordinator->rendering = false;
+    if (stats != NULL) {
+        *stats = coordinator->stats;
+        stats->workerCount = coordinator->connectionCount;
+        stats->tileCount = tileCount;
+    }
+    return status;
+}
+
+typedef struct render_cluster_worker_s {
+    Socket sock;
+    u8 receiveBuffer[RENDER_CLUSTER_CONTROL_MESSAGE_SIZE * RENDER_CLUSTER_WORKER_QUEUE_CAPACITY];
+    usize received;
+    RenderClusterTileMessage queue[RENDER_CLUSTER_WORKER_QUEUE_CAPACITY];
+    u32 queueCount;
+    u8 result[RENDER_CLUSTER_MAX_MESSAGE_SIZE];
+} RenderClusterWorker;
+
+/* Reads whatever arrived, waiting for it only when block is set. Returns 0, -1 once the peer closed, or an error. */
+int render_cluster_worker_receive(RenderClusterWorker *worker, bool block) {
+    int ready = socket_poll(worker->sock, POLLIN, block ? -1 : 0, NULL);
+    if (ready < 0) {
+        return socket_get_last_error();
+    }
+    if (ready == 0) {
+        return 0;
+    }
+    isize received = socket_receive(worker->sock, worker->receiveBuffer + worker->received,
+                                    sizeof(worker->receiveBuffer) - worker->received, 0);
+    if (received == 0) {
+        return -1;
+    }
+    if (received < 0) {
+        return socket_get_last_error();
+    }
+    worker->received += (usize) received;
+    usize offset = 0;
+    while (worker->received - offset >= RENDER_CLUSTER_CONTROL_MESSAGE_SIZE) {
+        RenderClusterMessageHeader header;
+        RenderClusterTileMessage message;
+        memcpy(&header, worker->receiveBuffer + offset, sizeof(RenderClusterMessageHeader));
+        memcpy(&message, worker->receiveBuffer + offset + sizeof(RenderClusterMessageHeader),
+               sizeof(RenderClusterTileMessage));
+        if (header.length != sizeof(RenderClusterTileMessage)) {
+            return EPROTO;
+        }
+        offset += RENDER_CLUSTER_CONTROL_MESSAGE_SIZE;
+        /* An empty frame or a tile outside it would divide by zero or overrun the result buffer while rendering. */
+        if (header.type == RENDER_CLUSTER_MESSAGE_TILE &&
+            (message.width == 0 || message.height == 0 ||
+             message.tile >= (u64) render_cluster_get_tile_count(message.width) *
+                             render_cluster_get_tile_count(message.height))) {
+            return EPROTO;
+        }
+        if (header.type == RENDER_CLUSTER_MESSAGE_TILE && worker->queueCount < RENDER_CLUSTER_WORKER_QUEUE_CAPACITY) {
+            worker->queue[worker->queueCount++] = message;
+        } else if (header.type == RENDER_CLUSTER_MESSAGE_CANCEL) {
+            for (u32 i = 0; i < worker->queueCount; i++) {
+                if (worker->queue[i].frameId == message.frameId && worker->queue[i].tile == message.tile) {
+                    memmove(&worker->queue[i], &worker->queue[i + 1],
+                            (worker->queueCount - i - 1) * sizeof(RenderClusterTileMessage));
+                    worker->queueCount--;
+                    break;
+                }
+            }
+        }
+    }
+    memmove(worker->receiveBuffer, worker->receiveBuffer + offset, worker->received - offset);
+    worker->received -= offset;
+    return 0;
+}
+
+int render_cluster_worker_send_all(Socket sock, const u8 *data, usize length) {
+    while (length > 0) {
+        isize sent = socket_send(sock, data, length, 0);
+        if (sent < 0) {
+            return socket_get_last_error();
+        }
+        data += sent;
+        length -= (usize) sent;
+    }
+    return 0;
+}
+
+int render_cluster_worker_run(const struct sockaddr *addr, int addr_length, u32 delay_ms, u32 *tiles_rendered) {
+    RenderClusterWorker *worker = malloc(sizeof(RenderClusterWorker));
+    if (worker == NULL) {
+        return ENOMEM;
+    }
+    worker->received = 0;
+    worker->queueCount = 0;
+    worker->sock = socket_create(addr->sa_family, SOCK_STREAM, IPPROTO_TCP);
+    if (worker->sock == INVALID_SOCKET_HANDLE || socket_connect(worker->sock, addr, addr_length) != 0) {
+        int status = socket_get_last_error();
+        if (worker->sock != INVALID_SOCKET_HANDLE) {
+            socket_close(worker->sock);
+        }
+        free(worker);
+        return status;
+    }
+    RaytracerScene scene;
+    raytracer_get_default_scene(&scene);
+    u32 rendered = 0;
+    int status = 0;
+    while (status == 0) {
+        /* Draining the socket before every tile lets cancels for queued tiles land before they are started. */
+        status = render_cluster_worker_receive(worker, worker->queueCount == 0);
+        if (status != 0 || worker->queueCount == 0) {
+            continue;
+        }
+        RenderClusterTileMessage message = worker->queue[0];
+        worker->queueCount--;
+        memmove(&worker->queue[0], &worker->queue[1], worker->queueCount * sizeof(RenderClusterTileMessage));
+        u32 x, y, tileWidth, tileHeight;
+        render_cluster_get_tile_rect(message.width, message.height, message.tile, &x, &y, &tileWidth, &tileHeight);
+        u8 *pixels = worker->result + RENDER_CLUSTER_CONTROL_MESSAGE_SIZE;
+        raytracer_render_rect(&scene, message.width, message.height, x, y, tileWidth, tileHeight, pixels);
+        if (delay_ms > 0) {
+            thread_sleep(delay_ms);
+        }
+        RenderClusterMessageHeader header;
+        header.type = RENDER_CLUSTER_MESSAGE_RESULT;
+        header.length = (u32) (sizeof(RenderClusterTileMessage) + (usize) tileWidth * tileHeight * 4);
+        memcpy(worker->result, &header, sizeof(RenderClusterMessageHeader));
+        memcpy(worker->result + sizeof(RenderClusterMessageHeader), &message, sizeof(RenderClusterTileMessage));
+        status = render_cluster_worker_send_all(worker->sock, worker->result,
+                                                sizeof(RenderClusterMessageHeader) + header.length);
+        rendered++;
+    }
+    socket_close(worker->sock);
+    free(worker);
+    if (tiles_rendered != NULL) {
+        *tiles_rendered = rendered;
+    }
+    return status == -1 ? 0 : status;
+}
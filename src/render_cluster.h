@@ -0,0 +1,48 @@
+#ifndef CGFS_RENDER_CLUSTER_H
+#define CGFS_RENDER_CLUSTER_H
+
+#include "socket.h"
+#include "types.h"
+
+#define RENDER_CLUSTER_TILE_SIZE 64
+
+/*
+ * Distributed tile rendering. The coordinator hands tiles of a frame to connected workers over TCP and collects the
+ * RGBA8 pixels they send back. Both ends render the default raytracer scene, so a request only names the frame size
+ * and the tile. Messages are a type and a payload length followed by the payload, in host byte order.
+ */
+typedef struct render_cluster_coordinator_s RenderClusterCoordinator;
+
+typedef struct render_cluster_stats_s {
+    u32 workerCount;
+    u32 tileCount;
+    u32 stolenTiles;
+    u32 duplicatedTiles;
+    u32 wastedTiles;
+    u64 bytesReceived;
+} RenderClusterStats;
+
+RenderClusterCoordinator *render_cluster_coordinator_create(const struct sockaddr *addr, int addr_length);
+
+/* Closes every worker connection, which is what tells the workers to exit. */
+void render_cluster_coordinator_destroy(RenderClusterCoordinator *coordinator);
+
+/* Accepts workers until count of them are connected or timeout_ms passed. Returns how many are connected. */
+u32 render_cluster_coordinator_wait_for_workers(RenderClusterCoordinator *coordinator, u32 count, u64 timeout_ms);
+
+/*
+ * Renders a frame across the workers. Each worker keeps a few tiles queued; once no unassigned tiles are left, an idle
+ * worker steals the last queued tile of the busiest one, or else duplicates the longest running tile, and whichever
+ * copy finishes first wins. Workers may join or leave at any time, and the tiles of one that left go back into the
+ * pool. Returns 0, or ETIMEDOUT when no tile finished for timeout_ms.
+ */
+int render_cluster_coordinator_render(RenderClusterCoordinator *coordinator, u32 width, u32 height, u8 *pixels,
+                                      u64 timeout_ms, RenderClusterStats *stats);
+
+/*
+ * Renders the tiles a coordinator hands out until it closes the connection. delay_ms is added to every tile so a
+ * worker can pose as a slow node. Returns 0 once the coordinator is gone, or an error.
+ */
+int render_cluster_worker_run(const struct sockaddr *addr, int addr_length, u32 delay_ms, u32 *tiles_rendered);
+
+#endif //CGFS_RENDER_CLUSTER_H
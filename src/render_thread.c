@@ -0,0 +1,203 @@
+#include "render_thread.h"
+#include "atomic.h"
+#include "job.h"
+#include "thread.h"
+#include "timer.h"
+#include "profiler.h"
+#include <stdlib.h>
+
+#define RENDER_EVENT_QUEUE_CAPACITY 256
+#define RENDER_THREAD_SPIN_NS 1000000
+#define RENDER_THREAD_IDLE_MS 10
+
+/*
+ * Single-producer single-consumer ring. Each side owns one index and only reads the other's, so neither ever waits;
+ * the indices sit on their own cache lines to keep the two threads from bouncing one line between them.
+ */
+typedef struct render_event_queue_s {
+    i64 head;
+    u8 headPadding[64 - sizeof(i64)];
+    i64 tail;
+    u8 tailPadding[64 - sizeof(i64)];
+    RenderEvent events[RENDER_EVENT_QUEUE_CAPACITY];
+} RenderEventQueue;
+
+struct render_thread_s {
+    RenderEventQueue queue;
+    Renderer renderer;
+    RenderThreadDrawFunction draw;
+    void *arg;
+    u64 framePeriod;
+    Thread thread;
+    bool creatorDetached;
+    i32 quit;
+    /*
+     * The newest window size packed as width << 32 | height, published before every resize event. The render thread
+     * reads the size from here rather than from the events, so a dropped or stale event can never leave it behind.
+     */
+    i64 latestSize;
+    i32 resizePending;
+    i64 frameCount;
+    i64 eventCount;
+    i64 droppedEventCount;
+    i64 resizeCount;
+    i64 totalFrameTimeNs;
+    i64 maxFrameTimeNs;
+};
+
+bool render_event_queue_push(RenderEventQueue *queue, const RenderEvent *event) {
+    i64 tail = atomic_load_i64(&queue->tail, ATOMIC_RELAXED);
+    i64 head = atomic_load_i64(&queue->head, ATOMIC_ACQUIRE);
+    if (tail - head >= RENDER_EVENT_QUEUE_CAPACITY) {
+        return false;
+    }
+    queue->events[tail & (RENDER_EVENT_QUEUE_CAPACITY - 1)] = *event;
+    atomic_store_i64(&queue->tail, tail + 1, ATOMIC_RELEASE);
+    return true;
+}
+
+bool render_event_queue_pop(RenderEventQueue *queue, RenderEvent *event) {
+    i64 head = atomic_load_i64(&queue->head, ATOMIC_RELAXED);
+    if (head == atomic_load_i64(&queue->tail, ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    *event = queue->events[head & (RENDER_EVENT_QUEUE_CAPACITY - 1)];
+    atomic_store_i64(&queue->head, head + 1, ATOMIC_RELEASE);
+    return true;
+}
+
+/* Drains the queue in one go so a burst of resizes from dragging a window edge costs a single swapchain rebuild. */
+void render_thread_handle_events(RenderThread *thread) {
+    bool resized = atomic_exchange_i32(&thread->resizePending, 0, ATOMIC_ACQUIRE) != 0;
+    RenderEvent event;
+    i64 eventCount = 0;
+    while (render_event_queue_pop(&thread->queue, &event)) {
+        eventCount++;
+        if (event.type == RENDER_EVENT_RESIZE) {
+            resized = true;
+        }
+    }
+    if (eventCount > 0) {
+        atomic_store_i64(&thread->eventCount, thread->eventCount + eventCount, ATOMIC_RELAXED);
+    }
+    if (resized) {
+        u64 size = (u64) atomic_load_i64(&thread->latestSize, ATOMIC_ACQUIRE);
+        renderer_resize(thread->renderer, (u32) (size >> 32), (u32) size);
+        atomic_store_i64(&thread->resizeCount, thread->resizeCount + 1, ATOMIC_RELAXED);
+    }
+}
+
+/* Sleeps through most of the wait and yields through the last millisecond, which thread_sleep cannot resolve. */
+void render_thread_wait_until(RenderThread *thread, u64 deadline) {
+    u64 now = timer_get_time_ns();
+    if (deadline > now + RENDER_THREAD_SPIN_NS) {
+        thread_sleep((deadline - now - RENDER_THREAD_SPIN_NS) / 1000000);
+    }
+    while (timer_get_time_ns() < deadline && atomic_load_i32(&thread->quit, ATOMIC_RELAXED) == 0) {
+        thread_yield();
+    }
+}
+
+void *render_thread_entry_point(void *arg) {
+    RenderThread *thread = arg;
+    profiler_set_thread_name("render");
+    bool attached = job_system_attach_thread() == 0;
+    u64 deadline = timer_get_time_ns();
+    while (atomic_load_i32(&thread->quit, ATOMIC_ACQUIRE) == 0) {
+        u64 start = timer_get_time_ns();
+        render_thread_handle_events(thread);
+        thread->draw(thread->renderer, thread->arg);
+        bool drawn = renderer_draw_frame(thread->renderer);
+        u64 end = timer_get_time_ns();
+        if (!drawn) {
+            /*
+             * Nothing to present to, typically because the window is minimized. Presentation no longer paces the
+             * loop, so poll the event queue at a leisurely rate until a resize brings the swapchain back.
+             */
+            thread_sleep(RENDER_THREAD_IDLE_MS);
+            deadline = timer_get_time_ns();
+            continue;
+        }
+        i64 frameTime = (i64) (end - start);
+        atomic_store_i64(&thread->totalFrameTimeNs, thread->totalFrameTimeNs + frameTime, ATOMIC_RELAXED);
+        if (frameTime > thread->maxFrameTimeNs) {
+            atomic_store_i64(&thread->maxFrameTimeNs, frameTime, ATOMIC_RELAXED);
+        }
+        atomic_store_i64(&thread->frameCount, thread->frameCount + 1, ATOMIC_RELAXED);
+        if (thread->framePeriod == 0) {
+            continue;
+        }
+        /* Frames follow a fixed grid; after a long stall the grid restarts rather than bursting to catch up. */
+        deadline += thread->framePeriod;
+        if (deadline < end) {
+            deadline = end;
+        }
+        render_thread_wait_until(thread, deadline);
+    }
+    if (attached) {
+        job_system_detach_thread();
+    }
+    return NULL;
+}
+
+RenderThread *render_thread_create(Renderer renderer, u32 target_fps, RenderThreadDrawFunction draw, void *arg) {
+    RenderThread *thread = calloc(1, sizeof(RenderThread));
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->renderer = renderer;
+    thread->draw = draw;
+    thread->arg = arg;
+    thread->framePeriod = target_fps > 0 ? 1000000000ull / target_fps : 0;
+    /*
+     * The renderer records in parallel through the job system, which only fans out from a job thread, so the creator
+     * gives up thread 0 to the render thread for as long as it runs.
+     */
+    thread->creatorDetached = job_get_thread_index() == 0;
+    if (thread->creatorDetached) {
+        job_system_detach_thread();
+    }
+    thread->thread = thread_create(render_thread_entry_point, thread);
+    if (thread->thread == 0) {
+        if (thread->creatorDetached) {
+            job_system_attach_thread();
+        }
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void render_thread_destroy(RenderThread *thread) {
+    atomic_store_i32(&thread->quit, 1, ATOMIC_RELEASE);
+    thread_join(thread->thread, NULL);
+    if (thread->creatorDetached) {
+        job_system_attach_thread();
+    }
+    free(thread);
+}
+
+bool render_thread_post_event(RenderThread *thread, const RenderEvent *event) {
+    if (event->type == RENDER_EVENT_RESIZE) {
+        atomic_store_i64(&thread->latestSize, (i64) ((u64) event->width << 32 | event->height), ATOMIC_RELEASE);
+    }
+    if (render_event_queue_push(&thread->queue, event)) {
+        return true;
+    }
+    if (event->type == RENDER_EVENT_RESIZE) {
+        atomic_store_i32(&thread->resizePending, 1, ATOMIC_RELEASE);
+    }
+    atomic_store_i64(&thread->droppedEventCount, thread->droppedEventCount + 1, ATOMIC_RELAXED);
+    return false;
+}
+
+RenderThreadStats render_thread_get_stats(RenderThread *thread) {
+    RenderThreadStats stats;
+    stats.frameCount = (u64) atomic_load_i64(&thread->frameCount, ATOMIC_RELAXED);
+    stats.eventCount = (u64) atomic_load_i64(&thread->eventCount, ATOMIC_RELAXED);
+    stats.droppedEventCount = (u64) atomic_load_i64(&thread->droppedEventCount, ATOMIC_RELAXED);
+    stats.resizeCount = (u64) atomic_load_i64(&thread->resizeCount, ATOMIC_RELAXED);
+    stats.totalFrameTimeNs = (u64) atomic_load_i64(&thread->totalFrameTimeNs, ATOMIC_RELAXED);
+    stats.maxFrameTimeNs = (u64) atomic_load_i64(&thread->maxFrameTimeNs, ATOMIC_RELAXED);
+    return stats;
+}
@@ -0,0 +1,51 @@
+#ifndef CGFS_RENDER_THREAD_H
+#define CGFS_RENDER_THREAD_H
+
+#include "renderer.h"
+#include "types.h"
+
+typedef enum render_event_type_e {
+    RENDER_EVENT_RESIZE
+} RenderEventType;
+
+typedef struct render_event_s {
+    RenderEventType type;
+    u32 width;
+    u32 height;
+} RenderEvent;
+
+typedef struct render_thread_stats_s {
+    u64 frameCount;
+    u64 eventCount;
+    u64 droppedEventCount;
+    u64 resizeCount;
+    u64 totalFrameTimeNs;
+    u64 maxFrameTimeNs;
+} RenderThreadStats;
+
+typedef struct render_thread_s RenderThread;
+
+/* Records the draw calls of one frame; the render thread submits it with renderer_draw_frame afterwards. */
+typedef void (*RenderThreadDrawFunction)(Renderer renderer, void *arg);
+
+/*
+ * Takes over the renderer and draws into it on a thread of its own, target_fps times per second or, with 0, as fast
+ * as presentation allows. Nothing else may touch the renderer until render_thread_destroy returns. When the caller
+ * is thread 0 of the job system, that slot moves to the render thread meanwhile, so frame recording fans out to the
+ * workers instead of running inline.
+ */
+RenderThread *render_thread_create(Renderer renderer, u32 target_fps, RenderThreadDrawFunction draw, void *arg);
+
+/* Stops and joins the thread, after which the renderer belongs to the caller again. */
+void render_thread_destroy(RenderThread *thread);
+
+/*
+ * Hands an event to the render thread without ever blocking. Only one thread, normally the one running the window
+ * event loop, may post. When the queue is full the event is dropped, except that a dropped resize still takes
+ * effect, since the render thread always applies the latest size.
+ */
+bool render_thread_post_event(RenderThread *thread, const RenderEvent *event);
+
+RenderThreadStats render_thread_get_stats(RenderThread *thread);
+
+#endif //CGFS_RENDER_THREAD_H
@@ -12,10 +12,43 @@ Renderer renderer_create(
         const u32 *fragment_shader_spv
 );
 
+Renderer renderer_create_headless(
+        u32 width,
+        u32 height,
+        usize vertex_shader_length,
+        const u32 *vertex_shader_spv,
+        usize fragment_shader_length,
+        const u32 *fragment_shader_spv
+);
+
 void renderer_reload(Renderer renderer);
 
+void renderer_resize(Renderer renderer, u32 width, u32 height);
+
 void renderer_destroy(Renderer renderer);
 
-void renderer_draw_frame(Renderer renderer);
+/*
+ * Submits the draws queued since the last frame. Returns false when no frame went out, for instance while a minimized
+ * window leaves nothing to present to; the queued draws are dropped either way.
+ */
+bool renderer_draw_frame(Renderer renderer);
+
+void renderer_get_frame_size(Renderer renderer, u32 *width, u32 *height);
+
+int renderer_read_frame(Renderer renderer, u8 *pixels);
+
+Mesh renderer_create_mesh(Renderer renderer, u32 vertex_count, const RendererVertex *vertices, u32 index_count,
+                          const u32 *indices);
+
+void renderer_destroy_mesh(Renderer renderer, Mesh mesh);
+
+void renderer_draw_mesh(Renderer renderer, Mesh mesh);
+
+u8 *renderer_acquire_host_frame(Renderer renderer, u32 width, u32 height);
+
+void renderer_submit_host_frame(Renderer renderer);
+
+void renderer_draw_mesh_instances(Renderer renderer, Mesh mesh, u32 instance_count,
+                                  const RendererInstance *instances);
 
 #endif //CGFS_RENDERER_H
@@ -2,57 +2,217 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stddef.h>
 #include "renderer_vulkan.h"
+#include "renderer_vulkan_memory.h"
+#include "renderer_vulkan_upload.h"
 #include "window.h"
+#include "file_async.h"
+#include "job.h"
+#include "profiler.h"
+#include "timer.h"
 
 #define INVALID_RENDERER 0xFFFFFFFF
+#define INVALID_MESH 0xFFFFFFFF
 #define VULKAN_VALIDATION_LAYER_NAME "VK_LAYER_KHRONOS_validation"
 #define MAX_FRAMES_IN_FLIGHT 2
+#define OFFSCREEN_FORMAT VK_FORMAT_R8G8B8A8_UNORM
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
+#define PIPELINE_CACHE_MAGIC 0x48435043 /* "CPCH" */
+#define UPLOAD_RING_CAPACITY (16 * 1024 * 1024)
+#define FRAME_ARENA_INITIAL_CAPACITY (1024 * 1024)
+#define MAX_RECORD_SLOTS 8
+#define PARALLEL_RECORD_MIN_BATCHES 64
+#define HOST_FRAME_STAGING_COUNT (MAX_FRAMES_IN_FLIGHT + 1)
+#define HOST_FRAME_NONE 0xFFFFFFFF
+
+typedef struct pipeline_cache_file_header_s {
+    u32 magic;
+    u32 vendorID;
+    u32 deviceID;
+    u32 driverVersion;
+    u8 pipelineCacheUUID[VK_UUID_SIZE];
+    u64 dataSize;
+} PipelineCacheFileHeader;
+
+typedef struct retired_swapchain_s {
+    VkSwapchainKHR swapchain;
+    u32 imageCount;
+    VkImageView *imageViews;
+    VkFramebuffer *framebuffers;
+    u64 lastUsedFrameNumber;
+} RetiredSwapchain;
+
+typedef struct mesh_data_s {
+    bool alive;
+    bool destroyed;
+    u64 lastUsedFrameNumber;
+    u32 vertexCount;
+    u32 indexCount;
+    VkBuffer vertexBuffer;
+    VulkanAllocation vertexAllocation;
+    VkBuffer indexBuffer;
+    VulkanAllocation indexAllocation;
+} MeshData;
+
+typedef struct draw_item_s {
+    Mesh mesh;
+    RendererInstance instance;
+} DrawItem;
+
+typedef struct draw_batch_s {
+    Mesh mesh;
+    u32 firstInstance;
+    u32 instanceCount;
+    VkDeviceSize commandOffset;
+} DrawBatch;
+
+typedef struct record_context_s {
+    VkDevice device;
+    VkRenderPass renderPass;
+    VkFramebuffer framebuffer;
+    VkPipeline pipeline;
+    VkPipelineLayout pipelineLayout;
+    VkDescriptorSet descriptorSet;
+    VkExtent2D extent;
+    VkBuffer indirectBuffer;
+    const DrawBatch *drawBatches;
+    const MeshData *meshes;
+    u32 frame;
+} RecordContext;
+
+typedef struct record_slot_s {
+    VkCommandPool commandPools[MAX_FRAMES_IN_FLIGHT];
+    VkCommandBuffer commandBuffers[MAX_FRAMES_IN_FLIGHT];
+    const RecordContext *context;
+    u32 firstBatch;
+    u32 batchCount;
+    VkResult result;
+} RecordSlot;
+
+typedef struct host_frame_staging_s {
+    VkBuffer buffer;
+    VulkanAllocation allocation;
+    u32 width;
+    u32 height;
+    u64 lastUsedFrameNumber;
+} HostFrameStaging;
 
 typedef struct renderer_data_s {
     Window window;
+    u32 windowWidth;
+    u32 windowHeight;
+    bool headless;
+    bool validationEnabled;
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkSurfaceKHR surface;
     VkPhysicalDevice physicalDevice;
     u32 graphicsQueueFamilyIndex;
     u32 presentQueueFamilyIndex;
+    u32 transferQueueFamilyIndex;
     VkDevice device;
+    VulkanMemoryAllocator memoryAllocator;
+    VulkanUploader uploader;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    VkQueue transferQueue;
     VkSurfaceFormatKHR surfaceFormat;
     VkPresentModeKHR presentMode;
     VkExtent2D swapExtent;
     VkSwapchainKHR swapchain;
+    bool swapchainOutOfDate;
+    RetiredSwapchain *retiredSwapchains;
+    u32 retiredSwapchainCount;
+    u32 retiredSwapchainLimit;
     u32 swapchainImageCount;
     VkImage *swapchainImages;
     VkImageView *swapchainImageViews;
     VkRenderPass renderPass;
+    VkRenderPass loadRenderPass;
     VkPipelineLayout pipelineLayout;
     VkPipeline graphicsPipeline;
+    VkPipelineCache pipelineCache;
+    usize pipelineCacheLoadedSize;
     VkFramebuffer *swapchainFramebuffers;
+    VulkanAllocation *offscreenImageAllocations;
+    VkBuffer *readbackBuffers;
+    VulkanAllocation *readbackBufferAllocations;
     VkCommandPool commandPool;
     VkCommandBuffer *commandBuffers;
+    RecordSlot *recordSlots;
+    u32 recordSlotCount;
     VkSemaphore *imageAvailableSemaphores;
     VkSemaphore *renderFinishedSemaphores;
+    VkSemaphore *uploadFinishedSemaphores;
     VkFence *inFlightFences;
+    VkQueryPool timestampQueryPool;
+    float timestampPeriod;
+    u64 timestampMask;
+    bool timestampsWritten[MAX_FRAMES_IN_FLIGHT];
+    u64 submitTimes[MAX_FRAMES_IN_FLIGHT];
+    MeshData *meshes;
+    u32 meshCount;
+    u32 meshLimit;
+    DrawItem *drawItems;
+    u32 drawItemCount;
+    u32 drawItemLimit;
+    DrawBatch *drawBatches;
+    u32 drawBatchCount;
+    u32 drawBatchLimit;
+    u32 *meshBatchIndices;
+    u32 meshBatchIndexLimit;
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSets[MAX_FRAMES_IN_FLIGHT];
+    VulkanLinearArena frameArenas[MAX_FRAMES_IN_FLIGHT];
     u32 currentFrame;
+    u32 lastSubmittedFrame;
+    u64 frameNumber;
+    u64 completedFrameNumber;
+    u64 frameNumbers[MAX_FRAMES_IN_FLIGHT];
+    bool hostFrameSupported;
+    VkFormat hostFrameFormat;
+    VkFilter hostFrameFilter;
+    HostFrameStaging hostFrameStagings[HOST_FRAME_STAGING_COUNT];
+    u32 hostFrameNext;
+    u32 hostFrameAcquired;
+    u32 hostFramePending;
+    VkImage hostFrameImage;
+    VulkanAllocation hostFrameImageAllocation;
+    u32 hostFrameImageWidth;
+    u32 hostFrameImageHeight;
+    bool hostFrameImageReady;
 } RendererData;
 
 Renderer renderer_vulkan_renderer_limit = 0;
 Renderer renderer_vulkan_renderer_count = 0;
-RendererData *renderer_vulkan_renderers_data = NULL;
+RendererData **renderer_vulkan_renderers_data = NULL;
 
-void renderer_vulkan_ensure_space_available() {
+/*
+ * Each renderer has an allocation of its own, so pointers into it, like the uploader's allocator, stay valid when the
+ * table grows. A slot left behind by a failed init is reused.
+ */
+RendererData *renderer_vulkan_allocate_renderer() {
     if (renderer_vulkan_renderer_count == renderer_vulkan_renderer_limit) {
         renderer_vulkan_renderer_limit = renderer_vulkan_renderer_limit * 2 + 1;
-        RendererData *old_data = renderer_vulkan_renderers_data;
-        renderer_vulkan_renderers_data = malloc(sizeof(RendererData) * renderer_vulkan_renderer_limit);
+        RendererData **old_data = renderer_vulkan_renderers_data;
+        renderer_vulkan_renderers_data = calloc(renderer_vulkan_renderer_limit, sizeof(RendererData *));
         if (old_data != NULL) {
-            memcpy(renderer_vulkan_renderers_data, old_data, sizeof(RendererData) * renderer_vulkan_renderer_count);
+            memcpy(renderer_vulkan_renderers_data, old_data, sizeof(RendererData *) * renderer_vulkan_renderer_count);
             free(old_data);
         }
     }
+    RendererData *rendererData = renderer_vulkan_renderers_data[renderer_vulkan_renderer_count];
+    if (rendererData == NULL) {
+        rendererData = malloc(sizeof(RendererData));
+        if (rendererData == NULL) {
+            return NULL;
+        }
+        renderer_vulkan_renderers_data[renderer_vulkan_renderer_count] = rendererData;
+    }
+    memset(rendererData, 0, sizeof(RendererData));
+    return rendererData;
 }
 
 VKAPI_ATTR VkBool32 VKAPI_CALL renderer_vulkan_debug_callback(
@@ -65,6 +225,27 @@ VKAPI_ATTR VkBool32 VKAPI_CALL renderer_vulkan_debug_callback(
     return VK_FALSE;
 }
 
+bool renderer_vulkan_is_instance_layer_available(const char *layerName) {
+    u32 layerCount = 0;
+    if (vkEnumerateInstanceLayerProperties(&layerCount, NULL) != VK_SUCCESS || layerCount == 0) {
+        return false;
+    }
+    VkLayerProperties *layers = malloc(sizeof(VkLayerProperties) * layerCount);
+    if (layers == NULL) {
+        return false;
+    }
+    vkEnumerateInstanceLayerProperties(&layerCount, layers);
+    bool found = false;
+    for (int i = 0; i < layerCount; i++) {
+        if (strcmp(layers[i].layerName, layerName) == 0) {
+            found = true;
+            break;
+        }
+    }
+    free(layers);
+    return found;
+}
+
 VkResult renderer_vulkan_create_instance(RendererData *rendererData) {
     VkApplicationInfo applicationInfo;
     applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -75,13 +256,25 @@ VkResult renderer_vulkan_create_instance(RendererData *rendererData) {
     applicationInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
     applicationInfo.apiVersion = VK_API_VERSION_1_0;
 
-    u32 extension_count = window_enumerate_required_vulkan_extensions(rendererData->window, NULL) + 1;
-    const char *extensions[extension_count];
-    window_enumerate_required_vulkan_extensions(rendererData->window, extensions);
-    extensions[extension_count - 1] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+    rendererData->validationEnabled = renderer_vulkan_is_instance_layer_available(VULKAN_VALIDATION_LAYER_NAME);
+
+    u32 extension_count = 0;
+    if (!rendererData->headless) {
+        extension_count += window_enumerate_required_vulkan_extensions(rendererData->window, NULL);
+    }
+    if (rendererData->validationEnabled) {
+        extension_count++;
+    }
+    const char *extensions[extension_count + 1];
+    if (!rendererData->headless) {
+        window_enumerate_required_vulkan_extensions(rendererData->window, extensions);
+    }
+    if (rendererData->validationEnabled) {
+        extensions[extension_count - 1] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+    }
 
-    u32 layer_count = 1;
-    const char *layers[layer_count];
+    u32 layer_count = rendererData->validationEnabled ? 1 : 0;
+    const char *layers[1];
     layers[0] = VULKAN_VALIDATION_LAYER_NAME;
 
     VkInstanceCreateInfo instanceCreateInfo;
@@ -164,6 +357,29 @@ bool renderer_vulkan_choose_swap_present_mode(RendererData *rendererData, VkPhys
     return true;
 }
 
+bool renderer_vulkan_is_headless_physical_device_usable(VkPhysicalDevice physicalDevice,
+                                                        VkPhysicalDeviceType *pPhysicalDeviceType,
+                                                        u32 graphicsQueueFamilyIndex,
+                                                        u32 *pGraphicsQueueFamilyIndex,
+                                                        u32 *pPresentQueueFamilyIndex,
+                                                        VkSurfaceFormatKHR *pSurfaceFormat,
+                                                        VkPresentModeKHR *pPresentMode) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, OFFSCREEN_FORMAT, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)) {
+        return false;
+    }
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    *pPhysicalDeviceType = properties.deviceType;
+    *pGraphicsQueueFamilyIndex = graphicsQueueFamilyIndex;
+    *pPresentQueueFamilyIndex = graphicsQueueFamilyIndex;
+    pSurfaceFormat->format = OFFSCREEN_FORMAT;
+    pSurfaceFormat->colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    *pPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    return true;
+}
+
 bool renderer_vulkan_is_physical_device_usable(RendererData *rendererData,
                                                VkPhysicalDevice physicalDevice,
                                                VkPhysicalDeviceType *pPhysicalDeviceType,
@@ -189,6 +405,9 @@ bool renderer_vulkan_is_physical_device_usable(RendererData *rendererData,
             (pQueueFamilyProperties[queueFamilyIndex].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
             graphicsQueueFamilyIndex = queueFamilyIndex;
         }
+        if (rendererData->headless) {
+            continue;
+        }
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, queueFamilyIndex, rendererData->surface, &presentSupport);
         if (presentQueueFamilyIndex == -1 && presentSupport) {
@@ -196,9 +415,18 @@ bool renderer_vulkan_is_physical_device_usable(RendererData *rendererData,
         }
     }
     free(pQueueFamilyProperties);
+    if (rendererData->headless) {
+        presentQueueFamilyIndex = graphicsQueueFamilyIndex;
+    }
     if (graphicsQueueFamilyIndex == -1 || presentQueueFamilyIndex == -1) {
         return false;
     }
+    if (rendererData->headless) {
+        return renderer_vulkan_is_headless_physical_device_usable(physicalDevice, pPhysicalDeviceType,
+                                                                  graphicsQueueFamilyIndex,
+                                                                  pGraphicsQueueFamilyIndex, pPresentQueueFamilyIndex,
+                                                                  pSurfaceFormat, pPresentMode);
+    }
     u32 availableExtensionCount = 0;
     vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &availableExtensionCount, NULL);
     VkExtensionProperties *availableExtensions = malloc(sizeof(VkExtensionProperties) * availableExtensionCount);
@@ -240,6 +468,25 @@ bool renderer_vulkan_is_physical_device_usable(RendererData *rendererData,
     return true;
 }
 
+u32 renderer_vulkan_find_transfer_queue_family(VkPhysicalDevice physicalDevice, u32 graphicsQueueFamilyIndex) {
+    u32 queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, NULL);
+    VkQueueFamilyProperties *pQueueFamilyProperties = malloc(sizeof(VkQueueFamilyProperties) * queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, pQueueFamilyProperties);
+    u32 transferQueueFamilyIndex = graphicsQueueFamilyIndex;
+    for (u32 queueFamilyIndex = 0; queueFamilyIndex < queueFamilyCount; queueFamilyIndex++) {
+        VkQueueFlags queueFlags = pQueueFamilyProperties[queueFamilyIndex].queueFlags;
+        if (!(queueFlags & VK_QUEUE_TRANSFER_BIT) || (queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+            continue;
+        }
+        if (transferQueueFamilyIndex == graphicsQueueFamilyIndex || !(queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+            transferQueueFamilyIndex = queueFamilyIndex;
+        }
+    }
+    free(pQueueFamilyProperties);
+    return transferQueueFamilyIndex;
+}
+
 VkResult renderer_vulkan_find_usable_physical_device(RendererData *rendererData) {
     u32 deviceCount = 0;
     VkResult result = vkEnumeratePhysicalDevices(rendererData->instance, &deviceCount, NULL);
@@ -281,6 +528,8 @@ VkResult renderer_vulkan_find_usable_physical_device(RendererData *rendererData)
         rendererData->physicalDevice = usablePhysicalDevice;
         rendererData->graphicsQueueFamilyIndex = graphicsQueueFamilyIndex;
         rendererData->presentQueueFamilyIndex = presentQueueFamilyIndex;
+        rendererData->transferQueueFamilyIndex = renderer_vulkan_find_transfer_queue_family(usablePhysicalDevice,
+                                                                                            graphicsQueueFamilyIndex);
         rendererData->surfaceFormat = surfaceFormat;
         rendererData->presentMode = presentMode;
         return VK_SUCCESS;
@@ -290,7 +539,7 @@ VkResult renderer_vulkan_find_usable_physical_device(RendererData *rendererData)
 
 void renderer_vulkan_init_device_queue_create_info(u32 queueFamilyIndex, u32 queueCount,
                                                    VkDeviceQueueCreateInfo *deviceQueueCreateInfo) {
-    float queuePriority = 1.0f;
+    static const float queuePriority = 1.0f;
     deviceQueueCreateInfo->sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     deviceQueueCreateInfo->pNext = NULL;
     deviceQueueCreateInfo->flags = 0;
@@ -307,15 +556,14 @@ u32 renderer_vulkan_get_unique_u32(u32 *result, u32 num, ...) {
     for (i = 1; i < num; i++) {
         u32 value = va_arg(valist, u32);
         bool unique = true;
-        for (int j = 0; j < i; j++) {
+        for (int j = 0; j < uniqueCount; j++) {
             if (value == result[j]) {
                 unique = false;
                 break;
             }
         }
         if (unique) {
-            result[i] = value;
-            uniqueCount++;
+            result[uniqueCount++] = value;
         }
     }
     va_end(valist);
@@ -323,11 +571,12 @@ u32 renderer_vulkan_get_unique_u32(u32 *result, u32 num, ...) {
 }
 
 VkResult renderer_vulkan_create_device(RendererData *rendererData) {
-    u32 queueFamilyIndices[2];
+    u32 queueFamilyIndices[3];
     u32 queueCreateInfoCount = renderer_vulkan_get_unique_u32(queueFamilyIndices,
-                                                              2,
+                                                              3,
                                                               rendererData->graphicsQueueFamilyIndex,
-                                                              rendererData->presentQueueFamilyIndex);
+                                                              rendererData->presentQueueFamilyIndex,
+                                                              rendererData->transferQueueFamilyIndex);
     VkDeviceQueueCreateInfo queueCreateInfos[queueCreateInfoCount];
     for (int i = 0; i < queueCreateInfoCount; i++) {
         renderer_vulkan_init_device_queue_create_info(queueFamilyIndices[i], 1, &queueCreateInfos[i]);
@@ -346,17 +595,15 @@ VkResult renderer_vulkan_create_device(RendererData *rendererData) {
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos;
     deviceCreateInfo.enabledLayerCount = 0;
     deviceCreateInfo.ppEnabledLayerNames = NULL;
-    deviceCreateInfo.enabledExtensionCount = 1;
+    deviceCreateInfo.enabledExtensionCount = rendererData->headless ? 0 : 1;
     deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions;
     deviceCreateInfo.pEnabledFeatures = &physicalDeviceFeatures;
 
     return vkCreateDevice(rendererData->physicalDevice, &deviceCreateInfo, NULL, &rendererData->device);
 }
 
-void renderer_vulkan_choose_swap_extent(Window window, VkSurfaceCapabilitiesKHR *surfaceCapabilities,
+void renderer_vulkan_choose_swap_extent(u32 width, u32 height, VkSurfaceCapabilitiesKHR *surfaceCapabilities,
                                         VkExtent2D *extent) {
-    u32 width, height;
-    window_get_size_in_pixels(window, &width, &height);
     if (width < surfaceCapabilities->minImageExtent.width) {
         width = surfaceCapabilities->minImageExtent.width;
     } else if (width > surfaceCapabilities->maxImageExtent.width) {
@@ -381,11 +628,12 @@ u32 renderer_vulkan_choose_swap_image_count(VkSurfaceCapabilitiesKHR *surfaceCap
     return imageCount;
 }
 
-VkResult renderer_vulkan_create_swapchain(RendererData *rendererData) {
+VkResult renderer_vulkan_create_swapchain(RendererData *rendererData, VkSwapchainKHR oldSwapchain) {
     VkSurfaceCapabilitiesKHR surfaceCapabilities;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(rendererData->physicalDevice, rendererData->surface,
                                               &surfaceCapabilities);
-    renderer_vulkan_choose_swap_extent(rendererData->window, &surfaceCapabilities, &rendererData->swapExtent);
+    renderer_vulkan_choose_swap_extent(rendererData->windowWidth, rendererData->windowHeight, &surfaceCapabilities,
+                                       &rendererData->swapExtent);
     u32 imageCount = renderer_vulkan_choose_swap_image_count(&surfaceCapabilities);
     VkSwapchainCreateInfoKHR swapchainCreateInfo;
     swapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -398,6 +646,11 @@ VkResult renderer_vulkan_create_swapchain(RendererData *rendererData) {
     swapchainCreateInfo.imageExtent = rendererData->swapExtent;
     swapchainCreateInfo.imageArrayLayers = 1;
     swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if (surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) {
+        swapchainCreateInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    } else {
+        rendererData->hostFrameSupported = false;
+    }
     u32 queueFamilyIndices[] = {rendererData->graphicsQueueFamilyIndex, rendererData->presentQueueFamilyIndex};
     if (queueFamilyIndices[0] != queueFamilyIndices[1]) {
         swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
@@ -412,7 +665,7 @@ VkResult renderer_vulkan_create_swapchain(RendererData *rendererData) {
     swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     swapchainCreateInfo.presentMode = rendererData->presentMode;
     swapchainCreateInfo.clipped = VK_TRUE;
-    swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+    swapchainCreateInfo.oldSwapchain = oldSwapchain;
     VkResult result = vkCreateSwapchainKHR(rendererData->device, &swapchainCreateInfo, NULL, &rendererData->swapchain);
     if (result != VK_SUCCESS) {
         return result;
@@ -426,12 +679,91 @@ VkResult renderer_vulkan_create_swapchain(RendererData *rendererData) {
                                    rendererData->swapchainImages);
 }
 
+VkResult renderer_vulkan_create_offscreen_image(RendererData *rendererData, u32 index) {
+    VkImageCreateInfo imageCreateInfo;
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.pNext = NULL;
+    imageCreateInfo.flags = 0;
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.format = rendererData->surfaceFormat.format;
+    imageCreateInfo.extent.width = rendererData->swapExtent.width;
+    imageCreateInfo.extent.height = rendererData->swapExtent.height;
+    imageCreateInfo.extent.depth = 1;
+    imageCreateInfo.mipLevels = 1;
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                            VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageCreateInfo.queueFamilyIndexCount = 0;
+    imageCreateInfo.pQueueFamilyIndices = NULL;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    return renderer_vulkan_memory_create_image(&rendererData->memoryAllocator, &imageCreateInfo,
+                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                               &rendererData->swapchainImages[index],
+                                               &rendererData->offscreenImageAllocations[index]);
+}
+
+VkResult renderer_vulkan_create_readback_buffer(RendererData *rendererData, u32 index) {
+    VkBufferCreateInfo bufferCreateInfo;
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.pNext = NULL;
+    bufferCreateInfo.flags = 0;
+    bufferCreateInfo.size = (VkDeviceSize) rendererData->swapExtent.width * rendererData->swapExtent.height * 4;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 0;
+    bufferCreateInfo.pQueueFamilyIndices = NULL;
+    return renderer_vulkan_memory_create_buffer(&rendererData->memoryAllocator, &bufferCreateInfo,
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+                                                &rendererData->readbackBuffers[index],
+                                                &rendererData->readbackBufferAllocations[index]);
+}
+
+VkResult renderer_vulkan_create_offscreen_targets(RendererData *rendererData) {
+    rendererData->swapchainImageCount = MAX_FRAMES_IN_FLIGHT;
+    rendererData->swapchainImages = calloc(MAX_FRAMES_IN_FLIGHT, sizeof(VkImage));
+    rendererData->offscreenImageAllocations = calloc(MAX_FRAMES_IN_FLIGHT, sizeof(VulkanAllocation));
+    rendererData->readbackBuffers = calloc(MAX_FRAMES_IN_FLIGHT, sizeof(VkBuffer));
+    rendererData->readbackBufferAllocations = calloc(MAX_FRAMES_IN_FLIGHT, sizeof(VulkanAllocation));
+    if (rendererData->swapchainImages == NULL || rendererData->offscreenImageAllocations == NULL ||
+        rendererData->readbackBuffers == NULL || rendererData->readbackBufferAllocations == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        VkResult result = renderer_vulkan_create_offscreen_image(rendererData, i);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        result = renderer_vulkan_create_readback_buffer(rendererData, i);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+    return VK_SUCCESS;
+}
+
+void renderer_vulkan_destroy_offscreen_targets(RendererData *rendererData) {
+    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        renderer_vulkan_memory_destroy_buffer(&rendererData->memoryAllocator, rendererData->readbackBuffers[i],
+                                              &rendererData->readbackBufferAllocations[i]);
+        renderer_vulkan_memory_destroy_image(&rendererData->memoryAllocator, rendererData->swapchainImages[i],
+                                             &rendererData->offscreenImageAllocations[i]);
+    }
+    free(rendererData->readbackBufferAllocations);
+    free(rendererData->readbackBuffers);
+    free(rendererData->offscreenImageAllocations);
+}
+
 VkResult renderer_vulkan_create_swapchain_image_views(RendererData *rendererData) {
     VkResult result = VK_SUCCESS;
     if (rendererData->swapchainImageViews != NULL) {
         free(rendererData->swapchainImageViews);
     }
-    rendererData->swapchainImageViews = malloc(sizeof(VkImageView) * rendererData->swapchainImageCount);
+    rendererData->swapchainImageViews = calloc(rendererData->swapchainImageCount, sizeof(VkImageView));
     for (int i = 0; i < rendererData->swapchainImageCount; ++i) {
         VkImageViewCreateInfo imageViewCreateInfo;
         imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -458,17 +790,23 @@ VkResult renderer_vulkan_create_swapchain_image_views(RendererData *rendererData
     return result;
 }
 
-VkResult renderer_vulkan_create_render_pass(RendererData *rendererData) {
+/*
+ * The clearing pass is the default. The loading pass is compatible with it and draws on top of a host frame that was
+ * blitted into the color attachment beforehand, so the same framebuffers and pipeline serve both.
+ */
+VkResult renderer_vulkan_create_render_pass(RendererData *rendererData, VkAttachmentLoadOp loadOp,
+                                            VkImageLayout initialLayout, VkRenderPass *renderPass) {
     VkAttachmentDescription attachmentDescription;
     attachmentDescription.flags = 0;
     attachmentDescription.format = rendererData->surfaceFormat.format;
     attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-    attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachmentDescription.loadOp = loadOp;
     attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    attachmentDescription.initialLayout = initialLayout;
+    attachmentDescription.finalLayout = rendererData->headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                                               : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference attachmentReference;
     attachmentReference.attachment = 0;
@@ -486,14 +824,21 @@ VkResult renderer_vulkan_create_render_pass(RendererData *rendererData) {
     subpassDescription.preserveAttachmentCount = 0;
     subpassDescription.pPreserveAttachments = NULL;
 
-    VkSubpassDependency subpassDependency;
-    subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    subpassDependency.dstSubpass = 0;
-    subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependency.srcAccessMask = 0;
-    subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    subpassDependency.dependencyFlags = 0;
+    VkSubpassDependency subpassDependencies[2];
+    subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    subpassDependencies[0].dstSubpass = 0;
+    subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    subpassDependencies[0].srcAccessMask = 0;
+    subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    subpassDependencies[0].dependencyFlags = 0;
+    subpassDependencies[1].srcSubpass = 0;
+    subpassDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    subpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    subpassDependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    subpassDependencies[1].dependencyFlags = 0;
 
     VkRenderPassCreateInfo renderPassCreateInfo;
     renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -503,10 +848,10 @@ VkResult renderer_vulkan_create_render_pass(RendererData *rendererData) {
     renderPassCreateInfo.pAttachments = &attachmentDescription;
     renderPassCreateInfo.subpassCount = 1;
     renderPassCreateInfo.pSubpasses = &subpassDescription;
-    renderPassCreateInfo.dependencyCount = 1;
-    renderPassCreateInfo.pDependencies = &subpassDependency;
+    renderPassCreateInfo.dependencyCount = rendererData->headless ? 2 : 1;
+    renderPassCreateInfo.pDependencies = subpassDependencies;
 
-    return vkCreateRenderPass(rendererData->device, &renderPassCreateInfo, NULL, &rendererData->renderPass);
+    return vkCreateRenderPass(rendererData->device, &renderPassCreateInfo, NULL, renderPass);
 }
 
 VkShaderModule renderer_vulkan_create_shader_module(
@@ -563,14 +908,29 @@ VkResult renderer_vulkan_create_graphics_pipeline(
     dynamicStateCreateInfo.dynamicStateCount = sizeof(dynamicStates) / sizeof(VkDynamicState);
     dynamicStateCreateInfo.pDynamicStates = dynamicStates;
 
+    VkVertexInputBindingDescription vertexBindingDescription;
+    vertexBindingDescription.binding = 0;
+    vertexBindingDescription.stride = sizeof(RendererVertex);
+    vertexBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputAttributeDescription vertexAttributeDescriptions[2];
+    vertexAttributeDescriptions[0].location = 0;
+    vertexAttributeDescriptions[0].binding = 0;
+    vertexAttributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+    vertexAttributeDescriptions[0].offset = offsetof(RendererVertex, position);
+    vertexAttributeDescriptions[1].location = 1;
+    vertexAttributeDescriptions[1].binding = 0;
+    vertexAttributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+    vertexAttributeDescriptions[1].offset = offsetof(RendererVertex, color);
+
     VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo;
     vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vertexInputStateCreateInfo.pNext = NULL;
     vertexInputStateCreateInfo.flags = 0;
-    vertexInputStateCreateInfo.vertexBindingDescriptionCount = 0;
-    vertexInputStateCreateInfo.pVertexBindingDescriptions = NULL;
-    vertexInputStateCreateInfo.vertexAttributeDescriptionCount = 0;
-    vertexInputStateCreateInfo.pVertexAttributeDescriptions = NULL;
+    vertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
+    vertexInputStateCreateInfo.pVertexBindingDescriptions = &vertexBindingDescription;
+    vertexInputStateCreateInfo.vertexAttributeDescriptionCount = 2;
+    vertexInputStateCreateInfo.pVertexAttributeDescriptions = vertexAttributeDescriptions;
 
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo;
     inputAssemblyStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -651,16 +1011,40 @@ VkResult renderer_vulkan_create_graphics_pipeline(
     colorBlendStateCreateInfo.blendConstants[2] = 0.0f;
     colorBlendStateCreateInfo.blendConstants[3] = 0.0f;
 
+    VkDescriptorSetLayoutBinding instanceBufferBinding;
+    instanceBufferBinding.binding = 0;
+    instanceBufferBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    instanceBufferBinding.descriptorCount = 1;
+    instanceBufferBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    instanceBufferBinding.pImmutableSamplers = NULL;
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo;
+    descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptorSetLayoutCreateInfo.pNext = NULL;
+    descriptorSetLayoutCreateInfo.flags = 0;
+    descriptorSetLayoutCreateInfo.bindingCount = 1;
+    descriptorSetLayoutCreateInfo.pBindings = &instanceBufferBinding;
+    VkResult result = vkCreateDescriptorSetLayout(rendererData->device, &descriptorSetLayoutCreateInfo, NULL,
+                                                  &rendererData->descriptorSetLayout);
+    if (result != VK_SUCCESS) {
+        goto exit;
+    }
+
+    VkPushConstantRange pushConstantRange;
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(u32);
+
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
     pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutCreateInfo.pNext = NULL;
     pipelineLayoutCreateInfo.flags = 0;
-    pipelineLayoutCreateInfo.setLayoutCount = 0;
-    pipelineLayoutCreateInfo.pSetLayouts = NULL;
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-    pipelineLayoutCreateInfo.pPushConstantRanges = NULL;
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts = &rendererData->descriptorSetLayout;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 
-    VkResult result = vkCreatePipelineLayout(rendererData->device, &pipelineLayoutCreateInfo, NULL,
+    result = vkCreatePipelineLayout(rendererData->device, &pipelineLayoutCreateInfo, NULL,
                                              &rendererData->pipelineLayout);
     if (result != VK_SUCCESS) {
         goto exit;
@@ -687,8 +1071,8 @@ VkResult renderer_vulkan_create_graphics_pipeline(
     pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineCreateInfo.basePipelineIndex = -1;
 
-    result = vkCreateGraphicsPipelines(rendererData->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, NULL,
-                                       &rendererData->graphicsPipeline);
+    result = vkCreateGraphicsPipelines(rendererData->device, rendererData->pipelineCache, 1, &pipelineCreateInfo,
+                                       NULL, &rendererData->graphicsPipeline);
 
     exit:
     vkDestroyShaderModule(rendererData->device, fragShaderModule, NULL);
@@ -696,11 +1080,92 @@ VkResult renderer_vulkan_create_graphics_pipeline(
     return result;
 }
 
+bool renderer_vulkan_is_pipeline_cache_valid(RendererData *rendererData, const u8 *data, usize length) {
+    if (length < sizeof(PipelineCacheFileHeader) + sizeof(VkPipelineCacheHeaderVersionOne)) {
+        return false;
+    }
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(rendererData->physicalDevice, &properties);
+    PipelineCacheFileHeader fileHeader;
+    memcpy(&fileHeader, data, sizeof(PipelineCacheFileHeader));
+    if (fileHeader.magic != PIPELINE_CACHE_MAGIC ||
+        fileHeader.vendorID != properties.vendorID ||
+        fileHeader.deviceID != properties.deviceID ||
+        fileHeader.driverVersion != properties.driverVersion ||
+        memcmp(fileHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0 ||
+        fileHeader.dataSize != length - sizeof(PipelineCacheFileHeader)) {
+        return false;
+    }
+    VkPipelineCacheHeaderVersionOne cacheHeader;
+    memcpy(&cacheHeader, data + sizeof(PipelineCacheFileHeader), sizeof(VkPipelineCacheHeaderVersionOne));
+    return cacheHeader.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+           cacheHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           cacheHeader.vendorID == properties.vendorID &&
+           cacheHeader.deviceID == properties.deviceID &&
+           memcmp(cacheHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+VkResult renderer_vulkan_create_pipeline_cache(RendererData *rendererData, FileRead *pipelineCacheRead) {
+    const u8 *data = NULL;
+    usize length = 0;
+    if (file_read_wait(pipelineCacheRead) == 0 &&
+        renderer_vulkan_is_pipeline_cache_valid(rendererData, pipelineCacheRead->data, pipelineCacheRead->bytesRead)) {
+        data = pipelineCacheRead->data;
+        length = pipelineCacheRead->bytesRead;
+    }
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo;
+    pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCreateInfo.pNext = NULL;
+    pipelineCacheCreateInfo.flags = 0;
+    pipelineCacheCreateInfo.initialDataSize = data != NULL ? length - sizeof(PipelineCacheFileHeader) : 0;
+    pipelineCacheCreateInfo.pInitialData = data != NULL ? data + sizeof(PipelineCacheFileHeader) : NULL;
+    rendererData->pipelineCacheLoadedSize = pipelineCacheCreateInfo.initialDataSize;
+    VkResult result = vkCreatePipelineCache(rendererData->device, &pipelineCacheCreateInfo, NULL,
+                                            &rendererData->pipelineCache);
+    if (result != VK_SUCCESS && data != NULL) {
+        pipelineCacheCreateInfo.initialDataSize = 0;
+        pipelineCacheCreateInfo.pInitialData = NULL;
+        rendererData->pipelineCacheLoadedSize = 0;
+        result = vkCreatePipelineCache(rendererData->device, &pipelineCacheCreateInfo, NULL,
+                                       &rendererData->pipelineCache);
+    }
+    return result;
+}
+
+void renderer_vulkan_save_pipeline_cache(RendererData *rendererData) {
+    usize cacheSize = 0;
+    if (vkGetPipelineCacheData(rendererData->device, rendererData->pipelineCache, &cacheSize, NULL) != VK_SUCCESS ||
+        cacheSize == 0 || cacheSize == rendererData->pipelineCacheLoadedSize) {
+        return;
+    }
+    u8 *data = malloc(sizeof(PipelineCacheFileHeader) + cacheSize);
+    if (data == NULL) {
+        return;
+    }
+    if (vkGetPipelineCacheData(rendererData->device, rendererData->pipelineCache, &cacheSize,
+                               data + sizeof(PipelineCacheFileHeader)) == VK_SUCCESS) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(rendererData->physicalDevice, &properties);
+        PipelineCacheFileHeader fileHeader;
+        fileHeader.magic = PIPELINE_CACHE_MAGIC;
+        fileHeader.vendorID = properties.vendorID;
+        fileHeader.deviceID = properties.deviceID;
+        fileHeader.driverVersion = properties.driverVersion;
+        memcpy(fileHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+        fileHeader.dataSize = cacheSize;
+        memcpy(data, &fileHeader, sizeof(PipelineCacheFileHeader));
+        if (file_write_all_binary(PIPELINE_CACHE_PATH, sizeof(PipelineCacheFileHeader) + cacheSize, data) != 0) {
+            printf("Failed to write pipeline cache to %s\n", PIPELINE_CACHE_PATH);
+        }
+    }
+    free(data);
+}
+
 VkResult renderer_vulkan_create_framebuffers(RendererData *rendererData) {
     if (rendererData->swapchainFramebuffers != NULL) {
         free(rendererData->swapchainFramebuffers);
     }
-    rendererData->swapchainFramebuffers = malloc(sizeof(VkFramebuffer) * rendererData->swapchainImageCount);
+    rendererData->swapchainFramebuffers = calloc(rendererData->swapchainImageCount, sizeof(VkFramebuffer));
     for (int i = 0; i < rendererData->swapchainImageCount; i++) {
         VkFramebufferCreateInfo framebufferCreateInfo;
         framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -753,6 +1218,10 @@ VkResult renderer_vulkan_create_sync_objects(RendererData *rendererData) {
         free(rendererData->renderFinishedSemaphores);
     }
     rendererData->renderFinishedSemaphores = malloc(sizeof(VkSemaphore) * MAX_FRAMES_IN_FLIGHT);
+    if (rendererData->uploadFinishedSemaphores != NULL) {
+        free(rendererData->uploadFinishedSemaphores);
+    }
+    rendererData->uploadFinishedSemaphores = malloc(sizeof(VkSemaphore) * MAX_FRAMES_IN_FLIGHT);
     if (rendererData->inFlightFences != NULL) {
         free(rendererData->inFlightFences);
     }
@@ -780,6 +1249,11 @@ VkResult renderer_vulkan_create_sync_objects(RendererData *rendererData) {
         if (result != VK_SUCCESS) {
             return result;
         }
+        result = vkCreateSemaphore(rendererData->device, &semaphoreCreateInfo, NULL,
+                                   &rendererData->uploadFinishedSemaphores[i]);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
         result = vkCreateFence(rendererData->device, &fenceCreateInfo, NULL, &rendererData->inFlightFences[i]);
         if (result != VK_SUCCESS) {
             return result;
@@ -788,24 +1262,330 @@ VkResult renderer_vulkan_create_sync_objects(RendererData *rendererData) {
     return VK_SUCCESS;
 }
 
-Renderer renderer_create(
-        Window window,
+/*
+ * Two timestamps per frame in flight bracket the render pass. Queues without valid timestamp bits leave the pool
+ * null and GPU timings are simply not reported.
+ */
+VkResult renderer_vulkan_create_timestamp_query_pool(RendererData *rendererData) {
+    VkPhysicalDeviceProperties physicalDeviceProperties;
+    vkGetPhysicalDeviceProperties(rendererData->physicalDevice, &physicalDeviceProperties);
+    u32 queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(rendererData->physicalDevice, &queueFamilyCount, NULL);
+    VkQueueFamilyProperties *pQueueFamilyProperties = malloc(sizeof(VkQueueFamilyProperties) * queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(rendererData->physicalDevice, &queueFamilyCount,
+                                             pQueueFamilyProperties);
+    u32 timestampValidBits = pQueueFamilyProperties[rendererData->graphicsQueueFamilyIndex].timestampValidBits;
+    free(pQueueFamilyProperties);
+    if (timestampValidBits == 0 || physicalDeviceProperties.limits.timestampPeriod == 0.0f) {
+        return VK_SUCCESS;
+    }
+    rendererData->timestampPeriod = physicalDeviceProperties.limits.timestampPeriod;
+    rendererData->timestampMask = timestampValidBits >= 64 ? UINT64_MAX : (1ull << timestampValidBits) - 1;
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo;
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.pNext = NULL;
+    queryPoolCreateInfo.flags = 0;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = MAX_FRAMES_IN_FLIGHT * 2;
+    queryPoolCreateInfo.pipelineStatistics = 0;
+    return vkCreateQueryPool(rendererData->device, &queryPoolCreateInfo, NULL, &rendererData->timestampQueryPool);
+}
+
+/*
+ * GPU and CPU clocks are not calibrated against each other, so the render pass is placed on the CPU timeline
+ * starting at the submit that carried it. Durations are exact; start offsets are a lower bound.
+ */
+void renderer_vulkan_read_timestamps(RendererData *rendererData) {
+    u32 frame = rendererData->currentFrame;
+    if (!rendererData->timestampsWritten[frame]) {
+        return;
+    }
+    rendererData->timestampsWritten[frame] = false;
+    u64 timestamps[2];
+    VkResult result = vkGetQueryPoolResults(rendererData->device, rendererData->timestampQueryPool, frame * 2, 2,
+                                            sizeof(timestamps), timestamps, sizeof(u64), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return;
+    }
+    u64 ticks = ((timestamps[1] & rendererData->timestampMask) - (timestamps[0] & rendererData->timestampMask)) &
+                rendererData->timestampMask;
+    u64 duration = (u64) ((double) ticks * rendererData->timestampPeriod);
+    profiler_record_gpu("render pass", rendererData->submitTimes[frame],
+                        rendererData->submitTimes[frame] + duration);
+}
+
+VkResult renderer_vulkan_create_frame_arena(RendererData *rendererData, u32 frame, VkDeviceSize capacity) {
+    VkResult result = renderer_vulkan_linear_arena_create(&rendererData->memoryAllocator, capacity,
+                                                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                          VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                                          &rendererData->frameArenas[frame]);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    VkDescriptorBufferInfo descriptorBufferInfo;
+    descriptorBufferInfo.buffer = rendererData->frameArenas[frame].buffer;
+    descriptorBufferInfo.offset = 0;
+    descriptorBufferInfo.range = VK_WHOLE_SIZE;
+    VkWriteDescriptorSet writeDescriptorSet;
+    writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSet.pNext = NULL;
+    writeDescriptorSet.dstSet = rendererData->descriptorSets[frame];
+    writeDescriptorSet.dstBinding = 0;
+    writeDescriptorSet.dstArrayElement = 0;
+    writeDescriptorSet.descriptorCount = 1;
+    writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writeDescriptorSet.pImageInfo = NULL;
+    writeDescriptorSet.pBufferInfo = &descriptorBufferInfo;
+    writeDescriptorSet.pTexelBufferView = NULL;
+    vkUpdateDescriptorSets(rendererData->device, 1, &writeDescriptorSet, 0, NULL);
+    return VK_SUCCESS;
+}
+
+VkResult renderer_vulkan_create_frame_resources(RendererData *rendererData) {
+    VkDescriptorPoolSize descriptorPoolSize;
+    descriptorPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorPoolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo;
+    descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolCreateInfo.pNext = NULL;
+    descriptorPoolCreateInfo.flags = 0;
+    descriptorPoolCreateInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
+    descriptorPoolCreateInfo.poolSizeCount = 1;
+    descriptorPoolCreateInfo.pPoolSizes = &descriptorPoolSize;
+    VkResult result = vkCreateDescriptorPool(rendererData->device, &descriptorPoolCreateInfo, NULL,
+                                             &rendererData->descriptorPool);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    VkDescriptorSetLayout setLayouts[MAX_FRAMES_IN_FLIGHT];
+    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        setLayouts[i] = rendererData->descriptorSetLayout;
+    }
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo;
+    descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptorSetAllocateInfo.pNext = NULL;
+    descriptorSetAllocateInfo.descriptorPool = rendererData->descriptorPool;
+    descriptorSetAllocateInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+    descriptorSetAllocateInfo.pSetLayouts = setLayouts;
+    result = vkAllocateDescriptorSets(rendererData->device, &descriptorSetAllocateInfo, rendererData->descriptorSets);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        result = renderer_vulkan_create_frame_arena(rendererData, i, FRAME_ARENA_INITIAL_CAPACITY);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+    return VK_SUCCESS;
+}
+
+void renderer_vulkan_record_draw_range(const RecordContext *context, VkCommandBuffer commandBuffer, u32 firstBatch,
+                                       u32 batchCount) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context->pipeline);
+
+    VkViewport viewport;
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float) context->extent.width;
+    viewport.height = (float) context->extent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor;
+    VkOffset2D scissorOffset = {0, 0};
+    scissor.offset = scissorOffset;
+    scissor.extent = context->extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    if (batchCount == 0) {
+        return;
+    }
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context->pipelineLayout, 0, 1,
+                            &context->descriptorSet, 0, NULL);
+    for (u32 i = firstBatch; i < firstBatch + batchCount; i++) {
+        const DrawBatch *drawBatch = &context->drawBatches[i];
+        const MeshData *meshData = &context->meshes[drawBatch->mesh];
+        VkDeviceSize vertexBufferOffset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &meshData->vertexBuffer, &vertexBufferOffset);
+        vkCmdBindIndexBuffer(commandBuffer, meshData->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdPushConstants(commandBuffer, context->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(u32),
+                           &drawBatch->firstInstance);
+        vkCmdDrawIndexedIndirect(commandBuffer, context->indirectBuffer, drawBatch->commandOffset, 1,
+                                 sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+VkResult renderer_vulkan_record_secondary(RecordSlot *slot) {
+    const RecordContext *context = slot->context;
+    VkResult result = vkResetCommandPool(context->device, slot->commandPools[context->frame], 0);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    VkCommandBuffer commandBuffer = slot->commandBuffers[context->frame];
+    VkCommandBufferInheritanceInfo inheritanceInfo;
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.pNext = NULL;
+    inheritanceInfo.renderPass = context->renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = context->framebuffer;
+    inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+    inheritanceInfo.queryFlags = 0;
+    inheritanceInfo.pipelineStatistics = 0;
+    VkCommandBufferBeginInfo commandBufferBeginInfo;
+    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    commandBufferBeginInfo.pNext = NULL;
+    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                                   VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+    result = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    renderer_vulkan_record_draw_range(context, commandBuffer, slot->firstBatch, slot->batchCount);
+    return vkEndCommandBuffer(commandBuffer);
+}
+
+void renderer_vulkan_record_slot_job(void *arg) {
+    RecordSlot *slot = arg;
+    profiler_begin("record secondary");
+    slot->result = renderer_vulkan_record_secondary(slot);
+    profiler_end();
+}
+
+/*
+ * Every slot records one contiguous range of batches on whichever job thread picks it up. Slots own one command
+ * pool per frame in flight, and a slot is only ever recorded by one job at a time, which is all the external
+ * synchronization Vulkan asks of command pools.
+ */
+VkResult renderer_vulkan_create_record_slots(RendererData *rendererData) {
+    u32 slotCount = job_system_get_thread_count();
+    if (slotCount > MAX_RECORD_SLOTS) {
+        slotCount = MAX_RECORD_SLOTS;
+    }
+    if (slotCount < 2) {
+        return VK_SUCCESS;
+    }
+    rendererData->recordSlots = calloc(slotCount, sizeof(RecordSlot));
+    if (rendererData->recordSlots == NULL) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    rendererData->recordSlotCount = slotCount;
+    VkCommandPoolCreateInfo commandPoolCreateInfo;
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.pNext = NULL;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = rendererData->graphicsQueueFamilyIndex;
+    for (u32 i = 0; i < slotCount; i++) {
+        RecordSlot *slot = &rendererData->recordSlots[i];
+        for (u32 frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+            VkResult result = vkCreateCommandPool(rendererData->device, &commandPoolCreateInfo, NULL,
+                                                  &slot->commandPools[frame]);
+            if (result != VK_SUCCESS) {
+                return result;
+            }
+            VkCommandBufferAllocateInfo commandBufferAllocateInfo;
+            commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            commandBufferAllocateInfo.pNext = NULL;
+            commandBufferAllocateInfo.commandPool = slot->commandPools[frame];
+            commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            commandBufferAllocateInfo.commandBufferCount = 1;
+            result = vkAllocateCommandBuffers(rendererData->device, &commandBufferAllocateInfo,
+                                              &slot->commandBuffers[frame]);
+            if (result != VK_SUCCESS) {
+                return result;
+            }
+        }
+    }
+    return VK_SUCCESS;
+}
+
+void renderer_vulkan_destroy_record_slots(RendererData *rendererData) {
+    for (u32 i = 0; i < rendererData->recordSlotCount; i++) {
+        for (u32 frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+            if (rendererData->recordSlots[i].commandPools[frame] != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(rendererData->device, rendererData->recordSlots[i].commandPools[frame], NULL);
+            }
+        }
+    }
+    free(rendererData->recordSlots);
+    rendererData->recordSlots = NULL;
+    rendererData->recordSlotCount = 0;
+}
+
+VkResult renderer_vulkan_record_parallel(RendererData *rendererData, const RecordContext *context,
+                                         VkCommandBuffer commandBuffer) {
+    u32 slotCount = rendererData->recordSlotCount;
+    u32 batchesPerSlot = (rendererData->drawBatchCount + slotCount - 1) / slotCount;
+    u32 firstBatch = 0;
+    JobCounter counter;
+    job_counter_init(&counter);
+    for (u32 i = 0; i < slotCount && firstBatch < rendererData->drawBatchCount; i++) {
+        RecordSlot *slot = &rendererData->recordSlots[i];
+        u32 remainingBatchCount = rendererData->drawBatchCount - firstBatch;
+        slot->context = context;
+        slot->firstBatch = firstBatch;
+        slot->batchCount = remainingBatchCount < batchesPerSlot ? remainingBatchCount : batchesPerSlot;
+        slot->result = VK_SUCCESS;
+        firstBatch += slot->batchCount;
+        job_run(renderer_vulkan_record_slot_job, slot, &counter);
+    }
+    job_wait(&counter);
+
+    VkCommandBuffer secondaryCommandBuffers[MAX_RECORD_SLOTS];
+    u32 secondaryCommandBufferCount = 0;
+    for (u32 i = 0; i < slotCount && secondaryCommandBufferCount * batchesPerSlot < firstBatch; i++) {
+        RecordSlot *slot = &rendererData->recordSlots[i];
+        if (slot->result != VK_SUCCESS) {
+            return slot->result;
+        }
+        secondaryCommandBuffers[secondaryCommandBufferCount++] = slot->commandBuffers[context->frame];
+    }
+    vkCmdExecuteCommands(commandBuffer, secondaryCommandBufferCount, secondaryCommandBuffers);
+    return VK_SUCCESS;
+}
+
+/*
+ * Host frames are blitted, so the swapchain format must accept blits and the staging image format must allow them
+ * as a source. An sRGB staging image is used for sRGB surfaces so the blit passes the encoded values through.
+ */
+void renderer_vulkan_check_host_frame_support(RendererData *rendererData) {
+    VkFormat targetFormat = rendererData->surfaceFormat.format;
+    rendererData->hostFrameFormat = targetFormat == VK_FORMAT_B8G8R8A8_SRGB || targetFormat == VK_FORMAT_R8G8B8A8_SRGB
+                                    ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    VkFormatProperties sourceProperties;
+    VkFormatProperties targetProperties;
+    vkGetPhysicalDeviceFormatProperties(rendererData->physicalDevice, rendererData->hostFrameFormat,
+                                        &sourceProperties);
+    vkGetPhysicalDeviceFormatProperties(rendererData->physicalDevice, targetFormat, &targetProperties);
+    rendererData->hostFrameSupported = (sourceProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT) &&
+                                       (targetProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT);
+    rendererData->hostFrameFilter = sourceProperties.optimalTilingFeatures &
+                                    VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT ? VK_FILTER_LINEAR
+                                                                                      : VK_FILTER_NEAREST;
+    rendererData->hostFrameAcquired = HOST_FRAME_NONE;
+    rendererData->hostFramePending = HOST_FRAME_NONE;
+}
+
+Renderer renderer_vulkan_init_objects(
+        RendererData *rendererData,
+        FileRead *pipelineCacheRead,
         usize vertex_shader_length,
         const u32 *vertex_shader_spv,
         usize fragment_shader_length,
         const u32 *fragment_shader_spv
 ) {
-    renderer_vulkan_ensure_space_available();
-    RendererData *rendererData = &renderer_vulkan_renderers_data[renderer_vulkan_renderer_count];
-    memset(rendererData, 0, sizeof(RendererData));
-    rendererData->window = window;
     if (renderer_vulkan_create_instance(rendererData) != VK_SUCCESS) {
         return INVALID_RENDERER;
     }
-    if (renderer_vulkan_create_debug_messenger(rendererData) != VK_SUCCESS) {
+    if (rendererData->validationEnabled && renderer_vulkan_create_debug_messenger(rendererData) != VK_SUCCESS) {
         return INVALID_RENDERER;
     }
-    if (window_create_vulkan_surface(window, rendererData->instance, &rendererData->surface) != VK_SUCCESS) {
+    if (!rendererData->headless &&
+        window_create_vulkan_surface(rendererData->window, rendererData->instance, &rendererData->surface) !=
+        VK_SUCCESS) {
         return INVALID_RENDERER;
     }
     if (renderer_vulkan_find_usable_physical_device(rendererData) != VK_SUCCESS) {
@@ -814,13 +1594,38 @@ Renderer renderer_create(
     if (renderer_vulkan_create_device(rendererData) != VK_SUCCESS) {
         return INVALID_RENDERER;
     }
-    if (renderer_vulkan_create_swapchain(rendererData) != VK_SUCCESS) {
+    if (renderer_vulkan_memory_create(rendererData->physicalDevice, rendererData->device,
+                                      &rendererData->memoryAllocator) != VK_SUCCESS) {
+        return INVALID_RENDERER;
+    }
+    renderer_vulkan_check_host_frame_support(rendererData);
+    vkGetDeviceQueue(rendererData->device, rendererData->transferQueueFamilyIndex, 0, &rendererData->transferQueue);
+    if (renderer_vulkan_upload_create(&rendererData->memoryAllocator, rendererData->transferQueue,
+                                      rendererData->transferQueueFamilyIndex, UPLOAD_RING_CAPACITY,
+                                      &rendererData->uploader) != VK_SUCCESS) {
+        return INVALID_RENDERER;
+    }
+    if (rendererData->headless) {
+        if (renderer_vulkan_create_offscreen_targets(rendererData) != VK_SUCCESS) {
+            return INVALID_RENDERER;
+        }
+    } else if (renderer_vulkan_create_swapchain(rendererData, VK_NULL_HANDLE) != VK_SUCCESS) {
         return INVALID_RENDERER;
     }
     if (renderer_vulkan_create_swapchain_image_views(rendererData) != VK_SUCCESS) {
         return INVALID_RENDERER;
     }
-    if (renderer_vulkan_create_render_pass(rendererData) != VK_SUCCESS) {
+    if (renderer_vulkan_create_render_pass(rendererData, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED,
+                                           &rendererData->renderPass) != VK_SUCCESS) {
+        return INVALID_RENDERER;
+    }
+    if (rendererData->hostFrameSupported &&
+        renderer_vulkan_create_render_pass(rendererData, VK_ATTACHMENT_LOAD_OP_LOAD,
+                                           VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                           &rendererData->loadRenderPass) != VK_SUCCESS) {
+        return INVALID_RENDERER;
+    }
+    if (renderer_vulkan_create_pipeline_cache(rendererData, pipelineCacheRead) != VK_SUCCESS) {
         return INVALID_RENDERER;
     }
     if (renderer_vulkan_create_graphics_pipeline(rendererData, vertex_shader_length, vertex_shader_spv,
@@ -839,44 +1644,541 @@ Renderer renderer_create(
     if (renderer_vulkan_create_sync_objects(rendererData) != VK_SUCCESS) {
         return INVALID_RENDERER;
     }
+    if (renderer_vulkan_create_timestamp_query_pool(rendererData) != VK_SUCCESS) {
+        return INVALID_RENDERER;
+    }
+    if (renderer_vulkan_create_frame_resources(rendererData) != VK_SUCCESS) {
+        return INVALID_RENDERER;
+    }
+    if (renderer_vulkan_create_record_slots(rendererData) != VK_SUCCESS) {
+        return INVALID_RENDERER;
+    }
     rendererData->currentFrame = 0;
+    rendererData->lastSubmittedFrame = MAX_FRAMES_IN_FLIGHT;
     vkGetDeviceQueue(rendererData->device, rendererData->graphicsQueueFamilyIndex, 0, &rendererData->graphicsQueue);
     vkGetDeviceQueue(rendererData->device, rendererData->presentQueueFamilyIndex, 0, &rendererData->presentQueue);
     return renderer_vulkan_renderer_count++;
 }
 
-void renderer_reload(Renderer renderer) {
-    if (renderer == INVALID_RENDERER) {
-        return;
+/* The pipeline cache is read in the background while the instance and device are created. */
+Renderer renderer_vulkan_init(
+        RendererData *rendererData,
+        usize vertex_shader_length,
+        const u32 *vertex_shader_spv,
+        usize fragment_shader_length,
+        const u32 *fragment_shader_spv
+) {
+    FileRead pipelineCacheRead;
+    file_read_all_async(PIPELINE_CACHE_PATH, &pipelineCacheRead);
+    Renderer renderer = renderer_vulkan_init_objects(rendererData, &pipelineCacheRead, vertex_shader_length,
+                                                     vertex_shader_spv, fragment_shader_length, fragment_shader_spv);
+    file_read_wait(&pipelineCacheRead);
+    free(pipelineCacheRead.data);
+    return renderer;
+}
+
+Renderer renderer_create(
+        Window window,
+        usize vertex_shader_length,
+        const u32 *vertex_shader_spv,
+        usize fragment_shader_length,
+        const u32 *fragment_shader_spv
+) {
+    RendererData *rendererData = renderer_vulkan_allocate_renderer();
+    if (rendererData == NULL) {
+        return INVALID_RENDERER;
     }
-    RendererData *rendererData = &renderer_vulkan_renderers_data[renderer];
-    vkDeviceWaitIdle(rendererData->device);
-    for (int i = 0; i < rendererData->swapchainImageCount; i++) {
-        vkDestroyFramebuffer(rendererData->device, rendererData->swapchainFramebuffers[i], NULL);
-        vkDestroyImageView(rendererData->device, rendererData->swapchainImageViews[i], NULL);
+    rendererData->window = window;
+    window_get_size_in_pixels(window, &rendererData->windowWidth, &rendererData->windowHeight);
+    rendererData->headless = false;
+    return renderer_vulkan_init(rendererData, vertex_shader_length, vertex_shader_spv, fragment_shader_length,
+                                fragment_shader_spv);
+}
+
+Renderer renderer_create_headless(
+        u32 width,
+        u32 height,
+        usize vertex_shader_length,
+        const u32 *vertex_shader_spv,
+        usize fragment_shader_length,
+        const u32 *fragment_shader_spv
+) {
+    if (width == 0 || height == 0) {
+        return INVALID_RENDERER;
     }
-    vkDestroySwapchainKHR(rendererData->device, rendererData->swapchain, NULL);
-    renderer_vulkan_create_swapchain(rendererData);
-    renderer_vulkan_create_swapchain_image_views(rendererData);
-    renderer_vulkan_create_framebuffers(rendererData);
+    RendererData *rendererData = renderer_vulkan_allocate_renderer();
+    if (rendererData == NULL) {
+        return INVALID_RENDERER;
+    }
+    rendererData->headless = true;
+    rendererData->swapExtent.width = width;
+    rendererData->swapExtent.height = height;
+    return renderer_vulkan_init(rendererData, vertex_shader_length, vertex_shader_spv, fragment_shader_length,
+                                fragment_shader_spv);
 }
 
-VkResult renderer_vulkan_record_command_buffer(RendererData *rendererData, uint32_t imageIndex) {
-    VkCommandBuffer commandBuffer = rendererData->commandBuffers[rendererData->currentFrame];
+void renderer_vulkan_destroy_swapchain_resources(RendererData *rendererData, u32 imageCount, VkImageView *imageViews,
+                                                 VkFramebuffer *framebuffers) {
+    for (int i = 0; i < imageCount; i++) {
+        vkDestroyFramebuffer(rendererData->device, framebuffers[i], NULL);
+        vkDestroyImageView(rendererData->device, imageViews[i], NULL);
+    }
+    free(framebuffers);
+    free(imageViews);
+}
 
-    VkCommandBufferBeginInfo commandBufferBeginInfo;
-    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    commandBufferBeginInfo.pNext = NULL;
-    commandBufferBeginInfo.flags = 0;
-    commandBufferBeginInfo.pInheritanceInfo = NULL;
-    VkResult result = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
-    if (result != VK_SUCCESS) {
-        return result;
+void renderer_vulkan_retire_swapchain(RendererData *rendererData) {
+    if (rendererData->retiredSwapchainCount == rendererData->retiredSwapchainLimit) {
+        rendererData->retiredSwapchainLimit = rendererData->retiredSwapchainLimit * 2 + 1;
+        rendererData->retiredSwapchains = realloc(rendererData->retiredSwapchains,
+                                                  sizeof(RetiredSwapchain) * rendererData->retiredSwapchainLimit);
     }
-    VkRenderPassBeginInfo renderPassBeginInfo;
-    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    RetiredSwapchain *retiredSwapchain = &rendererData->retiredSwapchains[rendererData->retiredSwapchainCount++];
+    retiredSwapchain->swapchain = rendererData->swapchain;
+    retiredSwapchain->imageCount = rendererData->swapchainImageCount;
+    retiredSwapchain->imageViews = rendererData->swapchainImageViews;
+    retiredSwapchain->framebuffers = rendererData->swapchainFramebuffers;
+    retiredSwapchain->lastUsedFrameNumber = rendererData->frameNumber;
+    rendererData->swapchain = VK_NULL_HANDLE;
+    rendererData->swapchainImageViews = NULL;
+    rendererData->swapchainFramebuffers = NULL;
+}
+
+void renderer_vulkan_release_retired_swapchains(RendererData *rendererData, bool force) {
+    u32 keptCount = 0;
+    for (u32 i = 0; i < rendererData->retiredSwapchainCount; i++) {
+        RetiredSwapchain *retiredSwapchain = &rendererData->retiredSwapchains[i];
+        if (force || retiredSwapchain->lastUsedFrameNumber <= rendererData->completedFrameNumber) {
+            renderer_vulkan_destroy_swapchain_resources(rendererData, retiredSwapchain->imageCount,
+                                                        retiredSwapchain->imageViews, retiredSwapchain->framebuffers);
+            vkDestroySwapchainKHR(rendererData->device, retiredSwapchain->swapchain, NULL);
+        } else {
+            rendererData->retiredSwapchains[keptCount++] = *retiredSwapchain;
+        }
+    }
+    rendererData->retiredSwapchainCount = keptCount;
+}
+
+/*
+ * A minimized window has a zero extent, for which no swapchain can be created. The old one is kept, the renderer stays
+ * out of date and frames are skipped until the window has an area again.
+ */
+VkResult renderer_vulkan_recreate_swapchain(RendererData *rendererData) {
+    VkSurfaceCapabilitiesKHR surfaceCapabilities;
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(rendererData->physicalDevice, rendererData->surface,
+                                              &surfaceCapabilities);
+    VkExtent2D extent;
+    renderer_vulkan_choose_swap_extent(rendererData->windowWidth, rendererData->windowHeight, &surfaceCapabilities,
+                                       &extent);
+    if (extent.width == 0 || extent.height == 0) {
+        rendererData->swapchainOutOfDate = true;
+        return VK_NOT_READY;
+    }
+    rendererData->swapchainOutOfDate = false;
+    VkSwapchainKHR oldSwapchain = rendererData->swapchain;
+    if (oldSwapchain != VK_NULL_HANDLE) {
+        renderer_vulkan_retire_swapchain(rendererData);
+    }
+    VkResult result = renderer_vulkan_create_swapchain(rendererData, oldSwapchain);
+    if (result != VK_SUCCESS) {
+        rendererData->swapchainOutOfDate = true;
+        return result;
+    }
+    result = renderer_vulkan_create_swapchain_image_views(rendererData);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    return renderer_vulkan_create_framebuffers(rendererData);
+}
+
+void renderer_reload(Renderer renderer) {
+    if (renderer == INVALID_RENDERER) {
+        return;
+    }
+    RendererData *rendererData = renderer_vulkan_renderers_data[renderer];
+    if (rendererData->headless) {
+        return;
+    }
+    window_get_size_in_pixels(rendererData->window, &rendererData->windowWidth, &rendererData->windowHeight);
+    rendererData->swapchainOutOfDate = true;
+}
+
+/*
+ * Unlike renderer_reload this never reads the window, so a renderer driven from another thread than the window's
+ * can be told the new size without racing the event loop.
+ */
+void renderer_resize(Renderer renderer, u32 width, u32 height) {
+    if (renderer == INVALID_RENDERER) {
+        return;
+    }
+    RendererData *rendererData = renderer_vulkan_renderers_data[renderer];
+    if (rendererData->headless) {
+        return;
+    }
+    rendererData->windowWidth = width;
+    rendererData->windowHeight = height;
+    rendererData->swapchainOutOfDate = true;
+}
+
+VkResult renderer_vulkan_create_mesh_buffer(RendererData *rendererData, VkDeviceSize size, VkBufferUsageFlags usage,
+                                           VkBuffer *buffer, VulkanAllocation *allocation) {
+    u32 queueFamilyIndices[] = {rendererData->graphicsQueueFamilyIndex, rendererData->transferQueueFamilyIndex};
+    VkBufferCreateInfo bufferCreateInfo;
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.pNext = NULL;
+    bufferCreateInfo.flags = 0;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if (rendererData->graphicsQueueFamilyIndex != rendererData->transferQueueFamilyIndex) {
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferCreateInfo.queueFamilyIndexCount = 2;
+        bufferCreateInfo.pQueueFamilyIndices = queueFamilyIndices;
+    } else {
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        bufferCreateInfo.queueFamilyIndexCount = 0;
+        bufferCreateInfo.pQueueFamilyIndices = NULL;
+    }
+    return renderer_vulkan_memory_create_buffer(&rendererData->memoryAllocator, &bufferCreateInfo,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, buffer, allocation);
+}
+
+void renderer_vulkan_release_mesh(RendererData *rendererData, MeshData *meshData) {
+    if (meshData->vertexBuffer != VK_NULL_HANDLE) {
+        renderer_vulkan_memory_destroy_buffer(&rendererData->memoryAllocator, meshData->vertexBuffer,
+                                              &meshData->vertexAllocation);
+    }
+    if (meshData->indexBuffer != VK_NULL_HANDLE) {
+        renderer_vulkan_memory_destroy_buffer(&rendererData->memoryAllocator, meshData->indexBuffer,
+                                              &meshData->indexAllocation);
+    }
+    memset(meshData, 0, sizeof(MeshData));
+}
+
+void renderer_vulkan_release_destroyed_meshes(RendererData *rendererData) {
+    for (u32 i = 0; i < rendererData->meshCount; i++) {
+        MeshData *meshData = &rendererData->meshes[i];
+        if (meshData->alive && meshData->destroyed &&
+            meshData->lastUsedFrameNumber <= rendererData->completedFrameNumber) {
+            renderer_vulkan_release_mesh(rendererData, meshData);
+        }
+    }
+}
+
+/*
+ * Groups the queued draws by mesh, writes the instances of each group contiguously at the start of the frame arena
+ * and emits one indirect command per group.
+ */
+VkResult renderer_vulkan_prepare_draw_batches(RendererData *rendererData) {
+    rendererData->drawBatchCount = 0;
+    if (rendererData->drawItemCount == 0) {
+        return VK_SUCCESS;
+    }
+    u32 frame = rendererData->currentFrame;
+    VkDeviceSize requiredCapacity = (VkDeviceSize) rendererData->drawItemCount *
+                                    (sizeof(RendererInstance) + sizeof(VkDrawIndexedIndirectCommand)) + 16;
+    if (requiredCapacity > rendererData->frameArenas[frame].capacity) {
+        VkDeviceSize capacity = rendererData->frameArenas[frame].capacity;
+        if (capacity < FRAME_ARENA_INITIAL_CAPACITY) {
+            capacity = FRAME_ARENA_INITIAL_CAPACITY;
+        }
+        while (capacity < requiredCapacity) {
+            capacity *= 2;
+        }
+        renderer_vulkan_linear_arena_destroy(&rendererData->memoryAllocator, &rendererData->frameArenas[frame]);
+        VkResult result = renderer_vulkan_create_frame_arena(rendererData, frame, capacity);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+    if (rendererData->drawBatchLimit < rendererData->meshCount) {
+        DrawBatch *drawBatches = realloc(rendererData->drawBatches, sizeof(DrawBatch) * rendererData->meshCount);
+        if (drawBatches == NULL) {
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+        rendererData->drawBatches = drawBatches;
+        rendererData->drawBatchLimit = rendererData->meshCount;
+    }
+    if (rendererData->meshBatchIndexLimit < rendererData->meshCount) {
+        u32 *meshBatchIndices = realloc(rendererData->meshBatchIndices, sizeof(u32) * rendererData->meshCount);
+        if (meshBatchIndices == NULL) {
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+        rendererData->meshBatchIndices = meshBatchIndices;
+        rendererData->meshBatchIndexLimit = rendererData->meshCount;
+    }
+    memset(rendererData->meshBatchIndices, 0xFF, sizeof(u32) * rendererData->meshCount);
+    for (u32 i = 0; i < rendererData->drawItemCount; i++) {
+        Mesh mesh = rendererData->drawItems[i].mesh;
+        if (rendererData->meshBatchIndices[mesh] == INVALID_MESH) {
+            rendererData->meshBatchIndices[mesh] = rendererData->drawBatchCount;
+            DrawBatch *drawBatch = &rendererData->drawBatches[rendererData->drawBatchCount++];
+            drawBatch->mesh = mesh;
+            drawBatch->instanceCount = 0;
+        }
+        rendererData->drawBatches[rendererData->meshBatchIndices[mesh]].instanceCount++;
+    }
+
+    VulkanLinearArena *arena = &rendererData->frameArenas[frame];
+    renderer_vulkan_linear_arena_reset(arena);
+    VkDeviceSize instanceOffset;
+    RendererInstance *instances = renderer_vulkan_linear_arena_allocate(
+            arena, (VkDeviceSize) rendererData->drawItemCount * sizeof(RendererInstance), 16, &instanceOffset);
+    VkDeviceSize commandOffset;
+    VkDrawIndexedIndirectCommand *commands = renderer_vulkan_linear_arena_allocate(
+            arena, (VkDeviceSize) rendererData->drawBatchCount * sizeof(VkDrawIndexedIndirectCommand), 4,
+            &commandOffset);
+    u32 firstInstance = 0;
+    for (u32 i = 0; i < rendererData->drawBatchCount; i++) {
+        DrawBatch *drawBatch = &rendererData->drawBatches[i];
+        drawBatch->firstInstance = firstInstance;
+        drawBatch->commandOffset = commandOffset + i * sizeof(VkDrawIndexedIndirectCommand);
+        commands[i].indexCount = rendererData->meshes[drawBatch->mesh].indexCount;
+        commands[i].instanceCount = drawBatch->instanceCount;
+        commands[i].firstIndex = 0;
+        commands[i].vertexOffset = 0;
+        commands[i].firstInstance = 0;
+        firstInstance += drawBatch->instanceCount;
+        drawBatch->instanceCount = 0;
+    }
+    for (u32 i = 0; i < rendererData->drawItemCount; i++) {
+        DrawItem *drawItem = &rendererData->drawItems[i];
+        DrawBatch *drawBatch = &rendererData->drawBatches[rendererData->meshBatchIndices[drawItem->mesh]];
+        instances[drawBatch->firstInstance + drawBatch->instanceCount++] = drawItem->instance;
+    }
+    return VK_SUCCESS;
+}
+
+void renderer_vulkan_wait_for_frame_number(RendererData *rendererData, u64 frameNumber) {
+    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        u64 inFlightFrameNumber = rendererData->frameNumbers[i];
+        if (inFlightFrameNumber <= rendererData->completedFrameNumber || inFlightFrameNumber > frameNumber) {
+            continue;
+        }
+        vkWaitForFences(rendererData->device, 1, &rendererData->inFlightFences[i], VK_TRUE, UINT64_MAX);
+        if (inFlightFrameNumber > rendererData->completedFrameNumber) {
+            rendererData->completedFrameNumber = inFlightFrameNumber;
+        }
+    }
+}
+
+void renderer_vulkan_destroy_host_frame_image(RendererData *rendererData) {
+    if (rendererData->hostFrameImage != VK_NULL_HANDLE) {
+        renderer_vulkan_memory_destroy_image(&rendererData->memoryAllocator, rendererData->hostFrameImage,
+                                             &rendererData->hostFrameImageAllocation);
+        rendererData->hostFrameImage = VK_NULL_HANDLE;
+    }
+    rendererData->hostFrameImageWidth = 0;
+    rendererData->hostFrameImageHeight = 0;
+    rendererData->hostFrameImageReady = false;
+}
+
+/* Only called when the host frame size changes, so waiting for every frame in flight is acceptable. */
+VkResult renderer_vulkan_create_host_frame_image(RendererData *rendererData, u32 width, u32 height) {
+    renderer_vulkan_wait_for_frame_number(rendererData, rendererData->frameNumber);
+    renderer_vulkan_destroy_host_frame_image(rendererData);
+    VkImageCreateInfo imageCreateInfo;
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.pNext = NULL;
+    imageCreateInfo.flags = 0;
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.format = rendererData->hostFrameFormat;
+    imageCreateInfo.extent.width = width;
+    imageCreateInfo.extent.height = height;
+    imageCreateInfo.extent.depth = 1;
+    imageCreateInfo.mipLevels = 1;
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageCreateInfo.queueFamilyIndexCount = 0;
+    imageCreateInfo.pQueueFamilyIndices = NULL;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkResult result = renderer_vulkan_memory_create_image(&rendererData->memoryAllocator, &imageCreateInfo,
+                                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                          &rendererData->hostFrameImage,
+                                                          &rendererData->hostFrameImageAllocation);
+    if (result != VK_SUCCESS) {
+        rendererData->hostFrameImage = VK_NULL_HANDLE;
+        return result;
+    }
+    rendererData->hostFrameImageWidth = width;
+    rendererData->hostFrameImageHeight = height;
+    return VK_SUCCESS;
+}
+
+void renderer_vulkan_image_barrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout,
+                                   VkImageLayout newLayout, VkPipelineStageFlags srcStageMask,
+                                   VkAccessFlags srcAccessMask, VkPipelineStageFlags dstStageMask,
+                                   VkAccessFlags dstAccessMask) {
+    VkImageMemoryBarrier imageMemoryBarrier;
+    imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageMemoryBarrier.pNext = NULL;
+    imageMemoryBarrier.srcAccessMask = srcAccessMask;
+    imageMemoryBarrier.dstAccessMask = dstAccessMask;
+    imageMemoryBarrier.oldLayout = oldLayout;
+    imageMemoryBarrier.newLayout = newLayout;
+    imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.image = image;
+    imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
+    imageMemoryBarrier.subresourceRange.levelCount = 1;
+    imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+    imageMemoryBarrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier);
+}
+
+/*
+ * Copies a newly submitted host frame into the host frame image, then blits the latest host frame over the whole
+ * color attachment. Returns false when there is nothing to show, in which case the render pass clears as usual.
+ * The copy only waits for earlier blits out of the same image, so the CPU is free to fill the next staging buffer.
+ */
+bool renderer_vulkan_record_host_frame(RendererData *rendererData, VkCommandBuffer commandBuffer, u32 imageIndex) {
+    if (rendererData->hostFramePending != HOST_FRAME_NONE) {
+        HostFrameStaging *staging = &rendererData->hostFrameStagings[rendererData->hostFramePending];
+        rendererData->hostFramePending = HOST_FRAME_NONE;
+        if ((rendererData->hostFrameImageWidth != staging->width ||
+             rendererData->hostFrameImageHeight != staging->height) &&
+            renderer_vulkan_create_host_frame_image(rendererData, staging->width, staging->height) != VK_SUCCESS) {
+            return false;
+        }
+        renderer_vulkan_image_barrier(commandBuffer, rendererData->hostFrameImage, VK_IMAGE_LAYOUT_UNDEFINED,
+                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+        VkBufferImageCopy region;
+        region.bufferOffset = 0;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        VkOffset3D imageOffset = {0, 0, 0};
+        region.imageOffset = imageOffset;
+        region.imageExtent.width = staging->width;
+        region.imageExtent.height = staging->height;
+        region.imageExtent.depth = 1;
+        vkCmdCopyBufferToImage(commandBuffer, staging->buffer, rendererData->hostFrameImage,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        renderer_vulkan_image_barrier(commandBuffer, rendererData->hostFrameImage,
+                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        staging->lastUsedFrameNumber = rendererData->frameNumber + 1;
+        rendererData->hostFrameImageReady = true;
+    }
+    if (!rendererData->hostFrameImageReady) {
+        return false;
+    }
+
+    /* Chained to the image available semaphore, which the submit waits on at the color attachment output stage. */
+    VkImage targetImage = rendererData->swapchainImages[imageIndex];
+    renderer_vulkan_image_barrier(commandBuffer, targetImage, VK_IMAGE_LAYOUT_UNDEFINED,
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                  0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    VkImageBlit blit;
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.mipLevel = 0;
+    blit.srcSubresource.baseArrayLayer = 0;
+    blit.srcSubresource.layerCount = 1;
+    blit.srcOffsets[0].x = 0;
+    blit.srcOffsets[0].y = 0;
+    blit.srcOffsets[0].z = 0;
+    blit.srcOffsets[1].x = (i32) rendererData->hostFrameImageWidth;
+    blit.srcOffsets[1].y = (i32) rendererData->hostFrameImageHeight;
+    blit.srcOffsets[1].z = 1;
+    blit.dstSubresource = blit.srcSubresource;
+    blit.dstOffsets[0] = blit.srcOffsets[0];
+    blit.dstOffsets[1].x = (i32) rendererData->swapExtent.width;
+    blit.dstOffsets[1].y = (i32) rendererData->swapExtent.height;
+    blit.dstOffsets[1].z = 1;
+    vkCmdBlitImage(commandBuffer, rendererData->hostFrameImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, targetImage,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, rendererData->hostFrameFilter);
+    renderer_vulkan_image_barrier(commandBuffer, targetImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                  VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                  VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+    return true;
+}
+
+void renderer_vulkan_record_readback(RendererData *rendererData, VkCommandBuffer commandBuffer, u32 imageIndex) {
+    VkBufferImageCopy region;
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    VkOffset3D imageOffset = {0, 0, 0};
+    region.imageOffset = imageOffset;
+    region.imageExtent.width = rendererData->swapExtent.width;
+    region.imageExtent.height = rendererData->swapExtent.height;
+    region.imageExtent.depth = 1;
+    vkCmdCopyImageToBuffer(commandBuffer, rendererData->swapchainImages[imageIndex],
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, rendererData->readbackBuffers[imageIndex], 1,
+                           &region);
+
+    VkBufferMemoryBarrier bufferMemoryBarrier;
+    bufferMemoryBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferMemoryBarrier.pNext = NULL;
+    bufferMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferMemoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferMemoryBarrier.buffer = rendererData->readbackBuffers[imageIndex];
+    bufferMemoryBarrier.offset = 0;
+    bufferMemoryBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, NULL, 1,
+                         &bufferMemoryBarrier, 0, NULL);
+}
+
+VkResult renderer_vulkan_record_command_buffer(RendererData *rendererData, uint32_t imageIndex) {
+    VkCommandBuffer commandBuffer = rendererData->commandBuffers[rendererData->currentFrame];
+    if (renderer_vulkan_prepare_draw_batches(rendererData) != VK_SUCCESS) {
+        rendererData->drawBatchCount = 0;
+    }
+    bool parallel = rendererData->recordSlotCount > 1 &&
+                    rendererData->drawBatchCount >= PARALLEL_RECORD_MIN_BATCHES;
+
+    RecordContext recordContext;
+    RecordContext *context = &recordContext;
+    context->device = rendererData->device;
+    context->renderPass = rendererData->renderPass;
+    context->framebuffer = rendererData->swapchainFramebuffers[imageIndex];
+    context->pipeline = rendererData->graphicsPipeline;
+    context->pipelineLayout = rendererData->pipelineLayout;
+    context->descriptorSet = rendererData->descriptorSets[rendererData->currentFrame];
+    context->extent = rendererData->swapExtent;
+    context->indirectBuffer = rendererData->frameArenas[rendererData->currentFrame].buffer;
+    context->drawBatches = rendererData->drawBatches;
+    context->meshes = rendererData->meshes;
+    context->frame = rendererData->currentFrame;
+
+    VkCommandBufferBeginInfo commandBufferBeginInfo;
+    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    commandBufferBeginInfo.pNext = NULL;
+    commandBufferBeginInfo.flags = 0;
+    commandBufferBeginInfo.pInheritanceInfo = NULL;
+    VkResult result = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    if (rendererData->hostFrameSupported && renderer_vulkan_record_host_frame(rendererData, commandBuffer, imageIndex)) {
+        context->renderPass = rendererData->loadRenderPass;
+    }
+    u32 queryIndex = rendererData->currentFrame * 2;
+    bool writeTimestamps = rendererData->timestampQueryPool != VK_NULL_HANDLE && profiler_is_enabled();
+    if (writeTimestamps) {
+        vkCmdResetQueryPool(commandBuffer, rendererData->timestampQueryPool, queryIndex, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, rendererData->timestampQueryPool,
+                            queryIndex);
+    }
+    VkRenderPassBeginInfo renderPassBeginInfo;
+    renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassBeginInfo.pNext = NULL;
-    renderPassBeginInfo.renderPass = rendererData->renderPass;
+    renderPassBeginInfo.renderPass = context->renderPass;
     renderPassBeginInfo.framebuffer = rendererData->swapchainFramebuffers[imageIndex];
     VkOffset2D renderAreaOffset = {0, 0};
     renderPassBeginInfo.renderArea.offset = renderAreaOffset;
@@ -884,62 +2186,200 @@ VkResult renderer_vulkan_record_command_buffer(RendererData *rendererData, uint3
     VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
     renderPassBeginInfo.clearValueCount = 1;
     renderPassBeginInfo.pClearValues = &clearColor;
-    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, rendererData->graphicsPipeline);
-
-    VkViewport viewport;
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float) rendererData->swapExtent.width;
-    viewport.height = (float) rendererData->swapExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    if (parallel) {
+        vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        result = renderer_vulkan_record_parallel(rendererData, context, commandBuffer);
+    } else {
+        vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        renderer_vulkan_record_draw_range(context, commandBuffer, 0, rendererData->drawBatchCount);
+    }
+    vkCmdEndRenderPass(commandBuffer);
+    if (writeTimestamps) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, rendererData->timestampQueryPool,
+                            queryIndex + 1);
+    }
+    rendererData->timestampsWritten[rendererData->currentFrame] = writeTimestamps;
+    if (rendererData->headless) {
+        renderer_vulkan_record_readback(rendererData, commandBuffer, imageIndex);
+    }
+    VkResult endResult = vkEndCommandBuffer(commandBuffer);
+    return result != VK_SUCCESS ? result : endResult;
+}
 
-    VkRect2D scissor;
-    VkOffset2D scissorOffset = {0, 0};
-    scissor.offset = scissorOffset;
-    scissor.extent = rendererData->swapExtent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
-    vkCmdEndRenderPass(commandBuffer);
-    return vkEndCommandBuffer(commandBuffer);
+void renderer_vulkan_wait_for_frame(RendererData *rendererData) {
+    VkFence inFlightFence = rendererData->inFlightFences[rendererData->currentFrame];
+    profiler_begin("wait for frame");
+    vkWaitForFences(rendererData->device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+    profiler_end();
+    if (rendererData->frameNumbers[rendererData->currentFrame] > rendererData->completedFrameNumber) {
+        rendererData->completedFrameNumber = rendererData->frameNumbers[rendererData->currentFrame];
+    }
+    renderer_vulkan_read_timestamps(rendererData);
+    renderer_vulkan_release_destroyed_meshes(rendererData);
 }
 
-void renderer_draw_frame(Renderer renderer) {
-    if (renderer == INVALID_RENDERER) {
+/*
+ * Called when a frame fails after some of its wait semaphores were signaled. A batch without command buffers waits on
+ * them so that none is left with a signal nothing consumes, and with signalFence it also signals the in-flight fence
+ * that was reset for the failed submit. Should even that submit fail, the fence is recreated signaled, so the next
+ * renderer_vulkan_wait_for_frame on this slot cannot block forever.
+ */
+void renderer_vulkan_abandon_frame(RendererData *rendererData, const VkSemaphore *waitSemaphores,
+                                   u32 waitSemaphoreCount, bool signalFence) {
+    VkFence *inFlightFence = &rendererData->inFlightFences[rendererData->currentFrame];
+    if (waitSemaphoreCount == 0 && !signalFence) {
+        return;
+    }
+    VkPipelineStageFlags waitStages[2] = {VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+    VkSubmitInfo submitInfo;
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = NULL;
+    submitInfo.waitSemaphoreCount = waitSemaphoreCount;
+    submitInfo.pWaitSemaphores = waitSemaphores;
+    submitInfo.pWaitDstStageMask = waitStages;
+    submitInfo.commandBufferCount = 0;
+    submitInfo.pCommandBuffers = NULL;
+    submitInfo.signalSemaphoreCount = 0;
+    submitInfo.pSignalSemaphores = NULL;
+    VkResult result = vkQueueSubmit(rendererData->graphicsQueue, 1, &submitInfo,
+                                    signalFence ? *inFlightFence : VK_NULL_HANDLE);
+    if (result == VK_SUCCESS || !signalFence) {
         return;
     }
-    RendererData *rendererData = &renderer_vulkan_renderers_data[renderer];
+    VkFenceCreateInfo fenceCreateInfo;
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceCreateInfo.pNext = NULL;
+    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    VkFence fence;
+    if (vkCreateFence(rendererData->device, &fenceCreateInfo, NULL, &fence) == VK_SUCCESS) {
+        vkDestroyFence(rendererData->device, *inFlightFence, NULL);
+        *inFlightFence = fence;
+    }
+}
+
+VkResult renderer_vulkan_submit_frame(RendererData *rendererData, VkSemaphore imageAvailableSemaphore,
+                                      VkSemaphore renderFinishedSemaphore) {
     VkCommandBuffer commandBuffer = rendererData->commandBuffers[rendererData->currentFrame];
-    VkSemaphore imageAvailableSemaphore = rendererData->imageAvailableSemaphores[rendererData->currentFrame];
-    VkSemaphore renderFinishedSemaphore = rendererData->renderFinishedSemaphores[rendererData->currentFrame];
     VkFence inFlightFence = rendererData->inFlightFences[rendererData->currentFrame];
-
-    vkWaitForFences(rendererData->device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
-    uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(rendererData->device, rendererData->swapchain, UINT64_MAX,
-                                            imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-        return;
+    VkSemaphore waitSemaphores[2];
+    VkPipelineStageFlags waitStages[2];
+    u32 waitSemaphoreCount = 0;
+    if (imageAvailableSemaphore != VK_NULL_HANDLE) {
+        waitSemaphores[waitSemaphoreCount] = imageAvailableSemaphore;
+        waitStages[waitSemaphoreCount++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    }
+    bool uploadSignaled;
+    VkSemaphore uploadFinishedSemaphore = rendererData->uploadFinishedSemaphores[rendererData->currentFrame];
+    VkResult result = renderer_vulkan_upload_submit(&rendererData->uploader, uploadFinishedSemaphore,
+                                                    &uploadSignaled);
+    if (result != VK_SUCCESS) {
+        renderer_vulkan_abandon_frame(rendererData, waitSemaphores, waitSemaphoreCount, false);
+        return result;
+    }
+    if (uploadSignaled) {
+        waitSemaphores[waitSemaphoreCount] = uploadFinishedSemaphore;
+        waitStages[waitSemaphoreCount++] = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
     }
-    vkResetFences(rendererData->device, 1, &inFlightFence);
-    vkResetCommandBuffer(commandBuffer, 0);
-    renderer_vulkan_record_command_buffer(rendererData, imageIndex);
 
     VkSubmitInfo submitInfo;
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.pNext = NULL;
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &imageAvailableSemaphore;
+    submitInfo.waitSemaphoreCount = waitSemaphoreCount;
+    submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = renderFinishedSemaphore != VK_NULL_HANDLE ? 1 : 0;
     submitInfo.pSignalSemaphores = &renderFinishedSemaphore;
-    vkQueueSubmit(rendererData->graphicsQueue, 1, &submitInfo, inFlightFence);
+    vkResetFences(rendererData->device, 1, &inFlightFence);
+    rendererData->submitTimes[rendererData->currentFrame] = timer_get_time_ns();
+    result = vkQueueSubmit(rendererData->graphicsQueue, 1, &submitInfo, inFlightFence);
+    if (result != VK_SUCCESS) {
+        renderer_vulkan_abandon_frame(rendererData, waitSemaphores, waitSemaphoreCount, true);
+        return result;
+    }
+    rendererData->frameNumbers[rendererData->currentFrame] = ++rendererData->frameNumber;
+    for (u32 i = 0; i < rendererData->drawBatchCount; i++) {
+        rendererData->meshes[rendererData->drawBatches[i].mesh].lastUsedFrameNumber = rendererData->frameNumber;
+    }
+    return VK_SUCCESS;
+}
+
+/*
+ * The in-flight fence is only reset right before the submit that signals it, and renderer_vulkan_submit_frame signals
+ * it through renderer_vulkan_abandon_frame when that submit fails, so a failed frame never leaves the next one waiting
+ * forever.
+ */
+bool renderer_vulkan_draw_headless_frame(RendererData *rendererData) {
+    VkCommandBuffer commandBuffer = rendererData->commandBuffers[rendererData->currentFrame];
+
+    renderer_vulkan_wait_for_frame(rendererData);
+    vkResetCommandBuffer(commandBuffer, 0);
+    profiler_begin("record");
+    VkResult result = renderer_vulkan_record_command_buffer(rendererData, rendererData->currentFrame);
+    profiler_end();
+    if (result != VK_SUCCESS) {
+        return false;
+    }
+    profiler_begin("submit");
+    result = renderer_vulkan_submit_frame(rendererData, VK_NULL_HANDLE, VK_NULL_HANDLE);
+    profiler_end();
+    if (result != VK_SUCCESS) {
+        return false;
+    }
+
+    rendererData->lastSubmittedFrame = rendererData->currentFrame;
+    rendererData->currentFrame = (rendererData->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    return true;
+}
+
+bool renderer_vulkan_draw_windowed_frame(RendererData *rendererData) {
+    VkCommandBuffer commandBuffer = rendererData->commandBuffers[rendererData->currentFrame];
+    VkSemaphore imageAvailableSemaphore = rendererData->imageAvailableSemaphores[rendererData->currentFrame];
+    VkSemaphore renderFinishedSemaphore = rendererData->renderFinishedSemaphores[rendererData->currentFrame];
+
+    renderer_vulkan_wait_for_frame(rendererData);
+    renderer_vulkan_release_retired_swapchains(rendererData, false);
+    if (rendererData->swapchainOutOfDate && renderer_vulkan_recreate_swapchain(rendererData) != VK_SUCCESS) {
+        return false;
+    }
+    uint32_t imageIndex;
+    profiler_begin("acquire");
+    VkResult result = vkAcquireNextImageKHR(rendererData->device, rendererData->swapchain, UINT64_MAX,
+                                            imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        result = renderer_vulkan_recreate_swapchain(rendererData);
+        if (result == VK_SUCCESS) {
+            result = vkAcquireNextImageKHR(rendererData->device, rendererData->swapchain, UINT64_MAX,
+                                           imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+        }
+    }
+    profiler_end();
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        rendererData->swapchainOutOfDate = true;
+        return false;
+    }
+    vkResetCommandBuffer(commandBuffer, 0);
+    profiler_begin("record");
+    result = renderer_vulkan_record_command_buffer(rendererData, imageIndex);
+    profiler_end();
+    if (result == VK_SUCCESS) {
+        profiler_begin("submit");
+        result = renderer_vulkan_submit_frame(rendererData, imageAvailableSemaphore, renderFinishedSemaphore);
+        profiler_end();
+    } else {
+        /*
+         * The acquire already signals imageAvailableSemaphore, and the next acquire on this slot must not find it
+         * signaled. A failed submit consumes it in renderer_vulkan_submit_frame.
+         */
+        renderer_vulkan_abandon_frame(rendererData, &imageAvailableSemaphore, 1, false);
+    }
+    if (result != VK_SUCCESS) {
+        /* The acquired image is never presented, so rebuild the swapchain rather than wait on it. */
+        rendererData->swapchainOutOfDate = true;
+        return false;
+    }
 
     VkPresentInfoKHR presentInfo;
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -950,46 +2390,331 @@ void renderer_draw_frame(Renderer renderer) {
     presentInfo.pSwapchains = &rendererData->swapchain;
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = NULL;
+    profiler_begin("present");
     result = vkQueuePresentKHR(rendererData->presentQueue, &presentInfo);
+    profiler_end();
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-        renderer_reload(renderer);
+        rendererData->swapchainOutOfDate = true;
     }
 
     rendererData->currentFrame = (rendererData->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    return true;
+}
+
+bool renderer_draw_frame(Renderer renderer) {
+    if (renderer == INVALID_RENDERER) {
+        return false;
+    }
+    RendererData *rendererData = renderer_vulkan_renderers_data[renderer];
+    profiler_begin("frame");
+    bool drawn;
+    if (rendererData->headless) {
+        drawn = renderer_vulkan_draw_headless_frame(rendererData);
+    } else {
+        drawn = renderer_vulkan_draw_windowed_frame(rendererData);
+    }
+    /* Draws queued for a frame that was skipped or failed are dropped, not carried into the next one. */
+    rendererData->drawItemCount = 0;
+    profiler_end();
+    return drawn;
+}
+
+void renderer_get_frame_size(Renderer renderer, u32 *width, u32 *height) {
+    if (renderer == INVALID_RENDERER) {
+        *width = 0;
+        *height = 0;
+        return;
+    }
+    RendererData *rendererData = renderer_vulkan_renderers_data[renderer];
+    *width = rendererData->swapExtent.width;
+    *height = rendererData->swapExtent.height;
+}
+
+int renderer_read_frame(Renderer renderer, u8 *pixels) {
+    if (renderer == INVALID_RENDERER) {
+        return -1;
+    }
+    RendererData *rendererData = renderer_vulkan_renderers_data[renderer];
+    if (!rendererData->headless || rendererData->lastSubmittedFrame >= MAX_FRAMES_IN_FLIGHT) {
+        return -1;
+    }
+    u32 frame = rendererData->lastSubmittedFrame;
+    VkResult result = vkWaitForFences(rendererData->device, 1, &rendererData->inFlightFences[frame], VK_TRUE,
+                                      UINT64_MAX);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    memcpy(pixels, rendererData->readbackBufferAllocations[frame].mapped,
+           (usize) rendererData->swapExtent.width * rendererData->swapExtent.height * 4);
+    return 0;
+}
+
+/*
+ * Picks the next staging buffer that is neither queued for drawing nor read by a frame still in flight. With one
+ * more buffer than frames in flight, this only blocks when the CPU produces frames faster than the GPU consumes them.
+ */
+u32 renderer_vulkan_choose_host_frame_staging(RendererData *rendererData) {
+    u32 fallback = HOST_FRAME_NONE;
+    for (u32 i = 0; i < HOST_FRAME_STAGING_COUNT; i++) {
+        u32 index = (rendererData->hostFrameNext + i) % HOST_FRAME_STAGING_COUNT;
+        if (index == rendererData->hostFramePending) {
+            continue;
+        }
+        if (rendererData->hostFrameStagings[index].lastUsedFrameNumber <= rendererData->completedFrameNumber) {
+            return index;
+        }
+        if (fallback == HOST_FRAME_NONE) {
+            fallback = index;
+        }
+    }
+    renderer_vulkan_wait_for_frame_number(rendererData, rendererData->hostFrameStagings[fallback].lastUsedFrameNumber);
+    return fallback;
+}
+
+/*
+ * Returns a persistently mapped RGBA8 buffer of width * height pixels for the CPU to render into. The frame is shown
+ * by the first renderer_draw_frame after renderer_submit_host_frame, scaled to the swapchain, and stays on screen
+ * under anything drawn with meshes until a newer host frame replaces it.
+ */
+u8 *renderer_acquire_host_frame(Renderer renderer, u32 width, u32 height) {
+    if (renderer == INVALID_RENDERER || width == 0 || height == 0) {
+        return NULL;
+    }
+    RendererData *rendererData = renderer_vulkan_renderers_data[renderer];
+    if (!rendererData->hostFrameSupported) {
+        return NULL;
+    }
+    u32 index = rendererData->hostFrameAcquired;
+    if (index == HOST_FRAME_NONE) {
+        index = renderer_vulkan_choose_host_frame_staging(rendererData);
+    }
+    HostFrameStaging *staging = &rendererData->hostFrameStagings[index];
+    if (staging->width != width || staging->height != height) {
+        if (staging->buffer != VK_NULL_HANDLE) {
+            renderer_vulkan_memory_destroy_buffer(&rendererData->memoryAllocator, staging->buffer,
+                                                  &staging->allocation);
+            staging->buffer = VK_NULL_HANDLE;
+        }
+        VkBufferCreateInfo bufferCreateInfo;
+        bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferCreateInfo.pNext = NULL;
+        bufferCreateInfo.flags = 0;
+        bufferCreateInfo.size = (VkDeviceSize) width * height * 4;
+        bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        bufferCreateInfo.queueFamilyIndexCount = 0;
+        bufferCreateInfo.pQueueFamilyIndices = NULL;
+        if (renderer_vulkan_memory_create_buffer(&rendererData->memoryAllocator, &bufferCreateInfo,
+                                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, &staging->buffer,
+                                                 &staging->allocation) != VK_SUCCESS) {
+            staging->buffer = VK_NULL_HANDLE;
+            staging->width = 0;
+            staging->height = 0;
+            rendererData->hostFrameAcquired = HOST_FRAME_NONE;
+            return NULL;
+        }
+        staging->width = width;
+        staging->height = height;
+    }
+    rendererData->hostFrameAcquired = index;
+    return staging->allocation.mapped;
+}
+
+void renderer_submit_host_frame(Renderer renderer) {
+    if (renderer == INVALID_RENDERER) {
+        return;
+    }
+    RendererData *rendererData = renderer_vulkan_renderers_data[renderer];
+    if (rendererData->hostFrameAcquired == HOST_FRAME_NONE) {
+        return;
+    }
+    rendererData->hostFramePending = rendererData->hostFrameAcquired;
+    rendererData->hostFrameNext = (rendererData->hostFrameAcquired + 1) % HOST_FRAME_STAGING_COUNT;
+    rendererData->hostFrameAcquired = HOST_FRAME_NONE;
+}
+
+Mesh renderer_create_mesh(Renderer renderer, u32 vertex_count, const RendererVertex *vertices, u32 index_count,
+                          const u32 *indices) {
+    if (renderer == INVALID_RENDERER || vertex_count == 0 || index_count == 0) {
+        return INVALID_MESH;
+    }
+    RendererData *rendererData = renderer_vulkan_renderers_data[renderer];
+    Mesh mesh = rendererData->meshCount;
+    for (u32 i = 0; i < rendererData->meshCount; i++) {
+        if (!rendererData->meshes[i].alive) {
+            mesh = i;
+            break;
+        }
+    }
+    if (mesh == rendererData->meshLimit) {
+        u32 meshLimit = rendererData->meshLimit * 2 + 1;
+        MeshData *meshes = realloc(rendererData->meshes, sizeof(MeshData) * meshLimit);
+        if (meshes == NULL) {
+            return INVALID_MESH;
+        }
+        rendererData->meshes = meshes;
+        rendererData->meshLimit = meshLimit;
+    }
+    MeshData *meshData = &rendererData->meshes[mesh];
+    memset(meshData, 0, sizeof(MeshData));
+    meshData->alive = true;
+    meshData->lastUsedFrameNumber = rendererData->frameNumber + 1;
+    meshData->vertexCount = vertex_count;
+    meshData->indexCount = index_count;
+    if (mesh == rendererData->meshCount) {
+        rendererData->meshCount++;
+    }
+    VkDeviceSize vertexSize = (VkDeviceSize) vertex_count * sizeof(RendererVertex);
+    VkDeviceSize indexSize = (VkDeviceSize) index_count * sizeof(u32);
+    if (renderer_vulkan_create_mesh_buffer(rendererData, vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                           &meshData->vertexBuffer, &meshData->vertexAllocation) != VK_SUCCESS ||
+        renderer_vulkan_create_mesh_buffer(rendererData, indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                           &meshData->indexBuffer, &meshData->indexAllocation) != VK_SUCCESS ||
+        renderer_vulkan_upload_buffer(&rendererData->uploader, meshData->vertexBuffer, 0, vertices,
+                                      vertexSize) != VK_SUCCESS ||
+        renderer_vulkan_upload_buffer(&rendererData->uploader, meshData->indexBuffer, 0, indices,
+                                      indexSize) != VK_SUCCESS) {
+        meshData->destroyed = true;
+        return INVALID_MESH;
+    }
+    return mesh;
+}
+
+void renderer_destroy_mesh(Renderer renderer, Mesh mesh) {
+    if (renderer == INVALID_RENDERER) {
+        return;
+    }
+    RendererData *rendererData = renderer_vulkan_renderers_data[renderer];
+    if (mesh >= rendererData->meshCount || !rendererData->meshes[mesh].alive) {
+        return;
+    }
+    rendererData->meshes[mesh].destroyed = true;
+    for (u32 i = 0; i < rendererData->drawItemCount; i++) {
+        if (rendererData->drawItems[i].mesh == mesh) {
+            rendererData->drawItems[i--] = rendererData->drawItems[--rendererData->drawItemCount];
+        }
+    }
+}
+
+void renderer_draw_mesh_instances(Renderer renderer, Mesh mesh, u32 instance_count,
+                                  const RendererInstance *instances) {
+    if (renderer == INVALID_RENDERER) {
+        return;
+    }
+    RendererData *rendererData = renderer_vulkan_renderers_data[renderer];
+    if (mesh >= rendererData->meshCount || !rendererData->meshes[mesh].alive ||
+        rendererData->meshes[mesh].destroyed) {
+        return;
+    }
+    if (rendererData->drawItemCount + instance_count > rendererData->drawItemLimit) {
+        u32 drawItemLimit = rendererData->drawItemLimit * 2 + 16;
+        if (drawItemLimit < rendererData->drawItemCount + instance_count) {
+            drawItemLimit = rendererData->drawItemCount + instance_count;
+        }
+        DrawItem *drawItems = realloc(rendererData->drawItems, sizeof(DrawItem) * drawItemLimit);
+        if (drawItems == NULL) {
+            return;
+        }
+        rendererData->drawItems = drawItems;
+        rendererData->drawItemLimit = drawItemLimit;
+    }
+    for (u32 i = 0; i < instance_count; i++) {
+        DrawItem *drawItem = &rendererData->drawItems[rendererData->drawItemCount++];
+        drawItem->mesh = mesh;
+        drawItem->instance = instances[i];
+    }
+}
+
+void renderer_draw_mesh(Renderer renderer, Mesh mesh) {
+    RendererInstance instance = {
+            {1.0f, 0.0f, 0.0f, 0.0f,
+             0.0f, 1.0f, 0.0f, 0.0f,
+             0.0f, 0.0f, 1.0f, 0.0f,
+             0.0f, 0.0f, 0.0f, 1.0f},
+            {1.0f, 1.0f, 1.0f, 1.0f}
+    };
+    renderer_draw_mesh_instances(renderer, mesh, 1, &instance);
 }
 
 void renderer_destroy(Renderer renderer) {
     if (renderer == INVALID_RENDERER) {
         return;
     }
-    RendererData data = renderer_vulkan_renderers_data[renderer];
-    vkDeviceWaitIdle(data.device);
+    RendererData *data = renderer_vulkan_renderers_data[renderer];
+    vkDeviceWaitIdle(data->device);
+    renderer_vulkan_release_retired_swapchains(data, true);
+    free(data->retiredSwapchains);
+    renderer_vulkan_upload_destroy(&data->uploader);
+    for (u32 i = 0; i < HOST_FRAME_STAGING_COUNT; i++) {
+        if (data->hostFrameStagings[i].buffer != VK_NULL_HANDLE) {
+            renderer_vulkan_memory_destroy_buffer(&data->memoryAllocator, data->hostFrameStagings[i].buffer,
+                                                  &data->hostFrameStagings[i].allocation);
+        }
+    }
+    renderer_vulkan_destroy_host_frame_image(data);
+    for (u32 i = 0; i < data->meshCount; i++) {
+        if (data->meshes[i].alive) {
+            renderer_vulkan_release_mesh(data, &data->meshes[i]);
+        }
+    }
+    free(data->meshes);
+    free(data->drawItems);
+    free(data->drawBatches);
+    free(data->meshBatchIndices);
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        renderer_vulkan_linear_arena_destroy(&data->memoryAllocator, &data->frameArenas[i]);
+    }
+    vkDestroyDescriptorPool(data->device, data->descriptorPool, NULL);
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroySemaphore(data.device, data.imageAvailableSemaphores[i], NULL);
-        vkDestroySemaphore(data.device, data.renderFinishedSemaphores[i], NULL);
-        vkDestroyFence(data.device, data.inFlightFences[i], NULL);
-    }
-    free(data.imageAvailableSemaphores);
-    free(data.renderFinishedSemaphores);
-    free(data.inFlightFences);
-    vkDestroyCommandPool(data.device, data.commandPool, NULL);
-    for (int i = 0; i < data.swapchainImageCount; i++) {
-        vkDestroyFramebuffer(data.device, data.swapchainFramebuffers[i], NULL);
-    }
-    free(data.swapchainFramebuffers);
-    vkDestroyPipeline(data.device, data.graphicsPipeline, NULL);
-    vkDestroyPipelineLayout(data.device, data.pipelineLayout, NULL);
-    vkDestroyRenderPass(data.device, data.renderPass, NULL);
-    for (int i = 0; i < data.swapchainImageCount; ++i) {
-        vkDestroyImageView(data.device, data.swapchainImageViews[i], NULL);
-    }
-    free(data.swapchainImageViews);
-    free(data.swapchainImages);
-    vkDestroySwapchainKHR(data.device, data.swapchain, NULL);
-    vkDestroyDevice(data.device, NULL);
-    vkDestroySurfaceKHR(data.instance, data.surface, NULL);
-    PFN_vkDestroyDebugUtilsMessengerEXT destroyDebugMessengerFunc = (PFN_vkDestroyDebugUtilsMessengerEXT)
-            vkGetInstanceProcAddr(data.instance, "vkDestroyDebugUtilsMessengerEXT");
-    destroyDebugMessengerFunc(data.instance, data.debugMessenger, NULL);
-    vkDestroyInstance(data.instance, NULL);
+        vkDestroySemaphore(data->device, data->imageAvailableSemaphores[i], NULL);
+        vkDestroySemaphore(data->device, data->renderFinishedSemaphores[i], NULL);
+        vkDestroySemaphore(data->device, data->uploadFinishedSemaphores[i], NULL);
+        vkDestroyFence(data->device, data->inFlightFences[i], NULL);
+    }
+    free(data->imageAvailableSemaphores);
+    free(data->renderFinishedSemaphores);
+    free(data->uploadFinishedSemaphores);
+    free(data->inFlightFences);
+    if (data->timestampQueryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(data->device, data->timestampQueryPool, NULL);
+    }
+    renderer_vulkan_destroy_record_slots(data);
+    vkDestroyCommandPool(data->device, data->commandPool, NULL);
+    for (int i = 0; i < data->swapchainImageCount; i++) {
+        vkDestroyFramebuffer(data->device, data->swapchainFramebuffers[i], NULL);
+    }
+    free(data->swapchainFramebuffers);
+    vkDestroyPipeline(data->device, data->graphicsPipeline, NULL);
+    renderer_vulkan_save_pipeline_cache(data);
+    vkDestroyPipelineCache(data->device, data->pipelineCache, NULL);
+    vkDestroyPipelineLayout(data->device, data->pipelineLayout, NULL);
+    vkDestroyDescriptorSetLayout(data->device, data->descriptorSetLayout, NULL);
+    vkDestroyRenderPass(data->device, data->renderPass, NULL);
+    if (data->loadRenderPass != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(data->device, data->loadRenderPass, NULL);
+    }
+    for (int i = 0; i < data->swapchainImageCount; ++i) {
+        vkDestroyImageView(data->device, data->swapchainImageViews[i], NULL);
+    }
+    free(data->swapchainImageViews);
+    if (data->headless) {
+        renderer_vulkan_destroy_offscreen_targets(data);
+    } else {
+        vkDestroySwapchainKHR(data->device, data->swapchain, NULL);
+    }
+    free(data->swapchainImages);
+    renderer_vulkan_memory_destroy(&data->memoryAllocator);
+    vkDestroyDevice(data->device, NULL);
+    if (!data->headless) {
+        vkDestroySurfaceKHR(data->instance, data->surface, NULL);
+    }
+    if (data->validationEnabled) {
+        PFN_vkDestroyDebugUtilsMessengerEXT destroyDebugMessengerFunc = (PFN_vkDestroyDebugUtilsMessengerEXT)
+                vkGetInstanceProcAddr(data->instance, "vkDestroyDebugUtilsMessengerEXT");
+        destroyDebugMessengerFunc(data->instance, data->debugMessenger, NULL);
+    }
+    vkDestroyInstance(data->instance, NULL);
+    free(data);
+    renderer_vulkan_renderers_data[renderer] = NULL;
 }
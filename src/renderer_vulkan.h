@@ -4,5 +4,16 @@
 #include "types.h"
 
 typedef u32 Renderer;
+typedef u32 Mesh;
+
+typedef struct renderer_vertex_s {
+    float position[3];
+    float color[3];
+} RendererVertex;
+
+typedef struct renderer_instance_s {
+    float transform[16];
+    float color[4];
+} RendererInstance;
 
 #endif //CGFS_RENDERER_VULKAN_H
@@ -0,0 +1,504 @@
+#include <stdlib.h>
+#include <string.h>
+#include "renderer_vulkan_memory.h"
+
+#define DEFAULT_BLOCK_SIZE (64 * 1024 * 1024)
+#define MIN_BLOCK_SIZE (1024 * 1024)
+#define MIN_ALLOCATION_SIZE 256
+
+VkDeviceSize renderer_vulkan_memory_round_up_to_power_of_two(VkDeviceSize value) {
+    VkDeviceSize result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+u32 renderer_vulkan_memory_order_for_size(VulkanMemoryAllocator *allocator, VkDeviceSize size) {
+    u32 order = 0;
+    while ((allocator->minAllocationSize << order) < size) {
+        order++;
+    }
+    return order;
+}
+
+bool renderer_vulkan_memory_free_list_push(VulkanMemoryFreeList *freeList, VkDeviceSize offset) {
+    if (freeList->count == freeList->limit) {
+        u32 limit = freeList->limit * 2 + 4;
+        VkDeviceSize *offsets = realloc(freeList->offsets, sizeof(VkDeviceSize) * limit);
+        if (offsets == NULL) {
+            return false;
+        }
+        freeList->offsets = offsets;
+        freeList->limit = limit;
+    }
+    freeList->offsets[freeList->count++] = offset;
+    return true;
+}
+
+bool renderer_vulkan_memory_free_list_remove(VulkanMemoryFreeList *freeList, VkDeviceSize offset) {
+    for (u32 i = 0; i < freeList->count; i++) {
+        if (freeList->offsets[i] == offset) {
+            freeList->offsets[i] = freeList->offsets[--freeList->count];
+            return true;
+        }
+    }
+    return false;
+}
+
+void renderer_vulkan_memory_release_block(VulkanMemoryAllocator *allocator, VulkanMemoryBlock *block) {
+    for (u32 order = 0; order < VULKAN_MEMORY_MAX_ORDERS; order++) {
+        free(block->freeLists[order].offsets);
+    }
+    if (block->mapped != NULL) {
+        vkUnmapMemory(allocator->device, block->memory);
+    }
+    vkFreeMemory(allocator->device, block->memory, NULL);
+    allocator->deviceAllocationCount--;
+    memset(block, 0, sizeof(VulkanMemoryBlock));
+}
+
+VkResult renderer_vulkan_memory_allocate_device_memory(VulkanMemoryAllocator *allocator, u32 memoryTypeIndex,
+                                                       VkDeviceSize size, VkDeviceMemory *memory, void **mapped) {
+    if (allocator->deviceAllocationCount >= allocator->maxDeviceAllocationCount) {
+        return VK_ERROR_TOO_MANY_OBJECTS;
+    }
+    VkMemoryAllocateInfo memoryAllocateInfo;
+    memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocateInfo.pNext = NULL;
+    memoryAllocateInfo.allocationSize = size;
+    memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+    VkResult result = vkAllocateMemory(allocator->device, &memoryAllocateInfo, NULL, memory);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    *mapped = NULL;
+    if (allocator->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        result = vkMapMemory(allocator->device, *memory, 0, VK_WHOLE_SIZE, 0, mapped);
+        if (result != VK_SUCCESS) {
+            vkFreeMemory(allocator->device, *memory, NULL);
+            return result;
+        }
+    }
+    allocator->deviceAllocationCount++;
+    return VK_SUCCESS;
+}
+
+VkResult renderer_vulkan_memory_create_block(VulkanMemoryAllocator *allocator, u32 memoryTypeIndex,
+                                             u32 *blockIndex) {
+    VulkanMemoryTypePool *pool = &allocator->pools[memoryTypeIndex];
+    u32 index = pool->blockCount;
+    for (u32 i = 0; i < pool->blockCount; i++) {
+        if (pool->blocks[i].memory == VK_NULL_HANDLE) {
+            index = i;
+            break;
+        }
+    }
+    if (index == pool->blockLimit) {
+        u32 limit = pool->blockLimit * 2 + 1;
+        VulkanMemoryBlock *blocks = realloc(pool->blocks, sizeof(VulkanMemoryBlock) * limit);
+        if (blocks == NULL) {
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+        pool->blocks = blocks;
+        pool->blockLimit = limit;
+    }
+    VulkanMemoryBlock *block = &pool->blocks[index];
+    memset(block, 0, sizeof(VulkanMemoryBlock));
+    VkResult result = renderer_vulkan_memory_allocate_device_memory(allocator, memoryTypeIndex, allocator->blockSize,
+                                                                    &block->memory, &block->mapped);
+    if (result != VK_SUCCESS) {
+        block->memory = VK_NULL_HANDLE;
+        return result;
+    }
+    block->size = allocator->blockSize;
+    block->maxOrder = renderer_vulkan_memory_order_for_size(allocator, block->size);
+    if (!renderer_vulkan_memory_free_list_push(&block->freeLists[block->maxOrder], 0)) {
+        renderer_vulkan_memory_release_block(allocator, block);
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    if (index == pool->blockCount) {
+        pool->blockCount++;
+    }
+    *blockIndex = index;
+    return VK_SUCCESS;
+}
+
+bool renderer_vulkan_memory_block_allocate(VulkanMemoryAllocator *allocator, VulkanMemoryBlock *block, u32 order,
+                                           VkDeviceSize *offset) {
+    if (block->memory == VK_NULL_HANDLE || block->evacuating || order > block->maxOrder) {
+        return false;
+    }
+    u32 foundOrder = order;
+    while (foundOrder <= block->maxOrder && block->freeLists[foundOrder].count == 0) {
+        foundOrder++;
+    }
+    if (foundOrder > block->maxOrder) {
+        return false;
+    }
+    VulkanMemoryFreeList *freeList = &block->freeLists[foundOrder];
+    VkDeviceSize foundOffset = freeList->offsets[--freeList->count];
+    while (foundOrder > order) {
+        foundOrder--;
+        if (!renderer_vulkan_memory_free_list_push(&block->freeLists[foundOrder],
+                                                   foundOffset + (allocator->minAllocationSize << foundOrder))) {
+            return false;
+        }
+    }
+    block->usedSize += allocator->minAllocationSize << order;
+    block->allocationCount++;
+    *offset = foundOffset;
+    return true;
+}
+
+void renderer_vulkan_memory_block_free(VulkanMemoryAllocator *allocator, VulkanMemoryBlock *block,
+                                       VkDeviceSize offset, u32 order) {
+    block->usedSize -= allocator->minAllocationSize << order;
+    block->allocationCount--;
+    while (order < block->maxOrder) {
+        VkDeviceSize buddyOffset = offset ^ (allocator->minAllocationSize << order);
+        if (!renderer_vulkan_memory_free_list_remove(&block->freeLists[order], buddyOffset)) {
+            break;
+        }
+        if (buddyOffset < offset) {
+            offset = buddyOffset;
+        }
+        order++;
+    }
+    renderer_vulkan_memory_free_list_push(&block->freeLists[order], offset);
+}
+
+bool renderer_vulkan_memory_find_type(VulkanMemoryAllocator *allocator, u32 memoryTypeBits,
+                                      VkMemoryPropertyFlags properties, u32 *memoryTypeIndex) {
+    for (u32 i = 0; i < allocator->memoryProperties.memoryTypeCount; i++) {
+        if ((memoryTypeBits & (1 << i)) &&
+            (allocator->memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            *memoryTypeIndex = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+VkResult renderer_vulkan_memory_allocate_from_type(VulkanMemoryAllocator *allocator, u32 memoryTypeIndex,
+                                                   const VkMemoryRequirements *requirements,
+                                                   VulkanAllocation *allocation) {
+    VulkanMemoryTypePool *pool = &allocator->pools[memoryTypeIndex];
+    VkDeviceSize alignedSize = requirements->size > requirements->alignment ? requirements->size
+                                                                            : requirements->alignment;
+    allocation->memoryTypeIndex = memoryTypeIndex;
+    allocation->size = requirements->size;
+    if (alignedSize > allocator->blockSize / 2) {
+        void *mapped;
+        VkResult result = renderer_vulkan_memory_allocate_device_memory(allocator, memoryTypeIndex,
+                                                                        requirements->size, &allocation->memory,
+                                                                        &mapped);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        allocation->offset = 0;
+        allocation->mapped = mapped;
+        allocation->blockIndex = VULKAN_MEMORY_DEDICATED_BLOCK;
+        allocation->order = 0;
+        pool->dedicatedCount++;
+        pool->dedicatedSize += requirements->size;
+        return VK_SUCCESS;
+    }
+    u32 order = renderer_vulkan_memory_order_for_size(allocator, alignedSize);
+    VkDeviceSize offset;
+    u32 blockIndex;
+    for (blockIndex = 0; blockIndex < pool->blockCount; blockIndex++) {
+        if (renderer_vulkan_memory_block_allocate(allocator, &pool->blocks[blockIndex], order, &offset)) {
+            break;
+        }
+    }
+    if (blockIndex == pool->blockCount) {
+        VkResult result = renderer_vulkan_memory_create_block(allocator, memoryTypeIndex, &blockIndex);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        if (!renderer_vulkan_memory_block_allocate(allocator, &pool->blocks[blockIndex], order, &offset)) {
+            return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        }
+    }
+    VulkanMemoryBlock *block = &pool->blocks[blockIndex];
+    allocation->memory = block->memory;
+    allocation->offset = offset;
+    allocation->mapped = block->mapped != NULL ? (u8 *) block->mapped + offset : NULL;
+    allocation->blockIndex = blockIndex;
+    allocation->order = order;
+    return VK_SUCCESS;
+}
+
+VkResult renderer_vulkan_memory_create(VkPhysicalDevice physicalDevice, VkDevice device,
+                                       VulkanMemoryAllocator *allocator) {
+    memset(allocator, 0, sizeof(VulkanMemoryAllocator));
+    allocator->device = device;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &allocator->memoryProperties);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    allocator->maxDeviceAllocationCount = properties.limits.maxMemoryAllocationCount;
+    allocator->minAllocationSize = renderer_vulkan_memory_round_up_to_power_of_two(
+            properties.limits.bufferImageGranularity > MIN_ALLOCATION_SIZE ? properties.limits.bufferImageGranularity
+                                                                          : MIN_ALLOCATION_SIZE);
+    VkDeviceSize smallestHeapSize = DEFAULT_BLOCK_SIZE;
+    for (u32 i = 0; i < allocator->memoryProperties.memoryHeapCount; i++) {
+        if (allocator->memoryProperties.memoryHeaps[i].size < smallestHeapSize * 8) {
+            smallestHeapSize = allocator->memoryProperties.memoryHeaps[i].size / 8;
+        }
+    }
+    allocator->blockSize = DEFAULT_BLOCK_SIZE;
+    while (allocator->blockSize > smallestHeapSize && allocator->blockSize > MIN_BLOCK_SIZE) {
+        allocator->blockSize >>= 1;
+    }
+    return VK_SUCCESS;
+}
+
+void renderer_vulkan_memory_destroy(VulkanMemoryAllocator *allocator) {
+    for (u32 i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+        VulkanMemoryTypePool *pool = &allocator->pools[i];
+        for (u32 j = 0; j < pool->blockCount; j++) {
+            if (pool->blocks[j].memory != VK_NULL_HANDLE) {
+                renderer_vulkan_memory_release_block(allocator, &pool->blocks[j]);
+            }
+        }
+        free(pool->blocks);
+    }
+    memset(allocator, 0, sizeof(VulkanMemoryAllocator));
+}
+
+VkResult renderer_vulkan_memory_allocate(VulkanMemoryAllocator *allocator, const VkMemoryRequirements *requirements,
+                                         VkMemoryPropertyFlags requiredProperties,
+                                         VkMemoryPropertyFlags preferredProperties, VulkanAllocation *allocation) {
+    u32 memoryTypeIndex;
+    VkResult result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    if (preferredProperties != 0 &&
+        renderer_vulkan_memory_find_type(allocator, requirements->memoryTypeBits,
+                                         requiredProperties | preferredProperties, &memoryTypeIndex)) {
+        result = renderer_vulkan_memory_allocate_from_type(allocator, memoryTypeIndex, requirements, allocation);
+    }
+    if (result != VK_SUCCESS &&
+        renderer_vulkan_memory_find_type(allocator, requirements->memoryTypeBits, requiredProperties,
+                                         &memoryTypeIndex)) {
+        result = renderer_vulkan_memory_allocate_from_type(allocator, memoryTypeIndex, requirements, allocation);
+    }
+    return result;
+}
+
+void renderer_vulkan_memory_free(VulkanMemoryAllocator *allocator, VulkanAllocation *allocation) {
+    if (allocation->memory == VK_NULL_HANDLE) {
+        return;
+    }
+    VulkanMemoryTypePool *pool = &allocator->pools[allocation->memoryTypeIndex];
+    if (allocation->blockIndex == VULKAN_MEMORY_DEDICATED_BLOCK) {
+        if (allocation->mapped != NULL) {
+            vkUnmapMemory(allocator->device, allocation->memory);
+        }
+        vkFreeMemory(allocator->device, allocation->memory, NULL);
+        allocator->deviceAllocationCount--;
+        pool->dedicatedCount--;
+        pool->dedicatedSize -= allocation->size;
+    } else {
+        renderer_vulkan_memory_block_free(allocator, &pool->blocks[allocation->blockIndex], allocation->offset,
+                                          allocation->order);
+    }
+    memset(allocation, 0, sizeof(VulkanAllocation));
+}
+
+VkResult renderer_vulkan_memory_create_buffer(VulkanMemoryAllocator *allocator, const VkBufferCreateInfo *createInfo,
+                                              VkMemoryPropertyFlags requiredProperties,
+                                              VkMemoryPropertyFlags preferredProperties, VkBuffer *buffer,
+                                              VulkanAllocation *allocation) {
+    VkResult result = vkCreateBuffer(allocator->device, createInfo, NULL, buffer);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(allocator->device, *buffer, &memoryRequirements);
+    result = renderer_vulkan_memory_allocate(allocator, &memoryRequirements, requiredProperties, preferredProperties,
+                                             allocation);
+    if (result == VK_SUCCESS) {
+        result = vkBindBufferMemory(allocator->device, *buffer, allocation->memory, allocation->offset);
+        if (result != VK_SUCCESS) {
+            renderer_vulkan_memory_free(allocator, allocation);
+        }
+    }
+    if (result != VK_SUCCESS) {
+        vkDestroyBuffer(allocator->device, *buffer, NULL);
+        *buffer = VK_NULL_HANDLE;
+    }
+    return result;
+}
+
+void renderer_vulkan_memory_destroy_buffer(VulkanMemoryAllocator *allocator, VkBuffer buffer,
+                                           VulkanAllocation *allocation) {
+    vkDestroyBuffer(allocator->device, buffer, NULL);
+    renderer_vulkan_memory_free(allocator, allocation);
+}
+
+VkResult renderer_vulkan_memory_create_image(VulkanMemoryAllocator *allocator, const VkImageCreateInfo *createInfo,
+                                             VkMemoryPropertyFlags requiredProperties, VkImage *image,
+                                             VulkanAllocation *allocation) {
+    VkResult result = vkCreateImage(allocator->device, createInfo, NULL, image);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(allocator->device, *image, &memoryRequirements);
+    result = renderer_vulkan_memory_allocate(allocator, &memoryRequirements, requiredProperties, 0, allocation);
+    if (result == VK_SUCCESS) {
+        result = vkBindImageMemory(allocator->device, *image, allocation->memory, allocation->offset);
+        if (result != VK_SUCCESS) {
+            renderer_vulkan_memory_free(allocator, allocation);
+        }
+    }
+    if (result != VK_SUCCESS) {
+        vkDestroyImage(allocator->device, *image, NULL);
+        *image = VK_NULL_HANDLE;
+    }
+    return result;
+}
+
+void renderer_vulkan_memory_destroy_image(VulkanMemoryAllocator *allocator, VkImage image,
+                                          VulkanAllocation *allocation) {
+    vkDestroyImage(allocator->device, image, NULL);
+    renderer_vulkan_memory_free(allocator, allocation);
+}
+
+void renderer_vulkan_memory_set_defragment_callback(VulkanMemoryAllocator *allocator,
+                                                    void (*callback)(void *userData, u32 memoryTypeIndex,
+                                                                     u32 blockIndex),
+                                                    void *userData) {
+    allocator->defragmentCallback = callback;
+    allocator->defragmentUserData = userData;
+}
+
+/*
+ * Releases empty blocks and, when a defragment callback is installed, asks the owner of the allocations in the
+ * least used block of every memory type to move them elsewhere. The block is skipped by new allocations while the
+ * callback runs, so reallocating from inside the callback always lands in another block.
+ */
+VkDeviceSize renderer_vulkan_memory_defragment(VulkanMemoryAllocator *allocator) {
+    VkDeviceSize releasedSize = 0;
+    for (u32 memoryTypeIndex = 0; memoryTypeIndex < allocator->memoryProperties.memoryTypeCount; memoryTypeIndex++) {
+        VulkanMemoryTypePool *pool = &allocator->pools[memoryTypeIndex];
+        u32 liveBlockCount = 0;
+        VkDeviceSize freeSize = 0;
+        u32 candidateIndex = VULKAN_MEMORY_DEDICATED_BLOCK;
+        for (u32 i = 0; i < pool->blockCount; i++) {
+            VulkanMemoryBlock *block = &pool->blocks[i];
+            if (block->memory == VK_NULL_HANDLE) {
+                continue;
+            }
+            if (block->allocationCount == 0) {
+                releasedSize += block->size;
+                renderer_vulkan_memory_release_block(allocator, block);
+                continue;
+            }
+            liveBlockCount++;
+            freeSize += block->size - block->usedSize;
+            if (candidateIndex == VULKAN_MEMORY_DEDICATED_BLOCK ||
+                block->usedSize < pool->blocks[candidateIndex].usedSize) {
+                candidateIndex = i;
+            }
+        }
+        if (allocator->defragmentCallback == NULL || liveBlockCount < 2) {
+            continue;
+        }
+        VulkanMemoryBlock *candidate = &pool->blocks[candidateIndex];
+        if (freeSize - (candidate->size - candidate->usedSize) < candidate->usedSize) {
+            continue;
+        }
+        candidate->evacuating = true;
+        allocator->defragmentCallback(allocator->defragmentUserData, memoryTypeIndex, candidateIndex);
+        candidate = &pool->blocks[candidateIndex];
+        candidate->evacuating = false;
+        if (candidate->allocationCount == 0) {
+            releasedSize += candidate->size;
+            renderer_vulkan_memory_release_block(allocator, candidate);
+        }
+    }
+    return releasedSize;
+}
+
+void renderer_vulkan_memory_get_stats(VulkanMemoryAllocator *allocator, u32 memoryTypeIndex,
+                                      VulkanMemoryStats *stats) {
+    memset(stats, 0, sizeof(VulkanMemoryStats));
+    VkDeviceSize freeSize = 0;
+    for (u32 i = 0; i < allocator->memoryProperties.memoryTypeCount; i++) {
+        if (memoryTypeIndex < VK_MAX_MEMORY_TYPES && i != memoryTypeIndex) {
+            continue;
+        }
+        VulkanMemoryTypePool *pool = &allocator->pools[i];
+        stats->dedicatedAllocationCount += pool->dedicatedCount;
+        stats->allocationCount += pool->dedicatedCount;
+        stats->reservedSize += pool->dedicatedSize;
+        stats->usedSize += pool->dedicatedSize;
+        for (u32 j = 0; j < pool->blockCount; j++) {
+            VulkanMemoryBlock *block = &pool->blocks[j];
+            if (block->memory == VK_NULL_HANDLE) {
+                continue;
+            }
+            stats->blockCount++;
+            stats->allocationCount += block->allocationCount;
+            stats->reservedSize += block->size;
+            stats->usedSize += block->usedSize;
+            freeSize += block->size - block->usedSize;
+            for (u32 order = block->maxOrder + 1; order-- > 0;) {
+                if (block->freeLists[order].count > 0) {
+                    VkDeviceSize rangeSize = allocator->minAllocationSize << order;
+                    if (rangeSize > stats->largestFreeRange) {
+                        stats->largestFreeRange = rangeSize;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    stats->fragmentation = freeSize > 0 ? 1.0f - (float) stats->largestFreeRange / (float) freeSize : 0.0f;
+}
+
+VkResult renderer_vulkan_linear_arena_create(VulkanMemoryAllocator *allocator, VkDeviceSize capacity,
+                                             VkBufferUsageFlags usage, VulkanLinearArena *arena) {
+    memset(arena, 0, sizeof(VulkanLinearArena));
+    VkBufferCreateInfo bufferCreateInfo;
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.pNext = NULL;
+    bufferCreateInfo.flags = 0;
+    bufferCreateInfo.size = capacity;
+    bufferCreateInfo.usage = usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 0;
+    bufferCreateInfo.pQueueFamilyIndices = NULL;
+    VkResult result = renderer_vulkan_memory_create_buffer(allocator, &bufferCreateInfo,
+                                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &arena->buffer,
+                                                           &arena->allocation);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    arena->capacity = capacity;
+    arena->head = 0;
+    return VK_SUCCESS;
+}
+
+void renderer_vulkan_linear_arena_destroy(VulkanMemoryAllocator *allocator, VulkanLinearArena *arena) {
+    renderer_vulkan_memory_destroy_buffer(allocator, arena->buffer, &arena->allocation);
+    memset(arena, 0, sizeof(VulkanLinearArena));
+}
+
+void *renderer_vulkan_linear_arena_allocate(VulkanLinearArena *arena, VkDeviceSize size, VkDeviceSize alignment,
+                                            VkDeviceSize *offset) {
+    VkDeviceSize alignedHead = alignment > 1 ? (arena->head + alignment - 1) / alignment * alignment : arena->head;
+    if (alignedHead + size > arena->capacity) {
+        return NULL;
+    }
+    arena->head = alignedHead + size;
+    *offset = alignedHead;
+    return (u8 *) arena->allocation.mapped + alignedHead;
+}
+
+void renderer_vulkan_linear_arena_reset(VulkanLinearArena *arena) {
+    arena->head = 0;
+}
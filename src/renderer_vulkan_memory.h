@@ -0,0 +1,120 @@
+#ifndef CGFS_RENDERER_VULKAN_MEMORY_H
+#define CGFS_RENDERER_VULKAN_MEMORY_H
+
+#include <vulkan/vulkan_core.h>
+#include "types.h"
+
+#define VULKAN_MEMORY_MAX_ORDERS 32
+#define VULKAN_MEMORY_DEDICATED_BLOCK 0xFFFFFFFF
+
+typedef struct vulkan_allocation_s {
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    void *mapped;
+    u32 memoryTypeIndex;
+    u32 blockIndex;
+    u32 order;
+} VulkanAllocation;
+
+typedef struct vulkan_memory_free_list_s {
+    VkDeviceSize *offsets;
+    u32 count;
+    u32 limit;
+} VulkanMemoryFreeList;
+
+typedef struct vulkan_memory_block_s {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    void *mapped;
+    u32 maxOrder;
+    VulkanMemoryFreeList freeLists[VULKAN_MEMORY_MAX_ORDERS];
+    VkDeviceSize usedSize;
+    u32 allocationCount;
+    bool evacuating;
+} VulkanMemoryBlock;
+
+typedef struct vulkan_memory_type_pool_s {
+    VulkanMemoryBlock *blocks;
+    u32 blockCount;
+    u32 blockLimit;
+    u32 dedicatedCount;
+    VkDeviceSize dedicatedSize;
+} VulkanMemoryTypePool;
+
+typedef struct vulkan_memory_allocator_s {
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    VkDeviceSize minAllocationSize;
+    VkDeviceSize blockSize;
+    u32 deviceAllocationCount;
+    u32 maxDeviceAllocationCount;
+    VulkanMemoryTypePool pools[VK_MAX_MEMORY_TYPES];
+    void (*defragmentCallback)(void *userData, u32 memoryTypeIndex, u32 blockIndex);
+    void *defragmentUserData;
+} VulkanMemoryAllocator;
+
+typedef struct vulkan_linear_arena_s {
+    VkBuffer buffer;
+    VulkanAllocation allocation;
+    VkDeviceSize capacity;
+    VkDeviceSize head;
+} VulkanLinearArena;
+
+typedef struct vulkan_memory_stats_s {
+    u32 blockCount;
+    u32 allocationCount;
+    u32 dedicatedAllocationCount;
+    VkDeviceSize reservedSize;
+    VkDeviceSize usedSize;
+    VkDeviceSize largestFreeRange;
+    float fragmentation;
+} VulkanMemoryStats;
+
+VkResult renderer_vulkan_memory_create(VkPhysicalDevice physicalDevice, VkDevice device,
+                                       VulkanMemoryAllocator *allocator);
+
+void renderer_vulkan_memory_destroy(VulkanMemoryAllocator *allocator);
+
+VkResult renderer_vulkan_memory_allocate(VulkanMemoryAllocator *allocator, const VkMemoryRequirements *requirements,
+                                         VkMemoryPropertyFlags requiredProperties,
+                                         VkMemoryPropertyFlags preferredProperties, VulkanAllocation *allocation);
+
+void renderer_vulkan_memory_free(VulkanMemoryAllocator *allocator, VulkanAllocation *allocation);
+
+VkResult renderer_vulkan_memory_create_buffer(VulkanMemoryAllocator *allocator, const VkBufferCreateInfo *createInfo,
+                                              VkMemoryPropertyFlags requiredProperties,
+                                              VkMemoryPropertyFlags preferredProperties, VkBuffer *buffer,
+                                              VulkanAllocation *allocation);
+
+void renderer_vulkan_memory_destroy_buffer(VulkanMemoryAllocator *allocator, VkBuffer buffer,
+                                           VulkanAllocation *allocation);
+
+VkResult renderer_vulkan_memory_create_image(VulkanMemoryAllocator *allocator, const VkImageCreateInfo *createInfo,
+                                             VkMemoryPropertyFlags requiredProperties, VkImage *image,
+                                             VulkanAllocation *allocation);
+
+void renderer_vulkan_memory_destroy_image(VulkanMemoryAllocator *allocator, VkImage image,
+                                          VulkanAllocation *allocation);
+
+void renderer_vulkan_memory_set_defragment_callback(VulkanMemoryAllocator *allocator,
+                                                    void (*callback)(void *userData, u32 memoryTypeIndex,
+                                                                     u32 blockIndex),
+                                                    void *userData);
+
+VkDeviceSize renderer_vulkan_memory_defragment(VulkanMemoryAllocator *allocator);
+
+void renderer_vulkan_memory_get_stats(VulkanMemoryAllocator *allocator, u32 memoryTypeIndex,
+                                      VulkanMemoryStats *stats);
+
+VkResult renderer_vulkan_linear_arena_create(VulkanMemoryAllocator *allocator, VkDeviceSize capacity,
+                                             VkBufferUsageFlags usage, VulkanLinearArena *arena);
+
+void renderer_vulkan_linear_arena_destroy(VulkanMemoryAllocator *allocator, VulkanLinearArena *arena);
+
+void *renderer_vulkan_linear_arena_allocate(VulkanLinearArena *arena, VkDeviceSize size, VkDeviceSize alignment,
+                                            VkDeviceSize *offset);
+
+void renderer_vulkan_linear_arena_reset(VulkanLinearArena *arena);
+
+#endif //CGFS_RENDERER_VULKAN_MEMORY_H
@@ -0,0 +1,244 @@
+#include <string.h>
+#include "renderer_vulkan_upload.h"
+
+#define UPLOAD_ALIGNMENT 16
+
+VkResult renderer_vulkan_upload_submit_batch(VulkanUploader *uploader, VkSemaphore signalSemaphore) {
+    VulkanUploadBatch *batch = &uploader->batches[uploader->currentBatch];
+    VkResult result = vkEndCommandBuffer(batch->commandBuffer);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = vkResetFences(uploader->allocator->device, 1, &batch->fence);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    VkSubmitInfo submitInfo;
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = NULL;
+    submitInfo.waitSemaphoreCount = 0;
+    submitInfo.pWaitSemaphores = NULL;
+    submitInfo.pWaitDstStageMask = NULL;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch->commandBuffer;
+    submitInfo.signalSemaphoreCount = signalSemaphore != VK_NULL_HANDLE ? 1 : 0;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+    result = vkQueueSubmit(uploader->queue, 1, &submitInfo, batch->fence);
+    batch->recording = false;
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    batch->ringEnd = uploader->head;
+    batch->submitted = true;
+    uploader->currentBatch = (uploader->currentBatch + 1) % VULKAN_UPLOAD_BATCH_COUNT;
+    uploader->unsynchronized = signalSemaphore == VK_NULL_HANDLE;
+    return VK_SUCCESS;
+}
+
+VkResult renderer_vulkan_upload_retire_batch(VulkanUploader *uploader, VulkanUploadBatch *batch) {
+    VkResult result = vkWaitForFences(uploader->allocator->device, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    if (batch->ringEnd > uploader->tail) {
+        uploader->tail = batch->ringEnd;
+    }
+    batch->submitted = false;
+    return VK_SUCCESS;
+}
+
+VkResult renderer_vulkan_upload_begin_batch(VulkanUploader *uploader) {
+    VulkanUploadBatch *batch = &uploader->batches[uploader->currentBatch];
+    if (batch->recording) {
+        return VK_SUCCESS;
+    }
+    if (batch->submitted) {
+        VkResult result = renderer_vulkan_upload_retire_batch(uploader, batch);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+    VkResult result = vkResetCommandBuffer(batch->commandBuffer, 0);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    VkCommandBufferBeginInfo commandBufferBeginInfo;
+    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    commandBufferBeginInfo.pNext = NULL;
+    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    commandBufferBeginInfo.pInheritanceInfo = NULL;
+    result = vkBeginCommandBuffer(batch->commandBuffer, &commandBufferBeginInfo);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    batch->recording = true;
+    return VK_SUCCESS;
+}
+
+VkResult renderer_vulkan_upload_reserve(VulkanUploader *uploader, VkDeviceSize size, VkDeviceSize *offset) {
+    for (;;) {
+        u64 position = (uploader->head + UPLOAD_ALIGNMENT - 1) / UPLOAD_ALIGNMENT * UPLOAD_ALIGNMENT;
+        VkDeviceSize ringOffset = position % uploader->capacity;
+        if (ringOffset + size > uploader->capacity) {
+            position += uploader->capacity - ringOffset;
+            ringOffset = 0;
+        }
+        if (position + size - uploader->tail <= uploader->capacity) {
+            uploader->head = position + size;
+            *offset = ringOffset;
+            return VK_SUCCESS;
+        }
+        VulkanUploadBatch *oldestBatch = NULL;
+        for (u32 i = 1; i <= VULKAN_UPLOAD_BATCH_COUNT; i++) {
+            VulkanUploadBatch *batch = &uploader->batches[(uploader->currentBatch + i) % VULKAN_UPLOAD_BATCH_COUNT];
+            if (batch->submitted) {
+                oldestBatch = batch;
+                break;
+            }
+        }
+        VkResult result;
+        if (oldestBatch != NULL) {
+            result = renderer_vulkan_upload_retire_batch(uploader, oldestBatch);
+        } else if (uploader->batches[uploader->currentBatch].recording) {
+            result = renderer_vulkan_upload_submit_batch(uploader, VK_NULL_HANDLE);
+        } else {
+            uploader->tail = uploader->head;
+            result = VK_SUCCESS;
+        }
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+}
+
+VkResult renderer_vulkan_upload_create(VulkanMemoryAllocator *allocator, VkQueue queue, u32 queueFamilyIndex,
+                                       VkDeviceSize capacity, VulkanUploader *uploader) {
+    memset(uploader, 0, sizeof(VulkanUploader));
+    uploader->allocator = allocator;
+    uploader->queue = queue;
+    uploader->capacity = capacity;
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo;
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.pNext = NULL;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT |
+                                  VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+    VkResult result = vkCreateCommandPool(allocator->device, &commandPoolCreateInfo, NULL, &uploader->commandPool);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkCommandBuffer commandBuffers[VULKAN_UPLOAD_BATCH_COUNT];
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo;
+    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.pNext = NULL;
+    commandBufferAllocateInfo.commandPool = uploader->commandPool;
+    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = VULKAN_UPLOAD_BATCH_COUNT;
+    result = vkAllocateCommandBuffers(allocator->device, &commandBufferAllocateInfo, commandBuffers);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkFenceCreateInfo fenceCreateInfo;
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceCreateInfo.pNext = NULL;
+    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    for (u32 i = 0; i < VULKAN_UPLOAD_BATCH_COUNT; i++) {
+        uploader->batches[i].commandBuffer = commandBuffers[i];
+        result = vkCreateFence(allocator->device, &fenceCreateInfo, NULL, &uploader->batches[i].fence);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+
+    VkBufferCreateInfo bufferCreateInfo;
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.pNext = NULL;
+    bufferCreateInfo.flags = 0;
+    bufferCreateInfo.size = capacity;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    bufferCreateInfo.queueFamilyIndexCount = 0;
+    bufferCreateInfo.pQueueFamilyIndices = NULL;
+    return renderer_vulkan_memory_create_buffer(allocator, &bufferCreateInfo,
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, &uploader->ringBuffer,
+                                                &uploader->ringAllocation);
+}
+
+void renderer_vulkan_upload_destroy(VulkanUploader *uploader) {
+    VkDevice device = uploader->allocator->device;
+    vkQueueWaitIdle(uploader->queue);
+    for (u32 i = 0; i < VULKAN_UPLOAD_BATCH_COUNT; i++) {
+        vkDestroyFence(device, uploader->batches[i].fence, NULL);
+    }
+    vkDestroyCommandPool(device, uploader->commandPool, NULL);
+    renderer_vulkan_memory_destroy_buffer(uploader->allocator, uploader->ringBuffer, &uploader->ringAllocation);
+    memset(uploader, 0, sizeof(VulkanUploader));
+}
+
+VkResult renderer_vulkan_upload_buffer(VulkanUploader *uploader, VkBuffer buffer, VkDeviceSize offset,
+                                       const void *data, VkDeviceSize size) {
+    VkDeviceSize maxChunkSize = uploader->capacity / 2;
+    while (size > 0) {
+        VkDeviceSize chunkSize = size < maxChunkSize ? size : maxChunkSize;
+        VkDeviceSize ringOffset;
+        VkResult result = renderer_vulkan_upload_reserve(uploader, chunkSize, &ringOffset);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        result = renderer_vulkan_upload_begin_batch(uploader);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        memcpy((u8 *) uploader->ringAllocation.mapped + ringOffset, data, chunkSize);
+        VkBufferCopy region;
+        region.srcOffset = ringOffset;
+        region.dstOffset = offset;
+        region.size = chunkSize;
+        vkCmdCopyBuffer(uploader->batches[uploader->currentBatch].commandBuffer, uploader->ringBuffer, buffer, 1,
+                        &region);
+        data = (const u8 *) data + chunkSize;
+        offset += chunkSize;
+        size -= chunkSize;
+    }
+    return VK_SUCCESS;
+}
+
+/*
+ * Submits the copies recorded so far. The semaphore is signaled once every upload submitted up to this point has
+ * finished, since a semaphore signal waits for all earlier work on the same queue.
+ */
+VkResult renderer_vulkan_upload_submit(VulkanUploader *uploader, VkSemaphore signalSemaphore, bool *signaled) {
+    *signaled = false;
+    if (uploader->batches[uploader->currentBatch].recording) {
+        VkResult result = renderer_vulkan_upload_submit_batch(uploader, signalSemaphore);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        *signaled = true;
+        return VK_SUCCESS;
+    }
+    if (!uploader->unsynchronized) {
+        return VK_SUCCESS;
+    }
+    VkSubmitInfo submitInfo;
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = NULL;
+    submitInfo.waitSemaphoreCount = 0;
+    submitInfo.pWaitSemaphores = NULL;
+    submitInfo.pWaitDstStageMask = NULL;
+    submitInfo.commandBufferCount = 0;
+    submitInfo.pCommandBuffers = NULL;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+    VkResult result = vkQueueSubmit(uploader->queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    uploader->unsynchronized = false;
+    *signaled = true;
+    return VK_SUCCESS;
+}
@@ -0,0 +1,42 @@
+#ifndef CGFS_RENDERER_VULKAN_UPLOAD_H
+#define CGFS_RENDERER_VULKAN_UPLOAD_H
+
+#include <vulkan/vulkan_core.h>
+#include "types.h"
+#include "renderer_vulkan_memory.h"
+
+#define VULKAN_UPLOAD_BATCH_COUNT 4
+
+typedef struct vulkan_upload_batch_s {
+    VkCommandBuffer commandBuffer;
+    VkFence fence;
+    u64 ringEnd;
+    bool recording;
+    bool submitted;
+} VulkanUploadBatch;
+
+typedef struct vulkan_uploader_s {
+    VulkanMemoryAllocator *allocator;
+    VkQueue queue;
+    VkCommandPool commandPool;
+    VkBuffer ringBuffer;
+    VulkanAllocation ringAllocation;
+    VkDeviceSize capacity;
+    u64 head;
+    u64 tail;
+    VulkanUploadBatch batches[VULKAN_UPLOAD_BATCH_COUNT];
+    u32 currentBatch;
+    bool unsynchronized;
+} VulkanUploader;
+
+VkResult renderer_vulkan_upload_create(VulkanMemoryAllocator *allocator, VkQueue queue, u32 queueFamilyIndex,
+                                       VkDeviceSize capacity, VulkanUploader *uploader);
+
+void renderer_vulkan_upload_destroy(VulkanUploader *uploader);
+
+VkResult renderer_vulkan_upload_buffer(VulkanUploader *uploader, VkBuffer buffer, VkDeviceSize offset,
+                                       const void *data, VkDeviceSize size);
+
+VkResult renderer_vulkan_upload_submit(VulkanUploader *uploader, VkSemaphore signalSemaphore, bool *signaled);
+
+#endif //CGFS_RENDERER_VULKAN_UPLOAD_H
@@ -0,0 +1,366 @@
+#include "resolver.h"
+#include "atomic.h"
+#include "condition.h"
+#include "file.h"
+#include "futex.h"
+#include "thread.h"
+#include "timer.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RESOLVER_DEFAULT_THREAD_COUNT 2
+#define RESOLVER_DEFAULT_TTL_MS 60000
+#define RESOLVER_NEGATIVE_TTL_MS 5000
+#define RESOLVER_CACHE_CAPACITY 64
+#define RESOLVER_MAX_HOST_ADDRESS 64
+
+typedef struct resolver_cache_entry_s {
+    char hostname[RESOLVER_MAX_HOSTNAME];
+    char service[RESOLVER_MAX_SERVICE];
+    int family;
+    int socketType;
+    i32 status;
+    ResolverAddress addresses[RESOLVER_MAX_ADDRESSES];
+    u32 addressCount;
+    u64 expiry;
+    u64 lastUsed;
+} ResolverCacheEntry;
+
+typedef struct resolver_host_s {
+    char name[RESOLVER_MAX_HOSTNAME];
+    char address[RESOLVER_MAX_HOST_ADDRESS];
+} ResolverHost;
+
+/*
+ * Queries queue up for a few threads that block in getaddrinfo. The cache is a small array searched linearly, which is
+ * plenty for the handful of hosts a process talks to; when it is full the least recently used entry goes.
+ */
+struct resolver_s {
+    Mutex mutex;
+    Condition condition;
+    bool stopping;
+    ResolverQuery *head;
+    ResolverQuery *tail;
+    Thread *threads;
+    u32 threadCount;
+    ResolverCacheEntry cache[RESOLVER_CACHE_CAPACITY];
+    u32 cacheCount;
+    ResolverHost *hosts;
+    u32 hostCount;
+    bool useHosts;
+    u64 ttl;
+    ResolverStats stats;
+};
+
+bool resolver_names_equal(const char *a, const char *b) {
+    for (; *a != '\0' && *b != '\0'; a++, b++) {
+        char lowerA = *a >= 'A' && *a <= 'Z' ? (char) (*a - 'A' + 'a') : *a;
+        char lowerB = *b >= 'A' && *b <= 'Z' ? (char) (*b - 'A' + 'a') : *b;
+        if (lowerA != lowerB) {
+            return false;
+        }
+    }
+    return *a == *b;
+}
+
+void resolver_complete(ResolverQuery *query, int status) {
+    query->status = status;
+    atomic_store_i32(&query->done, 1, ATOMIC_RELEASE);
+    futex_wake_all(&query->done);
+}
+
+/* Expects the mutex to be held. */
+ResolverCacheEntry *resolver_cache_find(Resolver *resolver, const ResolverQuery *query, u64 now) {
+    for (u32 i = 0; i < resolver->cacheCount; i++) {
+        ResolverCacheEntry *entry = &resolver->cache[i];
+        if (entry->expiry > now && entry->family == query->family && entry->socketType == query->socketType &&
+            strcmp(entry->service, query->service) == 0 && resolver_names_equal(entry->hostname, query->hostname)) {
+            entry->lastUsed = now;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Expects the mutex to be held. */
+void resolver_cache_store(Resolver *resolver, const ResolverQuery *query, int status, u64 now) {
+    ResolverCacheEntry *entry = NULL;
+    for (u32 i = 0; i < resolver->cacheCount && entry == NULL; i++) {
+        ResolverCacheEntry *candidate = &resolver->cache[i];
+        if (candidate->expiry <= now ||
+            (candidate->family == query->family && candidate->socketType == query->socketType &&
+             strcmp(candidate->service, query->service) == 0 &&
+             resolver_names_equal(candidate->hostname, query->hostname))) {
+            entry = candidate;
+        }
+    }
+    if (entry == NULL && resolver->cacheCount < RESOLVER_CACHE_CAPACITY) {
+        entry = &resolver->cache[resolver->cacheCount++];
+    }
+    if (entry == NULL) {
+        entry = &resolver->cache[0];
+        for (u32 i = 1; i < resolver->cacheCount; i++) {
+            if (resolver->cache[i].lastUsed < entry->lastUsed) {
+                entry = &resolver->cache[i];
+            }
+        }
+    }
+    memcpy(entry->hostname, query->hostname, sizeof(entry->hostname));
+    memcpy(entry->service, query->service, sizeof(entry->service));
+    entry->family = query->family;
+    entry->socketType = query->socketType;
+    entry->status = status;
+    memcpy(entry->addresses, query->addresses, sizeof(ResolverAddress) * query->addressCount);
+    entry->addressCount = query->addressCount;
+    entry->expiry = now + (status == 0 ? resolver->ttl : (u64) RESOLVER_NEGATIVE_TTL_MS * 1000000);
+    entry->lastUsed = now;
+}
+
+/* Appends what getaddrinfo found to the query, up to RESOLVER_MAX_ADDRESSES. */
+int resolver_lookup(ResolverQuery *query, const char *hostname, int flags) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = query->family;
+    hints.ai_socktype = query->socketType;
+    hints.ai_flags = flags;
+    struct addrinfo *addressInfo;
+    int status = socket_get_address_info(hostname, query->service[0] != '\0' ? query->service : NULL, &hints,
+                                         &addressInfo);
+    if (status != 0) {
+        return status;
+    }
+    for (struct addrinfo *info = addressInfo; info != NULL && query->addressCount < RESOLVER_MAX_ADDRESSES;
+         info = info->ai_next) {
+        if (info->ai_addrlen > sizeof(struct sockaddr_storage)) {
+            continue;
+        }
+        ResolverAddress *address = &query->addresses[query->addressCount++];
+        memcpy(&address->address, info->ai_addr, info->ai_addrlen);
+        address->length = (int) info->ai_addrlen;
+    }
+    socket_free_address_info(addressInfo);
+    return 0;
+}
+
+/* The hosts table never changes after creation, so it is read without the mutex. */
+int resolver_lookup_hosts(Resolver *resolver, ResolverQuery *query) {
+    for (u32 i = 0; i < resolver->hostCount; i++) {
+        if (resolver_names_equal(resolver->hosts[i].name, query->hostname)) {
+            /* Numeric lookups of the address never leave the process; a family mismatch just yields nothing. */
+            resolver_lookup(query, resolver->hosts[i].address, AI_NUMERICHOST | AI_NUMERICSERV);
+        }
+    }
+    return query->addressCount > 0 ? 0 : EAI_NONAME;
+}
+
+void *resolver_worker(void *arg) {
+    Resolver *resolver = arg;
+    mutex_lock(&resolver->mutex);
+    while (true) {
+        while (resolver->head == NULL && !resolver->stopping) {
+            condition_wait(&resolver->condition, &resolver->mutex);
+        }
+        ResolverQuery *query = resolver->head;
+        if (query == NULL || resolver->stopping) {
+            break;
+        }
+        resolver->head = query->next;
+        if (resolver->head == NULL) {
+            resolver->tail = NULL;
+        }
+        mutex_unlock(&resolver->mutex);
+        int status = resolver->useHosts ? resolver_lookup_hosts(resolver, query)
+                                        : resolver_lookup(query, query->hostname, 0);
+        mutex_lock(&resolver->mutex);
+        resolver_cache_store(resolver, query, status, timer_get_time_ns());
+        resolver_complete(query, status);
+    }
+    mutex_unlock(&resolver->mutex);
+    return NULL;
+}
+
+/* Lines are an address followed by names, with # starting a comment, as in /etc/hosts. */
+int resolver_load_hosts(Resolver *resolver, const char *path) {
+    FileMapping mapping;
+    int status = file_map(path, FILE_ACCESS_SEQUENTIAL, &mapping);
+    if (status != 0) {
+        return status;
+    }
+    u32 capacity = 0;
+    const char *text = (const char *) mapping.data;
+    usize position = 0;
+    while (position < mapping.length) {
+        char fields[2][RESOLVER_MAX_HOSTNAME];
+        u32 fieldCount = 0;
+        while (position < mapping.length && text[position] != '\n') {
+            char c = text[position];
+            if (c == '#') {
+                while (position < mapping.length && text[position] != '\n') {
+                    position++;
+                }
+                break;
+            }
+            if (c == ' ' || c == '\t' || c == '\r') {
+                position++;
+                continue;
+            }
+            usize start = position;
+            while (position < mapping.length && text[position] != ' ' && text[position] != '\t' &&
+                   text[position] != '\r' && text[position] != '\n' && text[position] != '#') {
+                position++;
+            }
+            usize length = position - start;
+            u32 field = fieldCount == 0 ? 0 : 1;
+            usize limit = field == 0 ? RESOLVER_MAX_HOST_ADDRESS : RESOLVER_MAX_HOSTNAME;
+            if (length >= limit) {
+                /* A malformed address makes the rest of the line meaningless; overlong names are just skipped. */
+                while (field == 0 && position < mapping.length && text[position] != '\n') {
+                    position++;
+                }
+                continue;
+            }
+            memcpy(fields[field], text + start, length);
+            fields[field][length] = '\0';
+            fieldCount++;
+            if (fieldCount < 2) {
+                continue;
+            }
+            if (resolver->hostCount == capacity) {
+                capacity = capacity == 0 ? 16 : capacity * 2;
+                ResolverHost *hosts = realloc(resolver->hosts, sizeof(ResolverHost) * capacity);
+                if (hosts == NULL) {
+                    file_unmap(&mapping);
+                    return ENOMEM;
+                }
+                resolver->hosts = hosts;
+            }
+            ResolverHost *host = &resolver->hosts[resolver->hostCount++];
+            memcpy(host->name, fields[1], length + 1);
+            memcpy(host->address, fields[0], strlen(fields[0]) + 1);
+        }
+        position++;
+    }
+    file_unmap(&mapping);
+    return 0;
+}
+
+Resolver *resolver_create(u32 thread_count, const char *hosts_path, u64 ttl_ms) {
+    Resolver *resolver = calloc(1, sizeof(Resolver));
+    if (resolver == NULL) {
+        return NULL;
+    }
+    if (hosts_path != NULL) {
+        if (resolver_load_hosts(resolver, hosts_path) != 0) {
+            free(resolver->hosts);
+            free(resolver);
+            return NULL;
+        }
+        resolver->useHosts = true;
+    }
+    if (thread_count == 0) {
+        thread_count = RESOLVER_DEFAULT_THREAD_COUNT;
+    }
+    resolver->ttl = (ttl_ms != 0 ? ttl_ms : RESOLVER_DEFAULT_TTL_MS) * 1000000;
+    resolver->threads = malloc(sizeof(Thread) * thread_count);
+    if (resolver->threads == NULL || mutex_init(&resolver->mutex) != 0) {
+        free(resolver->threads);
+        free(resolver->hosts);
+        free(resolver);
+        return NULL;
+    }
+    condition_init(&resolver->condition);
+    for (u32 i = 0; i < thread_count; i++) {
+        Thread thread = thread_create(resolver_worker, resolver);
+        if (thread == 0) {
+            break;
+        }
+        resolver->threads[resolver->threadCount++] = thread;
+    }
+    if (resolver->threadCount == 0) {
+        resolver_destroy(resolver);
+        return NULL;
+    }
+    return resolver;
+}
+
+void resolver_destroy(Resolver *resolver) {
+    mutex_lock(&resolver->mutex);
+    resolver->stopping = true;
+    condition_broadcast(&resolver->condition);
+    mutex_unlock(&resolver->mutex);
+    for (u32 i = 0; i < resolver->threadCount; i++) {
+        usize result;
+        thread_join(resolver->threads[i], &result);
+    }
+    while (resolver->head != NULL) {
+        ResolverQuery *query = resolver->head;
+        resolver->head = query->next;
+        resolver_complete(query, ECANCELED);
+    }
+    free(resolver->threads);
+    free(resolver->hosts);
+    condition_destroy(&resolver->condition);
+    mutex_destroy(&resolver->mutex);
+    free(resolver);
+}
+
+int resolver_resolve(Resolver *resolver, const char *hostname, const char *service, int family, int socket_type,
+                     ResolverQuery *query) {
+    usize hostnameLength = strlen(hostname);
+    usize serviceLength = service != NULL ? strlen(service) : 0;
+    if (hostnameLength >= RESOLVER_MAX_HOSTNAME || serviceLength >= RESOLVER_MAX_SERVICE) {
+        query->status = ENAMETOOLONG;
+        query->done = 1;
+        return ENAMETOOLONG;
+    }
+    query->done = 0;
+    query->status = 0;
+    memcpy(query->hostname, hostname, hostnameLength + 1);
+    memcpy(query->service, service != NULL ? service : "", serviceLength + 1);
+    query->family = family;
+    query->socketType = socket_type;
+    query->addressCount = 0;
+    query->cached = false;
+    query->next = NULL;
+    mutex_lock(&resolver->mutex);
+    ResolverCacheEntry *entry = resolver_cache_find(resolver, query, timer_get_time_ns());
+    if (entry != NULL) {
+        resolver->stats.cacheHits++;
+        memcpy(query->addresses, entry->addresses, sizeof(ResolverAddress) * entry->addressCount);
+        query->addressCount = entry->addressCount;
+        query->cached = true;
+        int status = entry->status;
+        mutex_unlock(&resolver->mutex);
+        resolver_complete(query, status);
+        return 0;
+    }
+    resolver->stats.cacheMisses++;
+    if (resolver->tail != NULL) {
+        resolver->tail->next = query;
+    } else {
+        resolver->head = query;
+    }
+    resolver->tail = query;
+    condition_signal(&resolver->condition);
+    mutex_unlock(&resolver->mutex);
+    return 0;
+}
+
+bool resolver_query_is_done(ResolverQuery *query) {
+    return atomic_load_i32(&query->done, ATOMIC_ACQUIRE) != 0;
+}
+
+int resolver_query_wait(ResolverQuery *query) {
+    while (atomic_load_i32(&query->done, ATOMIC_ACQUIRE) == 0) {
+        futex_wait(&query->done, 0);
+    }
+    return query->status;
+}
+
+ResolverStats resolver_get_stats(Resolver *resolver) {
+    mutex_lock(&resolver->mutex);
+    ResolverStats stats = resolver->stats;
+    mutex_unlock(&resolver->mutex);
+    return stats;
+}
@@ -0,0 +1,60 @@
+#ifndef CGFS_RESOLVER_H
+#define CGFS_RESOLVER_H
+
+#include "socket.h"
+#include "types.h"
+
+#define RESOLVER_MAX_HOSTNAME 256
+#define RESOLVER_MAX_SERVICE 32
+#define RESOLVER_MAX_ADDRESSES 8
+
+typedef struct resolver_address_s {
+    struct sockaddr_storage address;
+    int length;
+} ResolverAddress;
+
+/*
+ * Completion handle of one lookup, owned by the caller, which must keep it at the same address until it is done.
+ * The status is 0, an EAI_ code as returned by getaddrinfo, or ECANCELED when the resolver was destroyed first.
+ */
+typedef struct resolver_query_s {
+    i32 done;
+    i32 status;
+    char hostname[RESOLVER_MAX_HOSTNAME];
+    char service[RESOLVER_MAX_SERVICE];
+    int family;
+    int socketType;
+    ResolverAddress addresses[RESOLVER_MAX_ADDRESSES];
+    u32 addressCount;
+    bool cached;
+    struct resolver_query_s *next;
+} ResolverQuery;
+
+typedef struct resolver_stats_s {
+    u64 cacheHits;
+    u64 cacheMisses;
+} ResolverStats;
+
+typedef struct resolver_s Resolver;
+
+/*
+ * Resolves on thread_count threads of its own and caches answers for ttl_ms, failures for a shorter time. getaddrinfo
+ * does not report record TTLs, hence the fixed one. With hosts_path the resolver answers only from that hosts file
+ * and never touches the network, which is meant for tests; the service then has to be a port number.
+ */
+Resolver *resolver_create(u32 thread_count, const char *hosts_path, u64 ttl_ms);
+
+/* Queries still waiting for a thread complete with ECANCELED. */
+void resolver_destroy(Resolver *resolver);
+
+/* Answers from the cache right away when it can, so the query may already be done on return. */
+int resolver_resolve(Resolver *resolver, const char *hostname, const char *service, int family, int socket_type,
+                     ResolverQuery *query);
+
+bool resolver_query_is_done(ResolverQuery *query);
+
+int resolver_query_wait(ResolverQuery *query);
+
+ResolverStats resolver_get_stats(Resolver *resolver);
+
+#endif //CGFS_RESOLVER_H
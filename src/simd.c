@@ -0,0 +1,122 @@
+#include "simd.h"
+
+#if defined(_MSC_VER) && defined(SIMD_X86)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static i32 simd_isa = -1;
+
+#if defined(SIMD_X86) && defined(_MSC_VER)
+
+bool simd_x86_supports(SimdIsa isa) {
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (isa == SIMD_ISA_SSE4) {
+        return sse41;
+    }
+    if (!osxsave || !avx || maxLeaf < 7) {
+        return false;
+    }
+    u64 xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    if (isa == SIMD_ISA_AVX2) {
+        return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+    }
+    return (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+}
+
+#elif defined(SIMD_X86)
+
+bool simd_x86_supports(SimdIsa isa) {
+    __builtin_cpu_init();
+    if (isa == SIMD_ISA_SSE4) {
+        return __builtin_cpu_supports("sse4.1");
+    }
+    if (isa == SIMD_ISA_AVX2) {
+        return __builtin_cpu_supports("avx2");
+    }
+    return __builtin_cpu_supports("avx512f");
+}
+
+#endif
+
+bool simd_is_isa_supported(SimdIsa isa) {
+    switch (isa) {
+        case SIMD_ISA_SCALAR:
+            return true;
+#ifdef SIMD_X86
+        case SIMD_ISA_SSE4:
+        case SIMD_ISA_AVX2:
+        case SIMD_ISA_AVX512:
+            return simd_x86_supports(isa);
+#endif
+#ifdef SIMD_NEON
+        case SIMD_ISA_NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+/*
+ * Picks the widest instruction set the processor supports the first time it is asked. simd_set_isa() overrides the
+ * choice, for example to compare narrower kernels against it.
+ */
+SimdIsa simd_get_isa() {
+    if (simd_isa >= 0) {
+        return (SimdIsa) simd_isa;
+    }
+    SimdIsa isa = SIMD_ISA_SCALAR;
+    for (i32 candidate = SIMD_ISA_COUNT - 1; candidate > SIMD_ISA_SCALAR; candidate--) {
+        if (simd_is_isa_supported((SimdIsa) candidate)) {
+            isa = (SimdIsa) candidate;
+            break;
+        }
+    }
+    simd_isa = isa;
+    return isa;
+}
+
+bool simd_set_isa(SimdIsa isa) {
+    if (!simd_is_isa_supported(isa)) {
+        return false;
+    }
+    simd_isa = isa;
+    return true;
+}
+
+u32 simd_get_width(SimdIsa isa) {
+    switch (isa) {
+        case SIMD_ISA_SSE4:
+        case SIMD_ISA_NEON:
+            return 4;
+        case SIMD_ISA_AVX2:
+            return 8;
+        case SIMD_ISA_AVX512:
+            return 16;
+        default:
+            return 1;
+    }
+}
+
+const char *simd_get_isa_name(SimdIsa isa) {
+    switch (isa) {
+        case SIMD_ISA_SSE4:
+            return "sse4";
+        case SIMD_ISA_AVX2:
+            return "avx2";
+        case SIMD_ISA_AVX512:
+            return "avx512";
+        case SIMD_ISA_NEON:
+            return "neon";
+        default:
+            return "scalar";
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef CGFS_SIMD_H
+#define CGFS_SIMD_H
+
+#include "types.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#define SIMD_ALIGN(bytes) __attribute__((aligned(bytes)))
+#else
+#define SIMD_TARGET(isa)
+#define SIMD_ALIGN(bytes) __declspec(align(bytes))
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SIMD_X86 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SIMD_NEON 1
+#endif
+
+typedef enum simd_isa_e {
+    SIMD_ISA_SCALAR,
+    SIMD_ISA_SSE4,
+    SIMD_ISA_AVX2,
+    SIMD_ISA_AVX512,
+    SIMD_ISA_NEON,
+    SIMD_ISA_COUNT
+} SimdIsa;
+
+SimdIsa simd_get_isa();
+
+bool simd_is_isa_supported(SimdIsa isa);
+
+bool simd_set_isa(SimdIsa isa);
+
+u32 simd_get_width(SimdIsa isa);
+
+const char *simd_get_isa_name(SimdIsa isa);
+
+#endif //CGFS_SIMD_H
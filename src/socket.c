@@ -1,9 +1,28 @@
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+
 #include "socket.h"
 
+#ifdef _WIN32
+#include <mswsock.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <sys/sendfile.h>
+#endif
+#endif
+
+#define SOCKET_BATCH_SIZE 64
+#define SOCKET_MAX_TRANSFER 0x7FFFF000
+
 int socket_global_init() {
 #ifdef _WIN32
     WSADATA wsaData;
-    WORD versionRequested = MAKEWORD(1, 1);
+    WORD versionRequested = MAKEWORD(2, 2);
     int status = WSAStartup(versionRequested, &wsaData);
     if (status != 0) {
         return status;
@@ -45,12 +64,315 @@ int socket_connect(Socket sock, const struct sockaddr *addr, int addr_length) {
     return connect(sock, addr, addr_length);
 }
 
-int socket_send(Socket sock, const void *buffer, int length, int flags) {
+int socket_listen(Socket sock, int backlog) {
+    return listen(sock, backlog);
+}
+
+Socket socket_accept(Socket sock, struct sockaddr *addr, int *addr_length) {
+#ifdef _WIN32
+    return accept(sock, addr, addr_length);
+#else
+    socklen_t length = addr_length != NULL ? (socklen_t) *addr_length : 0;
+    Socket result = accept(sock, addr, addr_length != NULL ? &length : NULL);
+    if (addr_length != NULL) {
+        *addr_length = (int) length;
+    }
+    return result;
+#endif
+}
+
+int socket_set_non_blocking(Socket sock, bool non_blocking) {
+#ifdef _WIN32
+    u_long mode = non_blocking ? 1 : 0;
+    return ioctlsocket(sock, FIONBIO, &mode);
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags == -1) {
+        return -1;
+    }
+    flags = non_blocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK;
+    return fcntl(sock, F_SETFL, flags);
+#endif
+}
+
+int socket_set_option(Socket sock, int level, int name, const void *value, int value_length) {
+    return setsockopt(sock, level, name, value, value_length);
+}
+
+int socket_poll(Socket sock, short events, int timeout_ms, short *returned_events) {
+    struct pollfd descriptor;
+    descriptor.fd = sock;
+    descriptor.events = events;
+    descriptor.revents = 0;
+#ifdef _WIN32
+    int result = WSAPoll(&descriptor, 1, timeout_ms);
+#else
+    int result = poll(&descriptor, 1, timeout_ms);
+#endif
+    if (returned_events != NULL) {
+        *returned_events = result > 0 ? descriptor.revents : 0;
+    }
+    return result;
+}
+
+int socket_get_last_error() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+/* Single calls are capped like Linux caps read and write, so callers see an ordinary partial transfer. */
+isize socket_send(Socket sock, const void *buffer, usize length, int flags) {
+#ifdef _WIN32
+    return send(sock, buffer, length > SOCKET_MAX_TRANSFER ? SOCKET_MAX_TRANSFER : (int) length, flags);
+#else
     return send(sock, buffer, length, flags);
+#endif
 }
 
-int socket_receive(Socket sock, void *buffer, int length, int flags) {
+isize socket_receive(Socket sock, void *buffer, usize length, int flags) {
+#ifdef _WIN32
+    return recv(sock, buffer, length > SOCKET_MAX_TRANSFER ? SOCKET_MAX_TRANSFER : (int) length, flags);
+#else
     return recv(sock, buffer, length, flags);
+#endif
+}
+
+#ifndef _WIN32
+void socket_fill_message_header(struct msghdr *header, const SocketMessage *message) {
+    memset(header, 0, sizeof(struct msghdr));
+    header->msg_name = message->address;
+    header->msg_namelen = message->address != NULL ? (socklen_t) message->addressLength : 0;
+    header->msg_iov = message->buffers;
+    header->msg_iovlen = message->bufferCount;
+}
+#endif
+
+isize socket_send_vector(Socket sock, const SocketBuffer *buffers, u32 count, int flags) {
+#ifdef _WIN32
+    DWORD sent = 0;
+    if (WSASend(sock, (SocketBuffer *) buffers, count, &sent, (DWORD) flags, NULL, NULL) != 0) {
+        return -1;
+    }
+    return (isize) sent;
+#else
+    struct msghdr header;
+    memset(&header, 0, sizeof(struct msghdr));
+    header.msg_iov = (SocketBuffer *) buffers;
+    header.msg_iovlen = count;
+    return sendmsg(sock, &header, flags);
+#endif
+}
+
+isize socket_receive_vector(Socket sock, SocketBuffer *buffers, u32 count, int flags) {
+#ifdef _WIN32
+    DWORD received = 0;
+    DWORD receiveFlags = (DWORD) flags;
+    if (WSARecv(sock, buffers, count, &received, &receiveFlags, NULL, NULL) != 0) {
+        return -1;
+    }
+    return (isize) received;
+#else
+    struct msghdr header;
+    memset(&header, 0, sizeof(struct msghdr));
+    header.msg_iov = buffers;
+    header.msg_iovlen = count;
+    return recvmsg(sock, &header, flags);
+#endif
+}
+
+int socket_send_message(Socket sock, SocketMessage *message, int flags) {
+#ifdef _WIN32
+    DWORD sent = 0;
+    if (WSASendTo(sock, message->buffers, message->bufferCount, &sent, (DWORD) flags, message->address,
+                  message->address != NULL ? message->addressLength : 0, NULL, NULL) != 0) {
+        return -1;
+    }
+    message->length = sent;
+#else
+    struct msghdr header;
+    socket_fill_message_header(&header, message);
+    ssize_t sent = sendmsg(sock, &header, flags);
+    if (sent < 0) {
+        return -1;
+    }
+    message->length = (usize) sent;
+#endif
+    return 0;
+}
+
+int socket_receive_message(Socket sock, SocketMessage *message, int flags) {
+#ifdef _WIN32
+    DWORD received = 0;
+    DWORD receiveFlags = (DWORD) flags;
+    if (WSARecvFrom(sock, message->buffers, message->bufferCount, &received, &receiveFlags, message->address,
+                    message->address != NULL ? &message->addressLength : NULL, NULL, NULL) != 0) {
+        return -1;
+    }
+    message->length = received;
+#else
+    struct msghdr header;
+    socket_fill_message_header(&header, message);
+    ssize_t received = recvmsg(sock, &header, flags);
+    if (received < 0) {
+        return -1;
+    }
+    message->length = (usize) received;
+    message->addressLength = (int) header.msg_namelen;
+#endif
+    return 0;
+}
+
+int socket_send_batch(Socket sock, SocketMessage *messages, u32 count, int flags) {
+    u32 sent = 0;
+#if defined(__linux__)
+    struct mmsghdr headers[SOCKET_BATCH_SIZE];
+    while (sent < count) {
+        u32 batch = count - sent < SOCKET_BATCH_SIZE ? count - sent : SOCKET_BATCH_SIZE;
+        for (u32 i = 0; i < batch; i++) {
+            socket_fill_message_header(&headers[i].msg_hdr, &messages[sent + i]);
+        }
+        int result = sendmmsg(sock, headers, batch, flags);
+        if (result < 0) {
+            return sent > 0 ? (int) sent : -1;
+        }
+        for (int i = 0; i < result; i++) {
+            messages[sent + i].length = headers[i].msg_len;
+        }
+        sent += (u32) result;
+        if ((u32) result < batch) {
+            break;
+        }
+    }
+#else
+    for (; sent < count; sent++) {
+        if (socket_send_message(sock, &messages[sent], flags) != 0) {
+            return sent > 0 ? (int) sent : -1;
+        }
+    }
+#endif
+    return (int) sent;
+}
+
+int socket_receive_batch(Socket sock, SocketMessage *messages, u32 count, int flags) {
+#if defined(__linux__)
+    struct mmsghdr headers[SOCKET_BATCH_SIZE];
+    u32 batch = count < SOCKET_BATCH_SIZE ? count : SOCKET_BATCH_SIZE;
+    for (u32 i = 0; i < batch; i++) {
+        socket_fill_message_header(&headers[i].msg_hdr, &messages[i]);
+    }
+    int result = recvmmsg(sock, headers, batch, flags | MSG_WAITFORONE, NULL);
+    for (int i = 0; i < result; i++) {
+        messages[i].length = headers[i].msg_len;
+        messages[i].addressLength = (int) headers[i].msg_hdr.msg_namelen;
+    }
+    return result;
+#else
+    if (count == 0) {
+        return 0;
+    }
+    if (socket_receive_message(sock, &messages[0], flags) != 0) {
+        return -1;
+    }
+    /* Later datagrams are only taken if they are already there, so the call never blocks for more than one. */
+    u32 received = 1;
+#ifdef _WIN32
+    u_long available = 0;
+    while (received < count && ioctlsocket(sock, FIONREAD, &available) == 0 && available > 0 &&
+           socket_receive_message(sock, &messages[received], flags) == 0) {
+        received++;
+    }
+#else
+    while (received < count && socket_receive_message(sock, &messages[received], flags | MSG_DONTWAIT) == 0) {
+        received++;
+    }
+#endif
+    return (int) received;
+#endif
+}
+
+int socket_enable_zero_copy(Socket sock) {
+#if defined(__linux__) && defined(SO_ZEROCOPY)
+    int enable = 1;
+    return setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable));
+#elif defined(_WIN32)
+    WSASetLastError(WSAEOPNOTSUPP);
+    return -1;
+#else
+    errno = EOPNOTSUPP;
+    return -1;
+#endif
+}
+
+int socket_get_zero_copy_completions(Socket sock, u32 *first, u32 *last) {
+#if defined(__linux__) && defined(SO_EE_ORIGIN_ZEROCOPY)
+    u8 control[CMSG_SPACE(sizeof(struct sock_extended_err))];
+    struct msghdr header;
+    memset(&header, 0, sizeof(struct msghdr));
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    if (recvmsg(sock, &header, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    for (struct cmsghdr *message = CMSG_FIRSTHDR(&header); message != NULL; message = CMSG_NXTHDR(&header, message)) {
+        struct sock_extended_err error;
+        memcpy(&error, CMSG_DATA(message), sizeof(struct sock_extended_err));
+        if (error.ee_errno == 0 && error.ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+            *first = error.ee_info;
+            *last = error.ee_data;
+            return 1;
+        }
+    }
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+isize socket_send_file(Socket sock, FileHandle file, u64 offset, usize length) {
+    if (length > SOCKET_MAX_TRANSFER) {
+        length = SOCKET_MAX_TRANSFER;
+    }
+#ifdef _WIN32
+    /*
+     * TransmitFile succeeds after sending less when it reaches the end of the file, and sends the whole file when asked
+     * for 0 bytes, so the length is clamped to what the file still holds up front.
+     */
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        WSASetLastError((int) GetLastError());
+        return -1;
+    }
+    if (offset >= (u64) size.QuadPart) {
+        return 0;
+    }
+    if (length > (u64) size.QuadPart - offset) {
+        length = (usize) ((u64) size.QuadPart - offset);
+    }
+    /* TransmitFile sends from the current file position, which is why the handle is not shared between threads. */
+    LARGE_INTEGER position;
+    position.QuadPart = (LONGLONG) offset;
+    if (!SetFilePointerEx(file, position, NULL, FILE_BEGIN)) {
+        WSASetLastError((int) GetLastError());
+        return -1;
+    }
+    if (!TransmitFile(sock, file, (DWORD) length, 0, NULL, NULL, 0)) {
+        return -1;
+    }
+    return (isize) length;
+#elif defined(__linux__)
+    off_t position = (off_t) offset;
+    return sendfile(sock, file, &position, length);
+#else
+    u8 buffer[65536];
+    ssize_t read = pread(file, buffer, length < sizeof(buffer) ? length : sizeof(buffer), (off_t) offset);
+    if (read <= 0) {
+        return read;
+    }
+    return send(sock, buffer, (usize) read, 0);
+#endif
 }
 
 int socket_shutdown(Socket sock, int how) {
@@ -1,10 +1,13 @@
 #ifndef CGFS_SOCKET_H
 #define CGFS_SOCKET_H
 
+#include "file.h"
+#include "types.h"
+
 #ifdef _WIN32
 /* See http://stackoverflow.com/questions/12765743/getaddrinfo-on-win32 */
 #ifndef _WIN32_WINNT
-#define _WIN32_WINNT 0x0501  /* Windows XP. */
+#define _WIN32_WINNT 0x0600  /* Windows Vista, the first with WSAPoll. */
 #endif
 
 #include <winsock2.h>
@@ -12,6 +15,11 @@
 
 typedef SOCKET Socket;
 
+typedef WSABUF SocketBuffer;
+
+#define INVALID_SOCKET_HANDLE INVALID_SOCKET
+#define SOCKET_SEND_ZERO_COPY 0
+
 enum {
     SHUT_RD = SD_RECEIVE,
 #define SHUT_RD SHUT_RD
@@ -26,10 +34,43 @@ enum {
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netdb.h>  /* Needed for getaddrinfo() and freeaddrinfo() */
+#include <poll.h>
+#include <sys/uio.h>
 #include <unistd.h> /* Needed for close() */
 
 typedef int Socket;
+
+typedef struct iovec SocketBuffer;
+
+#define INVALID_SOCKET_HANDLE (-1)
+#ifdef MSG_ZEROCOPY
+#define SOCKET_SEND_ZERO_COPY MSG_ZEROCOPY
+#else
+#define SOCKET_SEND_ZERO_COPY 0
 #endif
+#endif
+
+/* Win32 buffers hold at most 4 GiB; vectored calls may then transfer less than asked, like any partial send. */
+static inline SocketBuffer socket_buffer(const void *data, usize length) {
+    SocketBuffer buffer;
+#ifdef _WIN32
+    buffer.buf = (char *) data;
+    buffer.len = length > 0xFFFFFFFFu ? 0xFFFFFFFFu : (ULONG) length;
+#else
+    buffer.iov_base = (void *) data;
+    buffer.iov_len = length;
+#endif
+    return buffer;
+}
+
+/* One datagram for the batched calls. address is optional; length is the number of bytes transferred. */
+typedef struct socket_message_s {
+    SocketBuffer *buffers;
+    u32 bufferCount;
+    struct sockaddr *address;
+    int addressLength;
+    usize length;
+} SocketMessage;
 
 int socket_global_init();
 
@@ -46,9 +87,54 @@ int socket_bind(Socket sock, const struct sockaddr *addr, int addr_length);
 
 int socket_connect(Socket sock, const struct sockaddr *addr, int addr_length);
 
-int socket_send(Socket sock, const void *buffer, int length, int flags);
+int socket_listen(Socket sock, int backlog);
+
+Socket socket_accept(Socket sock, struct sockaddr *addr, int *addr_length);
+
+int socket_set_non_blocking(Socket sock, bool non_blocking);
+
+int socket_set_option(Socket sock, int level, int name, const void *value, int value_length);
+
+/*
+ * Waits up to timeout_ms, or forever when negative, for any of events (POLLIN, POLLOUT) on one socket and stores the
+ * ones that occurred. Unlike select it works for any descriptor number. Returns 1, 0 on timeout, or -1.
+ */
+int socket_poll(Socket sock, short events, int timeout_ms, short *returned_events);
+
+/* errno or WSAGetLastError of the last failed call on this thread. */
+int socket_get_last_error();
+
+isize socket_send(Socket sock, const void *buffer, usize length, int flags);
+
+isize socket_receive(Socket sock, void *buffer, usize length, int flags);
+
+/* Gathers the buffers into a single sendmsg / WSASend. Returns the bytes sent or -1. */
+isize socket_send_vector(Socket sock, const SocketBuffer *buffers, u32 count, int flags);
+
+/* Scatters one recvmsg / WSARecv over the buffers. Returns the bytes received, 0 at the end of the stream, or -1. */
+isize socket_receive_vector(Socket sock, SocketBuffer *buffers, u32 count, int flags);
+
+/* Sends count datagrams with as few calls as the platform allows (sendmmsg on Linux). Returns the number sent or -1. */
+int socket_send_batch(Socket sock, SocketMessage *messages, u32 count, int flags);
+
+/* Waits for at least one datagram and takes whatever else is already queued, up to count. Returns the number or -1. */
+int socket_receive_batch(Socket sock, SocketMessage *messages, u32 count, int flags);
+
+/*
+ * Allows SOCKET_SEND_ZERO_COPY on later sends (MSG_ZEROCOPY, Linux only), which pins the pages instead of copying
+ * them. Worth it for payloads of a few hundred KiB and up; a buffer must stay untouched until its send was reported
+ * by socket_get_zero_copy_completions.
+ */
+int socket_enable_zero_copy(Socket sock);
+
+/*
+ * Reads one notification from the error queue without blocking. Zero copy sends are numbered from 0 in issue order,
+ * and the notification covers [first, last]. Returns 1 when a range was read, 0 when none is pending, or -1.
+ */
+int socket_get_zero_copy_completions(Socket sock, u32 *first, u32 *last);
 
-int socket_receive(Socket sock, void *buffer, int length, int flags);
+/* Sends length bytes of the file starting at offset without copying them through user space where supported. */
+isize socket_send_file(Socket sock, FileHandle file, u64 offset, usize length);
 
 int socket_shutdown(Socket sock, int how);
 
@@ -1,20 +1,46 @@
 #include "starter.h"
 #include "socket.h"
+#include "render_thread.h"
 #include "thread.h"
 #include "mutex.h"
 #include "window.h"
 #include "renderer.h"
-#include "file.h"
+#include "file_async.h"
+#include "archive.h"
+#include "embedded_assets.h"
+#include "job.h"
+#include "profiler.h"
+#include "raytracer.h"
+#include "demo_scene.h"
+#include "timer.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#define ASSET_ARCHIVE_PATH "assets.cga"
+#define HEADLESS_WIDTH 800
+#define HEADLESS_HEIGHT 600
+#define HEADLESS_DEFAULT_FRAME_COUNT 100
+#define WINDOWED_DEFAULT_TARGET_FPS 60
+#define RAYTRACE_DEFAULT_FRAME_COUNT 10
+#define RASTERIZE_DEFAULT_CUBE_COUNT 512
 
 const char *message = "Some message";
 
 Mutex mutex;
 
+typedef struct shader_data_s {
+    FileMapping mapping;
+    u8 *buffer;
+    const u32 *code;
+    usize length;
+} ShaderData;
+
 typedef struct cgfs_global_state_s {
     Window window;
     Renderer renderer;
+    Mesh mesh;
+    RenderThread *renderThread;
 } CgfsGlobalState;
 
 static CgfsGlobalState cgfs_global_state;
@@ -34,9 +60,12 @@ void test_socket() {
     socket_global_init();
     Socket sock = socket_create(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     struct addrinfo *address_info;
-    socket_get_address_info("google.com", "80", 0, &address_info);
-    socket_connect(sock, address_info->ai_addr, (int) address_info->ai_addrlen);
-    socket_free_address_info(address_info);
+    if (socket_get_address_info("google.com", "80", 0, &address_info) == 0) {
+        socket_connect(sock, address_info->ai_addr, (int) address_info->ai_addrlen);
+        socket_free_address_info(address_info);
+    } else {
+        printf("Failed to resolve google.com\n");
+    }
     socket_shutdown(sock, SHUT_RDWR);
     socket_close(sock);
     socket_global_destroy();
@@ -59,57 +88,370 @@ void test_concurrency() {
     mutex_destroy(&mutex);
 }
 
-usize shader_data_from_file(const char *path, u32 **data) {
-    usize length;
-    if (file_read_all_binary(path, &length, NULL) != 0) {
-        return 0;
+/*
+ * Shaders linked into the executable win, then the asset archive, then loose files. Uncompressed archive blobs and
+ * mapped files are 64 byte or page aligned, so the SPIR-V is used in place; only compressed blobs are copied out.
+ */
+bool shader_data_load(const Archive *archive, const char *path, ShaderData *shader) {
+    memset(shader, 0, sizeof(ShaderData));
+    const EmbeddedAsset *embedded = embedded_asset_find(path);
+    if (embedded != NULL) {
+        shader->code = embedded->data;
+        shader->length = embedded->length;
+        return true;
     }
-    *data = malloc((length / sizeof(u32) + 1) * sizeof(u32));
-    if (file_read_all_binary(path, &length, (u8 *) *data) != 0) {
-        free(*data);
-        return 0;
+    const ArchiveEntry *entry = archive_find(archive, path);
+    if (entry != NULL) {
+        shader->length = entry->originalSize;
+        shader->code = (const u32 *) archive_get_data(archive, entry);
+        if (shader->code == NULL) {
+            shader->buffer = malloc(entry->originalSize > 0 ? entry->originalSize : 1);
+            if (shader->buffer == NULL || archive_read(archive, entry, shader->buffer) != 0) {
+                free(shader->buffer);
+                return false;
+            }
+            shader->code = (const u32 *) shader->buffer;
+        }
+        return shader->length > 0;
     }
-    return length;
+    if (file_map(path, FILE_ACCESS_SEQUENTIAL, &shader->mapping) != 0) {
+        return false;
+    }
+    shader->code = (const u32 *) shader->mapping.data;
+    shader->length = shader->mapping.length;
+    return shader->length > 0;
+}
+
+void shader_data_release(ShaderData *shader) {
+    file_unmap(&shader->mapping);
+    free(shader->buffer);
+    memset(shader, 0, sizeof(ShaderData));
 }
 
-Renderer create_renderer(Window window) {
-    u32 *vertex_shader_spv;
-    usize vertex_shader_length = shader_data_from_file("shaders/shader.vert.spv", &vertex_shader_spv);
-    if (vertex_shader_length == 0) {
+Renderer create_renderer(Window window, bool headless) {
+    Archive archive;
+    archive_open(ASSET_ARCHIVE_PATH, &archive);
+    ShaderData vertex_shader;
+    ShaderData fragment_shader;
+    if (!shader_data_load(&archive, "shaders/shader.vert.spv", &vertex_shader)) {
+        archive_close(&archive);
         return -1;
     }
-    u32 *fragment_shader_spv;
-    usize fragment_shader_length = shader_data_from_file("shaders/shader.frag.spv", &fragment_shader_spv);
-    if (fragment_shader_length == 0) {
+    if (!shader_data_load(&archive, "shaders/shader.frag.spv", &fragment_shader)) {
+        shader_data_release(&vertex_shader);
+        archive_close(&archive);
         return -1;
     }
-    Renderer renderer = renderer_create(
-            window,
-            vertex_shader_length,
-            vertex_shader_spv,
-            fragment_shader_length,
-            fragment_shader_spv
-    );
-    free(fragment_shader_spv);
-    free(vertex_shader_spv);
+    usize vertex_shader_length = vertex_shader.length;
+    const u32 *vertex_shader_spv = vertex_shader.code;
+    usize fragment_shader_length = fragment_shader.length;
+    const u32 *fragment_shader_spv = fragment_shader.code;
+    Renderer renderer;
+    if (headless) {
+        renderer = renderer_create_headless(
+                HEADLESS_WIDTH,
+                HEADLESS_HEIGHT,
+                vertex_shader_length,
+                vertex_shader_spv,
+                fragment_shader_length,
+                fragment_shader_spv
+        );
+    } else {
+        renderer = renderer_create(
+                window,
+                vertex_shader_length,
+                vertex_shader_spv,
+                fragment_shader_length,
+                fragment_shader_spv
+        );
+    }
+    shader_data_release(&fragment_shader);
+    shader_data_release(&vertex_shader);
+    archive_close(&archive);
     return renderer;
 }
 
+Mesh create_triangle_mesh(Renderer renderer) {
+    const RendererVertex vertices[] = {
+            {{0.0f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+            {{0.5f, 0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+            {{-0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+    };
+    const u32 indices[] = {0, 1, 2};
+    return renderer_create_mesh(renderer, 3, vertices, 3, indices);
+}
+
 void size_callback(Window window, u32 width, u32 height) {
     renderer_reload(cgfs_global_state.renderer);
 }
 
-int cgfs_start() {
+void render_thread_size_callback(Window window, u32 width, u32 height) {
+    RenderEvent event = {RENDER_EVENT_RESIZE, width, height};
+    render_thread_post_event(cgfs_global_state.renderThread, &event);
+}
+
+void draw_triangle(Renderer renderer, void *arg) {
+    renderer_draw_mesh(renderer, *(Mesh *) arg);
+}
+
+int cgfs_start_headless() {
+    Renderer renderer = create_renderer(0, true);
+    printf("Headless renderer: %d\n", renderer);
+    if (renderer == -1) {
+        return 1;
+    }
+    Mesh mesh = create_triangle_mesh(renderer);
+    const char *frame_count_string = getenv("CGFS_HEADLESS_FRAMES");
+    u32 frame_count = frame_count_string != NULL ? strtoul(frame_count_string, NULL, 10) : 0;
+    if (frame_count == 0) {
+        frame_count = HEADLESS_DEFAULT_FRAME_COUNT;
+    }
+    u32 width, height;
+    renderer_get_frame_size(renderer, &width, &height);
+    u8 *pixels = malloc((usize) width * height * 4);
+    u64 checksum = 0;
+    for (u32 i = 0; i < frame_count; i++) {
+        renderer_draw_mesh(renderer, mesh);
+        renderer_draw_frame(renderer);
+        if (renderer_read_frame(renderer, pixels) != 0) {
+            printf("Failed to read back frame %u\n", i);
+            break;
+        }
+    }
+    for (usize i = 0; i < (usize) width * height * 4; i++) {
+        checksum = checksum * 31 + pixels[i];
+    }
+    printf("Rendered %u frames of %ux%u, last frame checksum %016llx\n", frame_count, width, height,
+           (unsigned long long) checksum);
+    free(pixels);
+    renderer_destroy_mesh(renderer, mesh);
+    renderer_destroy(renderer);
+    return 0;
+}
+
+int cgfs_start_raytracer() {
+    const char *frame_count_string = getenv("CGFS_RAYTRACE_FRAMES");
+    u32 frame_count = frame_count_string != NULL ? strtoul(frame_count_string, NULL, 10) : 0;
+    if (frame_count == 0) {
+        frame_count = RAYTRACE_DEFAULT_FRAME_COUNT;
+    }
+    u32 width = HEADLESS_WIDTH;
+    u32 height = HEADLESS_HEIGHT;
+    u8 *pixels = malloc((usize) width * height * 4);
+    if (pixels == NULL) {
+        return 1;
+    }
+    RaytracerScene scene;
+    raytracer_get_default_scene(&scene);
+    u64 start = timer_get_time_ns();
+    for (u32 i = 0; i < frame_count; i++) {
+        profiler_begin("raytrace frame");
+        raytracer_render(&scene, width, height, pixels);
+        profiler_end();
+    }
+    double seconds = (double) (timer_get_time_ns() - start) / 1e9;
+    printf("Raytraced %u frames of %ux%u on %u threads: %.2f ms/frame, %.1f Mpixel/s\n", frame_count, width,
+           height, job_system_get_thread_count(), seconds * 1000.0 / frame_count,
+           (double) width * height * frame_count / seconds / 1e6);
+    const char *output_path = getenv("CGFS_RAYTRACE_OUTPUT");
+    if (output_path != NULL && file_write_ppm(output_path, width, height, pixels) != 0) {
+        printf("Failed to write %s\n", output_path);
+    }
+    free(pixels);
+    return 0;
+}
+
+/* Converts RGBA8 to the window's BGRX layout, cropping to whichever of the two sizes is smaller. */
+void cgfs_present_pixels(Window window, u32 width, u32 height, const u8 *pixels) {
+    u32 framebuffer_width, framebuffer_height, stride;
+    u8 *framebuffer = window_acquire_framebuffer(window, &framebuffer_width, &framebuffer_height, &stride);
+    if (framebuffer == NULL) {
+        return;
+    }
+    u32 copy_width = width < framebuffer_width ? width : framebuffer_width;
+    u32 copy_height = height < framebuffer_height ? height : framebuffer_height;
+    for (u32 y = 0; y < copy_height; y++) {
+        const u8 *source = pixels + (usize) y * width * 4;
+        u8 *destination = framebuffer + (usize) y * stride;
+        for (u32 x = 0; x < copy_width; x++) {
+            destination[x * 4 + 0] = source[x * 4 + 2];
+            destination[x * 4 + 1] = source[x * 4 + 1];
+            destination[x * 4 + 2] = source[x * 4 + 0];
+            destination[x * 4 + 3] = 255;
+        }
+    }
+    window_present_framebuffer(window);
+}
+
+/* Draws the spinning cubes with the CPU rasterizer and presents them through the window's framebuffer. */
+int cgfs_start_rasterizer() {
+    const char *cube_count_string = getenv("CGFS_RASTERIZE_CUBES");
+    u32 cube_count = cube_count_string != NULL ? strtoul(cube_count_string, NULL, 10) : 0;
+    if (cube_count == 0) {
+        cube_count = RASTERIZE_DEFAULT_CUBE_COUNT;
+    }
+    u32 quad_count = demo_scene_get_quad_count(cube_count);
+    RasterizerVertex *vertices = malloc(sizeof(RasterizerVertex) * quad_count * 4);
+    u32 *indices = malloc(sizeof(u32) * quad_count * 6);
+    Rasterizer rasterizer;
+    if (vertices == NULL || indices == NULL ||
+        rasterizer_create(&rasterizer, HEADLESS_WIDTH, HEADLESS_HEIGHT) != 0) {
+        free(vertices);
+        free(indices);
+        return 1;
+    }
+    demo_scene_build_indices(indices, quad_count);
+    Window window = window_create(HEADLESS_WIDTH, HEADLESS_HEIGHT, "cgfs");
+    const float clear_color[4] = {0.1f, 0.1f, 0.15f, 1.0f};
+    float aspect = (float) HEADLESS_WIDTH / (float) HEADLESS_HEIGHT;
+    u32 frame_count = 0;
+    u64 draw_time = 0;
+    int result = window != INVALID_WINDOW ? 0 : 1;
+    while (result == 0 && !window_is_close_requested(window)) {
+        window_global_poll_events();
+        profiler_begin("rasterize frame");
+        demo_scene_build(vertices, cube_count, frame_count, aspect);
+        u64 start = timer_get_time_ns();
+        rasterizer_clear(&rasterizer, clear_color, 1.0f);
+        result = rasterizer_draw(&rasterizer, vertices, indices, quad_count * 2, RASTERIZER_CULL_BACK);
+        draw_time += timer_get_time_ns() - start;
+        profiler_end();
+        cgfs_present_pixels(window, HEADLESS_WIDTH, HEADLESS_HEIGHT, rasterizer.pixels);
+        frame_count++;
+    }
+    if (frame_count > 0) {
+        printf("Rasterized %u frames of %u triangles: %.2f ms/frame\n", frame_count, quad_count * 2,
+               (double) draw_time / 1e6 / frame_count);
+    }
+    if (window != INVALID_WINDOW) {
+        window_destroy(window);
+    }
+    rasterizer_destroy(&rasterizer);
+    free(vertices);
+    free(indices);
+    return result != 0;
+}
+
+/*
+ * The main thread only waits for window events and forwards resizes, while a render thread owns the renderer and
+ * draws at CGFS_TARGET_FPS (0 leaves pacing to presentation). The window stays on the thread that created it, which
+ * Win32 requires for its message loop.
+ */
+int cgfs_start_windowed() {
+    const char *target_fps_string = getenv("CGFS_TARGET_FPS");
+    u32 target_fps = target_fps_string != NULL ? strtoul(target_fps_string, NULL, 10) : WINDOWED_DEFAULT_TARGET_FPS;
     cgfs_global_state.window = window_create(800, 600, "cgfs");
-    cgfs_global_state.renderer = create_renderer(cgfs_global_state.window);
+    cgfs_global_state.renderer = create_renderer(cgfs_global_state.window, false);
     printf("Renderer: %d\n", cgfs_global_state.renderer);
-    window_set_size_callback(cgfs_global_state.window, size_callback);
+    cgfs_global_state.mesh = create_triangle_mesh(cgfs_global_state.renderer);
+    cgfs_global_state.renderThread = render_thread_create(cgfs_global_state.renderer, target_fps, draw_triangle,
+                                                          &cgfs_global_state.mesh);
+    if (cgfs_global_state.renderThread == NULL) {
+        printf("Failed to start render thread\n");
+        renderer_destroy_mesh(cgfs_global_state.renderer, cgfs_global_state.mesh);
+        renderer_destroy(cgfs_global_state.renderer);
+        window_destroy(cgfs_global_state.window);
+        return 1;
+    }
+    window_set_size_callback(cgfs_global_state.window, render_thread_size_callback);
+    u64 start = timer_get_time_ns();
     while (!window_is_close_requested(cgfs_global_state.window)) {
         window_global_wait_events();
-        renderer_draw_frame(cgfs_global_state.renderer);
     }
+    RenderThreadStats stats = render_thread_get_stats(cgfs_global_state.renderThread);
+    render_thread_destroy(cgfs_global_state.renderThread);
+    cgfs_global_state.renderThread = NULL;
+    window_set_size_callback(cgfs_global_state.window, NULL);
+    double seconds = (double) (timer_get_time_ns() - start) / 1e9;
+    if (stats.frameCount > 0) {
+        printf("Rendered %llu frames in %.1f s: %.2f ms/frame on average, %.2f ms at most, %llu resizes, "
+               "%llu/%llu events dropped\n", (unsigned long long) stats.frameCount, seconds,
+               (double) stats.totalFrameTimeNs / 1e6 / (double) stats.frameCount, (double) stats.maxFrameTimeNs / 1e6,
+               (unsigned long long) stats.resizeCount, (unsigned long long) stats.droppedEventCount,
+               (unsigned long long) (stats.eventCount + stats.droppedEventCount));
+    }
+    renderer_destroy_mesh(cgfs_global_state.renderer, cgfs_global_state.mesh);
     renderer_destroy(cgfs_global_state.renderer);
     window_destroy(cgfs_global_state.window);
 
     return 0;
 }
+
+/* Raytraces on the CPU and streams every frame through the renderer, which scales it to the window. */
+int cgfs_start_streaming() {
+    cgfs_global_state.window = window_create(800, 600, "cgfs");
+    cgfs_global_state.renderer = create_renderer(cgfs_global_state.window, false);
+    printf("Renderer: %d\n", cgfs_global_state.renderer);
+    if (cgfs_global_state.renderer == -1) {
+        window_destroy(cgfs_global_state.window);
+        return 1;
+    }
+    window_set_size_callback(cgfs_global_state.window, size_callback);
+    RaytracerScene scene;
+    raytracer_get_default_scene(&scene);
+    u32 frame_count = 0;
+    u64 start = timer_get_time_ns();
+    while (!window_is_close_requested(cgfs_global_state.window)) {
+        window_global_poll_events();
+        u8 *pixels = renderer_acquire_host_frame(cgfs_global_state.renderer, HEADLESS_WIDTH, HEADLESS_HEIGHT);
+        if (pixels == NULL) {
+            printf("Host frames are not supported by this renderer\n");
+            break;
+        }
+        profiler_begin("raytrace frame");
+        raytracer_render(&scene, HEADLESS_WIDTH, HEADLESS_HEIGHT, pixels);
+        profiler_end();
+        renderer_submit_host_frame(cgfs_global_state.renderer);
+        renderer_draw_frame(cgfs_global_state.renderer);
+        frame_count++;
+    }
+    double seconds = (double) (timer_get_time_ns() - start) / 1e9;
+    if (frame_count > 0) {
+        printf("Streamed %u frames of %ux%u: %.2f ms/frame\n", frame_count, HEADLESS_WIDTH, HEADLESS_HEIGHT,
+               seconds * 1000.0 / frame_count);
+    }
+    renderer_destroy(cgfs_global_state.renderer);
+    window_destroy(cgfs_global_state.window);
+    return 0;
+}
+
+int cgfs_start() {
+    const char *profile_path = getenv("CGFS_PROFILE");
+    if (profile_path != NULL) {
+        if (profiler_init(0) != 0) {
+            printf("Failed to start profiler\n");
+            return 1;
+        }
+        profiler_set_thread_name("main");
+    }
+    if (job_system_init(0) != 0) {
+        printf("Failed to start job system\n");
+        return 1;
+    }
+    if (file_async_init(0) != 0) {
+        printf("Failed to start file I/O\n");
+        job_system_destroy();
+        return 1;
+    }
+    int result;
+    if (getenv("CGFS_RASTERIZE") != NULL) {
+        result = cgfs_start_rasterizer();
+    } else if (getenv("CGFS_STREAM") != NULL) {
+        result = cgfs_start_streaming();
+    } else if (getenv("CGFS_RAYTRACE") != NULL) {
+        result = cgfs_start_raytracer();
+    } else if (getenv("CGFS_HEADLESS") != NULL) {
+        result = cgfs_start_headless();
+    } else {
+        result = cgfs_start_windowed();
+    }
+    file_async_destroy();
+    job_system_destroy();
+    if (profile_path != NULL) {
+        if (profiler_export_chrome_trace(profile_path) != 0) {
+            printf("Failed to write profile to %s\n", profile_path);
+        }
+        profiler_destroy();
+    }
+    return result;
+}
@@ -0,0 +1,240 @@
+#include "sync.h"
+#include "atomic.h"
+#include "futex.h"
+#include "thread.h"
+
+#define SYNC_SPIN_COUNT 128
+#define SYNC_MAX_BACKOFF 64
+
+#define LIGHT_MUTEX_UNLOCKED 0
+#define LIGHT_MUTEX_LOCKED 1
+#define LIGHT_MUTEX_CONTENDED 2
+
+#define RW_LOCK_WRITER (-1)
+
+void spin_lock_init(SpinLock *lock) {
+    lock->state = 0;
+}
+
+/*
+ * Test-and-test-and-set with exponential backoff. Once the backoff saturates the holder is probably descheduled, so
+ * the thread yields instead of burning the rest of its slice.
+ */
+void spin_lock(SpinLock *lock) {
+    u32 backoff = 1;
+    while (atomic_exchange_i32(&lock->state, 1, ATOMIC_ACQUIRE) != 0) {
+        while (atomic_load_i32(&lock->state, ATOMIC_RELAXED) != 0) {
+            if (backoff < SYNC_MAX_BACKOFF) {
+                for (u32 i = 0; i < backoff; i++) {
+                    atomic_pause();
+                }
+                backoff *= 2;
+            } else {
+                thread_yield();
+            }
+        }
+    }
+}
+
+bool spin_try_lock(SpinLock *lock) {
+    return atomic_load_i32(&lock->state, ATOMIC_RELAXED) == 0 &&
+           atomic_exchange_i32(&lock->state, 1, ATOMIC_ACQUIRE) == 0;
+}
+
+void spin_unlock(SpinLock *lock) {
+    atomic_store_i32(&lock->state, 0, ATOMIC_RELEASE);
+}
+
+void light_mutex_init(LightMutex *mutex) {
+    mutex->state = LIGHT_MUTEX_UNLOCKED;
+}
+
+/*
+ * Three-state futex mutex: unlocking only enters the kernel when some thread has marked the mutex contended.
+ */
+void light_mutex_lock(LightMutex *mutex) {
+    i32 state = LIGHT_MUTEX_UNLOCKED;
+    if (atomic_compare_exchange_i32(&mutex->state, &state, LIGHT_MUTEX_LOCKED, ATOMIC_ACQUIRE, ATOMIC_RELAXED)) {
+        return;
+    }
+    for (u32 i = 0; i < SYNC_SPIN_COUNT && state != LIGHT_MUTEX_CONTENDED; i++) {
+        atomic_pause();
+        state = atomic_load_i32(&mutex->state, ATOMIC_RELAXED);
+        if (state == LIGHT_MUTEX_UNLOCKED &&
+            atomic_compare_exchange_i32(&mutex->state, &state, LIGHT_MUTEX_LOCKED, ATOMIC_ACQUIRE,
+                                        ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+    while (atomic_exchange_i32(&mutex->state, LIGHT_MUTEX_CONTENDED, ATOMIC_ACQUIRE) != LIGHT_MUTEX_UNLOCKED) {
+        futex_wait(&mutex->state, LIGHT_MUTEX_CONTENDED);
+    }
+}
+
+bool light_mutex_try_lock(LightMutex *mutex) {
+    i32 state = LIGHT_MUTEX_UNLOCKED;
+    return atomic_compare_exchange_i32(&mutex->state, &state, LIGHT_MUTEX_LOCKED, ATOMIC_ACQUIRE, ATOMIC_RELAXED);
+}
+
+void light_mutex_unlock(LightMutex *mutex) {
+    if (atomic_exchange_i32(&mutex->state, LIGHT_MUTEX_UNLOCKED, ATOMIC_RELEASE) == LIGHT_MUTEX_CONTENDED) {
+        futex_wake_one(&mutex->state);
+    }
+}
+
+void light_condition_init(LightCondition *condition) {
+    condition->sequence = 0;
+    condition->waiterCount = 0;
+}
+
+/*
+ * Waiters sleep on a sequence number that every signal bumps, so a signal issued between unlocking the mutex and
+ * sleeping is never lost. Wakeups may be spurious; callers recheck their predicate.
+ */
+void light_condition_wait(LightCondition *condition, LightMutex *mutex) {
+    atomic_fetch_add_i32(&condition->waiterCount, 1, ATOMIC_SEQ_CST);
+    i32 sequence = atomic_load_i32(&condition->sequence, ATOMIC_SEQ_CST);
+    light_mutex_unlock(mutex);
+    futex_wait(&condition->sequence, sequence);
+    atomic_fetch_add_i32(&condition->waiterCount, -1, ATOMIC_RELAXED);
+    while (atomic_exchange_i32(&mutex->state, LIGHT_MUTEX_CONTENDED, ATOMIC_ACQUIRE) != LIGHT_MUTEX_UNLOCKED) {
+        futex_wait(&mutex->state, LIGHT_MUTEX_CONTENDED);
+    }
+}
+
+void light_condition_signal(LightCondition *condition) {
+    atomic_fetch_add_i32(&condition->sequence, 1, ATOMIC_SEQ_CST);
+    if (atomic_load_i32(&condition->waiterCount, ATOMIC_SEQ_CST) > 0) {
+        futex_wake_one(&condition->sequence);
+    }
+}
+
+void light_condition_broadcast(LightCondition *condition) {
+    atomic_fetch_add_i32(&condition->sequence, 1, ATOMIC_SEQ_CST);
+    if (atomic_load_i32(&condition->waiterCount, ATOMIC_SEQ_CST) > 0) {
+        futex_wake_all(&condition->sequence);
+    }
+}
+
+void rw_lock_init(RwLock *lock) {
+    lock->state = 0;
+    lock->waitingWriterCount = 0;
+    lock->epoch = 0;
+    lock->waiterCount = 0;
+}
+
+void rw_lock_wake(RwLock *lock) {
+    atomic_fetch_add_i32(&lock->epoch, 1, ATOMIC_SEQ_CST);
+    if (atomic_load_i32(&lock->waiterCount, ATOMIC_SEQ_CST) > 0) {
+        futex_wake_all(&lock->epoch);
+    }
+}
+
+bool rw_lock_try_read(RwLock *lock) {
+    i32 state = atomic_load_i32(&lock->state, ATOMIC_RELAXED);
+    while (state != RW_LOCK_WRITER && atomic_load_i32(&lock->waitingWriterCount, ATOMIC_RELAXED) == 0) {
+        if (atomic_compare_exchange_i32(&lock->state, &state, state + 1, ATOMIC_ACQUIRE, ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Writers are preferred: new readers queue up behind a waiting writer, so a steady stream of readers cannot
+ * starve it.
+ */
+void rw_lock_read(RwLock *lock) {
+    for (u32 i = 0; i < SYNC_SPIN_COUNT; i++) {
+        if (rw_lock_try_read(lock)) {
+            return;
+        }
+        atomic_pause();
+    }
+    while (!rw_lock_try_read(lock)) {
+        atomic_fetch_add_i32(&lock->waiterCount, 1, ATOMIC_SEQ_CST);
+        i32 epoch = atomic_load_i32(&lock->epoch, ATOMIC_SEQ_CST);
+        if (atomic_load_i32(&lock->state, ATOMIC_SEQ_CST) == RW_LOCK_WRITER ||
+            atomic_load_i32(&lock->waitingWriterCount, ATOMIC_SEQ_CST) != 0) {
+            futex_wait(&lock->epoch, epoch);
+        }
+        atomic_fetch_add_i32(&lock->waiterCount, -1, ATOMIC_RELAXED);
+    }
+}
+
+void rw_unlock_read(RwLock *lock) {
+    if (atomic_fetch_add_i32(&lock->state, -1, ATOMIC_RELEASE) == 1) {
+        rw_lock_wake(lock);
+    }
+}
+
+bool rw_lock_try_write(RwLock *lock) {
+    i32 state = 0;
+    return atomic_compare_exchange_i32(&lock->state, &state, RW_LOCK_WRITER, ATOMIC_ACQUIRE, ATOMIC_RELAXED);
+}
+
+void rw_lock_write(RwLock *lock) {
+    for (u32 i = 0; i < SYNC_SPIN_COUNT; i++) {
+        if (rw_lock_try_write(lock)) {
+            return;
+        }
+        atomic_pause();
+    }
+    atomic_fetch_add_i32(&lock->waitingWriterCount, 1, ATOMIC_SEQ_CST);
+    while (!rw_lock_try_write(lock)) {
+        atomic_fetch_add_i32(&lock->waiterCount, 1, ATOMIC_SEQ_CST);
+        i32 epoch = atomic_load_i32(&lock->epoch, ATOMIC_SEQ_CST);
+        if (atomic_load_i32(&lock->state, ATOMIC_SEQ_CST) != 0) {
+            futex_wait(&lock->epoch, epoch);
+        }
+        atomic_fetch_add_i32(&lock->waiterCount, -1, ATOMIC_RELAXED);
+    }
+    atomic_fetch_add_i32(&lock->waitingWriterCount, -1, ATOMIC_RELAXED);
+}
+
+void rw_unlock_write(RwLock *lock) {
+    atomic_store_i32(&lock->state, 0, ATOMIC_SEQ_CST);
+    rw_lock_wake(lock);
+}
+
+void semaphore_init(Semaphore *semaphore, u32 count) {
+    semaphore->count = (i32) count;
+    semaphore->waiterCount = 0;
+}
+
+bool semaphore_try_wait(Semaphore *semaphore) {
+    i32 count = atomic_load_i32(&semaphore->count, ATOMIC_RELAXED);
+    while (count > 0) {
+        if (atomic_compare_exchange_i32(&semaphore->count, &count, count - 1, ATOMIC_ACQUIRE, ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void semaphore_wait(Semaphore *semaphore) {
+    for (u32 i = 0; i < SYNC_SPIN_COUNT; i++) {
+        if (semaphore_try_wait(semaphore)) {
+            return;
+        }
+        atomic_pause();
+    }
+    while (!semaphore_try_wait(semaphore)) {
+        atomic_fetch_add_i32(&semaphore->waiterCount, 1, ATOMIC_SEQ_CST);
+        if (atomic_load_i32(&semaphore->count, ATOMIC_SEQ_CST) <= 0) {
+            futex_wait(&semaphore->count, 0);
+        }
+        atomic_fetch_add_i32(&semaphore->waiterCount, -1, ATOMIC_RELAXED);
+    }
+}
+
+void semaphore_post(Semaphore *semaphore, u32 count) {
+    atomic_fetch_add_i32(&semaphore->count, (i32) count, ATOMIC_SEQ_CST);
+    if (atomic_load_i32(&semaphore->waiterCount, ATOMIC_SEQ_CST) > 0) {
+        if (count == 1) {
+            futex_wake_one(&semaphore->count);
+        } else {
+            futex_wake_all(&semaphore->count);
+        }
+    }
+}
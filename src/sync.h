@@ -0,0 +1,77 @@
+#ifndef CGFS_SYNC_H
+#define CGFS_SYNC_H
+
+#include "types.h"
+
+typedef struct spin_lock_s {
+    i32 state;
+} SpinLock;
+
+typedef struct light_mutex_s {
+    i32 state;
+} LightMutex;
+
+typedef struct light_condition_s {
+    i32 sequence;
+    i32 waiterCount;
+} LightCondition;
+
+typedef struct rw_lock_s {
+    i32 state;
+    i32 waitingWriterCount;
+    i32 epoch;
+    i32 waiterCount;
+} RwLock;
+
+typedef struct semaphore_s {
+    i32 count;
+    i32 waiterCount;
+} Semaphore;
+
+void spin_lock_init(SpinLock *lock);
+
+void spin_lock(SpinLock *lock);
+
+bool spin_try_lock(SpinLock *lock);
+
+void spin_unlock(SpinLock *lock);
+
+void light_mutex_init(LightMutex *mutex);
+
+void light_mutex_lock(LightMutex *mutex);
+
+bool light_mutex_try_lock(LightMutex *mutex);
+
+void light_mutex_unlock(LightMutex *mutex);
+
+void light_condition_init(LightCondition *condition);
+
+void light_condition_wait(LightCondition *condition, LightMutex *mutex);
+
+void light_condition_signal(LightCondition *condition);
+
+void light_condition_broadcast(LightCondition *condition);
+
+void rw_lock_init(RwLock *lock);
+
+void rw_lock_read(RwLock *lock);
+
+bool rw_lock_try_read(RwLock *lock);
+
+void rw_unlock_read(RwLock *lock);
+
+void rw_lock_write(RwLock *lock);
+
+bool rw_lock_try_write(RwLock *lock);
+
+void rw_unlock_write(RwLock *lock);
+
+void semaphore_init(Semaphore *semaphore, u32 count);
+
+void semaphore_wait(Semaphore *semaphore);
+
+bool semaphore_try_wait(Semaphore *semaphore);
+
+void semaphore_post(Semaphore *semaphore, u32 count);
+
+#endif //CGFS_SYNC_H
@@ -17,4 +17,8 @@ void thread_exit(usize result);
 
 void thread_sleep(u64 millis);
 
+void thread_yield();
+
+u32 thread_get_processor_count();
+
 #endif //CGFS_THREAD_H
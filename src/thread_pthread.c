@@ -1,6 +1,8 @@
 #ifndef _WIN32
 
+#include <sched.h>
 #include <time.h>
+#include <unistd.h>
 #include "thread_pthread.h"
 #include "types.h"
 
@@ -28,4 +30,13 @@ void thread_sleep(u64 millis) {
     nanosleep(&ts, NULL);
 }
 
+void thread_yield() {
+    sched_yield();
+}
+
+u32 thread_get_processor_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (u32) count : 1;
+}
+
 #endif
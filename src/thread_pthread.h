@@ -5,4 +5,6 @@
 
 typedef pthread_t Thread;
 
+#define THREAD_LOCAL __thread
+
 #endif //CGFS_THREAD_PTHREAD_H
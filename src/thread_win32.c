@@ -22,4 +22,14 @@ void thread_sleep(u64 millis) {
     Sleep(millis);
 }
 
+void thread_yield() {
+    SwitchToThread();
+}
+
+u32 thread_get_processor_count() {
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return systemInfo.dwNumberOfProcessors;
+}
+
 #endif
@@ -5,4 +5,6 @@
 
 typedef HANDLE Thread;
 
+#define THREAD_LOCAL __declspec(thread)
+
 #endif //CGFS_THREAD_WIN32_H
@@ -0,0 +1,8 @@
+#ifndef CGFS_TIMER_H
+#define CGFS_TIMER_H
+
+#include "types.h"
+
+u64 timer_get_time_ns();
+
+#endif //CGFS_TIMER_H
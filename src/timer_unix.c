@@ -0,0 +1,12 @@
+#ifndef _WIN32
+
+#include <time.h>
+#include "timer.h"
+
+u64 timer_get_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000ull + (u64) ts.tv_nsec;
+}
+
+#endif
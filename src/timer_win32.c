@@ -0,0 +1,18 @@
+#ifdef _WIN32
+
+#include <windows.h>
+#include "timer.h"
+
+u64 timer_get_time_ns() {
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    u64 seconds = counter.QuadPart / frequency.QuadPart;
+    u64 remainder = counter.QuadPart % frequency.QuadPart;
+    return seconds * 1000000000ull + remainder * 1000000000ull / frequency.QuadPart;
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef CGFS_VEC3_H
+#define CGFS_VEC3_H
+
+#include <math.h>
+
+typedef struct vec3_s {
+    float x;
+    float y;
+    float z;
+} Vec3;
+
+static inline Vec3 vec3(float x, float y, float z) {
+    Vec3 result = {x, y, z};
+    return result;
+}
+
+static inline Vec3 vec3_add(Vec3 a, Vec3 b) {
+    return vec3(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+static inline Vec3 vec3_sub(Vec3 a, Vec3 b) {
+    return vec3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+static inline Vec3 vec3_mul(Vec3 a, Vec3 b) {
+    return vec3(a.x * b.x, a.y * b.y, a.z * b.z);
+}
+
+static inline Vec3 vec3_scale(Vec3 v, float s) {
+    return vec3(v.x * s, v.y * s, v.z * s);
+}
+
+static inline float vec3_dot(Vec3 a, Vec3 b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline Vec3 vec3_cross(Vec3 a, Vec3 b) {
+    return vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+static inline float vec3_length(Vec3 v) {
+    return sqrtf(vec3_dot(v, v));
+}
+
+static inline Vec3 vec3_normalize(Vec3 v) {
+    float length = vec3_length(v);
+    return length > 0.0f ? vec3_scale(v, 1.0f / length) : v;
+}
+
+static inline Vec3 vec3_reflect(Vec3 v, Vec3 n) {
+    return vec3_sub(vec3_scale(n, 2.0f * vec3_dot(n, v)), v);
+}
+
+static inline Vec3 vec3_min(Vec3 a, Vec3 b) {
+    return vec3(a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z);
+}
+
+static inline Vec3 vec3_max(Vec3 a, Vec3 b) {
+    return vec3(a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z);
+}
+
+#endif //CGFS_VEC3_H
@@ -28,4 +28,8 @@ void window_get_size_in_pixels(Window window, u32 *width, u32 *height);
 
 void window_set_size_callback(Window window, void (*callback)(Window window, u32 width, u32 height));
 
+u8 *window_acquire_framebuffer(Window window, u32 *width, u32 *height, u32 *stride);
+
+void window_present_framebuffer(Window window);
+
 #endif //CGFS_WINDOW_H
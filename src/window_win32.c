@@ -3,11 +3,11 @@
 #include "window_win32.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <windows.h>
 #include <vulkan/vulkan_core.h>
 #include <vulkan/vulkan_win32.h>
 
-#define INVALID_WINDOW 0xFFFFFFFF
 #define MAX_WINDOW_COUNT 8
 #define REQUIRED_VULKAN_EXTENSION_COUNT 2
 
@@ -20,9 +20,15 @@ typedef struct window_data_s {
     HWND handle;
     WNDCLASSEX class;
     bool close_requested;
+    bool size_changed;
     u16 width;
     u16 height;
     void (*size_callback)(Window window, u32 width, u32 height);
+    HDC framebuffer_dc;
+    HBITMAP framebuffer_bitmap;
+    u8 *framebuffer_pixels;
+    u16 framebuffer_width;
+    u16 framebuffer_height;
 } WindowData;
 
 HINSTANCE window_win32_module_handle = 0;
@@ -51,9 +57,23 @@ bool window_win32_handle_message(MSG *message, int status) {
     }
 }
 
+void window_win32_dispatch_size_changes() {
+    for (Window window = 0; window < window_win32_window_count; window++) {
+        WindowData *window_data = &window_win32_windows_data[window];
+        if (!window_data->size_changed) {
+            continue;
+        }
+        window_data->size_changed = false;
+        if (window_data->size_callback != NULL) {
+            window_data->size_callback(window, window_data->width, window_data->height);
+        }
+    }
+}
+
 void window_global_poll_events() {
     MSG message;
     while (window_win32_handle_message(&message, PeekMessage(&message, NULL, 0, 0, PM_REMOVE)));
+    window_win32_dispatch_size_changes();
 }
 
 void window_global_wait_events() {
@@ -79,9 +99,7 @@ LRESULT CALLBACK window_win32_window_function(HWND handle, UINT message, WPARAM
             u16 height = HIWORD(lParam);
             window_win32_windows_data[window].width = width;
             window_win32_windows_data[window].height = height;
-            if (window_win32_windows_data[window].size_callback != NULL) {
-                window_win32_windows_data[window].size_callback(window, width, height);
-            }
+            window_win32_windows_data[window].size_changed = true;
             break;
         }
         default: {
@@ -134,10 +152,83 @@ Window window_create(u16 width, u16 height, const char *title) {
     return window_win32_window_count - 1;
 }
 
+void window_win32_destroy_framebuffer(WindowData *window_data) {
+    if (window_data->framebuffer_dc != NULL) {
+        DeleteDC(window_data->framebuffer_dc);
+        window_data->framebuffer_dc = NULL;
+    }
+    if (window_data->framebuffer_bitmap != NULL) {
+        DeleteObject(window_data->framebuffer_bitmap);
+        window_data->framebuffer_bitmap = NULL;
+    }
+    window_data->framebuffer_pixels = NULL;
+}
+
+bool window_win32_create_framebuffer(WindowData *window_data) {
+    BITMAPINFO bitmap_info;
+    memset(&bitmap_info, 0, sizeof(BITMAPINFO));
+    bitmap_info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bitmap_info.bmiHeader.biWidth = window_data->width;
+    bitmap_info.bmiHeader.biHeight = -(LONG) window_data->height;
+    bitmap_info.bmiHeader.biPlanes = 1;
+    bitmap_info.bmiHeader.biBitCount = 32;
+    bitmap_info.bmiHeader.biCompression = BI_RGB;
+    void *pixels;
+    window_data->framebuffer_bitmap = CreateDIBSection(NULL, &bitmap_info, DIB_RGB_COLORS, &pixels, NULL, 0);
+    if (window_data->framebuffer_bitmap == NULL) {
+        return false;
+    }
+    window_data->framebuffer_dc = CreateCompatibleDC(NULL);
+    if (window_data->framebuffer_dc == NULL) {
+        window_win32_destroy_framebuffer(window_data);
+        return false;
+    }
+    SelectObject(window_data->framebuffer_dc, window_data->framebuffer_bitmap);
+    window_data->framebuffer_pixels = pixels;
+    window_data->framebuffer_width = window_data->width;
+    window_data->framebuffer_height = window_data->height;
+    return true;
+}
+
+/*
+ * Returns a top-down DIB section of 32-bit BGRX pixels matching the current window size. GDI may still be reading
+ * the previous frame from it, so pending GDI work is flushed before handing it out.
+ */
+u8 *window_acquire_framebuffer(Window window, u32 *width, u32 *height, u32 *stride) {
+    WindowData *window_data = &window_win32_windows_data[window];
+    if (window_data->width == 0 || window_data->height == 0) {
+        return NULL;
+    }
+    if (window_data->framebuffer_pixels == NULL || window_data->framebuffer_width != window_data->width ||
+        window_data->framebuffer_height != window_data->height) {
+        window_win32_destroy_framebuffer(window_data);
+        if (!window_win32_create_framebuffer(window_data)) {
+            return NULL;
+        }
+    }
+    GdiFlush();
+    *width = window_data->framebuffer_width;
+    *height = window_data->framebuffer_height;
+    *stride = (u32) window_data->framebuffer_width * 4;
+    return window_data->framebuffer_pixels;
+}
+
+void window_present_framebuffer(Window window) {
+    WindowData *window_data = &window_win32_windows_data[window];
+    if (window_data->framebuffer_pixels == NULL) {
+        return;
+    }
+    HDC window_dc = GetDC(window_data->handle);
+    BitBlt(window_dc, 0, 0, window_data->framebuffer_width, window_data->framebuffer_height,
+           window_data->framebuffer_dc, 0, 0, SRCCOPY);
+    ReleaseDC(window_data->handle, window_dc);
+}
+
 void window_destroy(Window window) {
     if (window >= window_win32_window_count) {
         return;
     }
+    window_win32_destroy_framebuffer(&window_win32_windows_data[window]);
     DestroyWindow(window_win32_windows_data[window].handle);
     window_win32_window_count--;
     if (window_win32_window_count == 0) {
@@ -3,6 +3,8 @@
 
 #include "types.h"
 
+#define INVALID_WINDOW 0xFFFFFFFF
+
 typedef u32 Window;
 
 #endif //CGFS_WINDOW_WIN32_H
@@ -3,35 +3,56 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include <xcb/xcb.h>
+#include <xcb/shm.h>
 #include <vulkan/vulkan_core.h>
 #include <vulkan/vulkan_xcb.h>
 #include "window_xcb.h"
 
-#define INVALID_WINDOW 0xFFFFFFFF
 #define MAX_WINDOW_COUNT 8
 #define DELETE_COOKIE_NAME "WM_DELETE_WINDOW"
 #define PROTOCOLS_COOKIE_NAME "WM_PROTOCOLS"
 #define REQUIRED_VULKAN_EXTENSION_COUNT 2
+#define FRAMEBUFFER_COUNT 2
+#define PUT_IMAGE_HEADER_SIZE 24
 
 const char *const window_required_vulkan_extensions[REQUIRED_VULKAN_EXTENSION_COUNT] = {
         VK_KHR_SURFACE_EXTENSION_NAME,
         VK_KHR_XCB_SURFACE_EXTENSION_NAME
 };
 
+typedef struct window_framebuffer_s {
+    u8 *pixels;
+    int shm_id;
+    xcb_shm_seg_t segment;
+    bool pending;
+} WindowFramebuffer;
+
 typedef struct window_data_s {
     xcb_window_t handle;
     xcb_atom_t delete_atom;
     bool close_requested;
+    bool size_changed;
     u16 width;
     u16 height;
     void (*size_callback)(Window window, u32 width, u32 height);
+    WindowFramebuffer framebuffers[FRAMEBUFFER_COUNT];
+    u32 framebuffer_count;
+    u32 framebuffer_index;
+    u16 framebuffer_width;
+    u16 framebuffer_height;
+    bool framebuffer_shm;
+    xcb_gcontext_t framebuffer_gc;
 } WindowData;
 
 xcb_connection_t *window_xcb_connection = 0;
 xcb_screen_t *window_xcb_screen = 0;
 Window window_xcb_window_count = 0;
 WindowData *window_xcb_windows_data = 0;
+bool window_xcb_shm_available = false;
+u8 window_xcb_shm_completion_event = 0;
 
 Window get_window_by_handle(xcb_window_t handle) {
     for (u32 i = 0; i < window_xcb_window_count; i++) {
@@ -42,10 +63,28 @@ Window get_window_by_handle(xcb_window_t handle) {
     return INVALID_WINDOW;
 }
 
+void window_xcb_handle_shm_completion(xcb_shm_completion_event_t *event) {
+    Window window = get_window_by_handle(event->drawable);
+    if (window == INVALID_WINDOW) {
+        return;
+    }
+    WindowData *window_data = &window_xcb_windows_data[window];
+    for (u32 i = 0; i < window_data->framebuffer_count; i++) {
+        if (window_data->framebuffers[i].segment == event->shmseg) {
+            window_data->framebuffers[i].pending = false;
+        }
+    }
+}
+
 bool window_xcb_handle_event(xcb_generic_event_t *event) {
     if (event == NULL) {
         return false;
     }
+    if (window_xcb_shm_available && (event->response_type & ~0x80) == window_xcb_shm_completion_event) {
+        window_xcb_handle_shm_completion((xcb_shm_completion_event_t *) event);
+        free(event);
+        return true;
+    }
     switch (event->response_type & ~0x80) {
         case 0: {
             xcb_generic_error_t *error = (xcb_generic_error_t *) event;
@@ -64,13 +103,9 @@ bool window_xcb_handle_event(xcb_generic_event_t *event) {
             xcb_resize_request_event_t *resize_request_event = (xcb_resize_request_event_t *) event;
             Window window = get_window_by_handle(resize_request_event->window);
             if (resize_request_event->width > 0 && resize_request_event->height > 0) {
-                u16 width = resize_request_event->width;
-                u16 height = resize_request_event->height;
-                window_xcb_windows_data[window].width = width;
-                window_xcb_windows_data[window].height = height;
-                if (window_xcb_windows_data[window].size_callback != NULL) {
-                    window_xcb_windows_data[window].size_callback(window, width, height);
-                }
+                window_xcb_windows_data[window].width = resize_request_event->width;
+                window_xcb_windows_data[window].height = resize_request_event->height;
+                window_xcb_windows_data[window].size_changed = true;
             }
             break;
         }
@@ -79,8 +114,22 @@ bool window_xcb_handle_event(xcb_generic_event_t *event) {
     return true;
 }
 
+void window_xcb_dispatch_size_changes() {
+    for (Window window = 0; window < window_xcb_window_count; window++) {
+        WindowData *window_data = &window_xcb_windows_data[window];
+        if (!window_data->size_changed) {
+            continue;
+        }
+        window_data->size_changed = false;
+        if (window_data->size_callback != NULL) {
+            window_data->size_callback(window, window_data->width, window_data->height);
+        }
+    }
+}
+
 void window_global_poll_events() {
     while (window_xcb_handle_event(xcb_poll_for_event(window_xcb_connection)));
+    window_xcb_dispatch_size_changes();
 }
 
 void window_global_wait_events() {
@@ -125,6 +174,25 @@ void window_xcb_set_on_window_delete_interest(Window window) {
     );
 }
 
+void window_xcb_query_shm() {
+    window_xcb_shm_available = false;
+    const xcb_query_extension_reply_t *extension = xcb_get_extension_data(window_xcb_connection, &xcb_shm_id);
+    if (extension == NULL || !extension->present) {
+        return;
+    }
+    xcb_shm_query_version_reply_t *version_reply = xcb_shm_query_version_reply(
+            window_xcb_connection,
+            xcb_shm_query_version(window_xcb_connection),
+            NULL
+    );
+    if (version_reply == NULL) {
+        return;
+    }
+    free(version_reply);
+    window_xcb_shm_completion_event = extension->first_event + XCB_SHM_COMPLETION;
+    window_xcb_shm_available = true;
+}
+
 Window window_create(u16 width, u16 height, const char *title) {
     if (window_xcb_window_count == MAX_WINDOW_COUNT) {
         return INVALID_WINDOW;
@@ -139,11 +207,17 @@ Window window_create(u16 width, u16 height, const char *title) {
         }
         window_xcb_screen = iter.data;
         window_xcb_windows_data = malloc(sizeof(WindowData) * MAX_WINDOW_COUNT);
+        memset(window_xcb_windows_data, 0, sizeof(WindowData) * MAX_WINDOW_COUNT);
+        window_xcb_query_shm();
     }
     window_xcb_windows_data[window_xcb_window_count].handle = xcb_generate_id(window_xcb_connection);
     window_xcb_windows_data[window_xcb_window_count].close_requested = false;
+    window_xcb_windows_data[window_xcb_window_count].size_changed = false;
+    window_xcb_windows_data[window_xcb_window_count].size_callback = NULL;
     window_xcb_windows_data[window_xcb_window_count].width = width;
     window_xcb_windows_data[window_xcb_window_count].height = height;
+    window_xcb_windows_data[window_xcb_window_count].framebuffer_count = 0;
+    window_xcb_windows_data[window_xcb_window_count].framebuffer_gc = 0;
     u32 eventMask = XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK;
     u32 valueList[] = {window_xcb_screen->black_pixel, XCB_EVENT_MASK_RESIZE_REDIRECT};
     xcb_create_window(
@@ -185,10 +259,187 @@ Window window_create(u16 width, u16 height, const char *title) {
     return window_xcb_window_count++;
 }
 
+void window_xcb_destroy_framebuffers(WindowData *window_data) {
+    for (u32 i = 0; i < window_data->framebuffer_count; i++) {
+        WindowFramebuffer *framebuffer = &window_data->framebuffers[i];
+        if (window_data->framebuffer_shm) {
+            xcb_shm_detach(window_xcb_connection, framebuffer->segment);
+            shmdt(framebuffer->pixels);
+        } else {
+            free(framebuffer->pixels);
+        }
+    }
+    window_data->framebuffer_count = 0;
+    window_data->framebuffer_index = 0;
+}
+
+/*
+ * A failed attach usually means the X server runs on another machine, in which case no later attach can succeed
+ * either, so SHM is disabled for the whole connection.
+ */
+bool window_xcb_create_shm_framebuffer(WindowFramebuffer *framebuffer, usize size) {
+    framebuffer->shm_id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (framebuffer->shm_id < 0) {
+        return false;
+    }
+    framebuffer->pixels = shmat(framebuffer->shm_id, NULL, 0);
+    if (framebuffer->pixels == (u8 *) -1) {
+        shmctl(framebuffer->shm_id, IPC_RMID, NULL);
+        return false;
+    }
+    framebuffer->segment = xcb_generate_id(window_xcb_connection);
+    xcb_generic_error_t *error = xcb_request_check(
+            window_xcb_connection,
+            xcb_shm_attach_checked(window_xcb_connection, framebuffer->segment, framebuffer->shm_id, 0)
+    );
+    shmctl(framebuffer->shm_id, IPC_RMID, NULL);
+    if (error != NULL) {
+        free(error);
+        shmdt(framebuffer->pixels);
+        return false;
+    }
+    framebuffer->pending = false;
+    return true;
+}
+
+bool window_xcb_create_framebuffers(WindowData *window_data) {
+    const xcb_setup_t *xcb_setup = xcb_get_setup(window_xcb_connection);
+    const xcb_format_t *formats = xcb_setup_pixmap_formats(xcb_setup);
+    int format_count = xcb_setup_pixmap_formats_length(xcb_setup);
+    bool supported = false;
+    for (int i = 0; i < format_count; i++) {
+        if (formats[i].depth == window_xcb_screen->root_depth) {
+            supported = formats[i].bits_per_pixel == 32;
+        }
+    }
+    if (!supported) {
+        return false;
+    }
+    if (window_data->framebuffer_gc == 0) {
+        window_data->framebuffer_gc = xcb_generate_id(window_xcb_connection);
+        xcb_create_gc(window_xcb_connection, window_data->framebuffer_gc, window_data->handle, 0, NULL);
+    }
+    usize size = (usize) window_data->width * window_data->height * 4;
+    window_data->framebuffer_width = window_data->width;
+    window_data->framebuffer_height = window_data->height;
+    window_data->framebuffer_index = 0;
+    window_data->framebuffer_shm = window_xcb_shm_available;
+    if (window_data->framebuffer_shm) {
+        for (u32 i = 0; i < FRAMEBUFFER_COUNT; i++) {
+            if (!window_xcb_create_shm_framebuffer(&window_data->framebuffers[i], size)) {
+                window_xcb_destroy_framebuffers(window_data);
+                window_xcb_shm_available = false;
+                window_data->framebuffer_shm = false;
+                break;
+            }
+            window_data->framebuffer_count++;
+        }
+    }
+    if (!window_data->framebuffer_shm) {
+        window_data->framebuffers[0].pixels = malloc(size);
+        if (window_data->framebuffers[0].pixels == NULL) {
+            return false;
+        }
+        window_data->framebuffers[0].pending = false;
+        window_data->framebuffer_count = 1;
+    }
+    return true;
+}
+
+/*
+ * Returns the back buffer as rows of 32-bit BGRX pixels matching the current window size. With MIT-SHM the buffer
+ * is shared with the X server and double-buffered; acquiring waits until the server has finished reading the
+ * buffer from two presents ago.
+ */
+u8 *window_acquire_framebuffer(Window window, u32 *width, u32 *height, u32 *stride) {
+    WindowData *window_data = &window_xcb_windows_data[window];
+    if (window_data->framebuffer_count == 0 || window_data->framebuffer_width != window_data->width ||
+        window_data->framebuffer_height != window_data->height) {
+        window_xcb_destroy_framebuffers(window_data);
+        if (!window_xcb_create_framebuffers(window_data)) {
+            return NULL;
+        }
+    }
+    WindowFramebuffer *framebuffer = &window_data->framebuffers[window_data->framebuffer_index];
+    while (framebuffer->pending) {
+        xcb_generic_event_t *event = xcb_wait_for_event(window_xcb_connection);
+        if (event == NULL) {
+            framebuffer->pending = false;
+            break;
+        }
+        window_xcb_handle_event(event);
+    }
+    *width = window_data->framebuffer_width;
+    *height = window_data->framebuffer_height;
+    *stride = (u32) window_data->framebuffer_width * 4;
+    return framebuffer->pixels;
+}
+
+/*
+ * Without SHM the image travels over the socket, split into strips that fit the maximum request length, which is
+ * reported in 4-byte units.
+ */
+void window_xcb_put_image_chunked(WindowData *window_data, const u8 *pixels) {
+    u32 stride = (u32) window_data->framebuffer_width * 4;
+    usize max_request_size = (usize) xcb_get_maximum_request_length(window_xcb_connection) * 4;
+    u32 rows_per_request = max_request_size > PUT_IMAGE_HEADER_SIZE + stride ?
+                           (u32) ((max_request_size - PUT_IMAGE_HEADER_SIZE) / stride) : 1;
+    for (u32 y = 0; y < window_data->framebuffer_height; y += rows_per_request) {
+        u32 rows = window_data->framebuffer_height - y < rows_per_request ?
+                   window_data->framebuffer_height - y : rows_per_request;
+        xcb_put_image(
+                window_xcb_connection,
+                XCB_IMAGE_FORMAT_Z_PIXMAP,
+                window_data->handle,
+                window_data->framebuffer_gc,
+                window_data->framebuffer_width,
+                rows,
+                0, (i16) y,
+                0,
+                window_xcb_screen->root_depth,
+                rows * stride,
+                pixels + (usize) y * stride
+        );
+    }
+}
+
+void window_present_framebuffer(Window window) {
+    WindowData *window_data = &window_xcb_windows_data[window];
+    if (window_data->framebuffer_count == 0) {
+        return;
+    }
+    WindowFramebuffer *framebuffer = &window_data->framebuffers[window_data->framebuffer_index];
+    if (window_data->framebuffer_shm) {
+        xcb_shm_put_image(
+                window_xcb_connection,
+                window_data->handle,
+                window_data->framebuffer_gc,
+                window_data->framebuffer_width, window_data->framebuffer_height,
+                0, 0,
+                window_data->framebuffer_width, window_data->framebuffer_height,
+                0, 0,
+                window_xcb_screen->root_depth,
+                XCB_IMAGE_FORMAT_Z_PIXMAP,
+                1,
+                framebuffer->segment,
+                0
+        );
+        framebuffer->pending = true;
+    } else {
+        window_xcb_put_image_chunked(window_data, framebuffer->pixels);
+    }
+    window_data->framebuffer_index = (window_data->framebuffer_index + 1) % window_data->framebuffer_count;
+    xcb_flush(window_xcb_connection);
+}
+
 void window_destroy(Window window) {
     if (window_xcb_connection == 0) {
         return;
     }
+    window_xcb_destroy_framebuffers(&window_xcb_windows_data[window]);
+    if (window_xcb_windows_data[window].framebuffer_gc != 0) {
+        xcb_free_gc(window_xcb_connection, window_xcb_windows_data[window].framebuffer_gc);
+    }
     xcb_unmap_window(window_xcb_connection, window_xcb_windows_data[window].handle);
     xcb_destroy_window(window_xcb_connection, window_xcb_windows_data[window].handle);
     window_xcb_window_count--;
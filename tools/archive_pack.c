@@ -0,0 +1,173 @@
+#include "archive.h"
+#include "lz4.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Only keep the compressed blob when it saves at least an eighth, otherwise zero-copy access is worth more. */
+#define ARCHIVE_PACK_MIN_SAVING 8
+
+typedef struct archive_pack_input_s {
+    const char *name;
+    usize nameLength;
+    u8 *data;
+    usize size;
+    u8 *compressed;
+    usize compressedSize;
+} ArchivePackInput;
+
+u64 archive_pack_align(u64 value) {
+    return (value + ARCHIVE_ALIGNMENT - 1) & ~(u64) (ARCHIVE_ALIGNMENT - 1);
+}
+
+/* Entry names are the paths relative to the base directory, always with forward slashes. */
+const char *archive_pack_entry_name(const char *base, const char *path) {
+    usize baseLength = strlen(base);
+    if (strncmp(path, base, baseLength) == 0 && (path[baseLength] == '/' || path[baseLength] == '\\')) {
+        path += baseLength + 1;
+    }
+    char *name = strdup(path);
+    for (char *c = name; name != NULL && *c != '\0'; c++) {
+        if (*c == '\\') {
+            *c = '/';
+        }
+    }
+    return name;
+}
+
+int archive_pack_load(ArchivePackInput *input, const char *path, bool compress) {
+    if (file_read_all_binary(path, &input->size, NULL) != 0) {
+        return 1;
+    }
+    input->data = malloc(input->size > 0 ? input->size : 1);
+    if (input->data == NULL || file_read_all_binary(path, &input->size, input->data) != 0) {
+        return 1;
+    }
+    if (compress && input->size > 0) {
+        usize capacity = input->size - input->size / ARCHIVE_PACK_MIN_SAVING;
+        input->compressed = malloc(capacity);
+        if (input->compressed == NULL) {
+            return 1;
+        }
+        input->compressedSize = lz4_compress(input->data, input->size, input->compressed, capacity);
+        if (input->compressedSize == 0) {
+            free(input->compressed);
+            input->compressed = NULL;
+        }
+    }
+    return 0;
+}
+
+int archive_pack(const char *output_path, ArchivePackInput *inputs, u32 input_count) {
+    u32 slotCount = 1;
+    while (slotCount < input_count * 2 + 1) {
+        slotCount *= 2;
+    }
+    u64 slotsOffset = sizeof(ArchiveHeader);
+    u64 entriesOffset = archive_pack_align(slotsOffset + (u64) slotCount * sizeof(u32));
+    u64 namesOffset = entriesOffset + (u64) input_count * sizeof(ArchiveEntry);
+    u64 namesSize = 0;
+    for (u32 i = 0; i < input_count; i++) {
+        namesSize += inputs[i].nameLength;
+    }
+    u64 size = archive_pack_align(namesOffset + namesSize);
+    for (u32 i = 0; i < input_count; i++) {
+        size = archive_pack_align(size + (inputs[i].compressed != NULL ? inputs[i].compressedSize : inputs[i].size));
+    }
+    u8 *image = calloc(1, size);
+    if (image == NULL) {
+        return 1;
+    }
+    ArchiveHeader *header = (ArchiveHeader *) image;
+    header->magic = ARCHIVE_MAGIC;
+    header->version = ARCHIVE_VERSION;
+    header->entryCount = input_count;
+    header->slotCount = slotCount;
+    header->slotsOffset = slotsOffset;
+    header->entriesOffset = entriesOffset;
+    header->namesOffset = namesOffset;
+    header->namesSize = namesSize;
+    u32 *slots = (u32 *) (image + slotsOffset);
+    memset(slots, 0xFF, slotCount * sizeof(u32));
+    ArchiveEntry *entries = (ArchiveEntry *) (image + entriesOffset);
+    u64 nameOffset = 0;
+    u64 blobOffset = archive_pack_align(namesOffset + namesSize);
+    for (u32 i = 0; i < input_count; i++) {
+        ArchiveEntry *entry = &entries[i];
+        entry->hash = archive_hash_name(inputs[i].name, inputs[i].nameLength);
+        for (u32 j = 0; j < i; j++) {
+            if (entries[j].hash == entry->hash && inputs[j].nameLength == inputs[i].nameLength &&
+                memcmp(inputs[j].name, inputs[i].name, inputs[i].nameLength) == 0) {
+                printf("Duplicate archive entry %s\n", inputs[i].name);
+                free(image);
+                return 1;
+            }
+        }
+        u32 mask = slotCount - 1;
+        u32 slot = (u32) entry->hash & mask;
+        while (slots[slot] != ARCHIVE_EMPTY_SLOT) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = i;
+        memcpy(image + namesOffset + nameOffset, inputs[i].name, inputs[i].nameLength);
+        entry->nameOffset = (u32) nameOffset;
+        entry->nameLength = (u32) inputs[i].nameLength;
+        nameOffset += inputs[i].nameLength;
+        entry->offset = blobOffset;
+        entry->originalSize = inputs[i].size;
+        if (inputs[i].compressed != NULL) {
+            entry->flags = ARCHIVE_ENTRY_LZ4;
+            entry->size = inputs[i].compressedSize;
+            memcpy(image + blobOffset, inputs[i].compressed, inputs[i].compressedSize);
+        } else {
+            entry->size = inputs[i].size;
+            memcpy(image + blobOffset, inputs[i].data, inputs[i].size);
+        }
+        blobOffset = archive_pack_align(blobOffset + entry->size);
+    }
+    int status = file_write_all_binary(output_path, size, image);
+    free(image);
+    return status != 0;
+}
+
+int main(int argc, char **argv) {
+    bool compress = false;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "--compress") == 0) {
+        compress = true;
+        first++;
+    }
+    if (argc - first < 2) {
+        printf("Usage: %s [--compress] <archive> <base directory> <files...>\n", argv[0]);
+        return 1;
+    }
+    const char *output_path = argv[first];
+    const char *base = argv[first + 1];
+    u32 input_count = (u32) (argc - first - 2);
+    ArchivePackInput *inputs = calloc(input_count > 0 ? input_count : 1, sizeof(ArchivePackInput));
+    if (inputs == NULL) {
+        return 1;
+    }
+    int result = 0;
+    for (u32 i = 0; i < input_count && result == 0; i++) {
+        const char *path = argv[first + 2 + i];
+        inputs[i].name = archive_pack_entry_name(base, path);
+        if (inputs[i].name == NULL || archive_pack_load(&inputs[i], path, compress) != 0) {
+            printf("Failed to read %s\n", path);
+            result = 1;
+            break;
+        }
+        inputs[i].nameLength = strlen(inputs[i].name);
+    }
+    if (result == 0 && archive_pack(output_path, inputs, input_count) != 0) {
+        printf("Failed to write %s\n", output_path);
+        result = 1;
+    }
+    for (u32 i = 0; i < input_count; i++) {
+        free((char *) inputs[i].name);
+        free(inputs[i].data);
+        free(inputs[i].compressed);
+    }
+    free(inputs);
+    return result;
+}
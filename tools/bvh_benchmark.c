@@ -0,0 +1,194 @@
+#include "bvh.h"
+#include "job.h"
+#include "ray_packet.h"
+#include "timer.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BVH_BENCHMARK_DEFAULT_TRIANGLE_COUNT 1000000
+#define BVH_BENCHMARK_RAY_GRID 512
+#define BVH_BENCHMARK_RAYS_PER_JOB 4096
+#define BVH_BENCHMARK_VALIDATION_RAYS 64
+
+float bvh_benchmark_random_float(u32 *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (float) (*state >> 8) / 16777216.0f;
+}
+
+typedef struct bvh_benchmark_trace_s {
+    const Bvh *bvh;
+    const TriangleSoa *triangles;
+    u32 first_ray;
+    u32 ray_count;
+    u32 hit_count;
+} BvhBenchmarkTrace;
+
+Vec3 bvh_benchmark_ray_direction(u32 ray) {
+    float x = ((float) (ray % BVH_BENCHMARK_RAY_GRID) + 0.5f) / BVH_BENCHMARK_RAY_GRID - 0.5f;
+    float y = ((float) (ray / BVH_BENCHMARK_RAY_GRID) + 0.5f) / BVH_BENCHMARK_RAY_GRID - 0.5f;
+    return vec3(x, y, 1.0f);
+}
+
+void bvh_benchmark_trace_job(void *arg) {
+    BvhBenchmarkTrace *trace = arg;
+    Vec3 origin = vec3(0.0f, 0.0f, -3.0f);
+    trace->hit_count = 0;
+    for (u32 ray = trace->first_ray; ray < trace->first_ray + trace->ray_count; ray++) {
+        float t_max = FLT_MAX;
+        if (bvh_intersect_triangles(trace->bvh, trace->triangles, origin, bvh_benchmark_ray_direction(ray),
+                                    0.0f, &t_max) != RAY_PACKET_NO_HIT) {
+            trace->hit_count++;
+        }
+    }
+}
+
+double bvh_benchmark_trace_all(const Bvh *bvh, const TriangleSoa *triangles, u32 *hit_count) {
+    u32 ray_count = BVH_BENCHMARK_RAY_GRID * BVH_BENCHMARK_RAY_GRID;
+    u32 job_count = ray_count / BVH_BENCHMARK_RAYS_PER_JOB;
+    *hit_count = 0;
+    BvhBenchmarkTrace *traces = malloc(sizeof(BvhBenchmarkTrace) * job_count);
+    if (traces == NULL) {
+        return 0.0;
+    }
+    JobCounter counter;
+    job_counter_init(&counter);
+    u64 start = timer_get_time_ns();
+    for (u32 i = 0; i < job_count; i++) {
+        traces[i].bvh = bvh;
+        traces[i].triangles = triangles;
+        traces[i].first_ray = i * BVH_BENCHMARK_RAYS_PER_JOB;
+        traces[i].ray_count = BVH_BENCHMARK_RAYS_PER_JOB;
+        job_run(bvh_benchmark_trace_job, &traces[i], &counter);
+    }
+    job_wait(&counter);
+    double seconds = (double) (timer_get_time_ns() - start) / 1e9;
+    for (u32 i = 0; i < job_count; i++) {
+        *hit_count += traces[i].hit_count;
+    }
+    free(traces);
+    return (double) ray_count / seconds / 1e6;
+}
+
+u32 bvh_benchmark_validate(const Bvh *bvh, TriangleSoa *triangles) {
+    float ray_data[BVH_BENCHMARK_VALIDATION_RAYS * 7];
+    u32 hit_ids[BVH_BENCHMARK_VALIDATION_RAYS];
+    RayPacket rays;
+    rays.originX = ray_data;
+    rays.originY = ray_data + BVH_BENCHMARK_VALIDATION_RAYS;
+    rays.originZ = ray_data + BVH_BENCHMARK_VALIDATION_RAYS * 2;
+    rays.directionX = ray_data + BVH_BENCHMARK_VALIDATION_RAYS * 3;
+    rays.directionY = ray_data + BVH_BENCHMARK_VALIDATION_RAYS * 4;
+    rays.directionZ = ray_data + BVH_BENCHMARK_VALIDATION_RAYS * 5;
+    rays.tMax = ray_data + BVH_BENCHMARK_VALIDATION_RAYS * 6;
+    rays.hitId = hit_ids;
+    rays.count = BVH_BENCHMARK_VALIDATION_RAYS;
+    u32 stride = BVH_BENCHMARK_RAY_GRID * BVH_BENCHMARK_RAY_GRID / BVH_BENCHMARK_VALIDATION_RAYS;
+    for (u32 i = 0; i < BVH_BENCHMARK_VALIDATION_RAYS; i++) {
+        Vec3 direction = bvh_benchmark_ray_direction(i * stride + stride / 2);
+        rays.originX[i] = 0.0f;
+        rays.originY[i] = 0.0f;
+        rays.originZ[i] = -3.0f;
+        rays.directionX[i] = direction.x;
+        rays.directionY[i] = direction.y;
+        rays.directionZ[i] = direction.z;
+        rays.tMax[i] = FLT_MAX;
+        rays.hitId[i] = RAY_PACKET_NO_HIT;
+    }
+    ray_packet_intersect_triangles(&rays, triangles, 0.0f, 0);
+    u32 mismatch_count = 0;
+    for (u32 i = 0; i < BVH_BENCHMARK_VALIDATION_RAYS; i++) {
+        float t_max = FLT_MAX;
+        u32 hit = bvh_intersect_triangles(bvh, triangles, vec3(0.0f, 0.0f, -3.0f),
+                                          vec3(rays.directionX[i], rays.directionY[i], rays.directionZ[i]), 0.0f,
+                                          &t_max);
+        if (hit != rays.hitId[i]) {
+            mismatch_count++;
+        }
+    }
+    return mismatch_count;
+}
+
+int bvh_benchmark_run(u32 triangle_count) {
+    float *triangle_data = malloc(sizeof(float) * triangle_count * 9);
+    Vec3 *bounds = malloc(sizeof(Vec3) * triangle_count * 2);
+    if (triangle_data == NULL || bounds == NULL) {
+        free(triangle_data);
+        free(bounds);
+        return 1;
+    }
+    TriangleSoa triangles;
+    triangles.v0X = triangle_data;
+    triangles.v0Y = triangle_data + triangle_count;
+    triangles.v0Z = triangle_data + triangle_count * 2;
+    triangles.edge1X = triangle_data + triangle_count * 3;
+    triangles.edge1Y = triangle_data + triangle_count * 4;
+    triangles.edge1Z = triangle_data + triangle_count * 5;
+    triangles.edge2X = triangle_data + triangle_count * 6;
+    triangles.edge2Y = triangle_data + triangle_count * 7;
+    triangles.edge2Z = triangle_data + triangle_count * 8;
+    triangles.count = triangle_count;
+    float edge_scale = 4.0f / cbrtf((float) triangle_count);
+    u32 random = 7;
+    for (u32 i = 0; i < triangle_count * 9; i++) {
+        float value = bvh_benchmark_random_float(&random) * 2.0f - 1.0f;
+        triangle_data[i] = i < triangle_count * 3 ? value : value * edge_scale;
+    }
+    Vec3 *bounds_min = bounds;
+    Vec3 *bounds_max = bounds + triangle_count;
+    bvh_get_triangle_bounds(&triangles, bounds_min, bounds_max);
+
+    Bvh bvh;
+    u64 start = timer_get_time_ns();
+    if (bvh_build(&bvh, bounds_min, bounds_max, triangle_count) != 0) {
+        printf("Failed to build BVH\n");
+        free(triangle_data);
+        free(bounds);
+        return 1;
+    }
+    double build_ms = (double) (timer_get_time_ns() - start) / 1e6;
+    printf("BVH over %u triangles built in %.1f ms on %u threads: %u nodes, %.1f MiB\n", triangle_count, build_ms,
+           job_system_get_thread_count(), bvh.nodeCount, (double) bvh_get_memory_size(&bvh) / (1024.0 * 1024.0));
+    u32 hit_count;
+    double mrays = bvh_benchmark_trace_all(&bvh, &triangles, &hit_count);
+    printf("Traced %u rays: %.2f Mrays/s, %u hits, %u/%u mismatches against brute force\n",
+           BVH_BENCHMARK_RAY_GRID * BVH_BENCHMARK_RAY_GRID, mrays, hit_count, bvh_benchmark_validate(&bvh, &triangles),
+           BVH_BENCHMARK_VALIDATION_RAYS);
+
+    float *v0_x = triangle_data;
+    for (u32 i = 0; i < triangle_count; i++) {
+        v0_x[i] += 0.01f;
+        v0_x[i + triangle_count] += 0.01f;
+    }
+    start = timer_get_time_ns();
+    bvh_get_triangle_bounds(&triangles, bounds_min, bounds_max);
+    bvh_refit(&bvh, bounds_min, bounds_max);
+    double refit_ms = (double) (timer_get_time_ns() - start) / 1e6;
+    mrays = bvh_benchmark_trace_all(&bvh, &triangles, &hit_count);
+    printf("Refit after moving every triangle in %.1f ms: %.2f Mrays/s, %u hits, %u/%u mismatches\n", refit_ms,
+           mrays, hit_count, bvh_benchmark_validate(&bvh, &triangles), BVH_BENCHMARK_VALIDATION_RAYS);
+
+    bvh_destroy(&bvh);
+    free(triangle_data);
+    free(bounds);
+    return 0;
+}
+
+/*
+ * Builds a BVH over random triangles, traces a grid of primary rays through it on the job system and checks a sample
+ * against brute force, then does the same after moving every triangle and refitting.
+ */
+int main(int argc, char **argv) {
+    u32 triangle_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 0;
+    if (triangle_count == 0) {
+        triangle_count = BVH_BENCHMARK_DEFAULT_TRIANGLE_COUNT;
+    }
+    if (job_system_init(0) != 0) {
+        printf("Failed to start job system\n");
+        return 1;
+    }
+    int result = bvh_benchmark_run(triangle_count);
+    job_system_destroy();
+    return result;
+}
@@ -0,0 +1,69 @@
+#include "demo_scene.h"
+#include "file.h"
+#include "job.h"
+#include "rasterizer.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RASTERIZER_BENCHMARK_WIDTH 800
+#define RASTERIZER_BENCHMARK_HEIGHT 600
+#define RASTERIZER_BENCHMARK_DEFAULT_FRAME_COUNT 100
+#define RASTERIZER_BENCHMARK_DEFAULT_CUBE_COUNT 512
+
+int rasterizer_benchmark_run(u32 frame_count, u32 cube_count, const char *output_path) {
+    u32 quad_count = demo_scene_get_quad_count(cube_count);
+    RasterizerVertex *vertices = malloc(sizeof(RasterizerVertex) * quad_count * 4);
+    u32 *indices = malloc(sizeof(u32) * quad_count * 6);
+    Rasterizer rasterizer;
+    if (vertices == NULL || indices == NULL ||
+        rasterizer_create(&rasterizer, RASTERIZER_BENCHMARK_WIDTH, RASTERIZER_BENCHMARK_HEIGHT) != 0) {
+        free(vertices);
+        free(indices);
+        return 1;
+    }
+    demo_scene_build_indices(indices, quad_count);
+    const float clear_color[4] = {0.1f, 0.1f, 0.15f, 1.0f};
+    float aspect = (float) RASTERIZER_BENCHMARK_WIDTH / (float) RASTERIZER_BENCHMARK_HEIGHT;
+    u64 draw_time = 0;
+    int result = 0;
+    for (u32 i = 0; i < frame_count && result == 0; i++) {
+        demo_scene_build(vertices, cube_count, i, aspect);
+        u64 start = timer_get_time_ns();
+        rasterizer_clear(&rasterizer, clear_color, 1.0f);
+        result = rasterizer_draw(&rasterizer, vertices, indices, quad_count * 2, RASTERIZER_CULL_BACK);
+        draw_time += timer_get_time_ns() - start;
+    }
+    double seconds = (double) draw_time / 1e9;
+    printf("Rasterized %u frames of %u triangles at %ux%u on %u threads: %.2f ms/frame, %.1f Mtriangles/s\n",
+           frame_count, quad_count * 2, RASTERIZER_BENCHMARK_WIDTH, RASTERIZER_BENCHMARK_HEIGHT,
+           job_system_get_thread_count(), seconds * 1000.0 / frame_count,
+           (double) quad_count * 2 * frame_count / seconds / 1e6);
+    if (output_path != NULL && file_write_ppm(output_path, RASTERIZER_BENCHMARK_WIDTH, RASTERIZER_BENCHMARK_HEIGHT,
+                                              rasterizer.pixels) != 0) {
+        printf("Failed to write %s\n", output_path);
+    }
+    rasterizer_destroy(&rasterizer);
+    free(vertices);
+    free(indices);
+    return result != 0;
+}
+
+/* Usage: rasterizer_benchmark [frames] [cubes] [output.ppm]. The PPM holds the last frame. */
+int main(int argc, char **argv) {
+    u32 frame_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 0;
+    if (frame_count == 0) {
+        frame_count = RASTERIZER_BENCHMARK_DEFAULT_FRAME_COUNT;
+    }
+    u32 cube_count = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+    if (cube_count == 0) {
+        cube_count = RASTERIZER_BENCHMARK_DEFAULT_CUBE_COUNT;
+    }
+    if (job_system_init(0) != 0) {
+        printf("Failed to start job system\n");
+        return 1;
+    }
+    int result = rasterizer_benchmark_run(frame_count, cube_count, argc > 3 ? argv[3] : NULL);
+    job_system_destroy();
+    return result;
+}
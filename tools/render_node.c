@@ -0,0 +1,129 @@
+#include "file.h"
+#include "job.h"
+#include "raytracer.h"
+#include "render_cluster.h"
+#include "socket.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RENDER_NODE_WIDTH 800
+#define RENDER_NODE_HEIGHT 600
+#define RENDER_NODE_DEFAULT_PORT "7879"
+#define RENDER_NODE_DEFAULT_FRAME_COUNT 3
+#define RENDER_NODE_WORKER_TIMEOUT_MS 30000
+#define RENDER_NODE_FRAME_TIMEOUT_MS 10000
+
+int render_node_coordinate(const char *port, u32 worker_count, u32 frame_count, const char *output_path) {
+    usize frame_size = (usize) RENDER_NODE_WIDTH * RENDER_NODE_HEIGHT * 4;
+    u8 *pixels = malloc(frame_size);
+    u8 *reference = malloc(frame_size);
+    if (pixels == NULL || reference == NULL) {
+        free(pixels);
+        free(reference);
+        return 1;
+    }
+    socket_global_init();
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((u16) strtoul(port, NULL, 10));
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    RenderClusterCoordinator *coordinator = render_cluster_coordinator_create((struct sockaddr *) &address,
+                                                                              sizeof(address));
+    if (coordinator == NULL) {
+        printf("Failed to listen on port %s\n", port);
+        socket_global_destroy();
+        free(pixels);
+        free(reference);
+        return 1;
+    }
+    u32 connected = render_cluster_coordinator_wait_for_workers(coordinator, worker_count,
+                                                                RENDER_NODE_WORKER_TIMEOUT_MS);
+    printf("%u of %u workers connected on port %s\n", connected, worker_count, port);
+    RaytracerScene scene;
+    raytracer_get_default_scene(&scene);
+    u64 start = timer_get_time_ns();
+    raytracer_render(&scene, RENDER_NODE_WIDTH, RENDER_NODE_HEIGHT, reference);
+    printf("Local render: %.2f ms\n", (double) (timer_get_time_ns() - start) / 1e6);
+    int result = connected > 0 ? 0 : 1;
+    for (u32 i = 0; i < frame_count && result == 0; i++) {
+        RenderClusterStats stats;
+        memset(pixels, 0, frame_size);
+        start = timer_get_time_ns();
+        result = render_cluster_coordinator_render(coordinator, RENDER_NODE_WIDTH, RENDER_NODE_HEIGHT, pixels,
+                                                   RENDER_NODE_FRAME_TIMEOUT_MS, &stats);
+        double milliseconds = (double) (timer_get_time_ns() - start) / 1e6;
+        bool match = result == 0 && memcmp(pixels, reference, frame_size) == 0;
+        printf("Frame %u on %u workers: %.2f ms, %u tiles, %u stolen, %u duplicated, %u wasted, %.1f MB, %s\n", i,
+               stats.workerCount, milliseconds, stats.tileCount, stats.stolenTiles, stats.duplicatedTiles,
+               stats.wastedTiles, (double) stats.bytesReceived / 1e6, match ? "matches" : "does not match");
+        if (!match) {
+            result = 1;
+        }
+    }
+    if (output_path != NULL && file_write_ppm(output_path, RENDER_NODE_WIDTH, RENDER_NODE_HEIGHT, pixels) != 0) {
+        printf("Failed to write %s\n", output_path);
+    }
+    render_cluster_coordinator_destroy(coordinator);
+    socket_global_destroy();
+    free(pixels);
+    free(reference);
+    return result != 0;
+}
+
+int render_node_work(const char *host, const char *port, u32 delay) {
+    socket_global_init();
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *address_info;
+    if (socket_get_address_info(host, port, &hints, &address_info) != 0) {
+        printf("Failed to resolve %s\n", host);
+        socket_global_destroy();
+        return 1;
+    }
+    u32 tiles_rendered = 0;
+    int status = render_cluster_worker_run(address_info->ai_addr, (int) address_info->ai_addrlen, delay,
+                                           &tiles_rendered);
+    socket_free_address_info(address_info);
+    socket_global_destroy();
+    printf("Worker rendered %u tiles, status %d\n", tiles_rendered, status);
+    return status != 0;
+}
+
+/*
+ * A coordinator waits for the given number of workers, raytraces frames across them and checks each against a local
+ * render. Workers connect to the coordinator's host, so several of them can run as separate processes on localhost;
+ * a worker delay adds milliseconds to every tile, to see slow nodes being rebalanced.
+ */
+int main(int argc, char **argv) {
+    bool coordinator = argc > 1 && strcmp(argv[1], "coordinator") == 0;
+    bool worker = argc > 2 && strcmp(argv[1], "worker") == 0;
+    if (!coordinator && !worker) {
+        printf("Usage: %s coordinator [port] [workers] [frames] [output.ppm]\n"
+               "       %s worker <host> [port] [delay ms]\n", argv[0], argv[0]);
+        return 1;
+    }
+    if (job_system_init(0) != 0) {
+        printf("Failed to start job system\n");
+        return 1;
+    }
+    int result;
+    if (coordinator) {
+        u32 worker_count = argc > 3 ? strtoul(argv[3], NULL, 10) : 1;
+        u32 frame_count = argc > 4 ? strtoul(argv[4], NULL, 10) : 0;
+        if (frame_count == 0) {
+            frame_count = RENDER_NODE_DEFAULT_FRAME_COUNT;
+        }
+        result = render_node_coordinate(argc > 2 ? argv[2] : RENDER_NODE_DEFAULT_PORT, worker_count, frame_count,
+                                        argc > 5 ? argv[5] : NULL);
+    } else {
+        result = render_node_work(argv[2], argc > 3 ? argv[3] : RENDER_NODE_DEFAULT_PORT,
+                                  argc > 4 ? strtoul(argv[4], NULL, 10) : 0);
+    }
+    job_system_destroy();
+    return result;
+}
@@ -0,0 +1,101 @@
+#include "connection_pool.h"
+#include "file.h"
+#include "resolver.h"
+#include "socket.h"
+#include "timer.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RESOLVER_TEST_HOSTS_PATH "cgfs_hosts.txt"
+#define RESOLVER_TEST_ROUNDS 4
+
+/*
+ * Resolves through a hosts file (the first argument, or a generated one mapping cgfs.local to the loopback address),
+ * then connects to a local listener through the connection pool a few times. Only the first lookup and the first
+ * connect should do any work.
+ */
+int main(int argc, char **argv) {
+    const char *hosts_path = argc > 1 ? argv[1] : NULL;
+    if (hosts_path == NULL) {
+        const char *hosts = "# Generated by cgfs\n127.0.0.1 cgfs.local render-node\n::1 cgfs.local\n";
+        hosts_path = RESOLVER_TEST_HOSTS_PATH;
+        if (file_write_all_binary(hosts_path, strlen(hosts), (const u8 *) hosts) != 0) {
+            printf("Failed to write %s\n", hosts_path);
+            return 1;
+        }
+    }
+    socket_global_init();
+    Resolver *resolver = resolver_create(0, hosts_path, 0);
+    if (resolver == NULL) {
+        printf("Failed to load %s\n", hosts_path);
+        socket_global_destroy();
+        return 1;
+    }
+    Socket listener = socket_create(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int address_length = sizeof(address);
+    if (listener == INVALID_SOCKET_HANDLE || socket_bind(listener, (struct sockaddr *) &address, address_length) != 0 ||
+        socket_listen(listener, 16) != 0 ||
+        getsockname(listener, (struct sockaddr *) &address, (void *) &address_length) != 0) {
+        printf("Failed to listen on the loopback address\n");
+        resolver_destroy(resolver);
+        socket_global_destroy();
+        return 1;
+    }
+    char service[16];
+    snprintf(service, sizeof(service), "%u", ntohs(address.sin_port));
+    int result = 0;
+    for (u32 i = 0; i < 2; i++) {
+        ResolverQuery query;
+        u64 start = timer_get_time_ns();
+        resolver_resolve(resolver, "cgfs.local", service, AF_INET, SOCK_STREAM, &query);
+        int status = resolver_query_wait(&query);
+        printf("Resolved cgfs.local: status %d, %u addresses, %s, %.1f us\n", status, query.addressCount,
+               query.cached ? "cached" : "looked up", (double) (timer_get_time_ns() - start) / 1e3);
+        if (status != 0) {
+            result = 1;
+        }
+    }
+    ResolverQuery missing;
+    resolver_resolve(resolver, "missing.local", service, AF_UNSPEC, SOCK_STREAM, &missing);
+    if (resolver_query_wait(&missing) == 0) {
+        printf("Resolved a name that is not in %s\n", hosts_path);
+        result = 1;
+    }
+    ConnectionPool *pool = connection_pool_create(resolver, 4, 30000);
+    if (pool != NULL) {
+        connection_pool_prefetch(pool, "render-node", service);
+    }
+    for (u32 i = 0; i < RESOLVER_TEST_ROUNDS && pool != NULL; i++) {
+        Socket sock;
+        u64 start = timer_get_time_ns();
+        int status = connection_pool_acquire(pool, "render-node", service, &sock);
+        printf("Acquired render-node:%s: status %d, %.1f us\n", service, status,
+               (double) (timer_get_time_ns() - start) / 1e3);
+        if (status != 0) {
+            result = 1;
+            break;
+        }
+        connection_pool_release(pool, "render-node", service, sock, true);
+    }
+    if (pool != NULL) {
+        ConnectionPoolStats stats = connection_pool_get_stats(pool);
+        printf("Connection pool: %llu created, %llu reused, %u idle\n",
+               (unsigned long long) stats.connectionsCreated, (unsigned long long) stats.connectionsReused,
+               stats.idleCount);
+        if (stats.connectionsCreated != 1) {
+            result = 1;
+        }
+        connection_pool_destroy(pool);
+    }
+    ResolverStats stats = resolver_get_stats(resolver);
+    printf("Resolver: %llu cache hits, %llu misses\n", (unsigned long long) stats.cacheHits,
+           (unsigned long long) stats.cacheMisses);
+    resolver_destroy(resolver);
+    socket_close(listener);
+    socket_global_destroy();
+    return result;
+}
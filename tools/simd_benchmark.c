@@ -0,0 +1,116 @@
+#include "ray_packet.h"
+#include "simd.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIMD_BENCHMARK_RAY_COUNT 65536
+#define SIMD_BENCHMARK_SPHERE_COUNT 32
+#define SIMD_BENCHMARK_TRIANGLE_COUNT 64
+#define SIMD_BENCHMARK_ITERATIONS 20
+
+float simd_benchmark_random_float(u32 *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (float) (*state >> 8) / 16777216.0f;
+}
+
+/* Runs the same packets through the sphere and triangle kernels once for every instruction set this CPU supports. */
+int main() {
+    u32 ray_count = SIMD_BENCHMARK_RAY_COUNT;
+    float *ray_data = malloc(sizeof(float) * ray_count * 7);
+    u32 *hit_ids = malloc(sizeof(u32) * ray_count);
+    float *primitive_data = malloc(sizeof(float) * (SIMD_BENCHMARK_SPHERE_COUNT * 4 +
+                                                    SIMD_BENCHMARK_TRIANGLE_COUNT * 9));
+    if (ray_data == NULL || hit_ids == NULL || primitive_data == NULL) {
+        free(ray_data);
+        free(hit_ids);
+        free(primitive_data);
+        return 1;
+    }
+    RayPacket rays;
+    rays.originX = ray_data;
+    rays.originY = ray_data + ray_count;
+    rays.originZ = ray_data + ray_count * 2;
+    rays.directionX = ray_data + ray_count * 3;
+    rays.directionY = ray_data + ray_count * 4;
+    rays.directionZ = ray_data + ray_count * 5;
+    rays.tMax = ray_data + ray_count * 6;
+    rays.hitId = hit_ids;
+    rays.count = ray_count;
+
+    u32 random = 1;
+    SphereSoa spheres;
+    float *sphere_data = primitive_data;
+    for (u32 i = 0; i < SIMD_BENCHMARK_SPHERE_COUNT; i++) {
+        sphere_data[i] = simd_benchmark_random_float(&random) * 8.0f - 4.0f;
+        sphere_data[SIMD_BENCHMARK_SPHERE_COUNT + i] = simd_benchmark_random_float(&random) * 8.0f - 4.0f;
+        sphere_data[SIMD_BENCHMARK_SPHERE_COUNT * 2 + i] = simd_benchmark_random_float(&random) * 8.0f + 4.0f;
+        sphere_data[SIMD_BENCHMARK_SPHERE_COUNT * 3 + i] = simd_benchmark_random_float(&random) * 0.5f + 0.1f;
+    }
+    spheres.centerX = sphere_data;
+    spheres.centerY = sphere_data + SIMD_BENCHMARK_SPHERE_COUNT;
+    spheres.centerZ = sphere_data + SIMD_BENCHMARK_SPHERE_COUNT * 2;
+    spheres.radius = sphere_data + SIMD_BENCHMARK_SPHERE_COUNT * 3;
+    spheres.count = SIMD_BENCHMARK_SPHERE_COUNT;
+
+    TriangleSoa triangles;
+    float *triangle_data = primitive_data + SIMD_BENCHMARK_SPHERE_COUNT * 4;
+    for (u32 i = 0; i < SIMD_BENCHMARK_TRIANGLE_COUNT * 9; i++) {
+        u32 component = i / SIMD_BENCHMARK_TRIANGLE_COUNT;
+        float value = simd_benchmark_random_float(&random);
+        if (component < 3) {
+            value = value * 8.0f - 4.0f + (component == 2 ? 8.0f : 0.0f);
+        } else {
+            value = value * 2.0f - 1.0f;
+        }
+        triangle_data[i] = value;
+    }
+    triangles.v0X = triangle_data;
+    triangles.v0Y = triangle_data + SIMD_BENCHMARK_TRIANGLE_COUNT;
+    triangles.v0Z = triangle_data + SIMD_BENCHMARK_TRIANGLE_COUNT * 2;
+    triangles.edge1X = triangle_data + SIMD_BENCHMARK_TRIANGLE_COUNT * 3;
+    triangles.edge1Y = triangle_data + SIMD_BENCHMARK_TRIANGLE_COUNT * 4;
+    triangles.edge1Z = triangle_data + SIMD_BENCHMARK_TRIANGLE_COUNT * 5;
+    triangles.edge2X = triangle_data + SIMD_BENCHMARK_TRIANGLE_COUNT * 6;
+    triangles.edge2Y = triangle_data + SIMD_BENCHMARK_TRIANGLE_COUNT * 7;
+    triangles.edge2Z = triangle_data + SIMD_BENCHMARK_TRIANGLE_COUNT * 8;
+    triangles.count = SIMD_BENCHMARK_TRIANGLE_COUNT;
+
+    SimdIsa best_isa = simd_get_isa();
+    for (u32 isa = SIMD_ISA_SCALAR; isa < SIMD_ISA_COUNT; isa++) {
+        if (!simd_set_isa((SimdIsa) isa)) {
+            continue;
+        }
+        u64 elapsed = 0;
+        u32 hit_count = 0;
+        for (u32 iteration = 0; iteration < SIMD_BENCHMARK_ITERATIONS; iteration++) {
+            u32 width = 256;
+            for (u32 i = 0; i < ray_count; i++) {
+                rays.originX[i] = 0.0f;
+                rays.originY[i] = 0.0f;
+                rays.originZ[i] = 0.0f;
+                rays.directionX[i] = ((float) (i % width) + 0.5f) / (float) width - 0.5f;
+                rays.directionY[i] = ((float) (i / width) + 0.5f) / (float) (ray_count / width) - 0.5f;
+                rays.directionZ[i] = 1.0f;
+                rays.tMax[i] = 1e30f;
+                rays.hitId[i] = RAY_PACKET_NO_HIT;
+            }
+            u64 start = timer_get_time_ns();
+            ray_packet_intersect_spheres(&rays, &spheres, 0.001f, 0);
+            ray_packet_intersect_triangles(&rays, &triangles, 0.001f, SIMD_BENCHMARK_SPHERE_COUNT);
+            elapsed += timer_get_time_ns() - start;
+        }
+        for (u32 i = 0; i < ray_count; i++) {
+            hit_count += rays.hitId[i] != RAY_PACKET_NO_HIT;
+        }
+        double seconds = (double) elapsed / 1e9;
+        printf("%-7s width %2u: %7.2f Mrays/s against %u primitives, %u hits\n", simd_get_isa_name((SimdIsa) isa),
+               simd_get_width((SimdIsa) isa), (double) ray_count * SIMD_BENCHMARK_ITERATIONS / seconds / 1e6,
+               SIMD_BENCHMARK_SPHERE_COUNT + SIMD_BENCHMARK_TRIANGLE_COUNT, hit_count);
+    }
+    simd_set_isa(best_isa);
+    free(ray_data);
+    free(hit_ids);
+    free(primitive_data);
+    return 0;
+}
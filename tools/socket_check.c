@@ -0,0 +1,309 @@
+#include "file.h"
+#include "socket.h"
+#include "thread.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SOCKET_CHECK_DATAGRAM_COUNT 48
+#define SOCKET_CHECK_DATAGRAM_SIZE 1024
+#define SOCKET_CHECK_STREAM_SIZE (4 * 1024 * 1024)
+#define SOCKET_CHECK_ZERO_COPY_CHUNK (256 * 1024)
+#define SOCKET_CHECK_FILE_PATH "cgfs_socket_check.bin"
+#define SOCKET_CHECK_TIMEOUT_MS 5000
+
+/* Reads until length bytes arrived or the peer closed, scattering every read over two buffers. */
+typedef struct socket_check_receiver_s {
+    Socket sock;
+    u8 *data;
+    usize length;
+    usize received;
+} SocketCheckReceiver;
+
+u8 socket_check_pattern(usize offset) {
+    return (u8) (offset * 7 + (offset >> 11));
+}
+
+bool socket_check_pattern_matches(const u8 *data, usize length) {
+    for (usize i = 0; i < length; i++) {
+        if (data[i] != socket_check_pattern(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void *socket_check_receive_thread(void *arg) {
+    SocketCheckReceiver *receiver = arg;
+    while (receiver->received < receiver->length) {
+        usize remaining = receiver->length - receiver->received;
+        usize head = remaining < 4096 ? remaining : 4096;
+        SocketBuffer buffers[2];
+        buffers[0] = socket_buffer(receiver->data + receiver->received, head);
+        buffers[1] = socket_buffer(receiver->data + receiver->received + head, remaining - head);
+        isize received = socket_receive_vector(receiver->sock, buffers, remaining > head ? 2 : 1, 0);
+        if (received <= 0) {
+            break;
+        }
+        receiver->received += (usize) received;
+    }
+    return NULL;
+}
+
+/* A connected pair of blocking TCP sockets on the loopback address. */
+int socket_check_connect_pair(Socket *client, Socket *server) {
+    Socket listener = socket_create(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int address_length = sizeof(address);
+    *client = INVALID_SOCKET_HANDLE;
+    *server = INVALID_SOCKET_HANDLE;
+    if (listener == INVALID_SOCKET_HANDLE || socket_bind(listener, (struct sockaddr *) &address, address_length) != 0 ||
+        socket_listen(listener, 1) != 0 ||
+        getsockname(listener, (struct sockaddr *) &address, (void *) &address_length) != 0) {
+        if (listener != INVALID_SOCKET_HANDLE) {
+            socket_close(listener);
+        }
+        return -1;
+    }
+    *client = socket_create(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (*client != INVALID_SOCKET_HANDLE && socket_connect(*client, (struct sockaddr *) &address, address_length) == 0) {
+        *server = socket_accept(listener, NULL, NULL);
+    }
+    socket_close(listener);
+    if (*server == INVALID_SOCKET_HANDLE) {
+        if (*client != INVALID_SOCKET_HANDLE) {
+            socket_close(*client);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/* Datagrams of a header and a payload buffer each, sent with socket_send_batch and taken with socket_receive_batch. */
+int socket_check_batch() {
+    Socket sender = socket_create(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    Socket receiver = socket_create(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int address_length = sizeof(address);
+    int buffer_size = SOCKET_CHECK_DATAGRAM_COUNT * SOCKET_CHECK_DATAGRAM_SIZE * 4;
+    socket_set_option(receiver, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    if (sender == INVALID_SOCKET_HANDLE || receiver == INVALID_SOCKET_HANDLE ||
+        socket_bind(receiver, (struct sockaddr *) &address, address_length) != 0 ||
+        getsockname(receiver, (struct sockaddr *) &address, (void *) &address_length) != 0) {
+        printf("Batch: failed to set up sockets\n");
+        socket_close(sender);
+        socket_close(receiver);
+        return 1;
+    }
+    u32 headers[SOCKET_CHECK_DATAGRAM_COUNT];
+    u8 *payload = malloc(SOCKET_CHECK_DATAGRAM_SIZE);
+    u8 *received = malloc((usize) SOCKET_CHECK_DATAGRAM_COUNT * (SOCKET_CHECK_DATAGRAM_SIZE + sizeof(u32)));
+    SocketBuffer send_buffers[SOCKET_CHECK_DATAGRAM_COUNT * 2];
+    SocketBuffer receive_buffers[SOCKET_CHECK_DATAGRAM_COUNT];
+    SocketMessage messages[SOCKET_CHECK_DATAGRAM_COUNT];
+    if (payload == NULL || received == NULL) {
+        free(payload);
+        free(received);
+        socket_close(sender);
+        socket_close(receiver);
+        return 1;
+    }
+    for (usize i = 0; i < SOCKET_CHECK_DATAGRAM_SIZE; i++) {
+        payload[i] = socket_check_pattern(i);
+    }
+    for (u32 i = 0; i < SOCKET_CHECK_DATAGRAM_COUNT; i++) {
+        headers[i] = i;
+        send_buffers[i * 2] = socket_buffer(&headers[i], sizeof(u32));
+        send_buffers[i * 2 + 1] = socket_buffer(payload, SOCKET_CHECK_DATAGRAM_SIZE - i);
+        memset(&messages[i], 0, sizeof(SocketMessage));
+        messages[i].buffers = &send_buffers[i * 2];
+        messages[i].bufferCount = 2;
+        messages[i].address = (struct sockaddr *) &address;
+        messages[i].addressLength = address_length;
+    }
+    u64 start = timer_get_time_ns();
+    int sent = socket_send_batch(sender, messages, SOCKET_CHECK_DATAGRAM_COUNT, 0);
+    double send_us = (double) (timer_get_time_ns() - start) / 1e3;
+    u32 count = 0;
+    u32 calls = 0;
+    bool valid = true;
+    while (sent > 0 && count < (u32) sent && socket_poll(receiver, POLLIN, SOCKET_CHECK_TIMEOUT_MS, NULL) == 1) {
+        for (u32 i = 0; i < (u32) sent - count; i++) {
+            receive_buffers[i] = socket_buffer(received + (usize) (count + i) * (SOCKET_CHECK_DATAGRAM_SIZE + 4),
+                                               SOCKET_CHECK_DATAGRAM_SIZE + 4);
+            memset(&messages[i], 0, sizeof(SocketMessage));
+            messages[i].buffers = &receive_buffers[i];
+            messages[i].bufferCount = 1;
+        }
+        int batch = socket_receive_batch(receiver, messages, (u32) sent - count, 0);
+        if (batch <= 0) {
+            break;
+        }
+        for (u32 i = 0; i < (u32) batch; i++) {
+            const u8 *datagram = received + (usize) (count + i) * (SOCKET_CHECK_DATAGRAM_SIZE + 4);
+            u32 index;
+            memcpy(&index, datagram, sizeof(u32));
+            valid = valid && index == count + i &&
+                    messages[i].length == sizeof(u32) + SOCKET_CHECK_DATAGRAM_SIZE - index &&
+                    socket_check_pattern_matches(datagram + sizeof(u32), SOCKET_CHECK_DATAGRAM_SIZE - index);
+        }
+        count += (u32) batch;
+        calls++;
+    }
+    bool passed = sent == SOCKET_CHECK_DATAGRAM_COUNT && count == (u32) sent && valid;
+    printf("Batch: %d of %u datagrams sent in %.1f us, %u received in %u calls, %s\n", sent,
+           SOCKET_CHECK_DATAGRAM_COUNT, send_us, count, calls, passed ? "ok" : "FAILED");
+    free(payload);
+    free(received);
+    socket_close(sender);
+    socket_close(receiver);
+    return passed ? 0 : 1;
+}
+
+/*
+ * Sends the stream in chunks with SOCKET_SEND_ZERO_COPY and waits until the error queue has reported every one of
+ * them, which is when the buffer may be reused. Systems without MSG_ZEROCOPY skip the check.
+ */
+int socket_check_zero_copy(const u8 *data) {
+    Socket client, server;
+    if (socket_check_connect_pair(&client, &server) != 0) {
+        printf("Zero copy: failed to connect\n");
+        return 1;
+    }
+    if (socket_enable_zero_copy(client) != 0) {
+        printf("Zero copy: not supported here, skipped\n");
+        socket_close(client);
+        socket_close(server);
+        return 0;
+    }
+    u8 *received = malloc(SOCKET_CHECK_STREAM_SIZE);
+    SocketCheckReceiver receiver = {server, received, SOCKET_CHECK_STREAM_SIZE, 0};
+    Thread thread = received != NULL ? thread_create(socket_check_receive_thread, &receiver) : 0;
+    if (thread == 0) {
+        free(received);
+        socket_close(client);
+        socket_close(server);
+        return 1;
+    }
+    u32 send_count = 0;
+    usize sent = 0;
+    while (sent < SOCKET_CHECK_STREAM_SIZE) {
+        usize chunk = SOCKET_CHECK_STREAM_SIZE - sent;
+        chunk = chunk < SOCKET_CHECK_ZERO_COPY_CHUNK ? chunk : SOCKET_CHECK_ZERO_COPY_CHUNK;
+        isize result = socket_send(client, data + sent, chunk, SOCKET_SEND_ZERO_COPY);
+        if (result < 0) {
+            break;
+        }
+        sent += (usize) result;
+        send_count++;
+    }
+    usize thread_result;
+    thread_join(thread, &thread_result);
+    /* The notifications arrive on the error queue, which poll reports as POLLERR whatever events were asked for. */
+    u32 completed = 0;
+    u32 notifications = 0;
+    u64 deadline = timer_get_time_ns() + (u64) SOCKET_CHECK_TIMEOUT_MS * 1000000;
+    while (completed < send_count && timer_get_time_ns() < deadline) {
+        u32 first, last;
+        int status = socket_get_zero_copy_completions(client, &first, &last);
+        if (status < 0) {
+            break;
+        }
+        if (status == 0) {
+            socket_poll(client, 0, 10, NULL);
+            continue;
+        }
+        completed += last - first + 1;
+        notifications++;
+    }
+    bool passed = sent == SOCKET_CHECK_STREAM_SIZE && receiver.received == SOCKET_CHECK_STREAM_SIZE &&
+                  completed == send_count && socket_check_pattern_matches(received, SOCKET_CHECK_STREAM_SIZE);
+    printf("Zero copy: %llu bytes in %u sends, %u completed in %u notifications, %s\n", (unsigned long long) sent,
+           send_count, completed, notifications, passed ? "ok" : "FAILED");
+    free(received);
+    socket_close(client);
+    socket_close(server);
+    return passed ? 0 : 1;
+}
+
+/* Sends the file from an odd offset with socket_send_file, so partial sends have to pick up mid-page. */
+int socket_check_send_file(const u8 *data) {
+    if (file_write_all_binary(SOCKET_CHECK_FILE_PATH, SOCKET_CHECK_STREAM_SIZE, data) != 0) {
+        printf("Send file: failed to write %s\n", SOCKET_CHECK_FILE_PATH);
+        return 1;
+    }
+    FileHandle file;
+    u64 size;
+    if (file_open_read(SOCKET_CHECK_FILE_PATH, &file, &size) != 0) {
+        printf("Send file: failed to open %s\n", SOCKET_CHECK_FILE_PATH);
+        remove(SOCKET_CHECK_FILE_PATH);
+        return 1;
+    }
+    Socket client, server;
+    if (socket_check_connect_pair(&client, &server) != 0) {
+        printf("Send file: failed to connect\n");
+        file_close(file);
+        remove(SOCKET_CHECK_FILE_PATH);
+        return 1;
+    }
+    u64 offset = 3;
+    u8 *received = malloc(SOCKET_CHECK_STREAM_SIZE);
+    SocketCheckReceiver receiver = {server, received, (usize) (size - offset), 0};
+    Thread thread = received != NULL ? thread_create(socket_check_receive_thread, &receiver) : 0;
+    u32 call_count = 0;
+    u64 start = timer_get_time_ns();
+    while (thread != 0 && offset < size) {
+        isize result = socket_send_file(client, file, offset, (usize) (size - offset));
+        if (result <= 0) {
+            break;
+        }
+        offset += (u64) result;
+        call_count++;
+    }
+    if (thread != 0) {
+        socket_shutdown(client, SHUT_WR);
+        usize thread_result;
+        thread_join(thread, &thread_result);
+    }
+    double seconds = (double) (timer_get_time_ns() - start) / 1e9;
+    bool passed = offset == size && receiver.received == receiver.length;
+    for (usize i = 0; passed && i < receiver.length; i++) {
+        passed = received[i] == data[i + 3];
+    }
+    printf("Send file: %llu bytes in %u calls, %.1f MB/s, %s\n", (unsigned long long) receiver.received, call_count,
+           seconds > 0.0 ? (double) receiver.received / 1e6 / seconds : 0.0, passed ? "ok" : "FAILED");
+    free(received);
+    socket_close(client);
+    socket_close(server);
+    file_close(file);
+    remove(SOCKET_CHECK_FILE_PATH);
+    return passed ? 0 : 1;
+}
+
+/*
+ * Loopback checks for the socket calls nothing else in the tree drives yet: batched datagrams, zero-copy sends with
+ * their completion notifications, sendfile, and the scattered receives the TCP checks read with.
+ */
+int main() {
+    u8 *data = malloc(SOCKET_CHECK_STREAM_SIZE);
+    if (data == NULL) {
+        return 1;
+    }
+    for (usize i = 0; i < SOCKET_CHECK_STREAM_SIZE; i++) {
+        data[i] = socket_check_pattern(i);
+    }
+    socket_global_init();
+    int failures = socket_check_batch();
+    failures += socket_check_zero_copy(data);
+    failures += socket_check_send_file(data);
+    socket_global_destroy();
+    free(data);
+    return failures != 0;
+}
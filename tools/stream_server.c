@@ -0,0 +1,190 @@
+#include "atomic.h"
+#include "demo_scene.h"
+#include "frame_stream.h"
+#include "job.h"
+#include "rasterizer.h"
+#include "socket.h"
+#include "thread.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STREAM_SERVER_WIDTH 800
+#define STREAM_SERVER_HEIGHT 600
+#define STREAM_SERVER_DEFAULT_PORT 7878
+#define STREAM_SERVER_DEFAULT_FRAME_COUNT 300
+#define STREAM_SERVER_CUBE_COUNT 27
+#define STREAM_SERVER_FRAME_INTERVAL_NS 16666667ull
+#define STREAM_LOOPBACK_TIMEOUT_MS 5000
+
+typedef struct stream_server_client_s {
+    struct sockaddr_in address;
+    u32 delayMs;
+    FrameStreamReceiver receiver;
+    volatile i64 lastFrameNumber;
+    u64 frameCount;
+    u64 byteCount;
+    u64 latencySum;
+    u64 latencyMax;
+    u64 elapsed;
+    int status;
+} StreamServerClient;
+
+/* Loopback viewer; both ends share the process, so the server timestamps are directly comparable. */
+void *stream_server_client_thread(void *arg) {
+    StreamServerClient *client = arg;
+    client->status = frame_stream_receiver_connect(&client->receiver, (struct sockaddr *) &client->address,
+                                                   sizeof(client->address));
+    u64 start = timer_get_time_ns();
+    while (client->status == 0) {
+        client->status = frame_stream_receiver_receive(&client->receiver);
+        if (client->status != 0) {
+            break;
+        }
+        u64 latency = timer_get_time_ns() - client->receiver.header.timestamp;
+        client->frameCount++;
+        client->byteCount += sizeof(FrameStreamHeader) + client->receiver.header.payloadLength;
+        client->latencySum += latency;
+        client->latencyMax = latency > client->latencyMax ? latency : client->latencyMax;
+        client->elapsed = timer_get_time_ns() - start;
+        atomic_store_i64(&client->lastFrameNumber, (i64) client->receiver.header.frameNumber, ATOMIC_RELEASE);
+        if (client->delayMs > 0) {
+            thread_sleep(client->delayMs);
+        }
+    }
+    return NULL;
+}
+
+int stream_server_run(u16 port, u32 frame_count, bool loopback, u32 client_delay) {
+    u32 quad_count = demo_scene_get_quad_count(STREAM_SERVER_CUBE_COUNT);
+    RasterizerVertex *vertices = malloc(sizeof(RasterizerVertex) * quad_count * 4);
+    u32 *indices = malloc(sizeof(u32) * quad_count * 6);
+    Rasterizer rasterizer;
+    if (vertices == NULL || indices == NULL ||
+        rasterizer_create(&rasterizer, STREAM_SERVER_WIDTH, STREAM_SERVER_HEIGHT) != 0) {
+        free(vertices);
+        free(indices);
+        return 1;
+    }
+    demo_scene_build_indices(indices, quad_count);
+    socket_global_init();
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+    FrameStreamServer *server = frame_stream_server_create((struct sockaddr *) &address, sizeof(address));
+    if (server == NULL) {
+        printf("Failed to listen on port %u\n", port);
+        socket_global_destroy();
+        rasterizer_destroy(&rasterizer);
+        free(vertices);
+        free(indices);
+        return 1;
+    }
+    printf("Streaming %u frames of %ux%u on port %u\n", frame_count, STREAM_SERVER_WIDTH, STREAM_SERVER_HEIGHT, port);
+    StreamServerClient client;
+    Thread client_thread = 0;
+    if (loopback) {
+        memset(&client, 0, sizeof(client));
+        client.address = address;
+        client.delayMs = client_delay;
+        client_thread = thread_create(stream_server_client_thread, &client);
+    }
+    const float clear_color[4] = {0.1f, 0.1f, 0.15f, 1.0f};
+    float aspect = (float) STREAM_SERVER_WIDTH / (float) STREAM_SERVER_HEIGHT;
+    u64 submit_time = 0;
+    int result = 0;
+    u64 next_frame = timer_get_time_ns();
+    for (u32 i = 0; i < frame_count && result == 0; i++) {
+        demo_scene_build(vertices, STREAM_SERVER_CUBE_COUNT, i, aspect);
+        rasterizer_clear(&rasterizer, clear_color, 1.0f);
+        result = rasterizer_draw(&rasterizer, vertices, indices, quad_count * 2, RASTERIZER_CULL_BACK);
+        u64 start = timer_get_time_ns();
+        frame_stream_server_submit(server, rasterizer.pixels, STREAM_SERVER_WIDTH, STREAM_SERVER_HEIGHT);
+        submit_time += timer_get_time_ns() - start;
+        next_frame += STREAM_SERVER_FRAME_INTERVAL_NS;
+        u64 now = timer_get_time_ns();
+        if (next_frame > now) {
+            thread_sleep((next_frame - now) / 1000000);
+        }
+    }
+    if (loopback && client_thread != 0) {
+        for (u32 waited = 0; waited < STREAM_LOOPBACK_TIMEOUT_MS && client.status == 0 &&
+                             atomic_load_i64(&client.lastFrameNumber, ATOMIC_ACQUIRE) < (i64) frame_count;
+             waited += 10) {
+            thread_sleep(10);
+        }
+    }
+    FrameStreamStats stats = frame_stream_server_get_stats(server);
+    frame_stream_server_destroy(server);
+    printf("Server: %llu frames submitted (%.3f ms each), %llu sent, %llu dropped, %llu tiles, %.1f MB\n",
+           (unsigned long long) stats.framesSubmitted, (double) submit_time / 1e6 / frame_count,
+           (unsigned long long) stats.framesSent, (unsigned long long) stats.framesDropped,
+           (unsigned long long) stats.tilesSent, (double) stats.bytesSent / 1e6);
+    if (loopback && client_thread != 0) {
+        usize thread_result;
+        thread_join(client_thread, &thread_result);
+        double raw_bytes = (double) client.frameCount * STREAM_SERVER_WIDTH * STREAM_SERVER_HEIGHT * 4;
+        double seconds = (double) client.elapsed / 1e9;
+        printf("Client: %llu frames, %.1f MB (%.1f%% of raw), %.1f MB/s, latency %.2f ms average, %.2f ms max\n",
+               (unsigned long long) client.frameCount, (double) client.byteCount / 1e6,
+               raw_bytes > 0.0 ? 100.0 * (double) client.byteCount / raw_bytes : 0.0,
+               seconds > 0.0 ? (double) client.byteCount / 1e6 / seconds : 0.0,
+               client.frameCount > 0 ? (double) client.latencySum / 1e6 / client.frameCount : 0.0,
+               (double) client.latencyMax / 1e6);
+        usize frame_size = (usize) STREAM_SERVER_WIDTH * STREAM_SERVER_HEIGHT * 4;
+        bool match = client.receiver.pixels != NULL && client.receiver.header.frameNumber == frame_count &&
+                     memcmp(client.receiver.pixels, rasterizer.pixels, frame_size) == 0;
+        printf("Last frame %s\n", match ? "matches" : "does not match");
+        if (!match) {
+            result = 1;
+        }
+        frame_stream_receiver_close(&client.receiver);
+    }
+    socket_global_destroy();
+    rasterizer_destroy(&rasterizer);
+    free(vertices);
+    free(indices);
+    return result != 0;
+}
+
+/*
+ * Rasterizes spinning cubes at 60 frames per second and streams them on the given port. With --loopback a client in
+ * this process receives the stream, optionally sleeping --client-delay ms per frame to act as a slow client, and
+ * checks that the last frame it reconstructed matches the rendered one.
+ */
+int main(int argc, char **argv) {
+    bool loopback = false;
+    u32 client_delay = 0;
+    u16 port = STREAM_SERVER_DEFAULT_PORT;
+    u32 frame_count = STREAM_SERVER_DEFAULT_FRAME_COUNT;
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--loopback") == 0) {
+            loopback = true;
+        } else if (strcmp(argv[i], "--client-delay") == 0 && i + 1 < argc) {
+            client_delay = strtoul(argv[++i], NULL, 10);
+        } else if (positional == 0) {
+            port = (u16) strtoul(argv[i], NULL, 10);
+            positional++;
+        } else if (positional == 1) {
+            frame_count = strtoul(argv[i], NULL, 10);
+            positional++;
+        } else {
+            positional++;
+        }
+    }
+    if (positional > 2 || port == 0 || frame_count == 0) {
+        printf("Usage: %s [--loopback] [--client-delay <ms>] [port] [frames]\n", argv[0]);
+        return 1;
+    }
+    if (job_system_init(0) != 0) {
+        printf("Failed to start job system\n");
+        return 1;
+    }
+    int result = stream_server_run(port, frame_count, loopback, client_delay);
+    job_system_destroy();
+    return result;
+}